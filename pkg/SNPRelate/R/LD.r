@@ -185,8 +185,6 @@ snpgdsLDpruning <- function(gdsobj, sample.id=NULL, snp.id=NULL,
 	stopifnot(is.na(slide.max.n) | is.numeric(slide.max.n))
 	stopifnot(is.numeric(ld.threshold) & is.finite(ld.threshold))
 	stopifnot(is.numeric(num.thread) & (num.thread>0))
-	if (num.thread > 1)
-		warning("The current version of 'snpgdsLDpruning' does not support multi processes.")
 	stopifnot(is.logical(verbose))
 
 	if (verbose)
@@ -197,6 +195,10 @@ snpgdsLDpruning <- function(gdsobj, sample.id=NULL, snp.id=NULL,
 		if (!is.finite(mn)) mn <- Inf
 		cat(sprintf("\tSliding window: %g basepairs, %g SNPs\n", bp, mn))
 		cat(sprintf("\t|LD| threshold: %g\n", ld.threshold))
+		if (num.thread <= 1)
+			cat("\tUsing", num.thread, "CPU core.\n")
+		else
+			cat("\tUsing", num.thread, "CPU cores.\n")
 	}
 
 	if (!is.finite(slide.max.bp))
@@ -314,7 +316,7 @@ snpgdsLDpruning <- function(gdsobj, sample.id=NULL, snp.id=NULL,
 			startidx <- sample(1:n.tmp, 1)
 			rv <- .C("gnrLDpruning", as.integer(startidx-1), position[flag],
 				as.integer(slide.max.bp), as.integer(slide.max.n), as.double(ld.threshold),
-				method, out_snp = logical(node$n.snp),
+				method, as.integer(num.thread), out_snp = logical(node$n.snp),
 				err = integer(1), NAOK=TRUE, PACKAGE="SNPRelate")
 			if (rv$err != 0) stop(snpgdsErrMsg())
 
@@ -30,21 +30,30 @@
 #   num.thread -- the number of threads
 #   bayesian -- if TRUE, to use Bayesian adjustment
 #   need.genmat -- if TRUE, return genetic covariance matrix
+#   use.blas -- if TRUE, use the BLAS linked with R to compute genetic covariance
+#   algorithm -- "exact" or "randomized" eigen-decomposition
+#   aux.dim -- the dimension of subspace in the randomized algorithm
+#   iter.num -- the number of iterations in the randomized algorithm
 #   verbose -- show information, if TRUE
 #
 
 snpgdsPCA <- function(gdsobj, sample.id=NULL, snp.id=NULL,
 	autosome.only=TRUE, remove.monosnp=TRUE, maf=NaN, missing.rate=NaN,
 	eigen.cnt=32, num.thread=1, bayesian=FALSE, need.genmat=FALSE, genmat.only=FALSE,
-	verbose=TRUE)
+	use.blas=FALSE, algorithm=c("exact", "randomized"), aux.dim=2*eigen.cnt,
+	iter.num=10, verbose=TRUE)
 {
 	# check
 	stopifnot(inherits(gdsobj, "gds.class"))
 	stopifnot(is.numeric(num.thread) & (num.thread>0))
 	stopifnot(is.numeric(eigen.cnt))
+	algorithm <- match.arg(algorithm)
+	stopifnot(is.numeric(aux.dim))
+	stopifnot(is.numeric(iter.num) & (iter.num>0))
 	stopifnot(is.logical(bayesian))
 	stopifnot(is.logical(need.genmat))
 	stopifnot(is.logical(genmat.only))
+	stopifnot(is.logical(use.blas))
 	stopifnot(is.logical(verbose))
 	if (genmat.only) need.genmat <- TRUE
 
@@ -110,6 +119,10 @@ snpgdsPCA <- function(gdsobj, sample.id=NULL, snp.id=NULL,
 	if (node$err != 0) stop(snpgdsErrMsg())
 
 	if (eigen.cnt <= 0) eigen.cnt <- node$n.samp
+	if (eigen.cnt > node$n.samp) eigen.cnt <- node$n.samp
+	aux.dim <- min(max(aux.dim, eigen.cnt), node$n.samp)
+	# all eigenvectors are computed by the exact algorithm
+	if (eigen.cnt >= node$n.samp) algorithm <- "exact"
 
 	# call allele freq. and missing rates
 	if (remove.monosnp || is.finite(maf) || is.finite(missing.rate))
@@ -143,8 +156,10 @@ snpgdsPCA <- function(gdsobj, sample.id=NULL, snp.id=NULL,
 
 	# call parallel PCA
 	rv <- .C("gnrPCA", as.integer(eigen.cnt), as.integer(num.thread),
-		as.logical(bayesian), as.logical(need.genmat), as.logical(genmat.only),
-		as.logical(verbose), TRUE, eigenval = double(node$n.samp),
+		as.logical(bayesian), as.logical(use.blas),
+		match(algorithm, c("exact", "randomized")) - 1L, as.integer(aux.dim),
+		as.integer(iter.num), as.logical(need.genmat),
+		as.logical(genmat.only), as.logical(verbose), TRUE, eigenval = double(node$n.samp),
 		eigenvect = matrix(NaN, nrow=node$n.samp, ncol=eigen.cnt),
 		TraceXTX = double(1),
 		genmat = switch(as.integer(need.genmat)+1, double(0),
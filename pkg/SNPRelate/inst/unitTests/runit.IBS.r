@@ -47,3 +47,153 @@ test.IBS <- function()
 	# close the file
 	closefn.gds(genofile)
 }
+
+
+
+#############################################################
+# the per-genotype computation, as a reference of the bit-plane kernels
+#
+
+.ibs.ref <- function(geno)
+{
+	# geno: a sample-by-SNP matrix of 0, 1, 2 and NA
+	V <- !is.na(geno)
+	A0 <- (V & (geno == 0)) * 1
+	A1 <- (V & (geno == 1)) * 1
+	A2 <- (V & (geno == 2)) * 1
+	V <- V * 1
+	G <- geno; G[is.na(G)] <- 0
+
+	ibs0 <- tcrossprod(A0, A2); ibs0 <- ibs0 + t(ibs0)
+	ibs1 <- tcrossprod(A1, A0 + A2); ibs1 <- ibs1 + t(ibs1)
+	ibs2 <- tcrossprod(A0) + tcrossprod(A1) + tcrossprod(A2)
+	sumsq <- ibs1 + 4*ibs0
+	het <- tcrossprod(A1, V)
+
+	# allele frequencies
+	p <- colSums(G) / (2*colSums(V))
+	f <- p * (1 - p)
+	sumf <- tcrossprod(sweep(V, 2, f, "*"), V)
+	sumf2 <- tcrossprod(sweep(V, 2, f^2, "*"), V)
+	sumgeno <- tcrossprod(G, 2*V - G); sumgeno <- sumgeno + t(sumgeno)
+
+	# KING-robust
+	king.ibs0 <- ibs0 / tcrossprod(V); diag(king.ibs0) <- 0
+	kinship <- 0.5 - sumsq / (4 * pmin(het, t(het))); diag(kinship) <- 0.5
+	kinship.fam <- 0.5 - sumsq / (2 * (het + t(het))); diag(kinship.fam) <- 0.5
+	# KING-homo
+	theta <- 0.5 - sumsq / (8 * sumf)
+	k0 <- ibs0 / (2 * sumf2)
+	k1 <- 2 - 2*k0 - 4*theta
+	diag(k0) <- diag(k1) <- 0
+	# dissimilarity
+	diss <- sumgeno / (8 * sumf)
+	diag(diss) <- 2 * diag(diss)
+
+	list(ibs0=ibs0, ibs1=ibs1, ibs2=ibs2,
+		ibs=(0.5*ibs1 + ibs2) / (ibs0 + ibs1 + ibs2),
+		king.ibs0=king.ibs0, kinship=kinship, kinship.fam=kinship.fam,
+		k0=k0, k1=k1, diss=diss)
+}
+
+
+test.IBS.missing <- function()
+{
+	# random genotypes with missing values, the number of SNPs is not a
+	#   multiple of 64
+	set.seed(1000)
+	n.samp <- 90; n.snp <- 2517
+	p <- runif(n.snp, 0.05, 0.95)
+	geno <- matrix(rbinom(n.samp*n.snp, 2, rep(p, each=n.samp)),
+		nrow=n.samp, ncol=n.snp)
+	geno[sample.int(length(geno), 0.05*length(geno))] <- NA
+	family.id <- rep(1:30, each=3)
+
+	gds.fn <- tempfile(fileext=".gds")
+	snpgdsCreateGeno(gds.fn, genmat=geno, snpfirstdim=FALSE,
+		sample.id=1:n.samp, snp.id=1:n.snp)
+	genofile <- openfn.gds(gds.fn)
+
+	for (snp.id in list(NULL, seq(1, n.snp, 3)))
+	{
+		for (nt in c(1, 3))
+		{
+			s <- sprintf("(%s SNPs, %d thread(s))",
+				ifelse(is.null(snp.id), "all", "selected"), nt)
+
+			ibs <- snpgdsIBS(genofile, snp.id=snp.id, num.thread=nt,
+				verbose=FALSE)
+			ref <- .ibs.ref(geno[, ibs$snp.id])
+			checkEquals(ibs$ibs, ref$ibs, paste("IBS", s))
+
+			ibs <- snpgdsIBSNum(genofile, snp.id=snp.id, num.thread=nt,
+				verbose=FALSE)
+			checkEquals(ibs$ibs0, ref$ibs0, paste("IBS0", s))
+			checkEquals(ibs$ibs1, ref$ibs1, paste("IBS1", s))
+			checkEquals(ibs$ibs2, ref$ibs2, paste("IBS2", s))
+
+			ibd <- snpgdsIBDKING(genofile, snp.id=snp.id, num.thread=nt,
+				type="KING-robust", verbose=FALSE)
+			ref <- .ibs.ref(geno[, ibd$snp.id])
+			checkEquals(ibd$IBS0, ref$king.ibs0, paste("KING-robust IBS0", s))
+			checkEquals(ibd$kinship, ref$kinship, paste("KING-robust", s))
+
+			ibd <- snpgdsIBDKING(genofile, snp.id=snp.id, num.thread=nt,
+				type="KING-robust", family.id=family.id, verbose=FALSE)
+			fam <- outer(family.id, family.id, "==")
+			checkEquals(ibd$kinship,
+				ifelse(fam, ref$kinship.fam, ref$kinship),
+				paste("KING-robust with families", s))
+
+			ibd <- snpgdsIBDKING(genofile, snp.id=snp.id, num.thread=nt,
+				type="KING-homo", verbose=FALSE)
+			checkEquals(ibd$k0, ref$k0, paste("KING-homo k0", s))
+			checkEquals(ibd$k1, ref$k1, paste("KING-homo k1", s))
+
+			diss <- snpgdsDiss(genofile, snp.id=snp.id, num.thread=nt,
+				verbose=FALSE)
+			ref <- .ibs.ref(geno[, diss$snp.id])
+			checkEquals(diss$diss, ref$diss, paste("Dissimilarity", s))
+		}
+	}
+
+	# close the file
+	closefn.gds(genofile)
+	unlink(gds.fn)
+}
+
+
+test.IBS.threads <- function()
+{
+	# compressed genotypes in many blocks of SNPs, which are read by a
+	#   dedicated thread when more than one thread is used
+	set.seed(1000)
+	n.samp <- 150; n.snp <- 6001
+	p <- runif(n.snp, 0.05, 0.95)
+	geno <- matrix(rbinom(n.samp*n.snp, 2, rep(p, each=n.samp)),
+		nrow=n.snp, ncol=n.samp, byrow=TRUE)
+	geno[sample.int(length(geno), 0.02*length(geno))] <- NA
+
+	gds.fn <- tempfile(fileext=".gds")
+	snpgdsCreateGeno(gds.fn, genmat=geno, sample.id=1:n.samp, snp.id=1:n.snp,
+		compress.geno="ZIP_RA")
+	genofile <- openfn.gds(gds.fn)
+
+	samp.id <- sort(sample(1:n.samp, 100))
+	ibs.1 <- snpgdsIBS(genofile, sample.id=samp.id, num.thread=1, verbose=FALSE)
+	num.1 <- snpgdsIBSNum(genofile, sample.id=samp.id, num.thread=1,
+		verbose=FALSE)
+	for (nt in c(2, 3, 4, 7))
+	{
+		ibs <- snpgdsIBS(genofile, sample.id=samp.id, num.thread=nt,
+			verbose=FALSE)
+		checkEquals(ibs, ibs.1, sprintf("IBS (%d threads vs one)", nt))
+		num <- snpgdsIBSNum(genofile, sample.id=samp.id, num.thread=nt,
+			verbose=FALSE)
+		checkEquals(num, num.1, sprintf("IBS num (%d threads vs one)", nt))
+	}
+
+	# close the file
+	closefn.gds(genofile)
+	unlink(gds.fn)
+}
@@ -0,0 +1,147 @@
+#############################################################
+#
+# DESCRIPTION: test linkage disequilibrium
+#
+
+library(RUnit)
+library(SNPRelate)
+
+
+# create a GDS file of genotypes with LD and missing values, on three
+#   chromosomes, and the number of SNPs is not a multiple of 64
+.ld.geno.file <- function(gds.fn)
+{
+	set.seed(1000)
+	n.samp <- 200; n.snp <- 301
+	geno <- matrix(0L, nrow=n.snp, ncol=n.samp)
+	geno[1, ] <- rbinom(n.samp, 2, 0.4)
+	for (i in 2:n.snp)
+	{
+		g <- geno[i-1, ]
+		k <- runif(n.samp) < 0.3
+		g[k] <- rbinom(sum(k), 2, runif(1, 0.1, 0.9))
+		geno[i, ] <- g
+	}
+	geno[sample.int(length(geno), 0.03*length(geno))] <- NA
+
+	chr <- rep(1:3, c(120, 100, 81))
+	snpgdsCreateGeno(gds.fn, genmat=geno, sample.id=1:n.samp,
+		snp.id=1:n.snp, snp.chromosome=chr,
+		snp.position=as.integer(unlist(lapply(table(chr), seq_len)) * 1000))
+	invisible()
+}
+
+.ld.methods <- c("composite", "r", "dprime", "corr")
+
+
+
+
+#############################################################
+# test functions
+#
+
+test.LDMat.threads <- function()
+{
+	gds.fn <- tempfile(fileext=".gds")
+	.ld.geno.file(gds.fn)
+	genofile <- openfn.gds(gds.fn)
+
+	for (method in .ld.methods)
+	{
+		for (slide in c(-1, 50))
+		{
+			ld.1 <- snpgdsLDMat(genofile, slide=slide, method=method,
+				num.thread=1, verbose=FALSE)
+			for (nt in c(2, 3, 4, 7))
+			{
+				ld <- snpgdsLDMat(genofile, slide=slide, method=method,
+					num.thread=nt, verbose=FALSE)
+				checkEquals(ld, ld.1, sprintf(
+					"LD matrix (%s, slide: %d, %d threads vs one)",
+					method, slide, nt))
+			}
+		}
+	}
+
+	# close the file
+	closefn.gds(genofile)
+	unlink(gds.fn)
+}
+
+
+test.LDMat.pair <- function()
+{
+	gds.fn <- tempfile(fileext=".gds")
+	.ld.geno.file(gds.fn)
+	genofile <- openfn.gds(gds.fn)
+
+	# SNP-by-sample genotypes, 3 is missing
+	geno <- read.gdsn(index.gdsn(genofile, "genotype"))
+	n <- nrow(geno); slide <- 50
+
+	# snpgdsLDpair uses the per-genotype codes, not the packed bit planes
+	for (method in .ld.methods)
+	{
+		ld <- snpgdsLDMat(genofile, slide=-1, method=method,
+			num.thread=2, verbose=FALSE)$LD
+		ld.s <- snpgdsLDMat(genofile, slide=slide, method=method,
+			num.thread=2, verbose=FALSE)$LD
+
+		ref <- matrix(1, nrow=n, ncol=n)
+		ref.s <- matrix(NaN, nrow=slide, ncol=n)
+		for (i in 1:(n-1))
+		{
+			for (j in (i+1):n)
+			{
+				v <- snpgdsLDpair(geno[i, ], geno[j, ], method=method)$ld
+				ref[i, j] <- ref[j, i] <- v
+				if (j - i <= slide) ref.s[j-i, i] <- v
+			}
+		}
+
+		checkEquals(ld, ref, sprintf("LD matrix (%s) vs snpgdsLDpair", method))
+		checkEquals(ld.s, ref.s,
+			sprintf("sliding LD matrix (%s) vs snpgdsLDpair", method))
+	}
+
+	# close the file
+	closefn.gds(genofile)
+	unlink(gds.fn)
+}
+
+
+test.LDpruning.threads <- function()
+{
+	gds.fn <- tempfile(fileext=".gds")
+	.ld.geno.file(gds.fn)
+	genofile <- openfn.gds(gds.fn)
+
+	# the whole chromosome, or a short window limited by both bp and count
+	win <- list(c(bp=500000, n=NA), c(bp=20000, n=10))
+
+	for (method in .ld.methods)
+	{
+		for (w in win)
+		{
+			for (ld.th in c(0.2, 0.5))
+			{
+				prune.1 <- snpgdsLDpruning(genofile, method=method,
+					slide.max.bp=w["bp"], slide.max.n=w["n"],
+					ld.threshold=ld.th, num.thread=1, verbose=FALSE)
+				for (nt in c(2, 3, 4, 7))
+				{
+					prune <- snpgdsLDpruning(genofile, method=method,
+						slide.max.bp=w["bp"], slide.max.n=w["n"],
+						ld.threshold=ld.th, num.thread=nt, verbose=FALSE)
+					checkEquals(prune, prune.1, sprintf(
+						"LD pruning (%s, max bp: %g, threshold: %g, %d threads vs one)",
+						method, w["bp"], ld.th, nt))
+				}
+			}
+		}
+	}
+
+	# close the file
+	closefn.gds(genofile)
+	unlink(gds.fn)
+}
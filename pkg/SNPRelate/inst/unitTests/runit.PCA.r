@@ -44,6 +44,51 @@ test.PCA <- function()
 	pca.16 <- snpgdsPCA(genofile, num.thread=16, need.genmat=TRUE)
 	checkEquals(pca.16, valid.dta, "PCA (16 cores)")
 
+	# run with BLAS
+	pca.blas <- snpgdsPCA(genofile, num.thread=2, need.genmat=TRUE, use.blas=TRUE)
+	checkEquals(pca.blas, valid.dta, "PCA (BLAS)")
+
+	# randomized eigen-decomposition, the top eigenpairs only
+	set.seed(1000)
+	pca.rnd <- snpgdsPCA(genofile, eigen.cnt=4, num.thread=2,
+		algorithm="randomized", iter.num=20)
+	checkEquals(pca.rnd$eigenval[1:4], valid.dta$eigenval[1:4],
+		tolerance=1e-4, "PCA (randomized eigenvalues)")
+	checkEquals(abs(pca.rnd$eigenvect), abs(valid.dta$eigenvect[, 1:4]),
+		tolerance=1e-3, "PCA (randomized eigenvectors)")
+
+	# close the file
+	closefn.gds(genofile)
+}
+
+
+test.PCA.threads <- function()
+{
+	# compressed genotypes in many blocks of SNPs, which are read by a
+	#   dedicated thread when more than one thread is used
+	set.seed(1000)
+	n.samp <- 150; n.snp <- 6001
+	p <- runif(n.snp, 0.05, 0.95)
+	geno <- matrix(rbinom(n.samp*n.snp, 2, rep(p, each=n.samp)),
+		nrow=n.snp, ncol=n.samp, byrow=TRUE)
+	geno[sample.int(length(geno), 0.02*length(geno))] <- NA
+
+	gds.fn <- tempfile(fileext=".gds")
+	snpgdsCreateGeno(gds.fn, genmat=geno, sample.id=1:n.samp, snp.id=1:n.snp,
+		compress.geno="ZIP_RA")
+	genofile <- openfn.gds(gds.fn)
+
+	samp.id <- sort(sample(1:n.samp, 100))
+	pca.1 <- snpgdsPCA(genofile, sample.id=samp.id, num.thread=1,
+		need.genmat=TRUE, verbose=FALSE)
+	for (nt in c(2, 3, 4, 7))
+	{
+		pca <- snpgdsPCA(genofile, sample.id=samp.id, num.thread=nt,
+			need.genmat=TRUE, verbose=FALSE)
+		checkEquals(pca, pca.1, sprintf("PCA (%d threads vs one)", nt))
+	}
+
 	# close the file
 	closefn.gds(genofile)
+	unlink(gds.fn)
 }
@@ -213,6 +213,25 @@
 #    endif
 #endif
 
+#if defined(__AVX2__)
+#    define COREARRAY_SIMD_AVX2
+#    ifndef COREARRAY_VT_SIMD
+#        define COREARRAY_VT_SIMD
+#    endif
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+#    define COREARRAY_SIMD_AVX512_VPOPCNTDQ
+#    ifndef COREARRAY_VT_SIMD
+#        define COREARRAY_VT_SIMD
+#    endif
+#endif
+
+// hardware population count
+#if defined(__POPCNT__)
+#    define COREARRAY_POPCNT
+#endif
+
 #ifdef COREARRAY_DONT_SIMD
 #  ifdef COREARRAY_VT_SIMD
 #    undef COREARRAY_VT_SIMD
@@ -220,7 +239,10 @@
 #    undef COREARRAY_SIMD_SSE2
 #    undef COREARRAY_SIMD_SSE3
 #    undef COREARRAY_SIMD_SSE4
+#    undef COREARRAY_SIMD_AVX2
+#    undef COREARRAY_SIMD_AVX512_VPOPCNTDQ
 #  endif
+#  undef COREARRAY_POPCNT
 #endif
 
 
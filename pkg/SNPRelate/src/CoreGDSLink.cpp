@@ -289,6 +289,25 @@ static TObjSuspend _WakeUp = NULL;
 bool GDSInterface::plc_WakeUp(TdThreadsSuspending obj) { return (*_WakeUp)(obj); }
 
 
+// initialize an auto-reset event object
+typedef TdThreadEvent (*TInitEvent)();
+static TInitEvent _InitEvent = NULL;
+TdThreadEvent GDSInterface::plc_InitEvent() { return (*_InitEvent)(); }
+
+// destroy the event object
+typedef bool (*TObjEvent)(TdThreadEvent obj);
+static TObjEvent _DoneEvent = NULL;
+bool GDSInterface::plc_DoneEvent(TdThreadEvent obj) { return (*_DoneEvent)(obj); }
+
+// signal the event object
+static TObjEvent _SetEvent = NULL;
+bool GDSInterface::plc_SetEvent(TdThreadEvent obj) { return (*_SetEvent)(obj); }
+
+// wait until the event object is signaled
+static TObjEvent _WaitEvent = NULL;
+bool GDSInterface::plc_WaitEvent(TdThreadEvent obj) { return (*_WaitEvent)(obj); }
+
+
 
 // ******************************************************************
 // ****	 the functions for block read
@@ -473,6 +492,10 @@ void GDSInterface::InitGDSInterface(const char *lib_fn)
 	LOAD(_DoneSuspend, TObjSuspend, "plc_DoneSuspend");
 	LOAD(_Suspend, TObjSuspend, "plc_Suspend");
 	LOAD(_WakeUp, TObjSuspend, "plc_WakeUp");
+	LOAD(_InitEvent, TInitEvent, "plc_InitEvent");
+	LOAD(_DoneEvent, TObjEvent, "plc_DoneEvent");
+	LOAD(_SetEvent, TObjEvent, "plc_SetEvent");
+	LOAD(_WaitEvent, TObjEvent, "plc_WaitEvent");
 	LOAD(_DoBaseThread, TDoBaseThread, "plc_DoBaseThread");
 
 	// ****  the functions for error messages  ****
@@ -237,6 +237,18 @@ namespace GDSInterface
 	/// wakeup the thread suspending object
 	bool plc_WakeUp(TdThreadsSuspending obj);
 
+	/// the class of auto-reset event object
+	typedef void* TdThreadEvent;
+
+	/// initialize an auto-reset event object
+	TdThreadEvent plc_InitEvent();
+	/// destroy the event object
+	bool plc_DoneEvent(TdThreadEvent obj);
+	/// signal the event object, and wake up one waiting thread
+	bool plc_SetEvent(TdThreadEvent obj);
+	/// wait until the event object is signaled, then reset it
+	bool plc_WaitEvent(TdThreadEvent obj);
+
 
 
 
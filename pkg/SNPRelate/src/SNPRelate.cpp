@@ -53,12 +53,18 @@ namespace PCA
 {
 	/// whether use Bayesian normalization
 	extern bool BayesianNormal;
+	/// whether compute the covariance matrix using the BLAS linked with R
+	extern bool CovBLAS;
 
-	void AutoDetectSNPBlockSize(int nSamp, bool Detect=true);
+	void AutoDetectSNPBlockSize(int nSamp, bool Detect=true, bool Tiled=false);
 
 	void DoCovCalculate(CdMatTri<double> &PublicCov, int NumThread, const char *Info,
 		bool verbose);
 
+	void DoRandEigenCalculate(CdMatTri<double> *Cov, int EigenCnt, double *InitQ,
+		int AuxDim, int IterNum, int NumThread, double &TraceXTX,
+		double *out_Eigenvalues, double *out_Eigenvectors, bool verbose);
+
 	void DoSNPCoeffCalculate(int EigCnt, double *EigenVect, double *out_snpcorr,
 		int NumThread, bool verbose, const char *Info);
 
@@ -185,7 +191,7 @@ namespace LD
 	void calcLD_mat(int nThread, double *out_LD);
 	void calcLD_slide_mat(int nThread, double *out_LD, int n_slide);
 	void calcLDpruning(int StartIdx, int *pos_bp, int slide_max_bp, int slide_max_n,
-		const double LD_threshold, bool *out_SNP);
+		const double LD_threshold, int nThread, bool *out_SNP);
 }
 
 namespace INBREEDING
@@ -667,6 +673,7 @@ DLLEXPORT void gnrAppendGenoSpaceStrand(PdSequenceX *Node, LongBool *snpfirstord
 
 /// to compute the eigenvalues and eigenvectors
 DLLEXPORT void gnrPCA(int *EigenCnt, int *NumThread, LongBool *_BayesianNormal,
+	LongBool *_UseBLAS, int *Algorithm, int *AuxDim, int *IterNum,
 	LongBool *NeedGenMat, LongBool *GenMat_Only, LongBool *Verbose, LongBool *DataCache,
 	double *out_Eigenvalues, double *out_Eigenvectors,
 	double *out_TraceXTX, double *out_GenMat, LongBool *out_err)
@@ -687,22 +694,46 @@ DLLEXPORT void gnrPCA(int *EigenCnt, int *NumThread, LongBool *_BayesianNormal,
 		const R_xlen_t n = MCWorkingGeno.Space.SampleNum();
 		// set parameters
 		PCA::BayesianNormal = ((*_BayesianNormal) == TRUE);
-		PCA::AutoDetectSNPBlockSize(n);
+		PCA::CovBLAS = ((*_UseBLAS) == TRUE);
+		// the randomized algorithm does not need the covariance matrix,
+		// unless it is returned
+		const bool RandEigen = (*Algorithm == 1) && !(*GenMat_Only);
+		const bool NeedCov = !RandEigen || *NeedGenMat;
+		PCA::AutoDetectSNPBlockSize(n, true, NeedCov);
 		// the upper-triangle genetic covariance matrix
-		CdMatTri<double> Cov(n);
-
-		// Calculate the genetic covariace
-		PCA::DoCovCalculate(Cov, *NumThread, "PCA:", *Verbose);
-		// Normalize
-		double TraceXTX = Cov.Trace();
-		double scale = double(n-1) / TraceXTX;
-		vt<double, av16Align>::Mul(Cov.get(), Cov.get(), scale, Cov.Size());
-		*out_TraceXTX = TraceXTX;
-		if (*NeedGenMat) Cov.SaveTo(out_GenMat);
+		CdMatTri<double> Cov(NeedCov ? n : 0);
+
+		double TraceXTX = 0;
+		if (NeedCov)
+		{
+			// Calculate the genetic covariace
+			PCA::DoCovCalculate(Cov, *NumThread, "PCA:", *Verbose);
+			// Normalize
+			TraceXTX = Cov.Trace();
+			double scale = double(n-1) / TraceXTX;
+			vt<double, av16Align>::Mul(Cov.get(), Cov.get(), scale, Cov.Size());
+			if (*NeedGenMat) Cov.SaveTo(out_GenMat);
+		}
 
 		// ******** The calculation of eigenvectors and eigenvalues ********
 
-		if (!(*GenMat_Only))
+		if (RandEigen)
+		{
+			// random starting matrix
+			const size_t size = n * (*AuxDim);
+			vector<double> InitQ(size);
+			GetRNGstate();
+			for (size_t i=0; i < size; i++) InitQ[i] = norm_rand();
+			PutRNGstate();
+
+			if (*Verbose)
+				Rprintf("PCA:\t%s\tBegin (randomized eigen-decomposition)\n", NowDateToStr().c_str());
+			PCA::DoRandEigenCalculate(NeedCov ? &Cov : NULL, *EigenCnt,
+				&InitQ[0], *AuxDim, *IterNum, *NumThread, TraceXTX,
+				out_Eigenvalues, out_Eigenvectors, *Verbose);
+			if (*Verbose)
+				Rprintf("PCA:\t%s\tEnd (randomized eigen-decomposition)\n", NowDateToStr().c_str());
+		} else if (!(*GenMat_Only))
 		{
 			const size_t NN = n;
 			auto_ptr<double> tmp_Work(new double[NN*3]);
@@ -733,6 +764,7 @@ DLLEXPORT void gnrPCA(int *EigenCnt, int *NumThread, LongBool *_BayesianNormal,
 			if (*Verbose)
 				Rprintf("PCA:\t%s\tEnd (eigenvalues and eigenvectors)\n", NowDateToStr().c_str());
 		}
+		*out_TraceXTX = TraceXTX;
 
 		// output
 		*out_err = 0;
@@ -1528,13 +1560,14 @@ DLLEXPORT void gnrLDMat(int *method, LongBool *Verbose, LongBool *DataCache,
 
 /// to compute the IBD coefficients by MLE
 DLLEXPORT void gnrLDpruning(int *StartIdx, int *pos_bp, int *slide_max_bp, int *slide_max_n,
-	double *LD_threshold, int *method, LongBool *out_SNPprune, LongBool *out_err)
+	double *LD_threshold, int *method, int *NumThread, LongBool *out_SNPprune,
+	LongBool *out_err)
 {
 	CORETRY
 		auto_ptr<bool> flag(new bool[MCWorkingGeno.Space.SNPNum()]);
 		LD::LD_Method = *method;
 		LD::calcLDpruning(*StartIdx, pos_bp, *slide_max_bp, *slide_max_n, *LD_threshold,
-			flag.get());
+			*NumThread, flag.get());
 		for (int i=0; i < MCWorkingGeno.Space.SNPNum(); i++)
 			out_SNPprune[i] = flag.get()[i];
 		// output
@@ -750,6 +750,12 @@ UInt8 *CdBufSpace::ReadPackedGeno(long idx, UInt8 *out_buf)
 	return PackGenotypes(_buf + (idx-fIdxStart)*fBufElmSize, fBufElmSize, out_buf);
 }
 
+UInt64 *CdBufSpace::ReadBitPlanes(long idx, UInt64 *out_buf)
+{
+	_RequireIdx(idx);
+	return PackBitPlanes(_buf + (idx-fIdxStart)*fBufElmSize, fBufElmSize, out_buf);
+}
+
 void CdBufSpace::_RequireIdx(long idx)
 {
 	if ((idx < 0) || (idx >= fIdxCnt))
@@ -903,6 +909,31 @@ UInt8 * GWAS::PackGenotypes(const UInt8 *src, long cnt, UInt8 *dest)
 	return dest;
 }
 
+UInt64 * GWAS::PackBitPlanes(const UInt8 *src, long cnt, UInt64 *dest)
+{
+	const long len = BitPlaneLen(cnt);
+	UInt64 *pL = dest, *pH = dest + len;
+	for (; cnt > 0; cnt -= 64)
+	{
+		long n = (cnt < 64) ? cnt : 64;
+		UInt64 L = 0, H = 0;
+		for (long k=0; k < n; k++)
+		{
+			UInt64 g = src[k] & 0x03;
+			L |= (g & 0x01) << k;
+			H |= (g >> 1) << k;
+		}
+		if (n < 64)
+		{
+			UInt64 mask = ~((UInt64(1) << n) - 1);
+			L |= mask; H |= mask;
+		}
+		*pL++ = L; *pH++ = H;
+		src += n;
+	}
+	return dest + 2*len;
+}
+
 
 // ===========================================================
 
@@ -1236,12 +1267,87 @@ void IdMatTriD::reset(int n)
 }
 
 
+// IdMatTriTile
+
+IdMatTriTile::IdMatTriTile(int n, bool diag, Int64 start, Int64 cnt,
+	int tile_size)
+{
+	fN = n; fD = diag ? 0 : 1;
+	fTile = (tile_size > 0) ? tile_size : 1;
+	fColumn = fColEnd = 0; fOffset = 0;
+	if (cnt > 0)
+	{
+		_Locate(start, fRowFirst, fColFirst);
+		_Locate(start + cnt - 1, fRowLast, fColLast);
+		fI0 = (fRowFirst / fTile) * fTile;
+	} else {
+		fRowFirst = fColFirst = 0;
+		fRowLast = fColLast = -1;
+		fI0 = 0;
+	}
+	fJ0 = fI0;
+	fRow = max(fI0, fRowFirst) - 1;
+}
+
+bool IdMatTriTile::Next()
+{
+	while (fI0 <= fRowLast)
+	{
+		// the next row in the current tile
+		fRow ++;
+		if ((fRow < fI0 + fTile) && (fRow <= fRowLast))
+		{
+			int lo = max(fJ0, fRow + fD);
+			if (fRow == fRowFirst) lo = max(lo, fColFirst);
+			int hi = min(fJ0 + fTile, fN);
+			if (fRow == fRowLast) hi = min(hi, fColLast + 1);
+			if (lo < hi)
+			{
+				fColumn = lo; fColEnd = hi;
+				fOffset = _RowStart(fRow) + (lo - fRow - fD);
+				return true;
+			}
+			continue;
+		}
+		// the next tile
+		fJ0 += fTile;
+		if (fJ0 >= fN)
+			{ fI0 += fTile; fJ0 = fI0; }
+		fRow = max(fI0, fRowFirst) - 1;
+	}
+	return false;
+}
+
+Int64 IdMatTriTile::_RowStart(int row) const
+{
+	Int64 i = row;
+	return i*(fN - fD) - i*(i-1)/2;
+}
+
+void IdMatTriTile::_Locate(Int64 offset, int &row, int &col) const
+{
+	int lo = 0, hi = fN - 1;
+	while (lo < hi)
+	{
+		int mid = (lo + hi + 1) / 2;
+		if (_RowStart(mid) <= offset)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	row = lo;
+	col = (int)(offset - _RowStart(lo)) + lo + fD;
+}
+
+
 // ===========================================================
 
 /// The number of SNPs in a block
 long GWAS::BlockSNP = 256;
 /// The number of samples in a block
 long GWAS::BlockSamp = 32;
+/// The number of samples in a tile of pairwise matrix
+long GWAS::TileSamp = 256;
 /// The mutex object for the variable "Progress" and the function "RequireWork"
 TdMutex GWAS::_Mutex = NULL;
 /// The starting point of SNP, used in the function "RequireWork"
@@ -1310,33 +1416,40 @@ CMultiCoreWorkingGeno GWAS::MCWorkingGeno;
 
 CMultiCoreWorkingGeno::CMultiCoreWorkingGeno()
 {
+	NumBuffer = 2;
 	_Mutex = NULL;
-	_Suspend = NULL;
+	_Done = NULL;
 }
 
 CMultiCoreWorkingGeno::~CMultiCoreWorkingGeno()
 {
 	if (_Mutex) plc_DoneMutex(_Mutex);
-	if (_Suspend) plc_DoneSuspend(_Suspend);
 }
 
 void CMultiCoreWorkingGeno::InitParam(bool snp_direction, bool read_snp_order, long block_size)
 {
 	if (_Mutex == NULL) _Mutex = plc_InitMutex();
-	if (_Suspend == NULL) _Suspend = plc_InitSuspend();
 
 	_SNP_Direction = snp_direction;
 	_Read_SNP_Order = read_snp_order;
 	_Block_Size = block_size;
-	if (snp_direction)
+
+	// the genotype buffers
+	size_t n = (NumBuffer > 1) ? NumBuffer : 1;
+	size_t size = block_size *
+		(snp_direction ? Space.SampleNum() : Space.SNPNum());
+	_Geno_Block.clear();
+	_Geno_Block.resize(n * size);
+	_Buffer.clear();
+	_Buffer.resize(n);
+	for (size_t i=0; i < n; i++)
 	{
-		_Geno_Block.reset(new UInt8[block_size * Space.SampleNum()]);
-		Progress.Init(Space.SNPNum());
-	} else {
-		_Geno_Block.reset(new UInt8[block_size * Space.SNPNum()]);
-		Progress.Init(Space.SampleNum());
+		_Buffer[i].Geno = &_Geno_Block[i * size];
+		_Buffer[i].Free = _Buffer[i].Full = NULL;
 	}
 
+	Progress.Init(snp_direction ? Space.SNPNum() : Space.SampleNum());
+
 	// init the internal variables
 	_Start_Position = 0;
 }
@@ -1349,104 +1462,195 @@ static void __DoThread_WorkingGeno(TdThread Thread, int ThreadIndex, void* Param
 
 void CMultiCoreWorkingGeno::Run(int nThread, TDoBlockRead do_read, TDoEachThread do_thread, void *Param)
 {
+	if (nThread < 1) nThread = 1;
 	_Num_Thread = nThread;
 	_DoRead = do_read; _DoThread = do_thread;
 	_Param = Param;
 	_If_End = false;
 	_StepCnt = 0; _StepStart = 0;
+	_Error.clear();
+
+	// initialize the events, all buffers are free
+	_Go.assign(nThread, (TdThreadEvent)NULL);
+	for (int i=1; i < nThread; i++)
+		_Go[i] = plc_InitEvent();
+	_Done = plc_InitEvent();
+	for (size_t i=0; i < _Buffer.size(); i++)
+	{
+		TGenoBuffer &B = _Buffer[i];
+		B.End = false; B.Error.clear();
+		B.Free = plc_InitEvent(); B.Full = plc_InitEvent();
+		plc_SetEvent(B.Free);
+	}
 
-	_Num_Use = _Num_Thread;
-	plc_DoBaseThread(__DoThread_WorkingGeno, this, nThread);
+	// the thread with index "nThread" is the reader if there are several buffers
+	plc_DoBaseThread(__DoThread_WorkingGeno, this,
+		(_Buffer.size() > 1) ? (nThread + 1) : nThread);
+
+	// finalize the events
+	for (int i=1; i < nThread; i++)
+		plc_DoneEvent(_Go[i]);
+	_Go.clear();
+	plc_DoneEvent(_Done); _Done = NULL;
+	for (size_t i=0; i < _Buffer.size(); i++)
+	{
+		TGenoBuffer &B = _Buffer[i];
+		plc_DoneEvent(B.Free); plc_DoneEvent(B.Full);
+		B.Free = B.Full = NULL;
+	}
+
+	if (!_Error.empty())
+		throw ErrCoreArray(_Error);
 }
 
 void CMultiCoreWorkingGeno::_DoThread_WorkingGeno(TdThread Thread, int ThreadIndex)
 {
-	// initialize ...
+	if (ThreadIndex == 0)
+		_DoMain();
+	else if (ThreadIndex < _Num_Thread)
+		_DoWorker(ThreadIndex);
+	else
+		_DoReader();
+}
+
+bool CMultiCoreWorkingGeno::_ReadBlock(TGenoBuffer &Buf)
+{
+	long Total = _SNP_Direction ? Space.SNPNum() : Space.SampleNum();
+	Buf.Start = _Start_Position;
+	Buf.Cnt = Total - _Start_Position;
+	if (Buf.Cnt <= 0) return false;
+	if (Buf.Cnt > _Block_Size) Buf.Cnt = _Block_Size;
+
+	if (_SNP_Direction)
+		Space.snpRead(Buf.Start, Buf.Cnt, Buf.Geno, _Read_SNP_Order);
+	else
+		Space.sampleRead(Buf.Start, Buf.Cnt, Buf.Geno, _Read_SNP_Order);
+	_Start_Position += Buf.Cnt;
+	return true;
+}
+
+void CMultiCoreWorkingGeno::_SetError(const char *msg)
+{
 	plc_LockMutex(_Mutex);
-	_Num_Use --;
+	if (_Error.empty()) _Error = msg;
 	plc_UnlockMutex(_Mutex);
+}
 
-	// if not main thread, suspend
-	if (ThreadIndex == 0)
-	{
-		// main thread, wait until the other threads are all suspended
-		int I;
-		do {
-			plc_LockMutex(_Mutex);
-			I = _Num_Use;
-			plc_UnlockMutex(_Mutex);
-		} while (I > 0);
-	} else {
-		plc_Suspend(_Suspend);
-	}
+void CMultiCoreWorkingGeno::_DoMain()
+{
+	const size_t nBuf = _Buffer.size();
+	bool Working = false;
 
-	// for loop
-	while (!_If_End)
-	{
-		if (ThreadIndex == 0)
+	try {
+		for (size_t k=0; ; k = (k+1) % nBuf)
 		{
-			// check no other thread is using ...
-			int I;
-			do {
-				plc_LockMutex(_Mutex);
-				I = _Num_Use;
-				plc_UnlockMutex(_Mutex);
-			} while (I > 0);
-
-			// progression information
-			{
-				long L = _Start_Position - _StepStart;
-				if (L > 0) Progress.Forward(L);
-			}
+			TGenoBuffer &B = _Buffer[k];
 
 			// reading ...
-			if (_SNP_Direction)
+			if (nBuf > 1)
 			{
-				_StepCnt = Space.SNPNum() - _Start_Position;
-				if (_StepCnt <= 0)
-					{ _If_End = true; break; }
-				if (_StepCnt > _Block_Size) _StepCnt = _Block_Size;
+				plc_WaitEvent(B.Full);
+				if (!B.Error.empty())
+					{ _SetError(B.Error.c_str()); break; }
+			} else
+				B.End = !_ReadBlock(B);
 
-				Space.snpRead(_Start_Position, _StepCnt, _Geno_Block.get(), _Read_SNP_Order);
-			} else {
-				_StepCnt = Space.SampleNum() - _Start_Position;
-				if (_StepCnt <= 0)
-					{ _If_End = true; break; }
-				if (_StepCnt > _Block_Size) _StepCnt = _Block_Size;
+			// progression information
+			if (_StepCnt > 0) Progress.Forward(_StepCnt);
+			if (B.End) break;
+
+			// handle reading, and then the buffer can be refilled
+			_StepStart = B.Start; _StepCnt = B.Cnt;
+			_DoRead(B.Geno, _StepStart, _StepCnt, _Param);
+			if (nBuf > 1) plc_SetEvent(B.Free);
 
-				Space.sampleRead(_Start_Position, _StepCnt, _Geno_Block.get(), _Read_SNP_Order);
+			// wake up other threads
+			if (_Num_Thread > 1)
+			{
+				plc_LockMutex(_Mutex);
+				_Num_Use = _Num_Thread - 1;
+				plc_UnlockMutex(_Mutex);
+				Working = true;
+				for (int i=1; i < _Num_Thread; i++)
+					plc_SetEvent(_Go[i]);
 			}
-			_StepStart = _Start_Position;
-			_Start_Position += _StepCnt;
 
-			// handle reading ...
-			_DoRead(_Geno_Block.get(), _StepStart, _StepCnt, _Param);
+			// handle each thread
+			_DoThread(0, _StepStart, _StepCnt, _Param);
 
-			// Wake up other threads
-			_Num_Use = _Num_Thread;
-			plc_WakeUp(_Suspend);
+			// wait until the other threads finish
+			if (Working)
+				{ plc_WaitEvent(_Done); Working = false; }
+			if (!_Error.empty()) break;
+		}
+	}
+	catch (std::exception &E) {
+		_SetError(E.what());
+	}
+	catch (const char *E) {
+		_SetError(E);
+	}
 
-			// handle each thread
-			_DoThread(ThreadIndex, _StepStart, _StepCnt, _Param);
+	// end ...
+	if (Working) plc_WaitEvent(_Done);
+	_If_End = true;
+	for (int i=1; i < _Num_Thread; i++)
+		plc_SetEvent(_Go[i]);
+	if (nBuf > 1)
+	{
+		for (size_t k=0; k < nBuf; k++)
+			plc_SetEvent(_Buffer[k].Free);
+	}
+}
 
-			plc_LockMutex(_Mutex);
-			_Num_Use --;
-			plc_UnlockMutex(_Mutex);
-		} else {
-			// handle each thread
+void CMultiCoreWorkingGeno::_DoWorker(int ThreadIndex)
+{
+	while (true)
+	{
+		plc_WaitEvent(_Go[ThreadIndex]);
+		if (_If_End) break;
+
+		// handle each thread
+		try {
 			_DoThread(ThreadIndex, _StepStart, _StepCnt, _Param);
-			//
-			plc_LockMutex(_Mutex);
-			_Num_Use --;
-			plc_UnlockMutex(_Mutex);
-			// Suspend immediately
-			plc_Suspend(_Suspend);
 		}
+		catch (std::exception &E) {
+			_SetError(E.what());
+		}
+		catch (const char *E) {
+			_SetError(E);
+		}
+
+		plc_LockMutex(_Mutex);
+		bool Last = ((--_Num_Use) <= 0);
+		plc_UnlockMutex(_Mutex);
+		if (Last) plc_SetEvent(_Done);
 	}
+}
 
-	// end ...
-	// if (ThreadIndex == 0)
-	plc_WakeUp(_Suspend);
+void CMultiCoreWorkingGeno::_DoReader()
+{
+	const size_t nBuf = _Buffer.size();
+	for (size_t k=0; ; k = (k+1) % nBuf)
+	{
+		TGenoBuffer &B = _Buffer[k];
+		plc_WaitEvent(B.Free);
+		if (_If_End) break;
+
+		// fill the buffer
+		B.End = true;
+		try {
+			B.End = !_ReadBlock(B);
+		}
+		catch (std::exception &E) {
+			B.Error = E.what();
+		}
+		catch (const char *E) {
+			B.Error = E;
+		}
+		plc_SetEvent(B.Full);
+		if (B.End) break;
+	}
 }
 
 void CMultiCoreWorkingGeno::SplitJobs(int nJob, int MatSize, IdMatTri outMatIdx[],
@@ -150,6 +150,7 @@ namespace GWAS
 
 		UInt8 * ReadGeno(long idx);
 		UInt8 * ReadPackedGeno(long idx, UInt8 *out_buf);
+		UInt64 * ReadBitPlanes(long idx, UInt64 *out_buf);
 
 		inline CdGenoWorkSpace &Space() { return *fSpace; }
 		inline bool ifSNP() const { return fSNPorSamp; }
@@ -218,6 +219,18 @@ namespace GWAS
 	/// four genotypes are packed into one byte
 	UInt8 *PackGenotypes(const UInt8 *src, long cnt, UInt8 *dest);
 
+	/// the number of 64-bit words in a bit plane of 'cnt' genotypes
+	inline long BitPlaneLen(long cnt) { return (cnt + 63) >> 6; }
+
+	/// genotypes are packed into two bit planes of 64-bit words
+	/** the lower bits of genotypes are stored in dest[0 .. len-1], and the
+	 *  higher bits in dest[len .. 2*len-1] with len = BitPlaneLen(cnt),
+	 *  i.e., 0 -- (0, 0), 1 -- (1, 0), 2 -- (0, 1), missing -- (1, 1);
+	 *  the unused bits in the last word are filled with missing genotypes
+	 *  \return dest + 2*len
+	**/
+	UInt64 *PackBitPlanes(const UInt8 *src, long cnt, UInt64 *dest);
+
 
 	// ===========================================================
 
@@ -335,6 +348,42 @@ namespace GWAS
 		ssize_t fOffset;
 	};
 
+	/// Iterate a range of IdMatTri or IdMatTriD in tiles
+	/** The pairs in [start, start+cnt) are visited tile by tile, each tile
+	 *  has tile_size rows and tile_size columns, so that the rows and
+	 *  columns of a tile are reused from cache. Next() returns the pairs
+	 *  (Row, Column), (Row, Column+1), ..., (Row, ColEnd-1) in a tile, and
+	 *  Offset() is the offset of (Row, Column).
+	**/
+	struct IdMatTriTile
+	{
+	public:
+		/// \param n          the dimension of matrix
+		/// \param diag       true for IdMatTri, false for IdMatTriD (without diagonal)
+		/// \param start      the offset of the first pair
+		/// \param cnt        the number of pairs
+		/// \param tile_size  the number of rows or columns in a tile
+		IdMatTriTile(int n, bool diag, Int64 start, Int64 cnt, int tile_size);
+
+		bool Next();
+
+		inline int Row() const { return fRow; }
+		inline int Column() const { return fColumn; }
+		inline int ColEnd() const { return fColEnd; }
+		inline Int64 Offset() const { return fOffset; }
+		/// the first row and column of the current tile
+		inline int TileRow() const { return fI0; }
+		inline int TileCol() const { return fJ0; }
+	private:
+		int fN, fTile, fD;
+		int fRowFirst, fColFirst, fRowLast, fColLast;
+		int fI0, fJ0, fRow, fColumn, fColEnd;
+		Int64 fOffset;
+
+		Int64 _RowStart(int row) const;
+		void _Locate(Int64 offset, int &row, int &col) const;
+	};
+
 
 	// matrix class
 
@@ -481,6 +530,8 @@ namespace GWAS
 
 	/// The number of SNPs in a block, the number of samples in a block
 	extern long BlockSNP, BlockSamp;
+	/// The number of samples in a tile of pairwise matrix, see IdMatTriTile
+	extern long TileSamp;
 	/// The mutex object for the variable "Progress" and the function "RequireWork"
 	extern TdMutex _Mutex;
 	/// The starting point of SNP, used in the function "RequireWork"
@@ -523,6 +574,9 @@ namespace GWAS
 		CdGenoWorkSpace Space;
 		/// The progression information
 		CdProgression Progress;
+		/// The number of genotype buffers, if > 1, a dedicated thread reads the next
+		/// blocks while the computing threads are working on the current block
+		int NumBuffer;
 
 		CMultiCoreWorkingGeno();
 		~CMultiCoreWorkingGeno();
@@ -538,14 +592,16 @@ namespace GWAS
 		void _DoThread_WorkingGeno(TdThread Thread, int ThreadIndex);
 
 	protected:
-		/// The genotypes will be filled in the buffer, one genotype per byte.
-		/** 0 -- BB, 1 -- AB, 2 -- AA, otherwise missing
-		 *  \param buf        the output buffer
-		 *  \param _SNPstart  output parameter, the starting SNP of block
-		 *  \param _SNPlen    output parameter, the SNP length of block
-		 *  \param SNPOrder   genotypes are stored in the SNP-major order if true,
-		 *                    genotypes are stored in the sample-major order if false
-		**/
+		/// A genotype block buffer
+		struct TGenoBuffer
+		{
+			UInt8 *Geno;         ///< the genotypes
+			long Start, Cnt;     ///< the starting position and length of block
+			bool End;            ///< true, if no block is left
+			std::string Error;   ///< the error message raised by the reader
+			TdThreadEvent Free;  ///< signaled, when the buffer can be refilled
+			TdThreadEvent Full;  ///< signaled, when the buffer has been filled
+		};
 
 		/// if TRUE perform computing SNP by SNP, otherwise sample by sample
 		bool _SNP_Direction;
@@ -555,21 +611,35 @@ namespace GWAS
 		long _Block_Size;
 		/// The starting point of SNP or sample
 		long _Start_Position;
-		/// The temparory genotype buffer
-		std::auto_ptr<UInt8> _Geno_Block;
+		/// The temparory genotype buffers
+		std::vector<UInt8> _Geno_Block;
+		std::vector<TGenoBuffer> _Buffer;
 
 		/// The mutex object
 		TdMutex _Mutex;
-		TdThreadsSuspending _Suspend;
+		/// The events to start computing, one per computing thread
+		std::vector<TdThreadEvent> _Go;
+		/// The event signaled when all other computing threads finish a block
+		TdThreadEvent _Done;
 
 		// The internal parameter
 		void *_Param;            /// The internal parameter
-		int _Num_Thread;         /// The number of threads
+		int _Num_Thread;         /// The number of computing threads
 		TDoBlockRead _DoRead;
 		TDoEachThread _DoThread;
 		int _Num_Use;
-		bool _If_End;
+		volatile bool _If_End;
 		long _StepCnt, _StepStart;
+		std::string _Error;
+
+		/// Fill the buffer with the next block, return false if no block is left
+		bool _ReadBlock(TGenoBuffer &Buf);
+		/// Record the first error message
+		void _SetError(const char *msg);
+
+		void _DoMain();
+		void _DoWorker(int ThreadIndex);
+		void _DoReader();
 	};
 
 	extern CMultiCoreWorkingGeno MCWorkingGeno;
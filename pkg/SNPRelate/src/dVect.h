@@ -39,6 +39,10 @@
 
 #include <dType.h>
 
+#ifdef COREARRAY_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
 namespace CoreArray
 {
 	namespace Vectorization
@@ -79,6 +83,63 @@ namespace CoreArray
 		};
 
 
+		// Bit Counting
+
+		/// the number of bits set in a 64-bit word
+		COREARRAY_INLINE static int PopCount64(UInt64 x)
+		{
+		#if defined(COREARRAY_POPCNT) && defined(__GNUC__)
+			return __builtin_popcountll(x);
+		#else
+			x = x - ((x >> 1) & 0x5555555555555555ULL);
+			x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+			x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+			return (int)((x * 0x0101010101010101ULL) >> 56);
+		#endif
+		}
+
+	#ifdef COREARRAY_SIMD_AVX2
+		/// the numbers of bits set in four 64-bit words
+		COREARRAY_INLINE static __m256i PopCount64x4(__m256i v)
+		{
+			const __m256i lookup = _mm256_setr_epi8(
+				0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+				0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+			const __m256i mask = _mm256_set1_epi8(0x0F);
+			__m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, mask));
+			__m256i hi = _mm256_shuffle_epi8(lookup,
+				_mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+			return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+		}
+
+		/// the sum of four 64-bit integers
+		COREARRAY_INLINE static UInt32 SumU64x4(__m256i v)
+		{
+			__m128i s = _mm_add_epi64(_mm256_castsi256_si128(v),
+				_mm256_extracti128_si256(v, 1));
+			s = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+			return (UInt32)_mm_cvtsi128_si32(s);
+		}
+	#endif
+
+		/// the index of the lowest bit set in a non-zero 64-bit word
+		COREARRAY_INLINE static int LowestBit64(UInt64 x)
+		{
+		#if defined(__GNUC__)
+			return __builtin_ctzll(x);
+		#else
+			int i = 0;
+			if (!(x & 0xFFFFFFFFULL)) { x >>= 32; i += 32; }
+			if (!(x & 0xFFFFULL)) { x >>= 16; i += 16; }
+			if (!(x & 0xFFULL)) { x >>= 8; i += 8; }
+			if (!(x & 0xFULL)) { x >>= 4; i += 4; }
+			if (!(x & 0x3ULL)) { x >>= 2; i += 2; }
+			if (!(x & 0x1ULL)) i ++;
+			return i;
+		#endif
+		}
+
+
 		// Vectorization Functions
 
 		enum TFlagVectorization { vtFPU, vtSSE, vtSSE2, vtSSE3, vtSSE4 };
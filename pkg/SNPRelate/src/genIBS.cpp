@@ -45,6 +45,9 @@
 #ifdef COREARRAY_SIMD_SSE2
 #include <emmintrin.h>
 #endif
+#if defined(COREARRAY_SIMD_AVX2) || defined(COREARRAY_SIMD_AVX512_VPOPCNTDQ)
+#include <immintrin.h>
+#endif
 
 
 #ifndef _FuncIBS_H_
@@ -62,7 +65,7 @@ namespace IBS
 	/// Packed size
 	static const long _SIZE_ = 256*256;
 
-	/// IBS
+	/// IBS (used in genIBD.cpp)
 	/// The number of IBS 0 in the packed genotype
 	UInt8 IBS0_Num_SNP[_SIZE_];
 	/// The number of IBS 1 in the packed genotype
@@ -70,25 +73,9 @@ namespace IBS
 	/// The number of IBS 2 in the packed genotype
 	UInt8 IBS2_Num_SNP[_SIZE_];
 
-	/// Genetic Distance
-	/// The distance in the packed genotype
-	UInt8 Gen_Dist_SNP[_SIZE_];
-	/// The flag of use of allele frequencies
-	UInt8 Gen_Both_Valid[_SIZE_];
-
-	/// KING robust estimator
-	/// The square value of genotype difference, (X_m^{(i)} - X_m^{(j)})^2
-	UInt8 Gen_KING_SqDiff[_SIZE_];
-	/// N1_Aa requiring both genotypes are available
-	UInt8 Gen_KING_N1_Aa[_SIZE_];
-	/// N2_Aa requiring both genotypes are available
-	UInt8 Gen_KING_N2_Aa[_SIZE_];
-	/// the number of valid loci
-	UInt8 Gen_KING_Num_Loci[_SIZE_];
-
-
-	/// The packed genotype buffer
-	auto_ptr<UInt8> GenoPacked;
+
+	/// The genotype buffer of bit planes, see PackBitPlanes()
+	TdAlignPtr<UInt64, 64> GenoBitPlane;
 	/// The allele frequencies
 	auto_ptr<double> GenoAlleleFreq;
 
@@ -175,31 +162,173 @@ namespace IBS
 			PACKED_COND((b1 < 3) && (b2 < 3) && (abs(b1-b2)==1), IBS1_Num_SNP, sum++);
 			/// The number of IBS 2 in the packed genotype
 			PACKED_COND((b1 < 3) && (b2 < 3) && (abs(b1-b2)==0), IBS2_Num_SNP, sum++);
-			
-			/// The distance in the packed genotype
-			PACKED_COND((b1 < 3) && (b2 < 3), Gen_Dist_SNP, sum += b1*(2-b2) + (2-b1)*b2);
-			PACKED_COND((b1 < 3) && (b2 < 3), Gen_Both_Valid, sum |= (1 << i));
-
-			/// \sum_m (X_m^{(i)} - X_m^{(j)})^2
-			PACKED_COND((b1 < 3) && (b2 < 3), Gen_KING_SqDiff, sum += (b1-b2)*(b1-b2));
-			PACKED_COND((b1 < 3) && (b2 < 3), Gen_KING_N1_Aa, sum += (b1==1) ? 1:0);
-			PACKED_COND((b1 < 3) && (b2 < 3), Gen_KING_N2_Aa, sum += (b2==1) ? 1:0);
-			PACKED_COND((b1 < 3) && (b2 < 3), Gen_KING_Num_Loci, sum ++);
 		}
 	} InitObj;
 
 
+	/// *********************************************************************************
+	/// **  Bit counting on the genotype bit planes  **
+	/// *********************************************************************************
+
+	/// The counts of a pair of samples on bit planes
+	/** with the lower (L) and higher (H) bits of genotypes:
+	 *    both available:  ~((L1 & H1) | (L2 & H2))
+	 *    IBS 0:           ~(L1 | L2) & (H1 ^ H2)
+	 *    IBS 2:           both available & ~((L1 ^ L2) | (H1 ^ H2))
+	 *    heterozygote:    L & ~H
+	**/
+	struct TBitCount
+	{
+		UInt32 nValid;   //< the number of loci with both genotypes available
+		UInt32 nIBS0;    //< the number of loci sharing no allele
+		UInt32 nIBS2;    //< the number of loci sharing two alleles
+		UInt32 nHet1;    //< the number of hetet loci for the first individual
+		UInt32 nHet2;    //< the number of hetet loci for the second individual
+		UInt32 nHetHet;  //< the number of loci where both are heterozygotes
+		TBitCount() { nValid = nIBS0 = nIBS2 = nHet1 = nHet2 = nHetHet = 0; }
+	};
+
+	/// Which counts are needed in TBitCount, in addition to nValid, nIBS0 and nIBS2
+	enum TBitCountMode
+	{
+		bcIBS  = 0,  //< nValid, nIBS0 and nIBS2 only
+		bcKING = 1,  //< plus nHet1 and nHet2
+		bcDiss = 2   //< plus nHetHet
+	};
+
+	/// Count IBS states of two samples, p1 and p2 are the bit planes of nw words
+	template<int Mode>
+		static void _BitCount(const UInt64 *p1, const UInt64 *p2, long nw,
+		TBitCount &out)
+	{
+		const UInt64 *L1 = p1, *H1 = p1 + nw;
+		const UInt64 *L2 = p2, *H2 = p2 + nw;
+		long i = 0;
+
+	#if defined(COREARRAY_SIMD_AVX512_VPOPCNTDQ)
+		__m512i nV=_mm512_setzero_si512(), n0=nV, n2=nV, h1=nV, h2=nV, hh=nV;
+		for (; i <= nw-8; i += 8)
+		{
+			__m512i l1 = _mm512_loadu_si512(L1+i), h_1 = _mm512_loadu_si512(H1+i);
+			__m512i l2 = _mm512_loadu_si512(L2+i), h_2 = _mm512_loadu_si512(H2+i);
+			__m512i V = _mm512_andnot_si512(_mm512_or_si512(
+				_mm512_and_si512(l1, h_1), _mm512_and_si512(l2, h_2)),
+				_mm512_set1_epi64(-1));
+			__m512i xh = _mm512_xor_si512(h_1, h_2);
+			nV = _mm512_add_epi64(nV, _mm512_popcnt_epi64(V));
+			n0 = _mm512_add_epi64(n0, _mm512_popcnt_epi64(
+				_mm512_andnot_si512(_mm512_or_si512(l1, l2), xh)));
+			n2 = _mm512_add_epi64(n2, _mm512_popcnt_epi64(_mm512_andnot_si512(
+				_mm512_or_si512(_mm512_xor_si512(l1, l2), xh), V)));
+			if (Mode == bcKING)
+			{
+				h1 = _mm512_add_epi64(h1, _mm512_popcnt_epi64(
+					_mm512_and_si512(V, _mm512_andnot_si512(h_1, l1))));
+				h2 = _mm512_add_epi64(h2, _mm512_popcnt_epi64(
+					_mm512_and_si512(V, _mm512_andnot_si512(h_2, l2))));
+			}
+			if (Mode == bcDiss)
+			{
+				hh = _mm512_add_epi64(hh, _mm512_popcnt_epi64(_mm512_andnot_si512(
+					_mm512_or_si512(h_1, h_2), _mm512_and_si512(l1, l2))));
+			}
+		}
+		out.nValid += (UInt32)_mm512_reduce_add_epi64(nV);
+		out.nIBS0 += (UInt32)_mm512_reduce_add_epi64(n0);
+		out.nIBS2 += (UInt32)_mm512_reduce_add_epi64(n2);
+		if (Mode == bcKING)
+		{
+			out.nHet1 += (UInt32)_mm512_reduce_add_epi64(h1);
+			out.nHet2 += (UInt32)_mm512_reduce_add_epi64(h2);
+		}
+		if (Mode == bcDiss)
+			out.nHetHet += (UInt32)_mm512_reduce_add_epi64(hh);
+
+	#elif defined(COREARRAY_SIMD_AVX2)
+		__m256i nV=_mm256_setzero_si256(), n0=nV, n2=nV, h1=nV, h2=nV, hh=nV;
+		for (; i <= nw-4; i += 4)
+		{
+			__m256i l1 = _mm256_loadu_si256((__m256i const*)(L1+i));
+			__m256i h_1 = _mm256_loadu_si256((__m256i const*)(H1+i));
+			__m256i l2 = _mm256_loadu_si256((__m256i const*)(L2+i));
+			__m256i h_2 = _mm256_loadu_si256((__m256i const*)(H2+i));
+			__m256i V = _mm256_andnot_si256(_mm256_or_si256(
+				_mm256_and_si256(l1, h_1), _mm256_and_si256(l2, h_2)),
+				_mm256_set1_epi64x(-1));
+			__m256i xh = _mm256_xor_si256(h_1, h_2);
+			nV = _mm256_add_epi64(nV, PopCount64x4(V));
+			n0 = _mm256_add_epi64(n0, PopCount64x4(
+				_mm256_andnot_si256(_mm256_or_si256(l1, l2), xh)));
+			n2 = _mm256_add_epi64(n2, PopCount64x4(_mm256_andnot_si256(
+				_mm256_or_si256(_mm256_xor_si256(l1, l2), xh), V)));
+			if (Mode == bcKING)
+			{
+				h1 = _mm256_add_epi64(h1, PopCount64x4(
+					_mm256_and_si256(V, _mm256_andnot_si256(h_1, l1))));
+				h2 = _mm256_add_epi64(h2, PopCount64x4(
+					_mm256_and_si256(V, _mm256_andnot_si256(h_2, l2))));
+			}
+			if (Mode == bcDiss)
+			{
+				hh = _mm256_add_epi64(hh, PopCount64x4(_mm256_andnot_si256(
+					_mm256_or_si256(h_1, h_2), _mm256_and_si256(l1, l2))));
+			}
+		}
+		out.nValid += SumU64x4(nV);
+		out.nIBS0 += SumU64x4(n0);
+		out.nIBS2 += SumU64x4(n2);
+		if (Mode == bcKING)
+		{
+			out.nHet1 += SumU64x4(h1);
+			out.nHet2 += SumU64x4(h2);
+		}
+		if (Mode == bcDiss)
+			out.nHetHet += SumU64x4(hh);
+	#endif
+
+		for (; i < nw; i++)
+		{
+			UInt64 V = ~((L1[i] & H1[i]) | (L2[i] & H2[i]));
+			UInt64 xh = H1[i] ^ H2[i];
+			out.nValid += PopCount64(V);
+			out.nIBS0 += PopCount64(~(L1[i] | L2[i]) & xh);
+			out.nIBS2 += PopCount64(V & ~((L1[i] ^ L2[i]) | xh));
+			if (Mode == bcKING)
+			{
+				out.nHet1 += PopCount64(V & L1[i] & ~H1[i]);
+				out.nHet2 += PopCount64(V & L2[i] & ~H2[i]);
+			}
+			if (Mode == bcDiss)
+				out.nHetHet += PopCount64(L1[i] & L2[i] & ~(H1[i] | H2[i]));
+		}
+	}
+
+	/// The loci with both genotypes available in the i-th word
+	inline static UInt64 _BitValid(const UInt64 *p1, const UInt64 *p2, long nw, long i)
+	{
+		return ~((p1[i] & p1[nw+i]) | (p2[i] & p2[nw+i]));
+	}
+
+
 	/// detect the effective value for BlockSNP
 	void AutoDetectSNPBlockSize(int nSamp, bool Detect=true)
 	{
+		long L2Cache = 1024*1024; // 1M
 		if (Detect)
 		{
-			long L2Cache = conf_GetL2CacheMemory();
+			L2Cache = conf_GetL2CacheMemory();
 			if (L2Cache <= 0) L2Cache = 1024*1024; // 1M
-			BlockSNP = (L2Cache - 3*256*256 - 8*1024) / nSamp * 4;
+			BlockSNP = (L2Cache - 8*1024) / nSamp * 4;
+			// a large number of samples is split into tiles instead (all
+			//   kernels here are tiled), at the cost of about 2.3KB memory
+			//   per sample for 1024 SNPs: two genotype buffers + bit planes
+			if (BlockSNP < 1024) BlockSNP = 1024;
 		}
-		BlockSNP = (BlockSNP / 4) * 4;
-		if (BlockSNP < 16) BlockSNP = 16;
+		BlockSNP = (BlockSNP / 64) * 64;
+		if (BlockSNP < 64) BlockSNP = 64;
+		// the genotypes of two tiles occupy a quarter of L2 cache
+		TileSamp = (L2Cache / 4) / (2 * (BlockSNP / 4));
+		if (TileSamp < 16) TileSamp = 16;
 	}
 
 	/// Convert the raw genotypes
@@ -208,12 +337,12 @@ namespace IBS
 		// initialize
 		const int nSamp = MCWorkingGeno.Space.SampleNum();
 		UInt8 *pG = GenoBuf;
-		UInt8 *pPack = GenoPacked.get();
+		UInt64 *pPack = GenoBitPlane.get();
 
 		// pack genotypes
 		for (long iSamp=0; iSamp < nSamp; iSamp++)
 		{
-			pPack = PackGenotypes(pG, SNP_Cnt, pPack);
+			pPack = PackBitPlanes(pG, SNP_Cnt, pPack);
 			pG += SNP_Cnt;
 		}
 	}
@@ -221,21 +350,23 @@ namespace IBS
 	/// Compute the pairwise IBS matrix for PLINK
 	static void _Do_PLINKIBS_Compute(int ThreadIndex, long Start, long SNP_Cnt, void* Param)
 	{
-		long Cnt = PLINKIBS_Thread_MatCnt[ThreadIndex];
-		IdMatTriD I = PLINKIBS_Thread_MatIdx[ThreadIndex];
-		TIBS_Flag *p = ((TIBS_Flag*)Param) + I.Offset();
-		long _PackSNPLen = (SNP_Cnt / 4) + (SNP_Cnt % 4 ? 1 : 0);
+		const long nw = BitPlaneLen(SNP_Cnt);
+		IdMatTriTile I(MCWorkingGeno.Space.SampleNum(), false,
+			PLINKIBS_Thread_MatIdx[ThreadIndex].Offset(),
+			PLINKIBS_Thread_MatCnt[ThreadIndex], TileSamp);
 
-		for (; Cnt > 0; Cnt--, ++I, p++)
+		while (I.Next())
 		{
-			UInt8 *p1 = GenoPacked.get() + I.Row()*_PackSNPLen;
-			UInt8 *p2 = GenoPacked.get() + I.Column()*_PackSNPLen;
-			for (long k=_PackSNPLen; k > 0; k--, p1++, p2++)
+			UInt64 *p1 = GenoBitPlane.get() + I.Row()*2*nw;
+			TIBS_Flag *p = ((TIBS_Flag*)Param) + I.Offset();
+			for (int j=I.Column(); j < I.ColEnd(); j++, p++)
 			{
-				size_t t = (size_t(*p1) << 8) | (*p2);
-				p->IBS0 += IBS0_Num_SNP[t];
-				p->IBS1 += IBS1_Num_SNP[t];
-				p->IBS2 += IBS2_Num_SNP[t];
+				UInt64 *p2 = GenoBitPlane.get() + j*2*nw;
+				TBitCount c;
+				_BitCount<bcIBS>(p1, p2, nw, c);
+				p->IBS0 += c.nIBS0;
+				p->IBS1 += c.nValid - c.nIBS0 - c.nIBS2;
+				p->IBS2 += c.nIBS2;
 			}
 		}
 	}
@@ -243,21 +374,23 @@ namespace IBS
 	/// Compute the pairwise IBS matrix
 	static void _Do_IBS_Compute(int ThreadIndex, long Start, long SNP_Cnt, void* Param)
 	{
-		long Cnt = IBS_Thread_MatCnt[ThreadIndex];
-		IdMatTri I = IBS_Thread_MatIdx[ThreadIndex];
-		TIBS_Flag *p = ((TIBS_Flag*)Param) + I.Offset();
-		long _PackSNPLen = (SNP_Cnt / 4) + (SNP_Cnt % 4 ? 1 : 0);
+		const long nw = BitPlaneLen(SNP_Cnt);
+		IdMatTriTile I(MCWorkingGeno.Space.SampleNum(), true,
+			IBS_Thread_MatIdx[ThreadIndex].Offset(),
+			IBS_Thread_MatCnt[ThreadIndex], TileSamp);
 
-		for (; Cnt > 0; Cnt--, ++I, p++)
+		while (I.Next())
 		{
-			UInt8 *p1 = GenoPacked.get() + I.Row()*_PackSNPLen;
-			UInt8 *p2 = GenoPacked.get() + I.Column()*_PackSNPLen;
-			for (long k=_PackSNPLen; k > 0; k--, p1++, p2++)
+			UInt64 *p1 = GenoBitPlane.get() + I.Row()*2*nw;
+			TIBS_Flag *p = ((TIBS_Flag*)Param) + I.Offset();
+			for (int j=I.Column(); j < I.ColEnd(); j++, p++)
 			{
-				size_t t = (size_t(*p1) << 8) | (*p2);
-				p->IBS0 += IBS0_Num_SNP[t];
-				p->IBS1 += IBS1_Num_SNP[t];
-				p->IBS2 += IBS2_Num_SNP[t];
+				UInt64 *p2 = GenoBitPlane.get() + j*2*nw;
+				TBitCount c;
+				_BitCount<bcIBS>(p1, p2, nw, c);
+				p->IBS0 += c.nIBS0;
+				p->IBS1 += c.nValid - c.nIBS0 - c.nIBS2;
+				p->IBS2 += c.nIBS2;
 			}
 		}
 	}
@@ -267,7 +400,7 @@ namespace IBS
 		const char *Info, bool verbose)
 	{
 		// Initialize ...
-		GenoPacked.reset(new UInt8[BlockSNP * PublicIBS.N()]);
+		GenoBitPlane.Reset(2*BitPlaneLen(BlockSNP) * PublicIBS.N());
 		memset(PublicIBS.get(), 0, sizeof(TIBS_Flag)*PublicIBS.Size());
 
 		MCWorkingGeno.Progress.Info = Info;
@@ -283,7 +416,7 @@ namespace IBS
 		const char *Info, bool verbose)
 	{
 		// Initialize ...
-		GenoPacked.reset(new UInt8[BlockSNP * PublicIBS.N()]);
+		GenoBitPlane.Reset(2*BitPlaneLen(BlockSNP) * PublicIBS.N());
 		memset(PublicIBS.get(), 0, sizeof(TIBS_Flag)*PublicIBS.Size());
 
 		MCWorkingGeno.Progress.Info = Info;
@@ -305,12 +438,12 @@ namespace IBS
 		// initialize
 		const int nSamp = MCWorkingGeno.Space.SampleNum();
 		UInt8 *pG = GenoBuf;
-		UInt8 *pPack = GenoPacked.get();
+		UInt64 *pPack = GenoBitPlane.get();
 
 		// pack genotypes
 		for (long iSamp=0; iSamp < nSamp; iSamp++)
 		{
-			pPack = PackGenotypes(pG, SNP_Cnt, pPack);
+			pPack = PackBitPlanes(pG, SNP_Cnt, pPack);
 			pG += SNP_Cnt;
 		}
 		// calculate the allele frequencies
@@ -332,43 +465,43 @@ namespace IBS
 	/// Compute IBD estimator in KING-homo
 	static void _Do_KING_Homo_Compute(int ThreadIndex, long Start, long SNP_Cnt, void* Param)
 	{
-		long Cnt = IBS_Thread_MatCnt[ThreadIndex];
-		IdMatTri I = IBS_Thread_MatIdx[ThreadIndex];
-		TKINGHomoFlag *p = ((TKINGHomoFlag*)Param) + I.Offset();
-		long _PackSNPLen = (SNP_Cnt / 4) + (SNP_Cnt % 4 ? 1 : 0);
+		const long nw = BitPlaneLen(SNP_Cnt);
+		IdMatTriTile I(MCWorkingGeno.Space.SampleNum(), true,
+			IBS_Thread_MatIdx[ThreadIndex].Offset(),
+			IBS_Thread_MatCnt[ThreadIndex], TileSamp);
 
-		for (; Cnt > 0; Cnt--, ++I, p++)
+		while (I.Next())
 		{
-			UInt8 *p1 = GenoPacked.get() + I.Row()*_PackSNPLen;
-			UInt8 *p2 = GenoPacked.get() + I.Column()*_PackSNPLen;
-			for (long k=0; k < _PackSNPLen; k++, p1++, p2++)
+			UInt64 *p1 = GenoBitPlane.get() + I.Row()*2*nw;
+			TKINGHomoFlag *p = ((TKINGHomoFlag*)Param) + I.Offset();
+			for (int j=I.Column(); j < I.ColEnd(); j++, p++)
 			{
-				size_t t = (size_t(*p1) << 8) | (*p2);
-
-				p->IBS0 += IBS0_Num_SNP[t];
-				p->SumSq += Gen_KING_SqDiff[t];
-
-				UInt8 flag = Gen_Both_Valid[t];
-				if (flag & 0x01)
-				{
-					double f = GenoAlleleFreq.get()[4*k + 0];
-					p->SumAFreq += f; p->SumAFreq2 += f*f;
-				}
-				if (flag & 0x02)
+				UInt64 *p2 = GenoBitPlane.get() + j*2*nw;
+				TBitCount c;
+				_BitCount<bcIBS>(p1, p2, nw, c);
+				// (X_m^{(i)} - X_m^{(j)})^2 is 1 for IBS 1, and 4 for IBS 0
+				p->IBS0 += c.nIBS0;
+				p->SumSq += c.nValid - c.nIBS2 + 3*c.nIBS0;
+
+				// in the order of SNPs
+				double SumAFreq = p->SumAFreq, SumAFreq2 = p->SumAFreq2;
+				for (long k=0; k < nw; k++)
 				{
-					double f = GenoAlleleFreq.get()[4*k + 1];
-					p->SumAFreq += f; p->SumAFreq2 += f*f;
-				}
-				if (flag & 0x04)
-				{
-					double f = GenoAlleleFreq.get()[4*k + 2];
-					p->SumAFreq += f; p->SumAFreq2 += f*f;
-				}
-				if (flag & 0x08)
-				{
-					double f = GenoAlleleFreq.get()[4*k + 3];
-					p->SumAFreq += f; p->SumAFreq2 += f*f;
+					const double *pF = GenoAlleleFreq.get() + (k << 6);
+					UInt64 V = _BitValid(p1, p2, nw, k);
+					if (V == ~UInt64(0))
+					{
+						for (int m=0; m < 64; m++)
+							{ double f = pF[m]; SumAFreq += f; SumAFreq2 += f*f; }
+					} else {
+						for (; V; V &= V - 1)
+						{
+							double f = pF[LowestBit64(V)];
+							SumAFreq += f; SumAFreq2 += f*f;
+						}
+					}
 				}
+				p->SumAFreq = SumAFreq; p->SumAFreq2 = SumAFreq2;
 			}
 		}
 	}
@@ -376,23 +509,25 @@ namespace IBS
 	/// Compute IBD estimator in KING-robust
 	static void _Do_KING_Robust_Compute(int ThreadIndex, long Start, long SNP_Cnt, void* Param)
 	{
-		long Cnt = IBS_Thread_MatCnt[ThreadIndex];
-		IdMatTri I = IBS_Thread_MatIdx[ThreadIndex];
-		TKINGRobustFlag *p = ((TKINGRobustFlag*)Param) + I.Offset();
-		long _PackSNPLen = (SNP_Cnt / 4) + (SNP_Cnt % 4 ? 1 : 0);
+		const long nw = BitPlaneLen(SNP_Cnt);
+		IdMatTriTile I(MCWorkingGeno.Space.SampleNum(), true,
+			IBS_Thread_MatIdx[ThreadIndex].Offset(),
+			IBS_Thread_MatCnt[ThreadIndex], TileSamp);
 
-		for (; Cnt > 0; Cnt--, ++I, p++)
+		while (I.Next())
 		{
-			UInt8 *p1 = GenoPacked.get() + I.Row()*_PackSNPLen;
-			UInt8 *p2 = GenoPacked.get() + I.Column()*_PackSNPLen;
-			for (long k=0; k < _PackSNPLen; k++, p1++, p2++)
+			UInt64 *p1 = GenoBitPlane.get() + I.Row()*2*nw;
+			TKINGRobustFlag *p = ((TKINGRobustFlag*)Param) + I.Offset();
+			for (int j=I.Column(); j < I.ColEnd(); j++, p++)
 			{
-				size_t t = (size_t(*p1) << 8) | (*p2);
-				p->IBS0 += IBS0_Num_SNP[t];
-				p->nLoci += Gen_KING_Num_Loci[t];
-				p->SumSq += Gen_KING_SqDiff[t];
-				p->N1_Aa += Gen_KING_N1_Aa[t];
-				p->N2_Aa += Gen_KING_N2_Aa[t];
+				UInt64 *p2 = GenoBitPlane.get() + j*2*nw;
+				TBitCount c;
+				_BitCount<bcKING>(p1, p2, nw, c);
+				p->IBS0 += c.nIBS0;
+				p->nLoci += c.nValid;
+				p->SumSq += c.nValid - c.nIBS2 + 3*c.nIBS0;
+				p->N1_Aa += c.nHet1;
+				p->N2_Aa += c.nHet2;
 			}
 		}
 	}
@@ -402,7 +537,7 @@ namespace IBS
 		const char *Info, bool verbose)
 	{
 		// Initialize ...
-		GenoPacked.reset(new UInt8[BlockSNP * PublicKING.N()]);
+		GenoBitPlane.Reset(2*BitPlaneLen(BlockSNP) * PublicKING.N());
 		memset(PublicKING.get(), 0, sizeof(TKINGHomoFlag)*PublicKING.Size());
 		GenoAlleleFreq.reset(new double[BlockSNP]);
 
@@ -419,7 +554,7 @@ namespace IBS
 		const char *Info, bool verbose)
 	{
 		// Initialize ...
-		GenoPacked.reset(new UInt8[BlockSNP * PublicKING.N()]);
+		GenoBitPlane.Reset(2*BitPlaneLen(BlockSNP) * PublicKING.N());
 		memset(PublicKING.get(), 0, sizeof(TKINGRobustFlag)*PublicKING.Size());
 		GenoAlleleFreq.reset(new double[BlockSNP]);
 
@@ -443,12 +578,12 @@ namespace IBS
 		// initialize
 		const int nSamp = MCWorkingGeno.Space.SampleNum();
 		UInt8 *pG = GenoBuf;
-		UInt8 *pPack = GenoPacked.get();
+		UInt64 *pPack = GenoBitPlane.get();
 
 		// pack genotypes
 		for (long iSamp=0; iSamp < nSamp; iSamp++)
 		{
-			pPack = PackGenotypes(pG, SNP_Cnt, pPack);
+			pPack = PackBitPlanes(pG, SNP_Cnt, pPack);
 			pG += SNP_Cnt;
 		}
 		// calculate the allele frequencies
@@ -470,25 +605,38 @@ namespace IBS
 	/// Compute the covariate matrix
 	static void _Do_Diss_Compute(int ThreadIndex, long Start, long SNP_Cnt, void* Param)
 	{
-		long Cnt = IBS_Thread_MatCnt[ThreadIndex];
-		IdMatTri I = IBS_Thread_MatIdx[ThreadIndex];
-		TDissflag *p = ((TDissflag*)Param) + I.Offset();
-		long _PackSNPLen = (SNP_Cnt / 4) + (SNP_Cnt % 4 ? 1 : 0);
+		const long nw = BitPlaneLen(SNP_Cnt);
+		IdMatTriTile I(MCWorkingGeno.Space.SampleNum(), true,
+			IBS_Thread_MatIdx[ThreadIndex].Offset(),
+			IBS_Thread_MatCnt[ThreadIndex], TileSamp);
 
-		for (; Cnt > 0; Cnt--, ++I, p++)
+		while (I.Next())
 		{
-			UInt8 *p1 = GenoPacked.get() + I.Row()*_PackSNPLen;
-			UInt8 *p2 = GenoPacked.get() + I.Column()*_PackSNPLen;
-			for (long k=0; k < _PackSNPLen; k++, p1++, p2++)
+			UInt64 *p1 = GenoBitPlane.get() + I.Row()*2*nw;
+			TDissflag *p = ((TDissflag*)Param) + I.Offset();
+			for (int j=I.Column(); j < I.ColEnd(); j++, p++)
 			{
-				size_t t = (size_t(*p1) << 8) | (*p2);
-				p->SumGeno += Gen_Dist_SNP[t];
-
-				UInt8 flag = Gen_Both_Valid[t];
-				if (flag & 0x01) p->SumAFreq += GenoAlleleFreq.get()[4*k];
-				if (flag & 0x02) p->SumAFreq += GenoAlleleFreq.get()[4*k+1];
-				if (flag & 0x04) p->SumAFreq += GenoAlleleFreq.get()[4*k+2];
-				if (flag & 0x08) p->SumAFreq += GenoAlleleFreq.get()[4*k+3];
+				UInt64 *p2 = GenoBitPlane.get() + j*2*nw;
+				TBitCount c;
+				_BitCount<bcDiss>(p1, p2, nw, c);
+				// g1*(2-g2) + (2-g1)*g2 is 2 for IBS 1, 4 for IBS 0 and
+				//   2 for two heterozygotes
+				p->SumGeno += 2 * (c.nValid - c.nIBS2 + c.nIBS0 + c.nHetHet);
+
+				// in the order of SNPs
+				double SumAFreq = p->SumAFreq;
+				for (long k=0; k < nw; k++)
+				{
+					const double *pF = GenoAlleleFreq.get() + (k << 6);
+					UInt64 V = _BitValid(p1, p2, nw, k);
+					if (V == ~UInt64(0))
+					{
+						for (int m=0; m < 64; m++) SumAFreq += pF[m];
+					} else {
+						for (; V; V &= V - 1) SumAFreq += pF[LowestBit64(V)];
+					}
+				}
+				p->SumAFreq = SumAFreq;
 			}
 		}
 	}
@@ -498,7 +646,7 @@ namespace IBS
 		const char *Info, bool verbose)
 	{
 		// Initialize ...
-		GenoPacked.reset(new UInt8[BlockSNP * PublicDist.N()]);
+		GenoBitPlane.Reset(2*BitPlaneLen(BlockSNP) * PublicDist.N());
 		memset(PublicDist.get(), 0, sizeof(TDissflag)*PublicDist.Size());
 		GenoAlleleFreq.reset(new double[BlockSNP]);
 
@@ -36,7 +36,6 @@
 #include <cmath>
 #include <cfloat>
 #include <memory>
-#include <list>
 #include <algorithm>
 
 
@@ -46,6 +45,9 @@
 #ifdef COREARRAY_SIMD_SSE2
 #include <emmintrin.h>
 #endif
+#ifdef COREARRAY_SIMD_AVX2
+#include <immintrin.h>
+#endif
 
 
 #ifndef _FuncLD_H_
@@ -56,6 +58,7 @@ namespace LD
 	// using namespace
 	using namespace std;
 	using namespace CoreArray;
+	using namespace CoreArray::Vectorization;
 	using namespace GDSInterface;
 	using namespace GWAS;
 
@@ -103,10 +106,10 @@ namespace LD
 	/// The number of DH (double hets)
 	UInt8 Num_DH2[_size];
 
-	/// Genotype, stored in a packed mode
-	auto_ptr<UInt8> PackedGeno;
-	/// the number of samples and snps
-	long nPackedSamp, nSNP;
+	/// Genotypes, stored in bit planes (see PackBitPlanes)
+	vector<UInt64> GenoBitPlane;
+	/// the number of 64-bit words in a bit plane, and the number of snps
+	long nBitWord, nSNP;
 
 
 	/// initial object
@@ -179,6 +182,92 @@ namespace LD
 	} InitObj;
 
 
+	// ---------------------------------------------------------------------
+	/// The genotype table of a pair of SNPs
+	/** n[g1][g2] is the number of samples with the genotype g1 (0, 1 or 2)
+	 *  at the first SNP and g2 at the second SNP, both genotypes available
+	**/
+	struct TGenoTable
+	{
+		long n[3][3];
+	};
+
+	/// Count the genotype table, p1 and p2 are the bit planes of nBitWord words
+	/** With the bit planes L and H of a SNP, the genotype is available if
+	 *  ~(L & H), 1 if L & ~H and 2 if H & ~L. The four cells of genotypes
+	 *  1 and 2 and the margins are popcounts, the others are derived.
+	**/
+	static void _GenoTable(const UInt64 *p1, const UInt64 *p2, TGenoTable &out)
+	{
+		const long nw = nBitWord;
+		const UInt64 *L1 = p1, *H1 = p1 + nw;
+		const UInt64 *L2 = p2, *H2 = p2 + nw;
+		UInt32 nV=0, nA1=0, nA2=0, nB1=0, nB2=0, n11=0, n12=0, n21=0, n22=0;
+		long i = 0;
+
+	#ifdef COREARRAY_SIMD_AVX2
+		const __m256i ones = _mm256_set1_epi64x(-1);
+		__m256i sV=_mm256_setzero_si256(), sA1=sV, sA2=sV, sB1=sV, sB2=sV,
+			s11=sV, s12=sV, s21=sV, s22=sV;
+		for (; i <= nw-4; i += 4)
+		{
+			__m256i l1 = _mm256_loadu_si256((__m256i const*)(L1+i));
+			__m256i h1 = _mm256_loadu_si256((__m256i const*)(H1+i));
+			__m256i l2 = _mm256_loadu_si256((__m256i const*)(L2+i));
+			__m256i h2 = _mm256_loadu_si256((__m256i const*)(H2+i));
+			__m256i v1 = _mm256_andnot_si256(_mm256_and_si256(l1, h1), ones);
+			__m256i v2 = _mm256_andnot_si256(_mm256_and_si256(l2, h2), ones);
+			__m256i a1 = _mm256_andnot_si256(h1, l1), a2 = _mm256_andnot_si256(l1, h1);
+			__m256i b1 = _mm256_andnot_si256(h2, l2), b2 = _mm256_andnot_si256(l2, h2);
+			sV = _mm256_add_epi64(sV, PopCount64x4(_mm256_and_si256(v1, v2)));
+			sA1 = _mm256_add_epi64(sA1, PopCount64x4(_mm256_and_si256(a1, v2)));
+			sA2 = _mm256_add_epi64(sA2, PopCount64x4(_mm256_and_si256(a2, v2)));
+			sB1 = _mm256_add_epi64(sB1, PopCount64x4(_mm256_and_si256(b1, v1)));
+			sB2 = _mm256_add_epi64(sB2, PopCount64x4(_mm256_and_si256(b2, v1)));
+			s11 = _mm256_add_epi64(s11, PopCount64x4(_mm256_and_si256(a1, b1)));
+			s12 = _mm256_add_epi64(s12, PopCount64x4(_mm256_and_si256(a1, b2)));
+			s21 = _mm256_add_epi64(s21, PopCount64x4(_mm256_and_si256(a2, b1)));
+			s22 = _mm256_add_epi64(s22, PopCount64x4(_mm256_and_si256(a2, b2)));
+		}
+		nV = SumU64x4(sV); nA1 = SumU64x4(sA1); nA2 = SumU64x4(sA2);
+		nB1 = SumU64x4(sB1); nB2 = SumU64x4(sB2);
+		n11 = SumU64x4(s11); n12 = SumU64x4(s12);
+		n21 = SumU64x4(s21); n22 = SumU64x4(s22);
+	#endif
+
+		for (; i < nw; i++)
+		{
+			UInt64 v1 = ~(L1[i] & H1[i]), v2 = ~(L2[i] & H2[i]);
+			UInt64 a1 = L1[i] & ~H1[i], a2 = H1[i] & ~L1[i];
+			UInt64 b1 = L2[i] & ~H2[i], b2 = H2[i] & ~L2[i];
+			nV += PopCount64(v1 & v2);
+			nA1 += PopCount64(a1 & v2); nA2 += PopCount64(a2 & v2);
+			nB1 += PopCount64(b1 & v1); nB2 += PopCount64(b2 & v1);
+			n11 += PopCount64(a1 & b1); n12 += PopCount64(a1 & b2);
+			n21 += PopCount64(a2 & b1); n22 += PopCount64(a2 & b2);
+		}
+
+		out.n[1][1] = n11; out.n[1][2] = n12;
+		out.n[2][1] = n21; out.n[2][2] = n22;
+		out.n[1][0] = (long)nA1 - n11 - n12;
+		out.n[2][0] = (long)nA2 - n21 - n22;
+		out.n[0][1] = (long)nB1 - n11 - n21;
+		out.n[0][2] = (long)nB2 - n12 - n22;
+		out.n[0][0] = (long)nV - nA1 - nA2 - out.n[0][1] - out.n[0][2];
+	}
+
+	/// The numbers of haplotypes from the genotype table, nDH2 -- double hets
+	inline static void _HaploCount(const TGenoTable &t, long &nA_A, long &nA_B,
+		long &nB_A, long &nB_B, long &nDH2)
+	{
+		nA_A = 2*t.n[2][2] + t.n[2][1] + t.n[1][2];
+		nA_B = 2*t.n[2][0] + t.n[2][1] + t.n[1][0];
+		nB_A = 2*t.n[0][2] + t.n[0][1] + t.n[1][2];
+		nB_B = 2*t.n[0][0] + t.n[0][1] + t.n[1][0];
+		nDH2 = 2*t.n[1][1];
+	}
+
+
 	// ---------------------------------------------------------------------
 	/// Composite LD estimation
 	static double PairComposite(const int *snp1, const int *snp2, int cnt)
@@ -219,24 +308,20 @@ namespace LD
 		}
 		return conf_F64_NaN();
 	}
-	static double PairComposite(const UInt8 *snp1, const UInt8 *snp2)
+	static double PairComposite(const UInt64 *snp1, const UInt64 *snp2)
 	{
-		// Init data
-		long n, naa, naA, nAA, nbb, nbB, nBB, nAABB, naabb, naaBB, nAAbb;
-		n = naa = naA = nAA = nbb = nbB = nBB =
-			nAABB = naabb = naaBB = nAAbb = 0;
-
-		for (long cnt=nPackedSamp; cnt > 0; cnt--, snp1++, snp2++)
-		{
-			size_t _p = (size_t(*snp1) << 8) | (*snp2);
-			size_t _q = (size_t(*snp2) << 8) | (*snp1);
-			n += Valid_Num_SNP[_p];
-			naa += Num_aa_SNP[_p]; nbb += Num_aa_SNP[_q];
-			naA += Num_aA_SNP[_p]; nbB += Num_aA_SNP[_q];
-			nAA += Num_AA_SNP[_p]; nBB += Num_AA_SNP[_q];
-			nAABB += Num_AA_BB_SNP[_p]; naabb += Num_aa_bb_SNP[_p];
-			naaBB += Num_aa_BB_SNP[_p]; nAAbb += Num_AA_bb_SNP[_p];
-		}
+		TGenoTable t;
+		_GenoTable(snp1, snp2, t);
+
+		long naa = t.n[0][0] + t.n[0][1] + t.n[0][2];
+		long naA = t.n[1][0] + t.n[1][1] + t.n[1][2];
+		long nAA = t.n[2][0] + t.n[2][1] + t.n[2][2];
+		long nbb = t.n[0][0] + t.n[1][0] + t.n[2][0];
+		long nbB = t.n[0][1] + t.n[1][1] + t.n[2][1];
+		long nBB = t.n[0][2] + t.n[1][2] + t.n[2][2];
+		long n = naa + naA + nAA;
+		long nAABB = t.n[2][2], naabb = t.n[0][0];
+		long naaBB = t.n[0][2], nAAbb = t.n[2][0];
 		if (n > 0)
 		{
 			double delta =
@@ -363,20 +448,13 @@ namespace LD
 		double D = pA_A - pA * p_A;
 		return D / sqrt(pA * p_A * pB * p_B);
 	}
-	static double PairR(const UInt8 *snp1, const UInt8 *snp2)
+	static double PairR(const UInt64 *snp1, const UInt64 *snp2)
 	{
 		// The number of haplotypes, nDH - double hets
 		long nA_A, nA_B, nB_A, nB_B, nDH2;
-		nA_A = nA_B = nB_A = nB_B = nDH2 = 0;
-
-		// Calculate the numbers of haplotypes
-		for (long cnt=nPackedSamp; cnt > 0; cnt--, snp1++, snp2++)
-		{
-			size_t _p = (size_t(*snp1) << 8) | (*snp2);
-			nA_A += Num_A_A[_p]; nA_B += Num_A_B[_p];
-			nB_A += Num_B_A[_p]; nB_B += Num_B_B[_p];
-			nDH2 += Num_DH2[_p];
-		}
+		TGenoTable t;
+		_GenoTable(snp1, snp2, t);
+		_HaploCount(t, nA_A, nA_B, nB_A, nB_B, nDH2);
 
 		double pA_A, pA_B, pB_A, pB_B;
 		ProportionHaplo(nA_A, nA_B, nB_A, nB_B, nDH2, pA_A, pA_B, pB_A, pB_B);
@@ -420,20 +498,13 @@ namespace LD
 		D = D / ((D>=0) ? min(pA*p_B, pB*p_A) : max(-pA*p_A, -pB*p_B));
 		return D;
 	}
-	static double PairDPrime(const UInt8 *snp1, const UInt8 *snp2)
+	static double PairDPrime(const UInt64 *snp1, const UInt64 *snp2)
 	{
 		// The number of haplotypes, nDH - double hets
 		long nA_A, nA_B, nB_A, nB_B, nDH2;
-		nA_A = nA_B = nB_A = nB_B = nDH2 = 0;
-
-		// Calculate the numbers of haplotypes
-		for (long cnt=nPackedSamp; cnt > 0; cnt--, snp1++, snp2++)
-		{
-			size_t _p = (size_t(*snp1) << 8) | (*snp2);
-			nA_A += Num_A_A[_p]; nA_B += Num_A_B[_p];
-			nB_A += Num_B_A[_p]; nB_B += Num_B_B[_p];
-			nDH2 += Num_DH2[_p];
-		}
+		TGenoTable t;
+		_GenoTable(snp1, snp2, t);
+		_HaploCount(t, nA_A, nA_B, nB_A, nB_B, nDH2);
 
 		double pA_A, pA_B, pB_A, pB_B;
 		ProportionHaplo(nA_A, nA_B, nB_A, nB_B, nDH2, pA_A, pA_B, pB_A, pB_B);
@@ -478,22 +549,19 @@ namespace LD
 		}
 		return conf_F64_NaN();
 	}
-	static double PairCorr(const UInt8 *snp1, const UInt8 *snp2)
+	static double PairCorr(const UInt64 *snp1, const UInt64 *snp2)
 	{
-		// Init data
-		long n, X, XX, Y, YY, XY;
-		n = X = XX = Y = YY = XY = 0;
-
-		// Calculate the numbers of haplotypes
-		for (long cnt=nPackedSamp; cnt > 0; cnt--, snp1++, snp2++)
-		{
-			size_t _p = (size_t(*snp1) << 8) | (*snp2);
-			size_t _q = (size_t(*snp2) << 8) | (*snp1);
-			n += Valid_Num_SNP[_p];
-			X += Sum_X_SNP[_p]; Y += Sum_X_SNP[_q];
-			XX += Sum_X_2_SNP[_p]; YY += Sum_X_2_SNP[_q];
-			XY += Sum_XY_SNP[_p];
-		}
+		TGenoTable t;
+		_GenoTable(snp1, snp2, t);
+
+		long n1 = t.n[1][0] + t.n[1][1] + t.n[1][2];
+		long n2 = t.n[2][0] + t.n[2][1] + t.n[2][2];
+		long m1 = t.n[0][1] + t.n[1][1] + t.n[2][1];
+		long m2 = t.n[0][2] + t.n[1][2] + t.n[2][2];
+		long n = t.n[0][0] + t.n[0][1] + t.n[0][2] + n1 + n2;
+		long X = n1 + 2*n2, XX = n1 + 4*n2;
+		long Y = m1 + 2*m2, YY = m1 + 4*m2;
+		long XY = t.n[1][1] + 2*(t.n[1][2] + t.n[2][1]) + 4*t.n[2][2];
 		if (n > 0)
 		{
 			double c1 = XX - double(X)*X/n;
@@ -520,28 +588,27 @@ namespace LD
 	// 4 -- "corr"       Correlation coefficient (BB, AB, AA are codes as 0, 1, 2)
 	int LD_Method = 1;
 
-	/// initialize the variable "Geno" with packed genotypes
+	/// initialize the variable "GenoBitPlane" with the genotypes of all SNPs
 	void InitPackedGeno()
 	{
 		// set # of samples and snps
 		nSNP = MCWorkingGeno.Space.SNPNum();
-		nPackedSamp = (MCWorkingGeno.Space.SampleNum() % 4 > 0) ?
-			(MCWorkingGeno.Space.SampleNum()/4 + 1) : (MCWorkingGeno.Space.SampleNum()/4);
-		PackedGeno.reset(new UInt8[nPackedSamp*nSNP]);
+		nBitWord = BitPlaneLen(MCWorkingGeno.Space.SampleNum());
+		GenoBitPlane.resize(2*nBitWord*nSNP);
 
 		// buffer
 		CdBufSpace Buf(MCWorkingGeno.Space, true, CdBufSpace::acInc);
-		UInt8 *p = PackedGeno.get();
+		UInt64 *p = &GenoBitPlane[0];
 		for (long i=0; i < MCWorkingGeno.Space.SNPNum(); i++)
 		{
-			p = Buf.ReadPackedGeno(i, p);
+			p = Buf.ReadBitPlanes(i, p);
 		}
 	}
 
-	/// destroy the variable "Geno" with packed genotypes
+	/// destroy the variable "GenoBitPlane"
 	void DonePackedGeno()
 	{
-		PackedGeno.reset(NULL);
+		vector<UInt64>().swap(GenoBitPlane);
 	}
 
 
@@ -563,60 +630,130 @@ namespace LD
 		return conf_F64_NaN();
 	}
 
-	// to compute LD matrix (n x n)
-	void calcLD_mat(int nThread, double *out_LD)
+	// to compute pair LD
+	static double _CalcLD(const UInt64 *snp1, const UInt64 *snp2)
 	{
-		for (int i=0; i < nSNP; i++)
+		switch (LD_Method)
 		{
-			out_LD[i*nSNP+i] = 1;
-			for (int j=i+1; j < nSNP; j++)
+			case 1:
+				return PairComposite(snp1, snp2);
+			case 2:
+				return PairR(snp1, snp2);
+			case 3:
+				return PairDPrime(snp1, snp2);
+			case 4:
+				return PairCorr(snp1, snp2);
+		}
+		return conf_F64_NaN();
+	}
+
+
+	// ---------------------------------------------------------------------
+	// LD matrix
+
+	/// the maximum number of threads
+	const int N_MAX_THREAD = 256;
+	/// the pairs of SNPs in the LD matrix assigned to each thread
+	IdMatTriD LD_Thread_MatIdx[N_MAX_THREAD];
+	Int64 LD_Thread_MatCnt[N_MAX_THREAD];
+	/// the rows of the sliding LD matrix assigned to each thread
+	int LD_Thread_Row[N_MAX_THREAD + 1];
+
+	/// the output LD matrix
+	static double *LD_Out = NULL;
+	/// the size of sliding window
+	static int LD_Slide = 0;
+	/// the number of SNPs in a tile of LD matrix
+	static int LD_Tile = 256;
+
+	/// the number of threads used
+	static int _LD_NumThread(int nThread)
+	{
+		#ifdef COREARRAY_NO_MULTICORE
+			nThread = 1;
+		#endif
+		if (nThread < 1) nThread = 1;
+		if (nThread > N_MAX_THREAD) nThread = N_MAX_THREAD;
+		return nThread;
+	}
+
+	/// the packed genotypes of two tiles occupy a half of L2 cache
+	static void _LD_InitTile()
+	{
+		long L2Cache = conf_GetL2CacheMemory();
+		if (L2Cache <= 0) L2Cache = 1024*1024; // 1M
+		LD_Tile = (L2Cache / 2) / (2 * sizeof(UInt64) * 2 * nBitWord);
+		if (LD_Tile < 16) LD_Tile = 16;
+	}
+
+	/// the thread entry for the LD matrix, the upper triangle tile by tile
+	static void Entry_LD_Mat(TdThread Thread, int ThreadIndex, void *Param)
+	{
+		IdMatTriTile I(nSNP, false, LD_Thread_MatIdx[ThreadIndex].Offset(),
+			LD_Thread_MatCnt[ThreadIndex], LD_Tile);
+		while (I.Next())
+		{
+			const size_t i = I.Row();
+			const UInt64 *s1 = &GenoBitPlane[i*2*nBitWord];
+			double *p = LD_Out + i*nSNP;
+			for (size_t j=I.Column(); j < (size_t)I.ColEnd(); j++)
 			{
-				double &p1 = out_LD[i*nSNP+j], &p2 = out_LD[j*nSNP+i];
-				UInt8 *s1 = PackedGeno.get() + i*nPackedSamp;
-				UInt8 *s2 = PackedGeno.get() + j*nPackedSamp;
-				switch (LD_Method)
-				{
-					case 1:
-						p1 = p2 = PairComposite(s1, s2); break;
-					case 2:
-						p1 = p2 = PairR(s1, s2); break;
-					case 3:
-						p1 = p2 = PairDPrime(s1, s2); break;
-					case 4:
-						p1 = p2 = PairCorr(s1, s2); break;
-					default:
-						p1 = p2 = conf_F64_NaN();
-				}
+				p[j] = LD_Out[j*nSNP + i] =
+					_CalcLD(s1, &GenoBitPlane[j*2*nBitWord]);
 			}
 		}
 	}
 
+	/// the thread entry for the sliding LD matrix, a range of rows
+	static void Entry_LD_SlideMat(TdThread Thread, int ThreadIndex, void *Param)
+	{
+		const int n = nSNP;
+		for (int i=LD_Thread_Row[ThreadIndex]; i < LD_Thread_Row[ThreadIndex+1]; i++)
+		{
+			const UInt64 *s1 = &GenoBitPlane[(size_t)i*2*nBitWord];
+			double *p = LD_Out + (size_t)i*LD_Slide;
+			for (int j=i+1; (j < n) && ((j-i) <= LD_Slide); j++)
+				p[j-i-1] = _CalcLD(s1, &GenoBitPlane[(size_t)j*2*nBitWord]);
+		}
+	}
+
+	// to compute LD matrix (n x n)
+	void calcLD_mat(int nThread, double *out_LD)
+	{
+		for (long i=0; i < nSNP; i++)
+			out_LD[i*nSNP + i] = 1;
+		if (nSNP <= 1) return;
+
+		nThread = _LD_NumThread(nThread);
+		_LD_InitTile();
+		LD_Out = out_LD;
+		MCWorkingGeno.SplitJobs(nThread, nSNP, LD_Thread_MatIdx, LD_Thread_MatCnt);
+		plc_DoBaseThread(Entry_LD_Mat, NULL, nThread);
+	}
+
 	// to compute LD matrix (n_slide x n)
 	void calcLD_slide_mat(int nThread, double *out_LD, int n_slide)
 	{
-		for (int i=0; i < nSNP; i++)
+		// split the rows, balancing the number of pairs (shorter rows at the end)
+		nThread = _LD_NumThread(nThread);
+		const int n = nSNP;
+		Int64 Total = 0;
+		for (int i=0; i < n; i++)
+			Total += min(n_slide, n - 1 - i);
+		LD_Thread_Row[0] = 0;
+		Int64 Sum = 0;
+		int i = 0;
+		for (int k=1; k < nThread; k++)
 		{
-			for (int j=i+1; (j < nSNP) && ((j-i) <= n_slide); j++)
-			{
-				int d = j - i - 1;
-				double &pVal = out_LD[i*n_slide + d];				
-				UInt8 *s1 = PackedGeno.get() + i*nPackedSamp;
-				UInt8 *s2 = PackedGeno.get() + j*nPackedSamp;
-				switch (LD_Method)
-				{
-					case 1:
-						pVal = PairComposite(s1, s2); break;
-					case 2:
-						pVal = PairR(s1, s2); break;
-					case 3:
-						pVal = PairDPrime(s1, s2); break;
-					case 4:
-						pVal = PairCorr(s1, s2); break;
-					default:
-						pVal = conf_F64_NaN();
-				}
-			}
+			const Int64 Goal = (Int64)((double)Total * k / nThread + 0.5);
+			for (; (i < n) && (Sum < Goal); i++)
+				Sum += min(n_slide, n - 1 - i);
+			LD_Thread_Row[k] = i;
 		}
+		LD_Thread_Row[nThread] = n;
+
+		LD_Out = out_LD; LD_Slide = n_slide;
+		plc_DoBaseThread(Entry_LD_SlideMat, NULL, nThread);
 	}
 
 
@@ -624,136 +761,360 @@ namespace LD
 	// ---------------------------------------------------------------------
 	// to prune SNPs
 
-	struct TSNP
+	/// The retained SNPs in the sliding window
+	/** The genotypes (bit planes) are stored in a ring buffer, and the k-th
+	 *  SNP is in the slot (fHead + k) % fCap.
+	**/
+	class CPruneWindow
 	{
-		int idx, pos_bp;
-		vector<UInt8> genobuf;
-		TSNP(int n=0): genobuf(n) {}
-		TSNP(int _idx, int _pos, int n=0): genobuf(n) { idx = _idx; pos_bp = _pos; }
+	public:
+		CPruneWindow(long nGenoWord)
+			{ fGenoWord = nGenoWord; fHead = fCnt = fCap = 0; }
+
+		inline int Count() const { return fCnt; }
+		inline int Idx(int k) const { return fIdx[_Slot(k)]; }
+		inline int Pos(int k) const { return fPos[_Slot(k)]; }
+		inline const UInt64 *Geno(int k) const
+			{ return &fGeno[(size_t)_Slot(k) * fGenoWord]; }
+
+		/// append a SNP, and return the buffer of its genotypes
+		UInt64 *Push(int idx, int pos)
+		{
+			if (fCnt >= fCap) _Grow();
+			const int s = _Slot(fCnt++);
+			fIdx[s] = idx; fPos[s] = pos;
+			return &fGeno[(size_t)s * fGenoWord];
+		}
+
+		/// remove the k-th SNP if dead[k] is true, keeping the order
+		void Remove(const vector<char> &dead)
+		{
+			// the SNPs at the front leave the ring without copying
+			int p = 0;
+			while ((p < fCnt) && dead[p]) p++;
+			if (p > 0)
+			{
+				fHead = _Slot(p); fCnt -= p;
+			}
+			int m = 0;
+			for (int k=0; k < fCnt; k++)
+			{
+				if (dead[p + k]) continue;
+				if (m < k) _Copy(k, m);
+				m ++;
+			}
+			fCnt = m;
+		}
+
+		void Clear() { fHead = fCnt = 0; }
+
+	private:
+		vector<UInt64> fGeno;
+		vector<int> fIdx, fPos;
+		long fGenoWord;
+		int fHead, fCnt, fCap;
+
+		inline int _Slot(int k) const
+			{ int s = fHead + k; return (s < fCap) ? s : (s - fCap); }
+
+		void _Copy(int src, int dst)
+		{
+			const int s = _Slot(src), d = _Slot(dst);
+			fIdx[d] = fIdx[s]; fPos[d] = fPos[s];
+			memcpy(&fGeno[(size_t)d * fGenoWord], &fGeno[(size_t)s * fGenoWord],
+				sizeof(UInt64) * fGenoWord);
+		}
+
+		void _Grow()
+		{
+			const int Cap = (fCap > 0) ? (2*fCap) : 64;
+			vector<UInt64> G((size_t)Cap * fGenoWord);
+			vector<int> I(Cap), P(Cap);
+			for (int k=0; k < fCnt; k++)
+			{
+				const int s = _Slot(k);
+				I[k] = fIdx[s]; P[k] = fPos[s];
+				memcpy(&G[(size_t)k * fGenoWord], &fGeno[(size_t)s * fGenoWord],
+					sizeof(UInt64) * fGenoWord);
+			}
+			fGeno.swap(G); fIdx.swap(I); fPos.swap(P);
+			fHead = 0; fCap = Cap;
+		}
 	};
 
-	// to compute pair LD
-	static double _CalcLD(const UInt8 *snp1, const UInt8 *snp2)
+
+	/// the parameters of LD pruning
+	static int Prune_MaxBP, Prune_MaxN;
+	static double Prune_Threshold;
+	static const int *Prune_PosBP = NULL;
+	/// the retained SNPs in the sliding window
+	static CPruneWindow *Prune_Win = NULL;
+	/// a batch of candidate SNPs, their indices and genotypes
+	static vector<int> Prune_BatchIdx;
+	static vector<UInt64> Prune_BatchGeno;
+	static int Prune_BatchCnt = 0;
+	/// the first candidate in the batch out of the window of a retained SNP
+	static vector<int> Prune_DeadAt;
+	/// whether a candidate fails the LD test with the retained SNPs
+	static vector<char> Prune_Fail;
+	/// the next candidate in the batch to be tested
+	static int Prune_Next = 0;
+
+	/// the threads testing a batch of candidates
+	static int Prune_NumThread = 1;
+	static TdThreadEvent Prune_Go[N_MAX_THREAD];
+	static TdThreadEvent Prune_Done = NULL;
+	static TdMutex Prune_Mutex = NULL;
+	static int Prune_NumUse = 0;
+	static volatile bool Prune_End = false;
+	static string Prune_Error;
+
+	/// whether the SNP (idx, pos) is in the sliding window of the SNP i
+	inline static bool _InWindow(int i, int idx, int pos)
 	{
-		switch (LD_Method)
+		return (abs(i - idx) <= Prune_MaxN) &&
+			(abs(Prune_PosBP[i] - pos) <= Prune_MaxBP);
+	}
+
+	/// test the candidates with the retained SNPs, until no candidate left
+	static void _PruneTestWindow()
+	{
+		const long nw = 2*nBitWord;
+		const CPruneWindow &W = *Prune_Win;
+		while (true)
 		{
-			case 1:
-				return PairComposite(snp1, snp2);
-			case 2:
-				return PairR(snp1, snp2);
-			case 3:
-				return PairDPrime(snp1, snp2);
-			case 4:
-				return PairCorr(snp1, snp2);
+			int b;
+			if (Prune_NumThread > 1)
+			{
+				TdAutoMutex _m(Prune_Mutex);
+				b = Prune_Next ++;
+			} else
+				b = Prune_Next ++;
+			if (b >= Prune_BatchCnt) break;
+
+			// the recently retained SNPs first, stop at the first failing pair
+			const UInt64 *g = &Prune_BatchGeno[b * nw];
+			bool fail = false;
+			for (int k=W.Count()-1; k >= 0; k--)
+			{
+				if (Prune_DeadAt[k] <= b) continue;
+				if (!(fabs(_CalcLD(W.Geno(k), g)) <= Prune_Threshold))
+					{ fail = true; break; }
+			}
+			Prune_Fail[b] = fail;
 		}
-		return conf_F64_NaN();
 	}
 
-	void calcLDpruning(int StartIdx, int *pos_bp, int slide_max_bp, int slide_max_n,
-		const double LD_threshold, bool *out_SNP)
+	/// test a batch of candidates with the retained SNPs, in parallel
+	static void _PruneTestBatch()
 	{
-		// initial variables
-		nPackedSamp = (MCWorkingGeno.Space.SampleNum() % 4 > 0) ?
-			(MCWorkingGeno.Space.SampleNum()/4 + 1) : (MCWorkingGeno.Space.SampleNum()/4);
-		list<TSNP> ListGeno;
-		out_SNP[StartIdx] = true;
-		auto_ptr<UInt8> buf(new UInt8[nPackedSamp]);
+		Prune_Next = 0;
+		// waking up the threads only if there is enough work
+		if ((Prune_NumThread > 1) && ((Int64)Prune_BatchCnt *
+			Prune_Win->Count() * nBitWord >= 65536))
+		{
+			plc_LockMutex(Prune_Mutex);
+			Prune_NumUse = Prune_NumThread - 1;
+			plc_UnlockMutex(Prune_Mutex);
+			for (int i=1; i < Prune_NumThread; i++)
+				plc_SetEvent(Prune_Go[i]);
+			_PruneTestWindow();
+			plc_WaitEvent(Prune_Done);
+		} else
+			_PruneTestWindow();
+	}
 
-		// -----------------------------------------------------
-		// increasing searching
+	/// LD pruning with the candidates Start, Start+Step, ..., until End (exclusive)
+	static void _PruneSweep(CdBufSpace &Buf, int Start, int End, int Step,
+		bool *out_SNP)
+	{
+		const long nw = 2*nBitWord;
+		const int BatchSize = Prune_BatchIdx.size();
+		CPruneWindow &W = *Prune_Win;
+		// the retained candidates in the current batch, still in the window
+		vector<int> Kept;
+		vector<char> Dead;
+
+		for (int i=Start; i != End; )
+		{
+			// load a batch of candidates
+			int n = 0;
+			for (; (n < BatchSize) && (i != End); n++, i += Step)
+			{
+				Prune_BatchIdx[n] = i;
+				Buf.ReadBitPlanes(i, &Prune_BatchGeno[n * nw]);
+			}
+			Prune_BatchCnt = n;
 
-		CdBufSpace BufSNP(MCWorkingGeno.Space, true, CdBufSpace::acInc);
-		ListGeno.push_back(TSNP(StartIdx, pos_bp[StartIdx], nPackedSamp));
-		BufSNP.ReadPackedGeno(StartIdx, &(ListGeno.back().genobuf[0]));
+			// when the retained SNPs leave the sliding window
+			Prune_DeadAt.resize(W.Count());
+			for (int k=0; k < W.Count(); k++)
+			{
+				const int idx = W.Idx(k), pos = W.Pos(k);
+				int b = 0;
+				while ((b < n) && _InWindow(Prune_BatchIdx[b], idx, pos)) b++;
+				Prune_DeadAt[k] = b;
+			}
 
-		// for-loop, increasing
-		for (int i=StartIdx+1; i < MCWorkingGeno.Space.SNPNum(); i++)
-		{
-			// load genotypes
-			BufSNP.ReadPackedGeno(i, buf.get());
-			// detect LD
-			int TotalCnt = 0, ValidCnt = 0;
-			list<TSNP>::iterator it;
-			for (it=ListGeno.begin(); it != ListGeno.end(); TotalCnt++)
+			// test the candidates with the retained SNPs
+			_PruneTestBatch();
+
+			// test the candidates with the retained candidates in the batch
+			Kept.clear();
+			for (int b=0; b < n; b++)
 			{
-				// check whether it is in the sliding window
-				if ((abs(i - it->idx) <= slide_max_n) &&
-					(abs(pos_bp[i] - it->pos_bp) <= slide_max_bp))
+				const int idx = Prune_BatchIdx[b];
+				size_t m = 0;
+				for (size_t k=0; k < Kept.size(); k++)
 				{
-					if (fabs(_CalcLD(&(it->genobuf[0]), buf.get())) <= LD_threshold)
-						ValidCnt ++;
-					it++;
-				} else {
-					ValidCnt ++;
-					// delete it
-					list<TSNP>::iterator tmp_it = it;
-					it++;
-					ListGeno.erase(tmp_it);
+					const int c = Prune_BatchIdx[Kept[k]];
+					if (_InWindow(idx, c, Prune_PosBP[c]))
+						Kept[m++] = Kept[k];
 				}
+				Kept.resize(m);
+
+				bool ok = !Prune_Fail[b];
+				const UInt64 *g = &Prune_BatchGeno[b * nw];
+				for (size_t k=Kept.size(); ok && (k > 0); k--)
+				{
+					ok = (fabs(_CalcLD(&Prune_BatchGeno[Kept[k-1] * nw], g)) <=
+						Prune_Threshold);
+				}
+				out_SNP[idx] = ok;
+				if (ok) Kept.push_back(b);
 			}
-			// handle
-			out_SNP[i] = (ValidCnt == TotalCnt);
-			if (out_SNP[i])
+
+			// update the sliding window
+			Dead.resize(W.Count());
+			for (int k=0; k < W.Count(); k++)
+				Dead[k] = (Prune_DeadAt[k] < n);
+			W.Remove(Dead);
+			for (size_t k=0; k < Kept.size(); k++)
 			{
-				ListGeno.push_back(TSNP(i, pos_bp[i], nPackedSamp));
-				memmove(&(ListGeno.back().genobuf[0]), buf.get(), nPackedSamp);
+				const int c = Prune_BatchIdx[Kept[k]];
+				memcpy(W.Push(c, Prune_PosBP[c]), &Prune_BatchGeno[Kept[k] * nw],
+					sizeof(UInt64) * nw);
 			}
 		}
+	}
+
+	/// the increasing and decreasing searching from StartIdx
+	static void _PruneMain(int StartIdx, bool *out_SNP)
+	{
+		CPruneWindow &W = *Prune_Win;
+		const int nSNP = MCWorkingGeno.Space.SNPNum();
+
+		// -----------------------------------------------------
+		// increasing searching
+
+		CdBufSpace BufSNP(MCWorkingGeno.Space, true, CdBufSpace::acInc);
+		BufSNP.ReadBitPlanes(StartIdx, W.Push(StartIdx, Prune_PosBP[StartIdx]));
+		_PruneSweep(BufSNP, StartIdx+1, nSNP, 1, out_SNP);
 
 		// -----------------------------------------------------
 		// decreasing searching
 
-		ListGeno.clear();
-		for (int i=StartIdx; i < MCWorkingGeno.Space.SNPNum(); i++)
+		W.Clear();
+		for (int i=StartIdx; i < nSNP; i++)
 		{
 			if (out_SNP[i])
 			{
 				// check whether it is in the sliding window
-				if ((abs(i - StartIdx) <= slide_max_n) &&
-					(abs(pos_bp[i] - pos_bp[StartIdx]) <= slide_max_bp))
-				{
-					ListGeno.push_back(TSNP(i, pos_bp[i], nPackedSamp));
-					BufSNP.ReadPackedGeno(i, &(ListGeno.back().genobuf[0]));
-				} else
+				if (_InWindow(StartIdx, i, Prune_PosBP[i]))
+					BufSNP.ReadBitPlanes(i, W.Push(i, Prune_PosBP[i]));
+				else
 					break;
 			}
 		}
 
 		BufSNP.SetAccessFlag(CdBufSpace::acDec);
-		// for-loop, descreasing
-		for (int i=StartIdx-1; i >= 0; i--)
+		_PruneSweep(BufSNP, StartIdx-1, -1, -1, out_SNP);
+	}
+
+	struct TPruneParam
+	{
+		int StartIdx;
+		bool *out_SNP;
+	};
+
+	/// the thread entry for LD pruning, the thread 0 is the main sweep
+	static void Entry_LDPrune(TdThread Thread, int ThreadIndex, void *Param)
+	{
+		if (ThreadIndex == 0)
 		{
-			// load genotypes
-			BufSNP.ReadPackedGeno(i, buf.get());
-			// detect LD
-			int TotalCnt = 0, ValidCnt = 0;
-			list<TSNP>::iterator it;
-			for (it=ListGeno.begin(); it != ListGeno.end(); TotalCnt++)
-			{
-				// check whether it is in the sliding window
-				if ((abs(i - it->idx) <= slide_max_n) &&
-					(abs(pos_bp[i] - it->pos_bp) <= slide_max_bp))
-				{
-					if (fabs(_CalcLD(&(it->genobuf[0]), buf.get())) <= LD_threshold)
-						ValidCnt ++;
-					it++;
-				} else {
-					ValidCnt ++;
-					// delete it
-					list<TSNP>::iterator tmp_it = it;
-					it++;
-					ListGeno.erase(tmp_it);
-				}
+			TPruneParam *P = (TPruneParam*)Param;
+			try {
+				_PruneMain(P->StartIdx, P->out_SNP);
 			}
-			// handle
-			out_SNP[i] = (ValidCnt == TotalCnt);
-			if (out_SNP[i])
+			catch (std::exception &E) {
+				Prune_Error = E.what();
+			}
+			catch (const char *E) {
+				Prune_Error = E;
+			}
+			Prune_End = true;
+			for (int i=1; i < Prune_NumThread; i++)
+				plc_SetEvent(Prune_Go[i]);
+		} else {
+			while (true)
 			{
-				ListGeno.push_front(TSNP(i, pos_bp[i], nPackedSamp));
-				memmove(&(ListGeno.front().genobuf[0]), buf.get(), nPackedSamp);
+				plc_WaitEvent(Prune_Go[ThreadIndex]);
+				if (Prune_End) break;
+				_PruneTestWindow();
+				plc_LockMutex(Prune_Mutex);
+				bool Last = ((--Prune_NumUse) <= 0);
+				plc_UnlockMutex(Prune_Mutex);
+				if (Last) plc_SetEvent(Prune_Done);
 			}
 		}
 	}
+
+	void calcLDpruning(int StartIdx, int *pos_bp, int slide_max_bp, int slide_max_n,
+		const double LD_threshold, int nThread, bool *out_SNP)
+	{
+		// initial variables
+		nBitWord = BitPlaneLen(MCWorkingGeno.Space.SampleNum());
+		const long nGenoWord = 2*nBitWord;
+		nThread = _LD_NumThread(nThread);
+		Prune_MaxBP = slide_max_bp; Prune_MaxN = slide_max_n;
+		Prune_Threshold = LD_threshold;
+		Prune_PosBP = pos_bp;
+		Prune_NumThread = nThread;
+
+		CPruneWindow Win(nGenoWord);
+		Prune_Win = &Win;
+		const int BatchSize = (nThread > 1) ? (8 * nThread) : 1;
+		Prune_BatchIdx.resize(BatchSize);
+		Prune_BatchGeno.resize(BatchSize * nGenoWord);
+		Prune_Fail.resize(BatchSize);
+		out_SNP[StartIdx] = true;
+
+		if (nThread > 1)
+		{
+			// initialize the events and run
+			for (int i=1; i < nThread; i++)
+				Prune_Go[i] = plc_InitEvent();
+			Prune_Done = plc_InitEvent();
+			Prune_Mutex = plc_InitMutex();
+			Prune_End = false;
+			Prune_Error.clear();
+
+			TPruneParam P;
+			P.StartIdx = StartIdx; P.out_SNP = out_SNP;
+			plc_DoBaseThread(Entry_LDPrune, &P, nThread);
+
+			// finalize
+			for (int i=1; i < nThread; i++)
+				{ plc_DoneEvent(Prune_Go[i]); Prune_Go[i] = NULL; }
+			plc_DoneEvent(Prune_Done); Prune_Done = NULL;
+			plc_DoneMutex(Prune_Mutex); Prune_Mutex = NULL;
+			if (!Prune_Error.empty())
+				throw ErrCoreArray(Prune_Error);
+		} else
+			_PruneMain(StartIdx, out_SNP);
+
+		Prune_Win = NULL;
+	}
 }
 
 
@@ -47,6 +47,12 @@
 #ifdef COREARRAY_SIMD_SSE2
 #include <emmintrin.h>
 #endif
+#ifdef COREARRAY_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+#include <R_ext/BLAS.h>
+#include <R_ext/Lapack.h>
 
 namespace PCA
 {
@@ -62,8 +68,6 @@ namespace PCA
 
 	// Vectorization
 
-	#define __ALIGNED16__ __attribute__((aligned(16)))
-
 	template<typename tfloat,
 		bool SSE = (FlagVectorization >= vtSSE),
 		bool SSE2 = (FlagVectorization >= vtSSE2)
@@ -82,30 +86,6 @@ namespace PCA
 			fN = n; fM = m;
 		}
 
-		void COREARRAY_CALL_ALIGN MulAdd(IdMatTri &Idx, size_t IdxCnt, size_t ArrayLength, tfloat *OutBuf)
-		{
-			for (; IdxCnt > 0; IdxCnt--, ++Idx)
-			{
-				tfloat *p1 = base() + Idx.Row() * fM;
-				tfloat *p2 = base() + Idx.Column() * fM;
-				tfloat rv = 0;
-				// unroll loop
-				size_t k = ArrayLength;
-				while (k >= 4)
-				{
-					rv += p1[0] * p2[0]; rv += p1[1] * p2[1];
-					rv += p1[2] * p2[2]; rv += p1[3] * p2[3];
-					p1 += 4; p2 += 4; k -= 4;
-				}
-				while (k > 0)
-				{
-					rv += (*p1++) * (*p2++);
-					k--;
-				}
-				(*OutBuf++) += rv;
-			}
-		}
-
 		inline size_t N() const { return fN; }
 		inline size_t M() const { return fM; }
 		inline tfloat* base() { return fBuf.get(); }
@@ -131,41 +111,6 @@ namespace PCA
 			fN = n; fM = m;
 		}
 
-		void COREARRAY_CALL_ALIGN MulAdd(IdMatTri &Idx, size_t IdxCnt, size_t ArrayLength, float *OutBuf)
-		{
-			for (; IdxCnt > 0; IdxCnt--, ++Idx)
-			{
-				float *p1 = base() + Idx.Row() * fM;
-				float *p2 = base() + Idx.Column() * fM;
-				// unroll loop
-				float rv4[4] __ALIGNED16__ = {0, 0, 0, 0};
-				size_t k = ArrayLength;
-				__m128 rv128 = _mm_load_ps(rv4);
-
-				while (k >= 16)
-				{
-					rv128 = _mm_add_ps(rv128, _mm_mul_ps(_mm_load_ps(&p1[0]), _mm_load_ps(&p2[0])));
-					rv128 = _mm_add_ps(rv128, _mm_mul_ps(_mm_load_ps(&p1[4]), _mm_load_ps(&p2[4])));
-					rv128 = _mm_add_ps(rv128, _mm_mul_ps(_mm_load_ps(&p1[8]), _mm_load_ps(&p2[8])));
-					rv128 = _mm_add_ps(rv128, _mm_mul_ps(_mm_load_ps(&p1[12]), _mm_load_ps(&p2[12])));
-					p1 += 16; p2 += 16; k -= 16;
-				}
-				while (k >= 4)
-				{
-					rv128 = _mm_add_ps(rv128, _mm_mul_ps(_mm_load_ps(p1), _mm_load_ps(p2)));
-					p1 += 4; p2 += 4; k -= 4;
-				}
-				_mm_store_ps(rv4, rv128);
-				rv4[0] += rv4[1] + rv4[2] + rv4[3];
-				while (k > 0)
-				{
-					rv4[0] += (*p1++) * (*p2++);
-					k--;
-				}
-				(*OutBuf++) += rv4[0];
-			}
-		}
-
 		inline size_t N() const { return fN; }
 		inline size_t M() const { return fM; }
 		inline float* base() { return fBuf.get(); }
@@ -192,38 +137,6 @@ namespace PCA
 			fN = n; fM = m;
 		}
 
-		void COREARRAY_CALL_ALIGN MulAdd(IdMatTri &Idx, size_t IdxCnt, size_t ArrayLength, double *OutBuf)
-		{
-			for (; IdxCnt > 0; IdxCnt--, ++Idx)
-			{
-				double *p1 = base() + Idx.Row() * fM;
-				double *p2 = base() + Idx.Column() * fM;
-				// unroll loop
-				double rv2[2] __ALIGNED16__ = {0, 0};
-				size_t k = ArrayLength;
-
-				__m128d rv128 = _mm_load_pd(rv2);
-				while (k >= 8)
-				{
-					rv128 = _mm_add_pd(rv128, _mm_mul_pd(_mm_load_pd(&p1[0]), _mm_load_pd(&p2[0])));
-					rv128 = _mm_add_pd(rv128, _mm_mul_pd(_mm_load_pd(&p1[2]), _mm_load_pd(&p2[2])));
-					rv128 = _mm_add_pd(rv128, _mm_mul_pd(_mm_load_pd(&p1[4]), _mm_load_pd(&p2[4])));
-					rv128 = _mm_add_pd(rv128, _mm_mul_pd(_mm_load_pd(&p1[6]), _mm_load_pd(&p2[6])));
-					p1 += 8; p2 += 8; k -= 8;
-				}
-
-				while (k >= 2)
-				{
-					rv128 = _mm_add_pd(rv128, _mm_mul_pd(_mm_load_pd(p1), _mm_load_pd(p2)));
-					p1 += 2; p2 += 2; k -= 2;
-				}
-				_mm_store_pd(rv2, rv128);
-				rv2[0] += rv2[1];
-				if (k > 0) rv2[0] += (*p1) * (*p2);
-				(*OutBuf++) += rv2[0];
-			}
-		}
-
 		inline size_t N() const { return fN; }
 		inline size_t M() const { return fM; }
 		inline double* base() { return fBuf.get(); }
@@ -235,11 +148,164 @@ namespace PCA
 
 
 
+	// ---------------------------------------------------------------------
+	// Blocked matrix product for the genetic covariance matrix
+
+	/// The rows and columns of the register block in the matrix product
+	#ifdef COREARRAY_SIMD_AVX2
+	#   define GRM_MR    4
+	#   define GRM_NR    8
+	#   ifdef __FMA__
+	#       define GRM_MULADD(a, b, c)    _mm256_fmadd_pd(a, b, c)
+	#   else
+	#       define GRM_MULADD(a, b, c)    _mm256_add_pd(c, _mm256_mul_pd(a, b))
+	#   endif
+	#else
+	#   define GRM_MR    4
+	#   define GRM_NR    4
+	#endif
+
+	/// The workspace of a thread for the tile product
+	struct TGRMWork
+	{
+		double *PackA;  ///< the row panel of a tile, GRM_MR rows interleaved
+		double *PackB;  ///< the column panel of a tile, GRM_NR rows interleaved
+		double *C;      ///< the product of a tile, stored row by row
+		size_t LdC;     ///< the leading dimension of C
+		int RowA;       ///< the first row in PackA, or -1 if PackA is not filled
+	};
+
+	/// Pack the rows [i0, i0+m) of X with the stride ldx into panels of R rows,
+	/// the k-th value of row (i0 + p*R + r) is stored in Out[p*R*k_len + k*R + r],
+	/// and the rows out of range are padded with zero
+	static void _GRM_Pack(const double *X, size_t ldx, int i0, int m,
+		size_t k_len, int R, double *Out)
+	{
+		for (int p=0; p < m; p += R)
+		{
+			for (int r=0; r < R; r++)
+			{
+				double *o = Out + r;
+				if (p + r < m)
+				{
+					const double *x = X + (i0 + p + r) * ldx;
+					for (size_t k=0; k < k_len; k++, o += R) *o = x[k];
+				} else {
+					for (size_t k=0; k < k_len; k++, o += R) *o = 0;
+				}
+			}
+			Out += R * k_len;
+		}
+	}
+
+	/// C[r*ldc + c] = sum_k A[k*GRM_MR + r] * B[k*GRM_NR + c]
+	static void COREARRAY_CALL_ALIGN _GRM_Kernel(size_t k_len, const double *A,
+		const double *B, double *C, size_t ldc)
+	{
+	#if defined(COREARRAY_SIMD_AVX2)
+		__m256d c00 = _mm256_setzero_pd(), c01 = c00, c10 = c00, c11 = c00;
+		__m256d c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+		for (; k_len > 0; k_len--, A += GRM_MR, B += GRM_NR)
+		{
+			__m256d b0 = _mm256_load_pd(B), b1 = _mm256_load_pd(B + 4);
+			__m256d a = _mm256_broadcast_sd(A);
+			c00 = GRM_MULADD(a, b0, c00);
+			c01 = GRM_MULADD(a, b1, c01);
+			a = _mm256_broadcast_sd(A + 1);
+			c10 = GRM_MULADD(a, b0, c10);
+			c11 = GRM_MULADD(a, b1, c11);
+			a = _mm256_broadcast_sd(A + 2);
+			c20 = GRM_MULADD(a, b0, c20);
+			c21 = GRM_MULADD(a, b1, c21);
+			a = _mm256_broadcast_sd(A + 3);
+			c30 = GRM_MULADD(a, b0, c30);
+			c31 = GRM_MULADD(a, b1, c31);
+		}
+		_mm256_storeu_pd(C, c00); _mm256_storeu_pd(C + 4, c01); C += ldc;
+		_mm256_storeu_pd(C, c10); _mm256_storeu_pd(C + 4, c11); C += ldc;
+		_mm256_storeu_pd(C, c20); _mm256_storeu_pd(C + 4, c21); C += ldc;
+		_mm256_storeu_pd(C, c30); _mm256_storeu_pd(C + 4, c31);
+	#elif defined(COREARRAY_SIMD_SSE2)
+		__m128d c00 = _mm_setzero_pd(), c01 = c00, c10 = c00, c11 = c00;
+		__m128d c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+		for (; k_len > 0; k_len--, A += GRM_MR, B += GRM_NR)
+		{
+			__m128d b0 = _mm_load_pd(B), b1 = _mm_load_pd(B + 2);
+			__m128d a = _mm_load1_pd(A);
+			c00 = _mm_add_pd(c00, _mm_mul_pd(a, b0));
+			c01 = _mm_add_pd(c01, _mm_mul_pd(a, b1));
+			a = _mm_load1_pd(A + 1);
+			c10 = _mm_add_pd(c10, _mm_mul_pd(a, b0));
+			c11 = _mm_add_pd(c11, _mm_mul_pd(a, b1));
+			a = _mm_load1_pd(A + 2);
+			c20 = _mm_add_pd(c20, _mm_mul_pd(a, b0));
+			c21 = _mm_add_pd(c21, _mm_mul_pd(a, b1));
+			a = _mm_load1_pd(A + 3);
+			c30 = _mm_add_pd(c30, _mm_mul_pd(a, b0));
+			c31 = _mm_add_pd(c31, _mm_mul_pd(a, b1));
+		}
+		_mm_storeu_pd(C, c00); _mm_storeu_pd(C + 2, c01); C += ldc;
+		_mm_storeu_pd(C, c10); _mm_storeu_pd(C + 2, c11); C += ldc;
+		_mm_storeu_pd(C, c20); _mm_storeu_pd(C + 2, c21); C += ldc;
+		_mm_storeu_pd(C, c30); _mm_storeu_pd(C + 2, c31);
+	#else
+		double c[GRM_MR][GRM_NR];
+		memset(c, 0, sizeof(c));
+		for (; k_len > 0; k_len--, A += GRM_MR, B += GRM_NR)
+		{
+			for (int r=0; r < GRM_MR; r++)
+				for (int j=0; j < GRM_NR; j++)
+					c[r][j] += A[r] * B[j];
+		}
+		for (int r=0; r < GRM_MR; r++, C += ldc)
+			memcpy(C, c[r], sizeof(double)*GRM_NR);
+	#endif
+	}
+
+	/// Compute the tile C = X[i0:i0+m] X[j0:j0+n]', the entries below the
+	/// diagonal are not computed if i0 == j0
+	static void _GRM_Tile(const double *X, size_t ldx, int i0, int m,
+		int j0, int n, size_t k_len, bool use_blas, TGRMWork &W)
+	{
+		if (use_blas)
+		{
+			// column-major C' = X[j0:j0+n] X[i0:i0+m]', i.e., row-major C
+			int _m = n, _n = m, _k = k_len, _ld = ldx, _ldc = W.LdC;
+			double one = 1, zero = 0;
+			F77_CALL(dgemm)("T", "N", &_m, &_n, &_k, &one, X + j0*ldx, &_ld,
+				X + i0*ldx, &_ld, &zero, W.C, &_ldc);
+			return;
+		}
+
+		const bool diag = (i0 == j0);
+		// the tiles in a row share the same row panel
+		if (W.RowA != i0)
+		{
+			_GRM_Pack(X, ldx, i0, m, k_len, GRM_MR, W.PackA);
+			W.RowA = i0;
+		}
+		_GRM_Pack(X, ldx, j0, n, k_len, GRM_NR, W.PackB);
+		// a column panel stays in L1 cache, while the row panels are streamed
+		for (int jb=0; jb < n; jb += GRM_NR)
+		{
+			const double *B = W.PackB + jb * k_len;
+			for (int ib=0; ib < m; ib += GRM_MR)
+			{
+				if (diag && (ib >= jb + GRM_NR)) break;
+				_GRM_Kernel(k_len, W.PackA + ib * k_len, B, W.C + ib*W.LdC + jb, W.LdC);
+			}
+		}
+	}
+
+
+
 	// ---------------------------------------------------------------------
 	// PCA parameters
 
 	/// whether use Bayesian normalization
 	bool BayesianNormal = false;
+	/// whether compute the covariance matrix using the BLAS linked with R
+	bool CovBLAS = false;
 	/// The number of eigenvectors output
 	long OutputEigenDim = 16;
 	/// the pointer to the output buffer for SNP correlation and SNP/sample loadings
@@ -252,16 +318,25 @@ namespace PCA
 	double *In_AveFreq = NULL;
 
 	/// detect the effective value for BlockSNP
-	void AutoDetectSNPBlockSize(int nSamp, bool Detect=true)
+	/** \param Tiled  whether the genetic covariance is computed in tiles
+	**/
+	void AutoDetectSNPBlockSize(int nSamp, bool Detect=true, bool Tiled=false)
 	{
+		long L2Cache = 1024*1024; // 1M
 		if (Detect)
 		{
-			long L2Cache = conf_GetL2CacheMemory();
+			L2Cache = conf_GetL2CacheMemory();
 			if (L2Cache <= 0) L2Cache = 1024*1024; // 1M
 			BlockSNP = (L2Cache - 8*1024) / (sizeof(double)*nSamp);
+			// a large number of samples is split into tiles instead, at the
+			//   cost of about 1.3KB memory per sample for 128 SNPs
+			if (Tiled && (BlockSNP < 128)) BlockSNP = 128;
 		}
 		BlockSNP = (BlockSNP / 4) * 4;
 		if (BlockSNP < 16) BlockSNP = 16;
+		// the genotypes of two tiles occupy a quarter of L2 cache
+		TileSamp = (L2Cache / 4) / (2 * sizeof(double) * BlockSNP);
+		if (TileSamp < 16) TileSamp = 16;
 	}
 
 	/// init mutex objects
@@ -289,9 +364,12 @@ namespace PCA
 	const int N_MAX_THREAD = 256;
 	IdMatTri PCA_Thread_MatIdx[N_MAX_THREAD];
 	Int64 PCA_Thread_MatCnt[N_MAX_THREAD];
+	/// The workspace of tile products for each thread
+	TGRMWork PCA_Work[N_MAX_THREAD];
+	TdAlignPtr<double, 32> PCA_WorkBuf;
 
-	/// Convert the raw genotypes to the mean-adjusted genotypes
-	void _Do_PCA_ReadBlock(UInt8 *GenoBuf, long Start, long SNP_Cnt, void* Param)
+	/// Convert the raw genotypes to the mean-adjusted genotypes in Mat
+	static void _PCA_Standardize(UInt8 *GenoBuf, long SNP_Cnt, CPCAMat<double> &Mat)
 	{
 		// init ...
 		const int n = MCWorkingGeno.Space.SampleNum();
@@ -303,10 +381,10 @@ namespace PCA
 
 		// calculate the averages of genotypes for each SelSNP
 		p = GenoBuf;
-		pp = PCA_Mat.base();
+		pp = Mat.base();
 		for (long iSample=0; iSample < n; iSample++)
 		{
-			pf = pp; pp += PCA_Mat.M();
+			pf = pp; pp += Mat.M();
 			for (long iSNP=0; iSNP < SNP_Cnt; iSNP++)
 			{
 				if (*p < 3)
@@ -329,11 +407,11 @@ namespace PCA
 		}
 
 		// Averaging and set missing values to ZERO
-		pp = PCA_Mat.base(); // C@ij - 2p@j
+		pp = Mat.base(); // C@ij - 2p@j
 		for (long iSample=0; iSample < n; iSample++)
 		{
 			vt<double, av16Align>::Sub(pp, pp, tmpBuf.get(), SNP_Cnt);
-			pp += PCA_Mat.M();
+			pp += Mat.M();
 		}
 		pf = tmpBuf.get(); // 1/sqrt(p@j*(1-p@j))
 		for (long iSNP=0; iSNP < SNP_Cnt; iSNP++, pf++)
@@ -351,18 +429,18 @@ namespace PCA
 				*pf = 0;
 		}
 		// (C@ij - 2p@j) / sqrt(p@j*(1-p@j))
-		pp = PCA_Mat.base();
+		pp = Mat.base();
 		for (long iSample=0; iSample < n; iSample++)
 		{
 			vt<double, av16Align>::Mul(pp, pp, tmpBuf.get(), SNP_Cnt);
-			pp += PCA_Mat.M();
+			pp += Mat.M();
 		}
 
 		// missing values
-		p = GenoBuf; pp = PCA_Mat.base();
+		p = GenoBuf; pp = Mat.base();
 		for (long iSample=0; iSample < n; iSample++)
 		{
-			pf = pp; pp += PCA_Mat.M();
+			pf = pp; pp += Mat.M();
 			for (long iSNP=0; iSNP < SNP_Cnt; iSNP++)
 			{
 				if (*p > 2) *pf = 0;
@@ -371,12 +449,37 @@ namespace PCA
 		}
 	}
 
+	/// Convert the raw genotypes to the mean-adjusted genotypes
+	void _Do_PCA_ReadBlock(UInt8 *GenoBuf, long Start, long SNP_Cnt, void* Param)
+	{
+		_PCA_Standardize(GenoBuf, SNP_Cnt, PCA_Mat);
+	}
+
 	/// Compute the covariate matrix
 	void _Do_PCA_ComputeCov(int ThreadIndex, long Start, long SNP_Cnt, void* Param)
 	{
 		double *base = (double*)Param;
-		IdMatTri I = PCA_Thread_MatIdx[ThreadIndex];
-		PCA_Mat.MulAdd(I, PCA_Thread_MatCnt[ThreadIndex], SNP_Cnt, base + I.Offset());
+		IdMatTriTile I(PCA_Mat.N(), true, PCA_Thread_MatIdx[ThreadIndex].Offset(),
+			PCA_Thread_MatCnt[ThreadIndex], TileSamp);
+		TGRMWork W = PCA_Work[ThreadIndex];
+		W.RowA = -1;
+		const int n = PCA_Mat.N();
+		int i0 = -1, j0 = -1;
+
+		while (I.Next())
+		{
+			// the product of a new tile
+			if ((I.TileRow() != i0) || (I.TileCol() != j0))
+			{
+				i0 = I.TileRow(); j0 = I.TileCol();
+				_GRM_Tile(PCA_Mat.base(), PCA_Mat.M(), i0, min(n - i0, (int)TileSamp),
+					j0, min(n - j0, (int)TileSamp), SNP_Cnt, CovBLAS, W);
+			}
+			// add to the upper triangle
+			vt<double>::Add(base + I.Offset(), base + I.Offset(),
+				W.C + (I.Row() - i0)*W.LdC + (I.Column() - j0),
+				I.ColEnd() - I.Column());
+		}
 	}
 
     /// Calculate the genetic covariace
@@ -389,6 +492,23 @@ namespace PCA
 		tmpBuf.Reset(PCA_Mat.M());
 		memset(PublicCov.get(), 0, sizeof(double)*PublicCov.Size());
 
+		// the workspace of tile products
+		{
+			const size_t T = TileSamp;
+			const size_t TA = (T + GRM_MR - 1) / GRM_MR * GRM_MR;
+			const size_t TB = (T + GRM_NR - 1) / GRM_NR * GRM_NR;
+			const size_t size = (TA + TB) * BlockSNP + TA * TB;
+			PCA_WorkBuf.Reset(size * NumThread);
+			for (int i=0; i < NumThread; i++)
+			{
+				TGRMWork &W = PCA_Work[i];
+				W.PackA = PCA_WorkBuf.get() + size*i;
+				W.PackB = W.PackA + TA * BlockSNP;
+				W.C = W.PackB + TB * BlockSNP;
+				W.LdC = TB;
+			}
+		}
+
 		MCWorkingGeno.Progress.Info = Info;
 		MCWorkingGeno.Progress.Show() = verbose;
 		MCWorkingGeno.InitParam(true, true, BlockSNP);
@@ -398,6 +518,349 @@ namespace PCA
 	}
 
 
+	// ****************** Randomized eigen-decomposition ******************
+
+	/// The number of samples and the dimension of subspace
+	static int RE_N = 0, RE_Dim = 0;
+	/// The basis of subspace and the product with the covariance matrix,
+	/// n-by-RE_Dim matrices stored row by row
+	static double *RE_Q = NULL, *RE_Y = NULL;
+	/// The product buffers of threads except the main thread
+	static vector<double> RE_YThread;
+	/// The normalized covariance matrix, or NULL if it is not available
+	static CdMatTri<double> *RE_Cov = NULL;
+	/// The number of samples in a tile of covariance matrix
+	static int RE_Tile = 256;
+	/// The number of threads
+	static int RE_NumThread = 1;
+
+	/// The standardized genotypes of the current and previous blocks
+	static CPCAMat<double> RE_Mat[2];
+	static int RE_Cur = 0;
+	static long RE_CurCnt = 0, RE_PrevCnt = 0;
+	/// The partial products X'Q of threads, and the sum for the previous block
+	static vector<double> RE_Z;
+	/// The sum of squared standardized genotypes
+	static double RE_Trace = 0;
+	static bool RE_NeedTrace = false;
+
+	/// Return the first row of a thread
+	static inline int RE_RowStart(int ThreadIndex)
+	{
+		return (Int64)RE_N * ThreadIndex / RE_NumThread;
+	}
+
+	/// The thread entry for Y = Cov * Q with the covariance matrix in memory
+	static void Entry_RE_CovMul(TdThread Thread, int ThreadIndex, void *Param)
+	{
+		const int n = RE_Cov->N(), l = RE_Dim;
+		double *Y = (ThreadIndex == 0) ? RE_Y :
+			&RE_YThread[(size_t)(ThreadIndex-1) * n * l];
+		memset(Y, 0, sizeof(double) * n * l);
+
+		// the upper triangle tile by tile, and its transpose
+		IdMatTriTile I(n, true, PCA_Thread_MatIdx[ThreadIndex].Offset(),
+			PCA_Thread_MatCnt[ThreadIndex], RE_Tile);
+		while (I.Next())
+		{
+			const int i = I.Row();
+			const double *c = RE_Cov->get() + I.Offset();
+			const double *qi = RE_Q + (size_t)i * l;
+			double *yi = Y + (size_t)i * l;
+			for (int j=I.Column(); j < I.ColEnd(); j++, c++)
+			{
+				const double v = *c;
+				if (j > i)
+				{
+					const double *qj = RE_Q + (size_t)j * l;
+					double *yj = Y + (size_t)j * l;
+					for (int k=0; k < l; k++)
+						{ yi[k] += v * qj[k]; yj[k] += v * qi[k]; }
+				} else {
+					for (int k=0; k < l; k++) yi[k] += v * qi[k];
+				}
+			}
+		}
+	}
+
+	/// y += v0*x0 + v1*x1 + v2*x2 + v3*x3
+	static inline void _RE_AXPY4(double *y, int n, double v0, const double *x0,
+		double v1, const double *x1, double v2, const double *x2,
+		double v3, const double *x3)
+	{
+		for (int c=0; c < n; c++)
+			y[c] += v0*x0[c] + v1*x1[c] + v2*x2[c] + v3*x3[c];
+	}
+
+	/// Y += X * Z for the rows [i0, i1) of X (with K columns)
+	static void _RE_AddXZ(CPCAMat<double> &X, long K, const double *Z,
+		int i0, int i1)
+	{
+		const int l = RE_Dim;
+		for (int i=i0; i < i1; i++)
+		{
+			const double *x = X.base() + (size_t)i * X.M();
+			double *y = RE_Y + (size_t)i * l;
+			const double *z = Z;
+			long k = 0;
+			for (; k+4 <= K; k+=4, z += 4*l)
+				_RE_AXPY4(y, l, x[k], z, x[k+1], z+l, x[k+2], z+2*l, x[k+3], z+3*l);
+			for (; k < K; k++, z += l)
+				_RE_AXPY4(y, l, x[k], z, 0, z, 0, z, 0, z);
+		}
+	}
+
+	/// Sum the partial products X'Q of all threads for the previous block
+	static void _RE_SumZ()
+	{
+		const size_t size = (size_t)RE_CurCnt * RE_Dim;
+		const size_t stride = (size_t)BlockSNP * RE_Dim;
+		double *Z = &RE_Z[stride * RE_NumThread];
+		memcpy(Z, &RE_Z[0], sizeof(double) * size);
+		for (int t=1; t < RE_NumThread; t++)
+		{
+			const double *s = &RE_Z[stride * t];
+			for (size_t i=0; i < size; i++) Z[i] += s[i];
+		}
+		RE_PrevCnt = RE_CurCnt;
+	}
+
+	/// Standardize the genotypes of a block
+	static void _Do_RE_ReadBlock(UInt8 *GenoBuf, long Start, long SNP_Cnt, void* Param)
+	{
+		// all threads have finished the previous block
+		if (RE_CurCnt > 0) _RE_SumZ();
+		RE_Cur = 1 - RE_Cur;
+		CPCAMat<double> &X = RE_Mat[RE_Cur];
+		_PCA_Standardize(GenoBuf, SNP_Cnt, X);
+		RE_CurCnt = SNP_Cnt;
+
+		if (RE_NeedTrace)
+		{
+			const int n = X.N();
+			for (int i=0; i < n; i++)
+			{
+				const double *x = X.base() + (size_t)i * X.M();
+				for (long k=0; k < SNP_Cnt; k++) RE_Trace += x[k] * x[k];
+			}
+		}
+	}
+
+	/// Y += X(previous) * Z(previous), and Z = X'Q for the rows of a thread
+	static void _Do_RE_Compute(int ThreadIndex, long Start, long SNP_Cnt, void* Param)
+	{
+		const int i0 = RE_RowStart(ThreadIndex);
+		const int i1 = RE_RowStart(ThreadIndex + 1);
+		const int l = RE_Dim;
+
+		// the previous block
+		if (RE_PrevCnt > 0)
+		{
+			_RE_AddXZ(RE_Mat[1 - RE_Cur], RE_PrevCnt,
+				&RE_Z[(size_t)BlockSNP * l * RE_NumThread], i0, i1);
+		}
+
+		// the current block
+		CPCAMat<double> &X = RE_Mat[RE_Cur];
+		double *Z = &RE_Z[(size_t)BlockSNP * l * ThreadIndex];
+		memset(Z, 0, sizeof(double) * SNP_Cnt * l);
+		const size_t M = X.M();
+		int i = i0;
+		for (; i < i1; i += 4)
+		{
+			// four rows at a time, and the rows out of range are zero
+			const double *x0 = X.base() + (size_t)i * M;
+			const double *x1 = (i+1 < i1) ? x0 + M : NULL;
+			const double *x2 = (i+2 < i1) ? x0 + 2*M : NULL;
+			const double *x3 = (i+3 < i1) ? x0 + 3*M : NULL;
+			const double *q = RE_Q + (size_t)i * l;
+			double *z = Z;
+			for (long k=0; k < SNP_Cnt; k++, z += l)
+			{
+				_RE_AXPY4(z, l, x0[k], q, x1 ? x1[k] : 0, x1 ? q+l : q,
+					x2 ? x2[k] : 0, x2 ? q+2*l : q, x3 ? x3[k] : 0, x3 ? q+3*l : q);
+			}
+		}
+	}
+
+	/// Y = Cov * Q
+	static void _RE_CovMul()
+	{
+		const int n = RE_N, l = RE_Dim;
+		if (RE_Cov)
+		{
+			plc_DoBaseThread(Entry_RE_CovMul, NULL, RE_NumThread);
+			for (int t=1; t < RE_NumThread; t++)
+			{
+				const double *s = &RE_YThread[(size_t)(t-1) * n * l];
+				vt<double>::Add(RE_Y, RE_Y, s, (size_t)n * l);
+			}
+		} else {
+			// X X' Q, computed block by block
+			memset(RE_Y, 0, sizeof(double) * n * l);
+			RE_Cur = 0; RE_CurCnt = RE_PrevCnt = 0;
+			MCWorkingGeno.InitParam(true, true, BlockSNP);
+			MCWorkingGeno.Run(RE_NumThread, &_Do_RE_ReadBlock, &_Do_RE_Compute, NULL);
+			// the last block
+			if (RE_CurCnt > 0)
+			{
+				_RE_SumZ();
+				_RE_AddXZ(RE_Mat[RE_Cur], RE_PrevCnt,
+					&RE_Z[(size_t)BlockSNP * l * RE_NumThread], 0, n);
+			}
+			RE_NeedTrace = false;
+		}
+	}
+
+	/// Orthonormalize the columns of an n-by-l matrix stored row by row
+	static void _RE_Orthonormalize(double *Y, int n, int l)
+	{
+		// Y is the column-major l-by-n matrix Y', and Y' = L Q with the
+		// orthonormal rows of Q, so Q' is an orthonormal basis of Y
+		vector<double> tau(l), work(1);
+		int info = 0, lwork = -1;
+		F77_NAME(dgelqf)(&l, &n, Y, &l, &tau[0], &work[0], &lwork, &info);
+		lwork = (int)work[0];
+		work.resize(max(lwork, l));
+		F77_NAME(dgelqf)(&l, &n, Y, &l, &tau[0], &work[0], &lwork, &info);
+		if (info != 0)
+			throw ErrCoreArray("LAPACK::DGELQF error (%d).", info);
+
+		lwork = -1;
+		F77_NAME(dorglq)(&l, &n, &l, Y, &l, &tau[0], &work[0], &lwork, &info);
+		lwork = (int)work[0];
+		work.resize(max(lwork, l));
+		F77_NAME(dorglq)(&l, &n, &l, Y, &l, &tau[0], &work[0], &lwork, &info);
+		if (info != 0)
+			throw ErrCoreArray("LAPACK::DORGLQ error (%d).", info);
+	}
+
+	/// Calculate the top eigenvalues and eigenvectors by randomized subspace iteration
+	/** \param Cov          the normalized covariance matrix, or NULL to multiply
+	 *                      the standardized genotypes block by block instead
+	 *  \param EigenCnt     the number of eigenpairs
+	 *  \param InitQ        the random starting matrix, n-by-AuxDim stored row by row
+	 *  \param AuxDim       the dimension of subspace (>= EigenCnt)
+	 *  \param IterNum      the number of iterations
+	 *  \param TraceXTX     the trace of covariance matrix before normalization,
+	 *                      output if Cov is NULL
+	**/
+	void DoRandEigenCalculate(CdMatTri<double> *Cov, int EigenCnt, double *InitQ,
+		int AuxDim, int IterNum, int NumThread, double &TraceXTX,
+		double *out_Eigenvalues, double *out_Eigenvectors, bool verbose)
+	{
+		const int n = MCWorkingGeno.Space.SampleNum();
+		const int l = AuxDim;
+		if ((EigenCnt > l) || (l > n))
+			throw ErrCoreArray("Invalid dimension of subspace.");
+		if (IterNum < 1) IterNum = 1;
+
+		// initialize
+		RE_N = n; RE_Dim = l; RE_Cov = Cov;
+		RE_NumThread = (NumThread > 0) ? NumThread : 1;
+		vector<double> Q(InitQ, InitQ + (size_t)n * l), Y((size_t)n * l);
+		RE_Q = &Q[0]; RE_Y = &Y[0];
+		if (Cov)
+		{
+			long L2Cache = conf_GetL2CacheMemory();
+			if (L2Cache <= 0) L2Cache = 1024*1024;
+			// the rows of Q and Y in two tiles occupy a half of L2 cache
+			RE_Tile = L2Cache / (2 * 4 * sizeof(double) * l);
+			if (RE_Tile < 16) RE_Tile = 16;
+			RE_YThread.resize((size_t)(RE_NumThread - 1) * n * l);
+			MCWorkingGeno.SplitJobs(RE_NumThread, n, PCA_Thread_MatIdx,
+				PCA_Thread_MatCnt);
+		} else {
+			PCA_gSum.reset(new int[BlockSNP]);
+			PCA_gNum.reset(new int[BlockSNP]);
+			RE_Mat[0].Reset(n, BlockSNP);
+			RE_Mat[1].Reset(n, BlockSNP);
+			tmpBuf.Reset(RE_Mat[0].M());
+			RE_Z.resize((size_t)BlockSNP * l * (RE_NumThread + 1));
+			RE_Trace = 0; RE_NeedTrace = true;
+			MCWorkingGeno.Progress.Info = "PCA:";
+		}
+		_RE_Orthonormalize(RE_Q, n, l);
+
+		// subspace iteration
+		for (int iter=1; iter <= IterNum; iter++)
+		{
+			if (verbose)
+			{
+				Rprintf("PCA:\t%s\tIteration %d of %d\n", NowDateToStr().c_str(),
+					iter, IterNum);
+			}
+			MCWorkingGeno.Progress.Show() = verbose && (iter == 1);
+			_RE_CovMul();
+			if (iter < IterNum)
+			{
+				memcpy(RE_Q, RE_Y, sizeof(double) * n * l);
+				_RE_Orthonormalize(RE_Q, n, l);
+			}
+		}
+
+		// the scale of normalization
+		double scale = 1;
+		if (!Cov)
+		{
+			TraceXTX = RE_Trace;
+			scale = double(n-1) / TraceXTX;
+		}
+
+		// Rayleigh-Ritz projection, B = Q' Cov Q
+		vector<double> B((size_t)l * l, 0.0);
+		for (int i=0; i < n; i++)
+		{
+			const double *q = RE_Q + (size_t)i * l, *y = RE_Y + (size_t)i * l;
+			for (int a=0; a < l; a++)
+			{
+				double *b = &B[(size_t)a * l];
+				const double v = q[a];
+				for (int c=0; c < l; c++) b[c] += v * y[c];
+			}
+		}
+		for (int a=0; a < l; a++)
+		{
+			for (int c=a+1; c < l; c++)
+				B[a*l + c] = B[c*l + a] = 0.5 * (B[a*l + c] + B[c*l + a]);
+		}
+
+		vector<double> W(l), work(1);
+		{
+			int info = 0, lwork = -1;
+			F77_NAME(dsyev)("V", "L", &l, &B[0], &l, &W[0], &work[0], &lwork, &info);
+			lwork = (int)work[0];
+			work.resize(max(lwork, 3*l));
+			F77_NAME(dsyev)("V", "L", &l, &B[0], &l, &W[0], &work[0], &lwork, &info);
+			if (info != 0)
+				throw ErrCoreArray("LAPACK::DSYEV error (%d).", info);
+		}
+
+		// output, in decreasing order of eigenvalues
+		for (int j=0; j < EigenCnt; j++)
+		{
+			const double *v = &B[(size_t)(l-1-j) * l];
+			out_Eigenvalues[j] = W[l-1-j] * scale;
+			double *p = out_Eigenvectors + (size_t)j * n;
+			for (int i=0; i < n; i++)
+			{
+				const double *q = RE_Q + (size_t)i * l;
+				double sum = 0;
+				for (int a=0; a < l; a++) sum += q[a] * v[a];
+				p[i] = sum;
+			}
+		}
+		for (int j=EigenCnt; j < n; j++)
+			out_Eigenvalues[j] = conf_F64_NaN();
+
+		// free memory
+		RE_Q = RE_Y = NULL; RE_Cov = NULL;
+		vector<double>().swap(RE_YThread);
+		vector<double>().swap(RE_Z);
+		RE_Mat[0].Reset(0, 0); RE_Mat[1].Reset(0, 0);
+	}
+
+
 	// ****************** SNP coefficients ******************
 
 	// Correlation
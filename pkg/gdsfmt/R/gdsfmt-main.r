@@ -58,14 +58,15 @@ createfn.gds <- function(filename, allow.duplicate=FALSE)
 # Open an existing file
 #
 openfn.gds <- function(filename, readonly=TRUE, allow.duplicate=FALSE,
-	allow.fork=FALSE)
+	allow.fork=FALSE, use.mmap=FALSE)
 {
 	stopifnot(is.character(filename) & is.vector(filename))
 	stopifnot(length(filename) == 1)
+	stopifnot(is.logical(use.mmap) & (length(use.mmap)==1))
 
 	filename <- normalizePath(filename, mustWork=FALSE)
 	ans <- .Call(gdsOpenGDS, filename, readonly, allow.duplicate,
-		allow.fork)
+		allow.fork, use.mmap)
 	names(ans) <- c("filename", "id", "root", "readonly")
 	ans$filename <- filename
 	class(ans$root) <- "gdsn.class"
@@ -170,6 +171,66 @@ diagnosis.gds <- function(gdsfile)
 }
 
 
+#############################################################
+# Get or set the cache of decompressed blocks
+#
+blockcache.gds <- function(gdsfile, max.size=NULL, reset=FALSE,
+	readahead=NULL)
+{
+	stopifnot(inherits(gdsfile, "gds.class"))
+	stopifnot(is.null(max.size) | (is.numeric(max.size) &
+		(length(max.size)==1)))
+	stopifnot(is.logical(reset) & (length(reset)==1))
+	stopifnot(is.null(readahead) | (is.numeric(readahead) &
+		(length(readahead)==1)))
+
+	# call C function
+	.Call(gdsBlockCache, gdsfile$id, max.size, reset, readahead)
+}
+
+
+#############################################################
+# Get or set the memory budget of pinned data
+#
+pincache.gds <- function(max.size=NULL, clear=FALSE)
+{
+	stopifnot(is.null(max.size) | (is.numeric(max.size) &
+		(length(max.size)==1)))
+	stopifnot(is.logical(clear) & (length(clear)==1))
+
+	# call C function
+	.Call(gdsPinCache, max.size, clear)
+}
+
+
+#############################################################
+# Get or set whether a table of blocks is written to a GDS file
+#
+blocktable.gds <- function(gdsfile, enable=NULL)
+{
+	stopifnot(inherits(gdsfile, "gds.class"))
+	stopifnot(is.null(enable) | (is.logical(enable) & (length(enable)==1)))
+
+	# call C function
+	.Call(gdsBlockTable, gdsfile$id, enable)
+}
+
+
+#############################################################
+# Get or set the default stream buffer sizes of a GDS file
+#
+bufsize.gds <- function(gdsfile, size=NULL, max.size=NULL)
+{
+	stopifnot(inherits(gdsfile, "gds.class"))
+	stopifnot(is.null(size) | (is.numeric(size) & (length(size)==1)))
+	stopifnot(is.null(max.size) | (is.numeric(max.size) &
+		(length(max.size)==1)))
+
+	# call C function
+	.Call(gdsBufSizeGDS, gdsfile$id, size, max.size)
+}
+
+
 
 
 
@@ -264,7 +325,7 @@ objdesp.gdsn <- function(node)
 # Add a GDS node
 #
 add.gdsn <- function(node, name, val=NULL, storage=storage.mode(val),
-	valdim=NULL, compress=c("", "ZIP", "ZIP_RA", "LZ4", "LZ4_RA"),
+	valdim=NULL, compress=c("", "ZIP", "ZIP_RA", "LZ4", "LZ4_RA", "ZSTD", "ZSTD_RA"),
 	closezip=FALSE, check=TRUE, replace=FALSE, ...)
 {
 	if (inherits(node, "gds.class"))
@@ -360,7 +421,8 @@ addfolder.gdsn <- function(node, name, type=c("directory", "virtual"),
 # Add a GDS node with a file
 #
 addfile.gdsn <- function(node, name, filename,
-	compress=c("ZIP", "ZIP_RA", "LZ4", "LZ4_RA"), replace=FALSE)
+	compress=c("ZIP", "ZIP_RA", "LZ4", "LZ4_RA", "ZSTD", "ZSTD_RA"),
+	replace=FALSE)
 {
 	if (inherits(node, "gds.class"))
 		node <- node$root
@@ -471,7 +533,7 @@ delete.attr.gdsn <- function(node, name)
 # Modify the data compression mode of data field
 #
 compression.gdsn <- function(node,
-	compress=c("", "ZIP", "ZIP_RA", "LZ4", "LZ4_RA"))
+	compress=c("", "ZIP", "ZIP_RA", "LZ4", "LZ4_RA", "ZSTD", "ZSTD_RA"))
 {
 	stopifnot(inherits(node, "gdsn.class"))
 	stopifnot(is.character(compress) & is.vector(compress))
@@ -844,16 +906,32 @@ assign.gdsn <- function(dest.obj, src.obj, append=TRUE)
 #############################################################
 # Caching the data associated with a GDS variable
 #
-cache.gdsn <- function(node)
+cache.gdsn <- function(node, pin=FALSE)
 {
 	stopifnot(inherits(node, "gdsn.class"))
+	stopifnot(is.logical(pin) & (length(pin)==1))
 
 	# call C function
-	.Call(gdsCache, node)
+	.Call(gdsCache, node, pin)
 	invisible()
 }
 
 
+#############################################################
+# Get or set the stream buffer sizes of a GDS variable
+#
+bufsize.gdsn <- function(node, size=NULL, max.size=NULL)
+{
+	stopifnot(inherits(node, "gdsn.class"))
+	stopifnot(is.null(size) | (is.numeric(size) & (length(size)==1)))
+	stopifnot(is.null(max.size) | (is.numeric(max.size) &
+		(length(max.size)==1)))
+
+	# call C function
+	.Call(gdsBufSizeNode, node, size, max.size)
+}
+
+
 #############################################################
 # move to a new location
 #
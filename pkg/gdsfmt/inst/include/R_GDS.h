@@ -70,8 +70,8 @@ extern "C" {
 
 	// ==================================================================
 
-	/// Version of R package gdsfmt: v1.1.3
-	#define GDSFMT_R_VERSION    0x010103
+	/// Version of R package gdsfmt: v1.1.4
+	#define GDSFMT_R_VERSION    0x010104
 
 
 	// [[ ********
@@ -173,8 +173,12 @@ extern "C" {
 	extern PdGDSFile GDS_File_Create(const char *FileName);
 	extern PdGDSFile GDS_File_Open(const char *FileName, C_BOOL ReadOnly,
 		C_BOOL ForkSupport);
+	extern PdGDSFile GDS_File_OpenEx(const char *FileName, C_BOOL ReadOnly,
+		C_BOOL ForkSupport, C_BOOL UseMMap);
 	extern void GDS_File_Close(PdGDSFile File);
 	extern void GDS_File_Sync(PdGDSFile File);
+	extern void GDS_File_SetBufSize(PdGDSFile File, C_Int64 Size,
+		C_Int64 MaxSize);
 	extern PdGDSFolder GDS_File_Root(PdGDSFile File);
 
 	extern PdGDSFile GDS_Node_File(PdGDSObj Node);
@@ -210,6 +214,16 @@ extern "C" {
 	extern void GDS_Array_AppendData(PdAbstractArray Obj, ssize_t Cnt,
 		const void *InBuf, enum C_SVType InSV);
 	extern void GDS_Array_AppendString(PdAbstractArray Obj, const char *Text);
+	extern void GDS_Array_SetBufSize(PdAbstractArray Obj, C_Int64 Size,
+		C_Int64 MaxSize);
+	/// create an independent reader of Obj in a read-only GDS file, which
+	///   can be used in a thread concurrently with other readers; readers
+	///   can be created and freed in any thread, but all of them should be
+	///   freed before the file is closed, and Obj should not be read in
+	///   the meantime
+	extern PdAbstractArray GDS_Array_NewReader(PdAbstractArray Obj);
+	/// free the reader created by GDS_Array_NewReader
+	extern void GDS_Array_FreeReader(PdAbstractArray Reader);
 
 
 	// ==================================================================
@@ -251,6 +265,12 @@ extern "C" {
 	extern void GDS_Parallel_WakeUp(PdThreadsSuspending Obj);
 	extern void GDS_Parallel_RunThreads(
 		void (*Proc)(PdThread, int, void*), void *Param, int nThread);
+	/// split [0, Total) into blocks of Grain tasks, and call
+	///   Proc(Start, Count, Index, Param) on each block in at most nThread
+	///   threads; only the calling thread is used if Total <= Grain
+	extern void GDS_Parallel_RunRange(
+		void (*Proc)(C_Int64, C_Int64, int, void*), void *Param,
+		C_Int64 Total, C_Int64 Grain, int nThread);
 
 
 	// ==================================================================
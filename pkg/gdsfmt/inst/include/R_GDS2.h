@@ -145,6 +145,14 @@ COREARRAY_DLL_LOCAL PdGDSFile GDS_File_Open(const char *FileName,
 	return (*func_File_Open)(FileName, ReadOnly, ForkSupport);
 }
 
+typedef PdGDSFile (*Type_File_OpenEx)(const char *, C_BOOL, C_BOOL, C_BOOL);
+static Type_File_OpenEx func_File_OpenEx = NULL;
+COREARRAY_DLL_LOCAL PdGDSFile GDS_File_OpenEx(const char *FileName,
+	C_BOOL ReadOnly, C_BOOL ForkSupport, C_BOOL UseMMap)
+{
+	return (*func_File_OpenEx)(FileName, ReadOnly, ForkSupport, UseMMap);
+}
+
 typedef void (*Type_File_Close)(PdGDSFile);
 static Type_File_Close func_File_Close = NULL;
 COREARRAY_DLL_LOCAL void GDS_File_Close(PdGDSFile File)
@@ -159,6 +167,14 @@ COREARRAY_DLL_LOCAL void GDS_File_Sync(PdGDSFile File)
 	(*func_File_Sync)(File);
 }
 
+typedef void (*Type_File_SetBufSize)(PdGDSFile, C_Int64, C_Int64);
+static Type_File_SetBufSize func_File_SetBufSize = NULL;
+COREARRAY_DLL_LOCAL void GDS_File_SetBufSize(PdGDSFile File, C_Int64 Size,
+	C_Int64 MaxSize)
+{
+	(*func_File_SetBufSize)(File, Size, MaxSize);
+}
+
 typedef PdGDSFolder (*Type_File_Root)(PdGDSFile);
 static Type_File_Root func_File_Root = NULL;
 COREARRAY_DLL_LOCAL PdGDSFolder GDS_File_Root(PdGDSFile File)
@@ -301,6 +317,28 @@ COREARRAY_DLL_LOCAL void GDS_Array_AppendString(PdAbstractArray Obj,
 	(*func_Array_AppendString)(Obj, Text);
 }
 
+typedef void (*Type_Array_SetBufSize)(PdAbstractArray, C_Int64, C_Int64);
+static Type_Array_SetBufSize func_Array_SetBufSize = NULL;
+COREARRAY_DLL_LOCAL void GDS_Array_SetBufSize(PdAbstractArray Obj,
+	C_Int64 Size, C_Int64 MaxSize)
+{
+	(*func_Array_SetBufSize)(Obj, Size, MaxSize);
+}
+
+typedef PdAbstractArray (*Type_Array_NewReader)(PdAbstractArray);
+static Type_Array_NewReader func_Array_NewReader = NULL;
+COREARRAY_DLL_LOCAL PdAbstractArray GDS_Array_NewReader(PdAbstractArray Obj)
+{
+	return (*func_Array_NewReader)(Obj);
+}
+
+typedef void (*Type_Array_FreeReader)(PdAbstractArray);
+static Type_Array_FreeReader func_Array_FreeReader = NULL;
+COREARRAY_DLL_LOCAL void GDS_Array_FreeReader(PdAbstractArray Reader)
+{
+	(*func_Array_FreeReader)(Reader);
+}
+
 
 
 // ===========================================================================
@@ -481,6 +519,16 @@ COREARRAY_DLL_LOCAL void GDS_Parallel_RunThreads(
 	(*func_Parallel_RunThreads)(Proc, Param, nThread);
 }
 
+typedef void (*Type_Parallel_RunRange)(void (*)(C_Int64, C_Int64, int, void*),
+	void *, C_Int64, C_Int64, int);
+static Type_Parallel_RunRange func_Parallel_RunRange = NULL;
+COREARRAY_DLL_LOCAL void GDS_Parallel_RunRange(
+	void (*Proc)(C_Int64, C_Int64, int, void*), void *Param,
+	C_Int64 Total, C_Int64 Grain, int nThread)
+{
+	(*func_Parallel_RunRange)(Proc, Param, Total, Grain, nThread);
+}
+
 
 // ===========================================================================
 // functions for machine
@@ -566,8 +614,10 @@ void Init_GDS_Routines()
 
 	LOAD(func_File_Create, "GDS_File_Create");
 	LOAD(func_File_Open, "GDS_File_Open");
+	LOAD(func_File_OpenEx, "GDS_File_OpenEx");
 	LOAD(func_File_Close, "GDS_File_Close");
 	LOAD(func_File_Sync, "GDS_File_Sync");
+	LOAD(func_File_SetBufSize, "GDS_File_SetBufSize");
 	LOAD(func_File_Root, "GDS_File_Root");
 
 	LOAD(func_Node_File, "GDS_Node_File");
@@ -588,6 +638,9 @@ void Init_GDS_Routines()
 	LOAD(func_Array_WriteData, "GDS_Array_WriteData");
 	LOAD(func_Array_AppendData, "GDS_Array_AppendData");
 	LOAD(func_Array_AppendString, "GDS_Array_AppendString");
+	LOAD(func_Array_SetBufSize, "GDS_Array_SetBufSize");
+	LOAD(func_Array_NewReader, "GDS_Array_NewReader");
+	LOAD(func_Array_FreeReader, "GDS_Array_FreeReader");
 
 	LOAD(func_Iter_GetStart, "GDS_Iter_GetStart");
 	LOAD(func_Iter_GetEnd, "GDS_Iter_GetEnd");
@@ -614,6 +667,7 @@ void Init_GDS_Routines()
 	LOAD(func_Parallel_Suspend, "GDS_Parallel_Suspend");
 	LOAD(func_Parallel_WakeUp, "GDS_Parallel_WakeUp");
 	LOAD(func_Parallel_RunThreads, "GDS_Parallel_RunThreads");
+	LOAD(func_Parallel_RunRange, "GDS_Parallel_RunRange");
 
 	LOAD(func_Mach_GetNumOfCores, "GDS_Mach_GetNumOfCores");
 	LOAD(func_Mach_GetCPULevelCache, "GDS_Mach_GetCPULevelCache");
@@ -213,3 +213,618 @@ test.data.read_selection <- function()
 		unlink("tmp.gds")
 	}
 }
+
+
+test.data.read_selection_sparse <- function()
+{
+	set.seed(1000)
+	v <- sample.int(3L, 200000L, replace=TRUE) - 1L
+
+	# create a new gds file
+	gfile <- createfn.gds("tmp.gds")
+
+	nodes <- list(
+		add.gdsn(gfile, "int", val=v, storage="int32"),
+		add.gdsn(gfile, "dbl", val=v, storage="float64"),
+		add.gdsn(gfile, "bit2", val=v, storage="bit2"),
+		add.gdsn(gfile, "zip", val=v, storage="int32", compress="ZIP_RA",
+			closezip=TRUE))
+
+	# sparse and clustered selections, with long unselected runs
+	sel.list <- list(
+		seq_along(v) %in% sample.int(length(v), 20),
+		(seq_along(v) %% 50000L) < 300L,
+		seq_along(v) %in% c(1L, length(v)))
+
+	for (node in nodes)
+	{
+		for (sel in sel.list)
+		{
+			checkEquals(readex.gdsn(node, sel=sel), v[sel],
+				sprintf("sparse selection: %s", name.gdsn(node)))
+		}
+	}
+
+	# close the gds file
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
+
+
+test.data.read_write_bit2 <- function()
+{
+	set.seed(1000)
+	n <- 5003L
+	v <- as.integer(floor(runif(n) * 4))
+
+	# create a new gds file
+	gfile <- createfn.gds("tmp.gds")
+
+	# append in pieces not aligned to a byte or a 16-byte vector
+	n1 <- add.gdsn(gfile, "int", storage="bit2")
+	append.gdsn(n1, v[1:3])
+	append.gdsn(n1, v[4:70])
+	append.gdsn(n1, v[71:n])
+	n2 <- add.gdsn(gfile, "double", storage="bit2")
+	append.gdsn(n2, as.double(v[1:129]))
+	append.gdsn(n2, as.double(v[130:n]))
+
+	# write at unaligned starts
+	for (s in c(2L, 35L, 1001L))
+	{
+		w <- as.integer(floor(runif(s + 99L) * 4))
+		write.gdsn(n1, w, start=s, count=length(w))
+		write.gdsn(n2, as.double(w), start=s, count=length(w))
+		v[s:(s+length(w)-1L)] <- w
+	}
+
+	for (node in list(n1, n2))
+	{
+		nm <- name.gdsn(node)
+		checkEquals(read.gdsn(node), v, sprintf("bit2 read: %s", nm))
+		checkEquals(as.integer(read.gdsn(node, .useraw=TRUE)), v,
+			sprintf("bit2 read raw: %s", nm))
+
+		for (tp in c("uint8", "int32", "float64"))
+		{
+			# unaligned start and count
+			for (s in c(1L, 2L, 3L, 5L, 17L, 31L, 66L, 129L))
+			{
+				for (cnt in c(0L, 1L, 7L, 63L, 65L, 1027L))
+				{
+					m <- sprintf("bit2 read %s at %d with %d: %s", tp, s, cnt, nm)
+					checkEquals(.Call("gds_test_ReadAs", node, s, cnt, NULL, tp,
+						PACKAGE="gdsfmt"), as.double(v[seq_len(cnt) + s - 1L]), m)
+				}
+			}
+
+			# sparse, dense, empty and full selections
+			for (p in c(0, 0.01, 0.1, 0.5, 0.9, 0.99, 1))
+			{
+				s <- 1L + (p * 100) %% 13
+				cnt <- n - s + 1L
+				sel <- runif(cnt) < p
+				m <- sprintf("bit2 read %s with selection %g: %s", tp, p, nm)
+				checkEquals(.Call("gds_test_ReadAs", node, s, cnt, sel, tp,
+					PACKAGE="gdsfmt"), as.double(v[s:n][sel]), m)
+			}
+		}
+
+		for (p in c(0.01, 0.5, 0.99))
+		{
+			sel <- runif(n) < p
+			checkEquals(readex.gdsn(node, sel=sel), v[sel],
+				sprintf("bit2 readex: %s", nm))
+			checkEquals(as.integer(readex.gdsn(node, sel=sel, .useraw=TRUE)),
+				v[sel], sprintf("bit2 readex raw: %s", nm))
+		}
+	}
+
+	# close the gds file
+	closefn.gds(gfile)
+	gfile <- openfn.gds("tmp.gds")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int")), v, "bit2 reopen: int")
+	checkEquals(read.gdsn(index.gdsn(gfile, "double")), v, "bit2 reopen: double")
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
+
+
+test.data.read_write_nbit <- function()
+{
+	set.seed(1000)
+	n <- 1003L
+
+	for (st in c(sprintf("bit%d", 3:31), sprintf("sbit%d", 2:31)))
+	{
+		nb <- as.integer(sub("^s?bit", "", st))
+		if (substr(st, 1L, 1L) == "s")
+			rg <- c(-2^(nb-1), 2^(nb-1) - 1)
+		else
+			rg <- c(0, 2^nb - 1)
+		v <- as.integer(floor(rg[1L] + runif(n) * (rg[2L] - rg[1L] + 1)))
+		v[c(1L, 10L, n)] <- as.integer(rg[c(1L, 2L, 2L)])
+
+		# create a new gds file
+		gfile <- createfn.gds("tmp.gds")
+
+		# append in pieces not aligned to a byte or a 64-bit word
+		n1 <- add.gdsn(gfile, "data", storage=st)
+		append.gdsn(n1, v[1:7])
+		append.gdsn(n1, v[8:500])
+		append.gdsn(n1, v[501:n])
+		n2 <- add.gdsn(gfile, "zip", val=v, storage=st, compress="ZIP_RA",
+			closezip=TRUE)
+
+		for (node in list(n1, n2))
+		{
+			nm <- sprintf("%s, %s", st, name.gdsn(node))
+			checkEquals(read.gdsn(node), v, sprintf("n-bit read: %s", nm))
+
+			# unaligned start and count
+			for (s in c(2L, 3L, 5L, 9L, 13L, 64L, 67L))
+			{
+				cnt <- min(n - s + 1L, s * 7L + 1L)
+				checkEquals(read.gdsn(node, start=s, count=cnt),
+					v[s:(s+cnt-1L)], sprintf("n-bit read from %d: %s", s, nm))
+			}
+
+			# selection
+			for (p in c(0.01, 0.5, 0.95))
+			{
+				sel <- runif(n) < p
+				checkEquals(readex.gdsn(node, sel=sel), v[sel],
+					sprintf("n-bit read with selection: %s", nm))
+			}
+		}
+
+		# write at an unaligned start
+		w <- rev(v[1:100])
+		write.gdsn(n1, w, start=11, count=100)
+		v[11:110] <- w
+		checkEquals(read.gdsn(n1), v, sprintf("n-bit write: %s", st))
+
+		# close the gds file
+		closefn.gds(gfile)
+		gfile <- openfn.gds("tmp.gds")
+		checkEquals(read.gdsn(index.gdsn(gfile, "data")), v,
+			sprintf("n-bit write and reopen: %s", st))
+		closefn.gds(gfile)
+
+		unlink("tmp.gds")
+	}
+}
+
+
+test.data.read_string_random <- function()
+{
+	# create a new gds file
+	gfile <- createfn.gds("tmp.gds")
+
+	v <- paste("rs", 1:10000, sep="")
+	node <- add.gdsn(gfile, "str", val=v)
+
+	# read strings in a non-monotonic order
+	set.seed(100)
+	for (i in sample.int(length(v), 200))
+	{
+		checkEquals(read.gdsn(node, start=i, count=1), v[i],
+			"random access of variable-length strings")
+	}
+
+	# change the length of a string
+	v[1500] <- "a_very_long_string_to_shift_the_following_ones"
+	write.gdsn(node, v[1500], start=1500, count=1)
+	for (i in c(3000, 1501, 1500, 1499, 9999))
+	{
+		checkEquals(read.gdsn(node, start=i, count=1), v[i],
+			"random access of variable-length strings after writing")
+	}
+
+	# close the gds file
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
+
+
+test.data.read_string_chunk <- function()
+{
+	set.seed(1000)
+	n <- 3000L
+
+	# short, empty and long strings, some longer than the reading chunk
+	v <- paste("s", seq_len(n), sep="")
+	v[c(2L, 3L, 700L, 1024L, 2048L, 2999L)] <- ""
+	ulong <- function(len)
+		intToUtf8(c(97L, 233L, 20013L)[sample.int(3L, len, replace=TRUE)])
+	for (i in c(1L, 5L, 1023L, 1025L, 1500L, 2049L, n))
+		v[i] <- ulong(sample(c(4095L, 4097L, 9000L, 20000L), 1L))
+
+	for (st in c("string", "string16", "string32"))
+	{
+		# create a new gds file
+		gfile <- createfn.gds("tmp.gds")
+		add.gdsn(gfile, "str", val=v, storage=st)
+		add.gdsn(gfile, "zip", val=v, storage=st, compress="ZIP_RA",
+			closezip=TRUE)
+		closefn.gds(gfile)
+
+		for (nm in c("str", "zip"))
+		{
+			# the offset index is empty after opening the file
+			gfile <- openfn.gds("tmp.gds")
+			node <- index.gdsn(gfile, nm)
+			m <- sprintf("%s, %s", st, nm)
+
+			# start in the middle of an index interval, backward
+			for (s in c(2500L, 1500L, 1030L, 700L, 2L))
+			{
+				cnt <- min(n - s + 1L, 600L)
+				checkEquals(read.gdsn(node, start=s, count=cnt),
+					v[s:(s+cnt-1L)], sprintf("read strings from %d: %s", s, m))
+			}
+			checkEquals(read.gdsn(node, start=n, count=1L), v[n],
+				sprintf("read the last string: %s", m))
+			checkEquals(read.gdsn(node), v, sprintf("read strings: %s", m))
+
+			# sparse and dense selections
+			for (p in c(0.001, 0.01, 0.5, 0.99))
+			{
+				sel <- runif(n) < p
+				checkEquals(readex.gdsn(node, sel=sel), v[sel],
+					sprintf("read strings with selection %g: %s", p, m))
+			}
+			sel <- rep(FALSE, n)
+			sel[c(4L, 1025L, 1026L, 2049L)] <- TRUE
+			checkEquals(readex.gdsn(node, sel=sel), v[sel],
+				sprintf("read long strings with selection: %s", m))
+
+			closefn.gds(gfile)
+		}
+
+		unlink("tmp.gds")
+	}
+}
+
+
+test.data.read_mmap <- function()
+{
+	# create a new gds file
+	gfile <- createfn.gds("tmp.gds")
+
+	set.seed(1000)
+	v1 <- as.integer(runif(100000) * 1000)
+	v2 <- paste("rs", 1:10000, sep="")
+	add.gdsn(gfile, "int", val=v1)
+	add.gdsn(gfile, "zip", val=v1, compress="ZIP_RA", closezip=TRUE)
+	add.gdsn(gfile, "str", val=v2)
+	closefn.gds(gfile)
+
+	# open the file via memory mapping
+	gfile <- openfn.gds("tmp.gds", use.mmap=TRUE)
+	checkEquals(read.gdsn(index.gdsn(gfile, "int")), v1, "mmap: int")
+	checkEquals(read.gdsn(index.gdsn(gfile, "zip")), v1, "mmap: ZIP_RA")
+	checkEquals(read.gdsn(index.gdsn(gfile, "str")), v2, "mmap: string")
+	sel <- runif(length(v1)) < 0.01
+	checkEquals(readex.gdsn(index.gdsn(gfile, "int"), sel), v1[sel],
+		"mmap: selection")
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
+
+test.data.read_concurrent <- function()
+{
+	# create a new gds file
+	gfile <- createfn.gds("tmp.gds")
+
+	set.seed(1000)
+	v1 <- as.integer(runif(200000) * 1000)
+	m <- matrix(sample(0:3, 200*1001, replace=TRUE), nrow=200)
+	add.gdsn(gfile, "int", val=v1)
+	add.gdsn(gfile, "zip", val=v1, compress="ZIP", closezip=TRUE)
+	add.gdsn(gfile, "zip_ra", val=v1, compress="ZIP_RA:16K", closezip=TRUE)
+	add.gdsn(gfile, "lz4_ra", val=v1, compress="LZ4_RA:16K", closezip=TRUE)
+	add.gdsn(gfile, "bit2", val=m, storage="bit2")
+	add.gdsn(gfile, "bit2_ra", val=m, storage="bit2", compress="ZIP_RA:16K",
+		closezip=TRUE)
+	add.gdsn(gfile, "float", val=v1/7, compress="LZ4", closezip=TRUE)
+	closefn.gds(gfile)
+
+	# independent readers in threads, compared with the serial reading
+	gfile <- openfn.gds("tmp.gds")
+	for (nm in c("int", "zip", "zip_ra", "lz4_ra", "bit2", "bit2_ra", "float"))
+	{
+		n <- index.gdsn(gfile, nm)
+		v <- as.double(read.gdsn(n))
+		for (nt in c(1L, 4L))
+		{
+			checkEquals(.Call("gds_test_Reader", n, nt, PACKAGE="gdsfmt"), v,
+				sprintf("concurrent readers: %s, %d thread(s)", nm, nt))
+		}
+	}
+	closefn.gds(gfile)
+
+	# not allowed in a writable file
+	gfile <- openfn.gds("tmp.gds", readonly=FALSE)
+	checkException(.Call("gds_test_Reader", index.gdsn(gfile, "int"), 2L,
+		PACKAGE="gdsfmt"), "concurrent readers: writable", silent=TRUE)
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
+
+
+test.data.bufsize <- function()
+{
+	# create a new gds file
+	gfile <- createfn.gds("tmp.gds")
+
+	set.seed(1000)
+	v1 <- as.integer(runif(100000) * 1000)
+	m <- matrix(sample(0:3, 250*401, replace=TRUE), nrow=250)
+	n1 <- add.gdsn(gfile, "int", val=v1)
+	n2 <- add.gdsn(gfile, "bit2", val=m, storage="bit2", compress="ZIP_RA:16K",
+		closezip=TRUE)
+	fd <- addfolder.gdsn(gfile, "folder")
+
+	# the defaults
+	checkEquals(bufsize.gds(gfile), list(size=4096, max.size=1048576),
+		"bufsize.gds: default")
+	checkEquals(bufsize.gdsn(n1)[1:2], list(size=4096, max.size=1048576),
+		"bufsize.gdsn: default")
+
+	# the setting of the file applies to all nodes
+	checkEquals(bufsize.gds(gfile, size=8192, max.size=65536),
+		list(size=8192, max.size=65536), "bufsize.gds: set")
+	checkEquals(bufsize.gdsn(n1)[1:2], list(size=8192, max.size=65536),
+		"bufsize.gdsn: file setting")
+	checkEquals(bufsize.gdsn(n2)[1:2], list(size=8192, max.size=65536),
+		"bufsize.gdsn: file setting")
+
+	# the setting of a node overrides the file setting
+	checkEquals(bufsize.gdsn(n1, size=1024, max.size=4096)[1:2],
+		list(size=1024, max.size=4096), "bufsize.gdsn: set")
+	bufsize.gds(gfile, size=16384)
+	checkEquals(bufsize.gdsn(n1)[1:2], list(size=1024, max.size=4096),
+		"bufsize.gdsn: node setting")
+	checkEquals(bufsize.gdsn(n2)[1:2], list(size=16384, max.size=65536),
+		"bufsize.gdsn: file setting")
+	checkEquals(bufsize.gdsn(n1, size=0, max.size=0)[1:2],
+		list(size=16384, max.size=65536), "bufsize.gdsn: reset")
+
+	checkException(bufsize.gds(gfile, size=-1), silent=TRUE)
+	checkException(bufsize.gdsn(n1, max.size=NaN), silent=TRUE)
+	checkException(bufsize.gdsn(fd), silent=TRUE)
+
+	closefn.gds(gfile)
+
+	# read with different buffer sizes
+	gfile <- openfn.gds("tmp.gds")
+	n1 <- index.gdsn(gfile, "int")
+	n2 <- index.gdsn(gfile, "bit2")
+	for (sz in list(c(16, 16), c(16, 1024*1024), c(4096, 0), c(65536, 65536)))
+	{
+		bufsize.gdsn(n1, size=sz[1], max.size=sz[2])
+		bufsize.gdsn(n2, size=sz[1], max.size=sz[2])
+		s <- sprintf("bufsize (%g, %g)", sz[1], sz[2])
+		checkEquals(read.gdsn(n1), v1, s)
+		checkEquals(read.gdsn(n2), m, s)
+		checkEquals(readex.gdsn(n2, list(seq(1, 250, 3), NULL)),
+			m[seq(1, 250, 3), ], s)
+		checkEquals(apply.gdsn(n2, 2, FUN=sum), colSums(m), s)
+
+		# the buffer grown in a scan is released at the end
+		b <- bufsize.gdsn(n1)
+		checkEquals(b$current, b$size, paste(s, "read.gdsn"))
+		b <- bufsize.gdsn(n2)
+		checkEquals(b$current, b$size, paste(s, "apply.gdsn"))
+	}
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
+
+
+
+test.data.blocktable <- function()
+{
+	# create a new gds file with a table of blocks
+	gfile <- createfn.gds("tmp.gds")
+	blocktable.gds(gfile, enable=TRUE)
+
+	set.seed(1000)
+	v1 <- as.integer(runif(10000) * 1000)
+	n1 <- add.gdsn(gfile, "int1", val=integer(0))
+	n2 <- add.gdsn(gfile, "int2", val=integer(0))
+	for (i in 1:10)
+	{
+		append.gdsn(n1, v1)
+		append.gdsn(n2, rev(v1))
+	}
+	add.gdsn(gfile, "tmp", val=v1)
+	delete.gdsn(index.gdsn(gfile, "tmp"))
+	closefn.gds(gfile)
+
+	# open the file with the table
+	gfile <- openfn.gds("tmp.gds")
+	checkTrue(blocktable.gds(gfile)$loaded, "block table: loaded")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int1")), rep(v1, 10),
+		"block table: int1")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int2")), rep(rev(v1), 10),
+		"block table: int2")
+	closefn.gds(gfile)
+
+	# modify the file, and the table should be rewritten
+	gfile <- openfn.gds("tmp.gds", readonly=FALSE)
+	append.gdsn(index.gdsn(gfile, "int1"), v1)
+	closefn.gds(gfile)
+
+	gfile <- openfn.gds("tmp.gds")
+	checkTrue(blocktable.gds(gfile)$loaded, "block table: reloaded")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int1")), rep(v1, 11),
+		"block table: appended")
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
+
+test.data.blocktable_stale <- function()
+{
+	# create a new gds file with a table of blocks
+	gfile <- createfn.gds("tmp.gds")
+	blocktable.gds(gfile, enable=TRUE)
+
+	set.seed(1000)
+	v1 <- as.integer(runif(10000) * 1000)
+	n1 <- add.gdsn(gfile, "int1", val=integer(0))
+	n2 <- add.gdsn(gfile, "int2", val=integer(0))
+	for (i in 1:10)
+	{
+		append.gdsn(n1, v1)
+		append.gdsn(n2, rev(v1))
+	}
+	closefn.gds(gfile)
+
+	# the position of the table in the footer
+	s <- file.size("tmp.gds")
+	buf <- readBin("tmp.gds", "raw", s)
+	tab.pos <- sum(as.integer(buf[(s-17):(s-12)]) * 256^(0:5))
+
+	# modify the file in place without the table, as an older version does
+	gfile <- openfn.gds("tmp.gds", readonly=FALSE)
+	blocktable.gds(gfile, enable=FALSE)
+	delete.gdsn(index.gdsn(gfile, "int2"))
+	closefn.gds(gfile)
+	checkEquals(file.size("tmp.gds"), tab.pos, "stale block table: in place")
+
+	# restore the stale table at the end of the file
+	con <- file("tmp.gds", "ab")
+	writeBin(buf[(tab.pos+1):s], con)
+	close(con)
+
+	# the stale table should be ignored
+	gfile <- openfn.gds("tmp.gds")
+	checkTrue(!blocktable.gds(gfile)$loaded, "stale block table: not loaded")
+	checkEquals(ls.gdsn(gfile), "int1", "stale block table: nodes")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int1")), rep(v1, 10),
+		"stale block table: int1")
+	closefn.gds(gfile)
+
+	# the freed blocks can be reused
+	gfile <- openfn.gds("tmp.gds", readonly=FALSE)
+	add.gdsn(gfile, "int3", val=v1)
+	closefn.gds(gfile)
+	gfile <- openfn.gds("tmp.gds")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int1")), rep(v1, 10),
+		"stale block table: int1 after writing")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int3")), v1,
+		"stale block table: int3")
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
+
+test.data.blocktable_reuse <- function()
+{
+	# create a new gds file with a table of blocks
+	gfile <- createfn.gds("tmp.gds")
+	blocktable.gds(gfile, enable=TRUE)
+
+	set.seed(1000)
+	v1 <- as.integer(runif(10000) * 1000)
+	v2 <- as.integer(runif(1000) * 1000)
+	add.gdsn(gfile, "int1", val=v1)
+	add.gdsn(gfile, "int2", val=v1)
+	add.gdsn(gfile, "int3", val=v1)
+	closefn.gds(gfile)
+
+	# the blocks of the deleted node are unused in the table
+	gfile <- openfn.gds("tmp.gds", readonly=FALSE)
+	delete.gdsn(index.gdsn(gfile, "int2"))
+	closefn.gds(gfile)
+
+	s <- file.size("tmp.gds")
+	buf <- readBin("tmp.gds", "raw", s)
+	tab.pos <- sum(as.integer(buf[(s-17):(s-12)]) * 256^(0:5))
+
+	# reuse the unused blocks without the table, as an older version does
+	gfile <- openfn.gds("tmp.gds", readonly=FALSE)
+	blocktable.gds(gfile, enable=FALSE)
+	add.gdsn(gfile, "int4", val=v2)
+	closefn.gds(gfile)
+	checkEquals(file.size("tmp.gds"), tab.pos, "reused blocks: in place")
+
+	# restore the stale table at the end of the file
+	con <- file("tmp.gds", "ab")
+	writeBin(buf[(tab.pos+1):s], con)
+	close(con)
+
+	# the stale table should be ignored
+	gfile <- openfn.gds("tmp.gds")
+	checkTrue(!blocktable.gds(gfile)$loaded, "reused blocks: not loaded")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int4")), v2,
+		"reused blocks: the new node")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int1")), v1, "reused blocks: int1")
+	checkEquals(read.gdsn(index.gdsn(gfile, "int3")), v1, "reused blocks: int3")
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
+
+
+test.data.pin_cache <- function()
+{
+	# create a new gds file
+	gfile <- createfn.gds("tmp.gds")
+
+	set.seed(1000)
+	v1 <- as.integer(runif(100000) * 1000)
+	v2 <- paste("rs", 1:10000, sep="")
+	add.gdsn(gfile, "int", val=v1)
+	add.gdsn(gfile, "zip", val=v1, compress="ZIP", closezip=TRUE)
+	add.gdsn(gfile, "str", val=v2, compress="LZ4", closezip=TRUE)
+	closefn.gds(gfile)
+
+	# pin the nodes in memory
+	pincache.gds(clear=TRUE)
+	gfile <- openfn.gds("tmp.gds")
+	for (nm in c("int", "zip", "str"))
+		cache.gdsn(index.gdsn(gfile, nm), pin=TRUE)
+	s <- pincache.gds()
+	checkEquals(s$num.node, 3L, "pin cache: num.node")
+	checkTrue(s$size >= 2*4*length(v1), "pin cache: size")
+
+	sel <- runif(length(v1)) < 0.01
+	checkEquals(read.gdsn(index.gdsn(gfile, "int")), v1, "pin cache: int")
+	checkEquals(read.gdsn(index.gdsn(gfile, "zip")), v1, "pin cache: ZIP")
+	checkEquals(readex.gdsn(index.gdsn(gfile, "zip"), sel), v1[sel],
+		"pin cache: ZIP with selection")
+	checkEquals(read.gdsn(index.gdsn(gfile, "str")), v2, "pin cache: string")
+	checkEquals(read.gdsn(index.gdsn(gfile, "str"), start=5000, count=10),
+		v2[5000:5009], "pin cache: string, random access")
+
+	# the least recently pinned nodes are released
+	s <- pincache.gds(max.size=4*length(v1) + 100)
+	checkEquals(s$num.node, 1L, "pin cache: shrink")
+	checkEquals(read.gdsn(index.gdsn(gfile, "zip")), v1,
+		"pin cache: ZIP after shrinking")
+	closefn.gds(gfile)
+	checkEquals(pincache.gds()$num.node, 0L, "pin cache: closing the file")
+
+	# writing to a pinned node
+	pincache.gds(max.size=2^30)
+	gfile <- openfn.gds("tmp.gds", readonly=FALSE)
+	n <- index.gdsn(gfile, "int")
+	cache.gdsn(n, pin=TRUE)
+	write.gdsn(n, 1:10, start=11, count=10)
+	v1[11:20] <- 1:10
+	checkEquals(read.gdsn(n), v1, "pin cache: writing")
+	checkEquals(pincache.gds()$num.node, 0L, "pin cache: unpinned by writing")
+	closefn.gds(gfile)
+
+	unlink("tmp.gds")
+}
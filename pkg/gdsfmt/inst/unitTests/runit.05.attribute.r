@@ -37,3 +37,142 @@ test.data.attribute <- function()
 	closefn.gds(gfile)
 	unlink("tmp.gds")
 }
+
+
+test.data.attribute_index <- function()
+{
+	# create a new gds file
+	gfile <- createfn.gds("tmp.gds")
+	node <- add.gdsn(gfile, "data", val=1L)
+
+	# more attributes than needed to build the name index
+	val <- as.list(1:40)
+	names(val) <- sprintf("a%02d", 1:40)
+	for (i in names(val))
+		put.attr.gdsn(node, i, val[[i]])
+	checkEquals(get.attr.gdsn(node), val, "attribute index: add")
+
+	# replace and delete
+	put.attr.gdsn(node, "a05", 100L)
+	val$a05 <- 100L
+	delete.attr.gdsn(node, "a10")
+	val$a10 <- NULL
+	checkEquals(get.attr.gdsn(node), val, "attribute index: replace and delete")
+
+	# rename by name and by index
+	.Call("gds_test_RenameAttr", node, "a20", "r20", PACKAGE="gdsfmt")
+	names(val)[names(val) == "a20"] <- "r20"
+	.Call("gds_test_RenameAttr", node, 1L, "first", PACKAGE="gdsfmt")
+	names(val)[1L] <- "first"
+	.Call("gds_test_RenameAttr", node, "a30", "a30", PACKAGE="gdsfmt")
+	checkException(.Call("gds_test_RenameAttr", node, "a31", "a32",
+		PACKAGE="gdsfmt"), silent=TRUE)
+	checkException(.Call("gds_test_RenameAttr", node, 2L, "r20",
+		PACKAGE="gdsfmt"), silent=TRUE)
+	checkException(.Call("gds_test_RenameAttr", node, "a20", "x",
+		PACKAGE="gdsfmt"), silent=TRUE)
+	checkEquals(get.attr.gdsn(node), val, "attribute index: rename")
+
+	# the old names can be used again
+	put.attr.gdsn(node, "a20", 200L)
+	val$a20 <- 200L
+	put.attr.gdsn(node, "r20", 20L)
+	checkEquals(get.attr.gdsn(node), val, "attribute index: reuse")
+
+	# close and reopen the gds file
+	closefn.gds(gfile)
+	gfile <- openfn.gds("tmp.gds", readonly=FALSE)
+	node <- index.gdsn(gfile, "data")
+	checkEquals(get.attr.gdsn(node), val, "attribute index: reopen")
+	put.attr.gdsn(node, "a40", 400L)
+	val$a40 <- 400L
+	delete.attr.gdsn(node, "first")
+	val$first <- NULL
+	checkEquals(get.attr.gdsn(node), val, "attribute index: reopen and modify")
+
+	# close the gds file
+	closefn.gds(gfile)
+	unlink("tmp.gds")
+}
+
+
+test.folder.name_index <- function()
+{
+	.check <- function(dir, val, msg)
+	{
+		checkEquals(ls.gdsn(dir), names(val), msg)
+		for (i in names(val))
+		{
+			checkEquals(read.gdsn(index.gdsn(dir, i)), val[[i]],
+				paste(msg, i, sep=": "))
+		}
+		checkTrue(is.null(index.gdsn(dir, "none", silent=TRUE)), msg)
+	}
+
+	# create a new gds file
+	gfile <- createfn.gds("tmp.gds")
+	dir <- addfolder.gdsn(gfile, "dir")
+
+	# more nodes than needed to build the name index
+	val <- as.list(1:40)
+	names(val) <- sprintf("n%02d", 1:40)
+	for (i in names(val))
+		add.gdsn(dir, i, val=val[[i]])
+	.check(dir, val, "folder index: add")
+	checkException(add.gdsn(dir, "n02", val=0L), silent=TRUE)
+
+	# replace a node in place
+	add.gdsn(dir, "n05", val=100L, replace=TRUE)
+	val$n05 <- 100L
+	.check(dir, val, "folder index: replace")
+
+	# insert a node before "n03"
+	moveto.gdsn(add.gdsn(dir, "ins", val=0L), index.gdsn(dir, "n03"),
+		relpos="before")
+	val <- c(val[1:2], list(ins=0L), val[-(1:2)])
+	.check(dir, val, "folder index: insert")
+
+	# move "n01" after "n35"
+	moveto.gdsn(index.gdsn(dir, "n01"), index.gdsn(dir, "n35"),
+		relpos="after")
+	k <- match("n35", names(val))
+	val <- c(val[2:k], val[1L], val[-(1:k)])
+	.check(dir, val, "folder index: move")
+
+	# delete
+	delete.gdsn(index.gdsn(dir, "n10"))
+	val$n10 <- NULL
+	.check(dir, val, "folder index: delete")
+
+	# rename
+	rename.gdsn(index.gdsn(dir, "n20"), "r20")
+	names(val)[names(val) == "n20"] <- "r20"
+	checkException(rename.gdsn(index.gdsn(dir, "n21"), "n22"), silent=TRUE)
+	.check(dir, val, "folder index: rename")
+	add.gdsn(dir, "n20", val=200L)
+	val$n20 <- 200L
+	.check(dir, val, "folder index: reuse a name")
+
+	# "n30" replaces "n31" and takes its name
+	moveto.gdsn(index.gdsn(dir, "n30"), index.gdsn(dir, "n31"),
+		relpos="replace")
+	k <- match("n31", names(val))
+	val[[k]] <- val$n30
+	val$n30 <- NULL
+	.check(dir, val, "folder index: move and replace")
+
+	# close and reopen the gds file
+	closefn.gds(gfile)
+	gfile <- openfn.gds("tmp.gds", readonly=FALSE)
+	dir <- index.gdsn(gfile, "dir")
+	.check(dir, val, "folder index: reopen")
+	delete.gdsn(index.gdsn(dir, "ins"))
+	val$ins <- NULL
+	rename.gdsn(index.gdsn(dir, "n40"), "r40")
+	names(val)[names(val) == "n40"] <- "r40"
+	.check(dir, val, "folder index: reopen and modify")
+
+	# close the gds file
+	closefn.gds(gfile)
+	unlink("tmp.gds")
+}
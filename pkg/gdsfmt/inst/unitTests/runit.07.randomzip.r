@@ -142,3 +142,153 @@ test.random_access_2 <- function()
 	# delete the GDS file
 	unlink("tmp.gds")
 }
+
+
+test.random_access_cache <- function()
+{
+	####  cteate a GDS file  ####
+	f <- createfn.gds("tmp.gds")
+
+	set.seed(1000)
+	v <- matrix(as.integer(rnorm(1000000) >= 0), nrow=1000)
+
+	n1 <- add.gdsn(f, "I1", val=v, compress="ZIP_RA:16K", closezip=TRUE)
+	n2 <- add.gdsn(f, "I2", val=v, compress="LZ4_RA:16K", closezip=TRUE)
+
+	sel <- list(rep(c(TRUE, FALSE, FALSE), length.out=1000),
+		rep(c(FALSE, TRUE), length.out=1000))
+
+	# disabled by default
+	s <- blockcache.gds(f)
+	checkEquals(c(s$max.size, s$readahead), c(0, 0), "block cache, default")
+	checkEquals(readex.gdsn(n1, sel), v[sel[[1]], sel[[2]]],
+		"block cache (default), ZIP_RA")
+	checkEquals(blockcache.gds(f)$size, 0, "block cache (default), size")
+
+	for (sz in c(0, 64*1024, 16*1024*1024))
+	{
+		s <- blockcache.gds(f, max.size=sz, reset=TRUE)
+		checkEquals(s$max.size, sz, "block cache, max.size")
+
+		z1 <- readex.gdsn(n1, sel)
+		z2 <- readex.gdsn(n2, sel)
+		checkEquals(z1, v[sel[[1]], sel[[2]]],
+			sprintf("block cache (%g), ZIP_RA", sz))
+		checkEquals(z2, v[sel[[1]], sel[[2]]],
+			sprintf("block cache (%g), LZ4_RA", sz))
+
+		s <- blockcache.gds(f)
+		checkTrue(s$size <= max(sz, 2^20), "block cache, size")
+		if (sz > 0)
+			checkTrue(s$hit > 0, "block cache, hit")
+	}
+
+	# read-ahead
+	s <- blockcache.gds(f, readahead=4)
+	checkEquals(s$readahead, 4L, "block cache, readahead")
+	checkEquals(read.gdsn(n1), v, "read-ahead, ZIP_RA")
+	checkEquals(read.gdsn(n2), v, "read-ahead, LZ4_RA")
+	checkEquals(readex.gdsn(n1, sel), v[sel[[1]], sel[[2]]],
+		"read-ahead, ZIP_RA with selection")
+
+	# close the file
+	closefn.gds(f)
+
+	# delete the GDS file
+	unlink("tmp.gds")
+}
+
+
+test.random_access_thread <- function()
+{
+	####  cteate a GDS file  ####
+	f <- createfn.gds("tmp.gds")
+
+	set.seed(1000)
+	v <- as.integer(rnorm(1000000) >= 0)
+
+	for (cp in c("ZIP_RA:16K:4T", "ZIP_RA.max:2T", "LZ4_RA.fast:16K:4T",
+		"LZ4_RA:3T"))
+	{
+		n <- add.gdsn(f, "I", val=v, compress=cp, closezip=TRUE,
+			replace=TRUE)
+		checkEquals(read.gdsn(n), v, sprintf("multithreaded %s", cp))
+
+		set.seed(1000)
+		idx <- sample.int(length(v), 100)
+		vv <- rep.int(0L, length(idx))
+		for (i in 1:length(idx))
+			vv[i] <- read.gdsn(n, start=idx[i], count=1)
+		checkEquals(vv, v[idx], sprintf("multithreaded %s, random access", cp))
+	}
+
+	# close the file
+	closefn.gds(f)
+
+	# delete the GDS file
+	unlink("tmp.gds")
+}
+
+
+test.thread_pool <- function()
+{
+	# all threads are called
+	checkEquals(.Call("gds_test_ThreadPool", 4L, -1L, PACKAGE="gdsfmt"),
+		rep(1L, 4), "thread pool")
+
+	# the calling thread (0) or a worker throws an exception
+	for (i in 0:3)
+	{
+		checkException(.Call("gds_test_ThreadPool", 4L, i, PACKAGE="gdsfmt"),
+			sprintf("thread pool, an exception in thread %d", i), silent=TRUE)
+	}
+
+	# the pool is still usable
+	checkEquals(.Call("gds_test_ThreadPool", 8L, -1L, PACKAGE="gdsfmt"),
+		rep(1L, 8), "thread pool, after exceptions")
+}
+
+
+test.thread_grain <- function()
+{
+	for (n in c(1L, 5L, 64L, 1000L, 10007L))
+	{
+		for (grain in c(1L, 3L, 64L, 5000L))
+		{
+			for (nt in c(1L, 2L, 3L, 7L))
+			{
+				v <- .Call("gds_test_Grain", n, grain, nt, PACKAGE="gdsfmt")
+				s <- sprintf("(n: %d, grain: %d, %d threads)", n, grain, nt)
+				checkEquals(v[, 1L], rep(1L, n), paste("RunRange", s))
+				checkEquals(v[, 2L], seq_len(n), paste("CParallelSection", s))
+				checkEquals(v[, 3L], rep(1L, n), paste("CParallelQueue", s))
+			}
+		}
+	}
+}
+
+
+test.zstd <- function()
+{
+	####  cteate a GDS file  ####
+	f <- createfn.gds("tmp.gds")
+
+	set.seed(1000)
+	v <- as.integer(rnorm(1000000) >= 0)
+
+	for (cp in c("ZSTD", "ZSTD.max", "ZSTD_RA", "ZSTD_RA.fast:16K",
+		"ZSTD_RA:16K:4T"))
+	{
+		n <- add.gdsn(f, "I", val=v, compress=cp, closezip=TRUE,
+			replace=TRUE)
+		checkEquals(read.gdsn(n), v, cp)
+		checkEquals(read.gdsn(n, start=123457, count=100),
+			v[123457:123556], sprintf("%s, start=123457", cp))
+	}
+
+	# close the file
+	closefn.gds(f)
+
+	# delete the GDS file
+	unlink("tmp.gds")
+}
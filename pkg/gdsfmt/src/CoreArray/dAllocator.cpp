@@ -27,6 +27,7 @@
 
 #include "dAllocator.h"
 #include <cctype>
+#include <cstring>
 #include <limits>
 
 #ifndef COREARRAY_NO_STD_IN_OUT
@@ -98,6 +99,35 @@ void CdAllocator::_BufSetPos(CdAllocator &Obj, SIZE64 NewPos)
 	{ Obj._BufStream->SetPosition(NewPos); }
 void CdAllocator::_BufRead(CdAllocator &Obj, void *Buffer, ssize_t Count)
 	{ Obj._BufStream->ReadData(Buffer, Count); }
+void CdAllocator::_MemRead(CdAllocator &Obj, void *Buffer, ssize_t Count)
+{
+	// small blocks are served by the buffer
+	if (Count < (ssize_t)sizeof(C_UInt64)*8)
+	{
+		Obj._BufStream->ReadData(Buffer, Count);
+		return;
+	}
+	// copy directly from the memory-mapped file
+	CdBufStream &Buf = *Obj._BufStream;
+	SIZE64 Pos = Buf.Position();
+	C_UInt8 *p = (C_UInt8*)Buffer;
+	while (Count > 0)
+	{
+		SIZE64 L = 0;
+		const void *ptr = Buf.Stream()->MemPtr(Pos, L);
+		if (!ptr)
+		{
+			// e.g., compression pipe
+			Buf.SetPosition(Pos);
+			Buf.ReadData(p, Count);
+			return;
+		}
+		if (L > Count) L = Count;
+		memcpy(p, ptr, L);
+		p += L; Pos += L; Count -= L;
+	}
+	Buf.SetPosition(Pos);
+}
 C_UInt8 CdAllocator::_BufR8b(CdAllocator &Obj)
 	{ return Obj._BufStream->R8b(); }
 C_UInt16 CdAllocator::_BufR16b(CdAllocator &Obj)
@@ -144,10 +174,82 @@ void CdAllocator::_NoW32b(CdAllocator &Obj, C_UInt32 val)
 void CdAllocator::_NoW64b(CdAllocator &Obj, C_UInt64 val)
 	{ throw ErrAllocWrite(); }
 
+// Pinned in memory
+
+/// the pinned data and the saved allocator functions
+struct CdAllocator::TPinInfo
+{
+	const C_UInt8 *Data;  ///< the pinned data
+	SIZE64 Size;          ///< the size of pinned data
+	SIZE64 Pos;           ///< the current position
+
+	TAllocFree    _Free;
+	TAllocGetSize _GetSize;
+	TAllocSetSize _SetSize;
+	TAllocGetPos  _GetPos;
+	TAllocSetPos  _SetPos;
+	TAllocRead    _Read;
+	TAllocR8b     _R8b;
+	TAllocR16b    _R16b;
+	TAllocR32b    _R32b;
+	TAllocR64b    _R64b;
+	TAllocWrite   _Write;
+	TAllocW8b     _W8b;
+	TAllocW16b    _W16b;
+	TAllocW32b    _W32b;
+	TAllocW64b    _W64b;
+};
+
+void CdAllocator::_PinFree(CdAllocator &Obj)
+{
+	Obj.Unpin();
+	(*Obj._Free)(Obj);
+}
+SIZE64 CdAllocator::_PinGetSize(CdAllocator &Obj)
+	{ return (*Obj._Pin->_GetSize)(Obj); }
+void CdAllocator::_PinSetSize(CdAllocator &Obj, SIZE64 NewSize)
+	{ Obj.Unpin(); Obj.SetSize(NewSize); }
+SIZE64 CdAllocator::_PinGetPos(CdAllocator &Obj)
+	{ return Obj._Pin->Pos; }
+void CdAllocator::_PinSetPos(CdAllocator &Obj, SIZE64 NewPos)
+	{ Obj._Pin->Pos = NewPos; }
+void CdAllocator::_PinRead(CdAllocator &Obj, void *Buffer, ssize_t Count)
+{
+	TPinInfo &P = *Obj._Pin;
+	if ((P.Pos >= 0) && (P.Pos + Count <= P.Size))
+	{
+		memcpy(Buffer, P.Data + P.Pos, Count);
+	} else {
+		// out of the pinned data
+		(*P._SetPos)(Obj, P.Pos);
+		(*P._Read)(Obj, Buffer, Count);
+	}
+	P.Pos += Count;
+}
+C_UInt8 CdAllocator::_PinR8b(CdAllocator &Obj)
+	{ C_UInt8 v; _PinRead(Obj, &v, sizeof(v)); return v; }
+C_UInt16 CdAllocator::_PinR16b(CdAllocator &Obj)
+	{ C_UInt16 v; _PinRead(Obj, &v, sizeof(v)); return v; }
+C_UInt32 CdAllocator::_PinR32b(CdAllocator &Obj)
+	{ C_UInt32 v; _PinRead(Obj, &v, sizeof(v)); return v; }
+C_UInt64 CdAllocator::_PinR64b(CdAllocator &Obj)
+	{ C_UInt64 v; _PinRead(Obj, &v, sizeof(v)); return v; }
+void CdAllocator::_PinWrite(CdAllocator &Obj, const void *Buffer, ssize_t Count)
+	{ Obj.Unpin(); Obj.WriteData(Buffer, Count); }
+void CdAllocator::_PinW8b(CdAllocator &Obj, C_UInt8 val)
+	{ Obj.Unpin(); Obj.W8b(val); }
+void CdAllocator::_PinW16b(CdAllocator &Obj, C_UInt16 val)
+	{ Obj.Unpin(); Obj.W16b(val); }
+void CdAllocator::_PinW32b(CdAllocator &Obj, C_UInt32 val)
+	{ Obj.Unpin(); Obj.W32b(val); }
+void CdAllocator::_PinW64b(CdAllocator &Obj, C_UInt64 val)
+	{ Obj.Unpin(); Obj.W64b(val); }
+
 
 CdAllocator::CdAllocator()
 {
 	_BufStream = NULL;
+	_Pin = NULL;
 	Initialize();
 }
 
@@ -190,7 +292,8 @@ void CdAllocator::Initialize(CdStream &Stream, bool CanRead, bool CanWrite)
 	if (CanRead)
 	{
 		_GetSize = _BufGetSize;
-		_Read = _BufRead;
+		SIZE64 n;
+		_Read = (!CanWrite && Stream.MemPtr(0, n)) ? _MemRead : _BufRead;
 		_R8b  = _BufR8b;  _R16b = _BufR16b;
 		_R32b = _BufR32b; _R64b = _BufR64b;
 	} else {
@@ -220,6 +323,27 @@ void CdAllocator::Free()
 	_BufStream = NULL;
 }
 
+ssize_t CdAllocator::Read(void *Buffer, ssize_t Count)
+{
+	if (_Pin)
+	{
+		TPinInfo &P = *_Pin;
+		if ((P.Pos >= 0) && (P.Pos < P.Size))
+		{
+			if (Count > P.Size - P.Pos) Count = P.Size - P.Pos;
+			memcpy(Buffer, P.Data + P.Pos, Count);
+			P.Pos += Count;
+			return Count;
+		}
+		// out of the pinned data
+		(*P._SetPos)(*this, P.Pos);
+		ssize_t n = _BufStream->Read(Buffer, Count);
+		P.Pos += n;
+		return n;
+	} else
+		return _BufStream->Read(Buffer, Count);
+}
+
 void CdAllocator::Move(SIZE64 Src, SIZE64 Dst, SIZE64 Size)
 {
 	if ((Size > 0) && (Src != Dst))
@@ -308,6 +432,240 @@ void CdAllocator::CopyTo(CdBufStream &Obj, SIZE64 Pos, SIZE64 Count)
 }
 
 
+bool CdAllocator::Pin(SIZE64 Size)
+{
+	if (_Pin)
+	{
+		if (_Pin->Size == Size)
+		{
+			dAllocPinCache.Touch(this);
+			return true;
+		}
+		Unpin();
+	}
+	if ((_Read == _InitRead) || (_Read == _NoRead) || (Size < 0))
+		return false;
+
+	C_UInt8 *Buf = dAllocPinCache.Add(this, Size);
+	if (!Buf) return false;
+
+	SIZE64 SavePos = 0;
+	try {
+		SavePos = Position();
+		SetPosition(0);
+		for (SIZE64 p=0; p < Size; )
+		{
+			SIZE64 L = Size - p;
+			if (L > 0x1000000) L = 0x1000000;
+			ReadData(Buf + p, L);
+			p += L;
+		}
+		SetPosition(SavePos);
+	}
+	catch (...) {
+		dAllocPinCache.Remove(this);
+		throw;
+	}
+
+	// save the functions
+	TPinInfo *I = new TPinInfo;
+	I->Data = Buf; I->Size = Size; I->Pos = SavePos;
+	I->_Free = _Free;   I->_GetSize = _GetSize; I->_SetSize = _SetSize;
+	I->_GetPos = _GetPos; I->_SetPos = _SetPos;
+	I->_Read = _Read;   I->_R8b = _R8b;   I->_R16b = _R16b;
+	I->_R32b = _R32b;   I->_R64b = _R64b;
+	I->_Write = _Write; I->_W8b = _W8b;   I->_W16b = _W16b;
+	I->_W32b = _W32b;   I->_W64b = _W64b;
+	_Pin = I;
+
+	// read from memory
+	_Free = _PinFree;   _GetSize = _PinGetSize; _SetSize = _PinSetSize;
+	_GetPos = _PinGetPos; _SetPos = _PinSetPos;
+	_Read = _PinRead;   _R8b = _PinR8b;   _R16b = _PinR16b;
+	_R32b = _PinR32b;   _R64b = _PinR64b;
+	_Write = _PinWrite; _W8b = _PinW8b;   _W16b = _PinW16b;
+	_W32b = _PinW32b;   _W64b = _PinW64b;
+
+	return true;
+}
+
+void CdAllocator::Unpin()
+{
+	if (_Pin)
+		dAllocPinCache.Remove(this);
+}
+
+void CdAllocator::_PinRestore()
+{
+	if (!_Pin) return;
+	TPinInfo *I = _Pin;
+	_Pin = NULL;
+
+	_Free = I->_Free;   _GetSize = I->_GetSize; _SetSize = I->_SetSize;
+	_GetPos = I->_GetPos; _SetPos = I->_SetPos;
+	_Read = I->_Read;   _R8b = I->_R8b;   _R16b = I->_R16b;
+	_R32b = I->_R32b;   _R64b = I->_R64b;
+	_Write = I->_Write; _W8b = I->_W8b;   _W16b = I->_W16b;
+	_W32b = I->_W32b;   _W64b = I->_W64b;
+
+	SIZE64 Pos = I->Pos;
+	delete I;
+	SetPosition(Pos);
+}
+
+
+
+// =====================================================================
+// Cache of pinned allocator data
+// =====================================================================
+
+const C_Int64 CdAllocPinCache::DEFAULT_MAX_SIZE;
+
+CdAllocPinCache CoreArray::dAllocPinCache;
+
+CdAllocPinCache::CdAllocPinCache()
+{
+	fMaxSize = DEFAULT_MAX_SIZE;
+	fSize = 0;
+}
+
+CdAllocPinCache::~CdAllocPinCache()
+{
+	// the allocators may be freed after this object
+	Clear();
+}
+
+void CdAllocPinCache::Clear()
+{
+	Shrink(-1);
+}
+
+void CdAllocPinCache::SetMaxSize(C_Int64 NewSize)
+{
+	if (NewSize < 0) NewSize = 0;
+	fMaxSize = NewSize;
+	Shrink(NewSize);
+}
+
+C_UInt8 *CdAllocPinCache::Add(CdAllocator *Owner, SIZE64 Size)
+{
+	Remove(Owner);
+	if (Size > fMaxSize) return NULL;
+	Shrink(fMaxSize - Size);
+
+	fList.push_front(TItem());
+	TItem &I = fList.front();
+	I.Owner = Owner;
+	I.Size = Size;
+	I.Data.resize((Size > 0) ? Size : 1);
+	fMap[Owner] = fList.begin();
+	fSize += Size;
+	return &I.Data[0];
+}
+
+void CdAllocPinCache::Touch(CdAllocator *Owner)
+{
+	map<CdAllocator*, TList::iterator>::iterator it = fMap.find(Owner);
+	if (it != fMap.end())
+		fList.splice(fList.begin(), fList, it->second);
+}
+
+void CdAllocPinCache::Remove(CdAllocator *Owner)
+{
+	map<CdAllocator*, TList::iterator>::iterator it = fMap.find(Owner);
+	if (it != fMap.end())
+	{
+		TList::iterator p = it->second;
+		fMap.erase(it);
+		fSize -= p->Size;
+		// drop the item first, since _PinRestore() may throw when seeking
+		fList.erase(p);
+		Owner->_PinRestore();
+	}
+}
+
+void CdAllocPinCache::Shrink(C_Int64 MaxSize)
+{
+	while ((fSize > MaxSize) && !fList.empty())
+		Remove(fList.back().Owner);
+}
+
+
+
+// =====================================================================
+// Selection
+// =====================================================================
+
+/// the number of unselected elements after the last selected one in a word
+/** \param t  the flags of selected elements in a word, t != 0
+**/
+static COREARRAY_INLINE ssize_t sel_num_tail_zero(C_UInt64 t)
+{
+	ssize_t k = 0;
+#ifdef COREARRAY_ENDIAN_BIG
+	if (!(t & 0xFFFFFFFF)) { k += 4; t >>= 32; }
+	if (!(t & 0xFFFF)) { k += 2; t >>= 16; }
+	if (!(t & 0xFF)) k ++;
+#else
+	if (!(t >> 32)) { k += 4; t <<= 32; }
+	if (!(t >> 48)) { k += 2; t <<= 16; }
+	if (!(t >> 56)) k ++;
+#endif
+	return k;
+}
+
+ssize_t CoreArray::SelNextSegment(const C_BOOL sel[], ssize_t n, ssize_t gap,
+	ssize_t &start, ssize_t &nsel)
+{
+	const C_UInt64 M7 = ((C_UInt64)0x7F7F7F7F << 32) | 0x7F7F7F7F;
+	const C_UInt64 M1 = ((C_UInt64)0x01010101 << 32) | 0x01010101;
+	const C_UInt64 M8 = M1 << 7;
+	const C_BOOL *p = sel, *pEnd = sel + n;
+
+	// skip the leading unselected elements, 8 at a time
+	for (; pEnd - p >= 8; p += 8)
+	{
+		C_UInt64 v;
+		memcpy(&v, p, sizeof(v));
+		if (v) break;
+	}
+	while ((p < pEnd) && !*p) p++;
+	start = p - sel;
+	nsel = 0;
+	if (p >= pEnd) return 0;
+
+	// find the end of segment, 8 elements at a time
+	const C_BOOL *s = p, *last = p;
+	ssize_t zero = 0;
+	for (; pEnd - p >= 8; p += 8)
+	{
+		C_UInt64 v;
+		memcpy(&v, p, sizeof(v));
+		// the highest bit of each byte indicates a selected element
+		C_UInt64 t = (v | ((v & M7) + M7)) & M8;
+		if (t)
+		{
+			ssize_t k = sel_num_tail_zero(t);
+			last = p + 7 - k;
+			nsel += (ssize_t)(((t >> 7) * M1) >> 56);
+			zero = k;
+		} else {
+			zero += 8;
+			if (zero >= gap) return last - s + 1;
+		}
+	}
+	for (; p < pEnd; p++)
+	{
+		if (*p)
+		{
+			last = p; nsel ++; zero = 0;
+		} else if (++zero >= gap)
+			break;
+	}
+	return last - s + 1;
+}
+
+
 
 // =====================================================================
 // Exception for Allocator
@@ -42,6 +42,8 @@
 
 #include <cstring>
 #include <vector>
+#include <list>
+#include <map>
 
 #ifdef COREARRAY_PLATFORM_UNIX
 #  include <sys/types.h>
@@ -81,6 +83,8 @@ namespace CoreArray
 		/// read block of data
 		COREARRAY_FORCEINLINE void ReadData(void *Buffer, ssize_t Count)
 			{ (*_Read)(*this, Buffer, Count); }
+		/// read at most 'Count' bytes, and return the number of bytes read
+		ssize_t Read(void *Buffer, ssize_t Count);
 		/// read a 8-bit integer with native endianness
 		COREARRAY_FORCEINLINE C_UInt8 R8b()
 			{ return (*_R8b)(*this); }
@@ -125,7 +129,19 @@ namespace CoreArray
 		COREARRAY_FORCEINLINE CdBufStream *BufStream()
 			{ return _BufStream; }
 
+		/// copy the first 'Size' bytes to the pinned cache in memory, and
+		/// then read from memory until it is unpinned
+		/** \return false, if it is not readable or 'Size' exceeds the memory
+		 *          budget of dAllocPinCache
+		**/
+		bool Pin(SIZE64 Size);
+		/// release the pinned data, and read from the stream again
+		void Unpin();
+		/// whether the data are pinned in memory
+		COREARRAY_INLINE bool Pinned() const { return _Pin != NULL; }
+
 	protected:
+		friend class CdAllocPinCache;
 		typedef void (*TAllocFree)(CdAllocator &Obj);
 		typedef SIZE64 (*TAllocGetSize)(CdAllocator &Obj);
 		typedef void (*TAllocSetSize)(CdAllocator &Obj, SIZE64 NewSize);
@@ -161,6 +177,13 @@ namespace CoreArray
 
 		CdBufStream *_BufStream;
 
+		struct TPinInfo;
+		/// the pinned data and the saved functions, or NULL if not pinned
+		TPinInfo *_Pin;
+
+		/// restore the saved functions, called by CdAllocPinCache
+		void _PinRestore();
+
 		static void _InitFree(CdAllocator &Obj);
 		static SIZE64 _InitGetSize(CdAllocator &Obj);
 		static void _InitSetSize(CdAllocator &Obj, SIZE64 NewSize);
@@ -183,6 +206,7 @@ namespace CoreArray
 		static SIZE64 _BufGetPos(CdAllocator &Obj);
 		static void _BufSetPos(CdAllocator &Obj, SIZE64 NewPos);
 		static void _BufRead(CdAllocator &Obj, void *Buffer, ssize_t Count);
+		static void _MemRead(CdAllocator &Obj, void *Buffer, ssize_t Count);
 		static C_UInt8 _BufR8b(CdAllocator &Obj);
 		static C_UInt16 _BufR16b(CdAllocator &Obj);
 		static C_UInt32 _BufR32b(CdAllocator &Obj);
@@ -205,8 +229,79 @@ namespace CoreArray
 		static void _NoW16b(CdAllocator &Obj, C_UInt16 val);
 		static void _NoW32b(CdAllocator &Obj, C_UInt32 val);
 		static void _NoW64b(CdAllocator &Obj, C_UInt64 val);
+
+		static void _PinFree(CdAllocator &Obj);
+		static SIZE64 _PinGetSize(CdAllocator &Obj);
+		static void _PinSetSize(CdAllocator &Obj, SIZE64 NewSize);
+		static SIZE64 _PinGetPos(CdAllocator &Obj);
+		static void _PinSetPos(CdAllocator &Obj, SIZE64 NewPos);
+		static void _PinRead(CdAllocator &Obj, void *Buffer, ssize_t Count);
+		static C_UInt8 _PinR8b(CdAllocator &Obj);
+		static C_UInt16 _PinR16b(CdAllocator &Obj);
+		static C_UInt32 _PinR32b(CdAllocator &Obj);
+		static C_UInt64 _PinR64b(CdAllocator &Obj);
+		static void _PinWrite(CdAllocator &Obj, const void *Buffer, ssize_t Count);
+		static void _PinW8b(CdAllocator &Obj, C_UInt8 val);
+		static void _PinW16b(CdAllocator &Obj, C_UInt16 val);
+		static void _PinW32b(CdAllocator &Obj, C_UInt32 val);
+		static void _PinW64b(CdAllocator &Obj, C_UInt64 val);
+	};
+
+
+	/// The process-wide cache of allocator data pinned in memory
+	/** The data of an allocator are kept until it is unpinned or freed. The
+	 *  least recently pinned data are released if the total size exceeds the
+	 *  memory budget. Writing to a pinned allocator unpins it first. **/
+	class COREARRAY_DLL_DEFAULT CdAllocPinCache
+	{
+	public:
+		friend class CdAllocator;
+
+		/// the default memory budget in bytes
+		static const C_Int64 DEFAULT_MAX_SIZE = 1024*1024*1024;
+
+		CdAllocPinCache();
+		~CdAllocPinCache();
+
+		/// release all pinned data
+		void Clear();
+		/// set the memory budget, 0 to disable pinning
+		void SetMaxSize(C_Int64 NewSize);
+
+		COREARRAY_INLINE C_Int64 MaxSize() const { return fMaxSize; }
+		COREARRAY_INLINE C_Int64 Size() const { return fSize; }
+		COREARRAY_INLINE size_t Count() const { return fMap.size(); }
+
+	protected:
+		struct TItem
+		{
+			CdAllocator *Owner;
+			SIZE64 Size;
+			vector<C_UInt8> Data;
+		};
+		typedef list<TItem> TList;
+
+		/// the pinned data, the most recently pinned first
+		TList fList;
+		/// the map from an allocator to an item in fList
+		map<CdAllocator*, TList::iterator> fMap;
+		/// the memory budget, the current size in total
+		C_Int64 fMaxSize, fSize;
+
+		/// add an item, and return the buffer (Size bytes) to be filled, or
+		///   NULL if Size exceeds the memory budget
+		C_UInt8 *Add(CdAllocator *Owner, SIZE64 Size);
+		/// move the item of an allocator to the front
+		void Touch(CdAllocator *Owner);
+		/// remove the item of an allocator, and restore the allocator
+		void Remove(CdAllocator *Owner);
+		/// release the least recently pinned data until fSize <= MaxSize
+		void Shrink(C_Int64 MaxSize);
 	};
 
+	/// the process-wide cache of pinned allocator data
+	COREARRAY_DLL_DEFAULT extern CdAllocPinCache dAllocPinCache;
+
 
 	/// Iterator for CoreArray allocator object
 	class COREARRAY_DLL_DEFAULT CdBaseIterator
@@ -297,7 +392,7 @@ namespace CoreArray
 		COREARRAY_INLINE static DestT *CvtSub(DestT *p, const SourceT *s, ssize_t n, const C_BOOL sel[])
 		{
 			for (; n > 0; n--, s++, sel++)
-				if (*sel) *p++ = DestT(*s++);
+				if (*sel) *p++ = DestT(*s);
 			return p;
 		}
 	};
@@ -590,6 +685,59 @@ namespace CoreArray
 	/// Define the size of buffer for ALLOC_FUNC
 	const size_t COREARRAY_ALLOC_FUNC_BUFFER = 0x10000;
 
+	/// Define the minimum size (in bytes) of unselected data skipped by ReadEx
+	/** A run of unselected elements smaller than this size is read and
+	 *  discarded, since seeking over it costs more than reading it.
+	**/
+	const size_t COREARRAY_ALLOC_SKIP_SIZE = 0x1000;
+
+	/// Find the next segment of a selection to be read
+	/** \param sel    the selection
+	 *  \param n      the number of elements in 'sel'
+	 *  \param gap    a run of at least 'gap' unselected elements ends
+	 *                the segment
+	 *  \param start  output, the number of leading unselected elements
+	 *  \param nsel   output, the number of selected elements in the segment
+	 *  \return the length of segment starting at 'sel + start' and ending
+	 *          with a selected element, or 0 if no element is selected
+	**/
+	COREARRAY_DLL_DEFAULT ssize_t SelNextSegment(const C_BOOL sel[],
+		ssize_t n, ssize_t gap, ssize_t &start, ssize_t &nsel);
+
+	/// Read an array with a selection, skipping long unselected runs
+	/** FUNC::Read is called on the fully selected segments, and
+	 *  FUNC::ReadExDense on the others.
+	 *  \tparam FUNC  the ALLOC_FUNC class
+	 *  \param  I     the iterator
+	 *  \param  Buffer  the output buffer
+	 *  \param  n     the number of elements
+	 *  \param  sel   the selection
+	 *  \param  ElmSize  the increment of I.Ptr per element
+	 *  \param  gap   the minimum number of unselected elements to be skipped
+	**/
+	template<class FUNC, class ITERATOR, typename MEM_TYPE>
+		MEM_TYPE *ALLOC_READ_SEL(ITERATOR &I, MEM_TYPE *Buffer, ssize_t n,
+		const C_BOOL sel[], ssize_t ElmSize, ssize_t gap)
+	{
+		SIZE64 pEnd = I.Ptr + n * ElmSize;
+		while (n > 0)
+		{
+			ssize_t st, nsel;
+			ssize_t m = SelNextSegment(sel, n, gap, st, nsel);
+			if (m <= 0) break;
+			I.Ptr += st * ElmSize;
+			sel += st;
+			if (nsel >= m)
+				Buffer = FUNC::Read(I, Buffer, m);
+			else
+				Buffer = FUNC::ReadExDense(I, Buffer, m, sel);
+			sel += m;
+			n -= st + m;
+		}
+		I.Ptr = pEnd;
+		return Buffer;
+	}
+
 	/// Template functions for allocator
 	template<typename ALLOC_TYPE, typename MEM_TYPE,
 		bool MEM_TYPE_IS_NUMERIC =
@@ -619,18 +767,39 @@ namespace CoreArray
 			const C_BOOL Sel[])
 		{
 			const ssize_t N = COREARRAY_ALLOC_FUNC_BUFFER / sizeof(ALLOC_TYPE);
+			const ssize_t GAP = COREARRAY_ALLOC_SKIP_SIZE / sizeof(ALLOC_TYPE);
 			ALLOC_TYPE Buf[N];
 			BYTE_LE<CdAllocator> ss(I.Allocator);
-			I.Allocator->SetPosition(I.Ptr);
+			SIZE64 pI = I.Ptr;
 			I.Ptr += n * sizeof(ALLOC_TYPE);
 			while (n > 0)
 			{
-				ssize_t m = (n <= N) ? n : N;
-				ss.R(Buf, m);
-				Buffer = VAL_CONV<MEM_TYPE, ALLOC_TYPE>::CvtSub(
-					Buffer, Buf, m, Sel);
-				Sel += m;
-				n -= m;
+				// skip the unselected run
+				ssize_t st, nsel;
+				ssize_t L = SelNextSegment(Sel, n, GAP, st, nsel);
+				if (L <= 0) break;
+				pI += st * sizeof(ALLOC_TYPE);
+				Sel += st;
+				n -= st + L;
+				I.Allocator->SetPosition(pI);
+				pI += L * sizeof(ALLOC_TYPE);
+				// read the segment
+				const bool all = (nsel >= L);
+				while (L > 0)
+				{
+					ssize_t m = (L <= N) ? L : N;
+					ss.R(Buf, m);
+					if (all)
+					{
+						Buffer = VAL_CONV<MEM_TYPE, ALLOC_TYPE>::Cvt(
+							Buffer, Buf, m);
+					} else {
+						Buffer = VAL_CONV<MEM_TYPE, ALLOC_TYPE>::CvtSub(
+							Buffer, Buf, m, Sel);
+					}
+					Sel += m;
+					L -= m;
+				}
 			}
 			return Buffer;
 		}
@@ -675,17 +844,37 @@ namespace CoreArray
 			const C_BOOL Sel[])
 		{
 			const ssize_t N = COREARRAY_ALLOC_FUNC_BUFFER / sizeof(TYPE);
+			const ssize_t GAP = COREARRAY_ALLOC_SKIP_SIZE / sizeof(TYPE);
 			TYPE Buf[N];
 			BYTE_LE<CdAllocator> ss(I.Allocator);
-			I.Allocator->SetPosition(I.Ptr);
+			SIZE64 pI = I.Ptr;
 			I.Ptr += n * sizeof(TYPE);
 			while (n > 0)
 			{
-				ssize_t m = (n <= N) ? n : N;
-				ss.R(Buf, m);
-				Buffer = VAL_CONV<TYPE, TYPE>::CvtSub(Buffer, Buf, m, Sel);
-				Sel += m;
-				n -= m;
+				// skip the unselected run
+				ssize_t st, nsel;
+				ssize_t L = SelNextSegment(Sel, n, GAP, st, nsel);
+				if (L <= 0) break;
+				pI += st * sizeof(TYPE);
+				Sel += st;
+				n -= st + L;
+				I.Allocator->SetPosition(pI);
+				pI += L * sizeof(TYPE);
+				// read the segment
+				if (nsel >= L)
+				{
+					ss.R(Buffer, L);
+					Buffer += L; Sel += L;
+					continue;
+				}
+				while (L > 0)
+				{
+					ssize_t m = (L <= N) ? L : N;
+					ss.R(Buf, m);
+					Buffer = VAL_CONV<TYPE, TYPE>::CvtSub(Buffer, Buf, m, Sel);
+					Sel += m;
+					L -= m;
+				}
 			}
 			return Buffer;
 		}
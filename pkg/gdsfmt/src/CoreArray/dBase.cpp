@@ -361,6 +361,18 @@ SIZE64 CdStream::GetSize()
 	return rv;
 }
 
+const void *CdStream::MemPtr(SIZE64 Pos, SIZE64 &Count)
+{
+	Count = 0;
+	return NULL;
+}
+
+ssize_t CdStream::ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count)
+{
+	SetPosition(Pos);
+	return Read(Buffer, Count);
+}
+
 SIZE64 CdStream::Position()
 {
 	return Seek(0, soCurrent);
@@ -509,7 +521,9 @@ CdBufStream::CdBufStream(CdStream *vStream, ssize_t vBufSize): CdRef()
 	if (vStream)
 		vStream->AddRef();
 
-	_BufSize = 0; SetBufSize(vBufSize);
+	_BufSize = _BufMinSize = _BufAllocSize = 0;
+	_BufMaxSize = STREAM_BUFFER_MAX_SIZE;
+	SetBufSize(vBufSize);
 }
 
 CdBufStream::~CdBufStream()
@@ -558,12 +572,17 @@ void CdBufStream::ReadData(void *Buf, ssize_t Count)
 		// Check in Range
 		if ((_Position<_BufStart) || (_Position>=_BufEnd))
 		{
-			// Save to Buffer
-			FlushBuffer();
-			// Make it in range
-			_BufStart = (_Position >> BufStreamAlign) << BufStreamAlign;
-			_Stream->SetPosition(_BufStart);
-			_BufEnd = _BufStart + _Stream->Read(_Buffer, _BufSize);
+			if (Count >= _BufSize)
+			{
+				// Read directly
+				FlushBuffer();
+				_Stream->SetPosition(_Position);
+				_Stream->ReadData(Buf, Count);
+				_Position += Count;
+				_BufStart = _BufEnd = _Position;
+				return;
+			}
+			_FillBuffer();
 		}
 
 		// Loop Copy
@@ -574,15 +593,110 @@ void CdBufStream::ReadData(void *Buf, ssize_t Count)
 			if (L > Count) L = Count;
 			memcpy(p, _Buffer + ssize_t(_Position - _BufStart), L);
 			_Position += L; p += L; Count -= L;
-			if (Count > 0)
+			if (Count >= _BufSize)
 			{
+				// Read the remaining directly
 				FlushBuffer();
-				_BufStart = _BufEnd;
-				_Stream->SetPosition(_BufStart);
-				_BufEnd = _BufStart + _Stream->Read(_Buffer, _BufSize);
+				_Stream->SetPosition(_Position);
+				_Stream->ReadData(p, Count);
+				_Position += Count;
+				_BufStart = _BufEnd = _Position;
+				break;
+			} else if (Count > 0)
+				_FillBuffer();
+		} while (Count > 0);
+	}
+}
+
+ssize_t CdBufStream::Read(void *Buf, ssize_t Count)
+{
+	ssize_t rv = 0;
+	if (Count > 0)
+	{
+		// Check in Range
+		if ((_Position<_BufStart) || (_Position>=_BufEnd))
+		{
+			if (Count >= _BufSize)
+			{
+				// Read directly
+				FlushBuffer();
+				_Stream->SetPosition(_Position);
+				rv = _Stream->Read(Buf, Count);
+				_Position += rv;
+				_BufStart = _BufEnd = _Position;
+				return rv;
 			}
+			_FillBuffer();
+		}
+
+		// Loop Copy, stop at the end of stream
+		C_UInt8 *p = (C_UInt8*)Buf;
+		do {
+			ssize_t L = _BufEnd - _Position;
+			if (L <= 0) break;
+			if (L > Count) L = Count;
+			memcpy(p, _Buffer + ssize_t(_Position - _BufStart), L);
+			_Position += L; p += L; Count -= L; rv += L;
+			if (Count >= _BufSize)
+			{
+				// Read the remaining directly
+				FlushBuffer();
+				_Stream->SetPosition(_Position);
+				L = _Stream->Read(p, Count);
+				_Position += L; rv += L;
+				_BufStart = _BufEnd = _Position;
+				break;
+			} else if (Count > 0)
+				_FillBuffer();
 		} while (Count > 0);
 	}
+	return rv;
+}
+
+void CdBufStream::_FillBuffer()
+{
+	// Save to Buffer
+	FlushBuffer();
+	// Adjust the buffer size
+	if (_BufMaxSize > _BufMinSize)
+	{
+		if (_Position == _BufEnd)
+		{
+			// contiguous reading
+			if (_BufSize < _BufMaxSize)
+			{
+				_ResizeBuffer((2*_BufSize <= _BufMaxSize) ?
+					2*_BufSize : _BufMaxSize);
+			}
+		} else if (_BufSize > _BufMinSize)
+		{
+			// random access
+			_ResizeBuffer(_BufMinSize);
+		}
+	}
+	// Make it in range
+	_BufStart = (_Position >> BufStreamAlign) << BufStreamAlign;
+	_Stream->SetPosition(_BufStart);
+	_BufEnd = _BufStart + _Stream->Read(_Buffer, _BufSize);
+}
+
+void CdBufStream::_ResizeBuffer(ssize_t NewSize, bool Release)
+{
+	NewSize = (NewSize >> BufStreamAlign) << BufStreamAlign;
+	if (NewSize <= 0) return;
+	// keep the allocated memory on random access, since returning it to
+	//   the system and faulting it in again costs more than the reading
+	if ((NewSize > _BufAllocSize) || (Release && (NewSize < _BufAllocSize)))
+	{
+		C_UInt8 *p = (C_UInt8*)realloc((void*)_Buffer, NewSize);
+		COREARRAY_ALLOCCHECK(p);
+		_Buffer = p;
+		_BufAllocSize = NewSize;
+	} else if (NewSize == _BufSize)
+		return;
+	_BufSize = NewSize;
+	// the buffer is not valid any more
+	_BufStart = _BufEnd = _Position;
 }
 
 C_UInt8 CdBufStream::R8b()
@@ -729,13 +843,37 @@ void CdBufStream::SetStream(CdStream *Value)
 
 void CdBufStream::SetBufSize(const ssize_t NewBufSize)
 {
-	if ((_BufSize!=NewBufSize) && (NewBufSize>=(1 << BufStreamAlign)))
+	if (NewBufSize >= (1 << BufStreamAlign))
+	{
+		_BufMinSize = (NewBufSize >> BufStreamAlign) << BufStreamAlign;
+		if ((_BufSize != _BufMinSize) || (_BufAllocSize != _BufMinSize))
+		{
+			FlushWrite();
+			_ResizeBuffer(_BufMinSize, true);
+		}
+	}
+}
+
+void CdBufStream::SetBufMaxSize(const ssize_t NewMaxSize)
+{
+	_BufMaxSize = (NewMaxSize >> BufStreamAlign) << BufStreamAlign;
+	if (_BufAllocSize > _BufMinSize)
+	{
+		if ((_BufAllocSize > _BufMaxSize) || (_BufMaxSize <= _BufMinSize))
+		{
+			FlushWrite();
+			_ResizeBuffer(_BufMinSize, true);
+		}
+	}
+}
+
+void CdBufStream::ShrinkBuffer()
+{
+	if (_BufAllocSize > _BufMinSize)
 	{
 		FlushWrite();
-		_BufSize = (NewBufSize >> BufStreamAlign) << BufStreamAlign;
-		_Buffer = (C_UInt8*)realloc((void*)_Buffer, _BufSize);
-		COREARRAY_ALLOCCHECK(_Buffer);
-    }
+		_ResizeBuffer(_BufMinSize, true);
+	}
 }
 
 SIZE64 CdBufStream::GetSize()
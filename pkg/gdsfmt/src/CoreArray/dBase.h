@@ -593,6 +593,20 @@ namespace CoreArray
 		/// Copy from a CdBufStream object
 		SIZE64 CopyFrom(CdBufStream &Source, SIZE64 Count=-1);
 
+		/// Return a pointer to the data at Pos, if the stream is in memory
+		/** \param Pos    the position in the stream
+		 *  \param Count  output, the number of bytes accessible from the pointer
+		 *  \return the pointer, or NULL if the data are not in memory
+		**/
+		virtual const void *MemPtr(SIZE64 Pos, SIZE64 &Count);
+
+		/// Read a block of data at Pos, and return number of read in bytes
+		/** The default implementation moves the position and is not
+		 *  thread-safe, while file streams use positional I/O and leave the
+		 *  position unchanged, allowing concurrent calls from threads.
+		**/
+		virtual ssize_t ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count);
+
 	private:
 		CdStream& operator= (const CdStream& m);
 		CdStream& operator= (CdStream& m);
@@ -610,6 +624,8 @@ namespace CoreArray
 	const ssize_t STREAM_BUFFER_SMALL_SIZE = 1024;
 	/// Default large size of buffer in TBufdStream, 128K
 	const ssize_t STREAM_BUFFER_LARGE_SIZE = 128*1024;
+	/// Default maximum size of buffer grown for sequential reading, 1M
+	const ssize_t STREAM_BUFFER_MAX_SIZE   = 1024*1024;
 
 	/// Aligned bytes of stream buffer
 	const size_t BufStreamAlign = 4;  // 2^4 = 16 bytes aligned
@@ -635,6 +651,11 @@ namespace CoreArray
 
 
 	/// The class adds a buffer to a stream
+	/** The buffer is doubled up to BufMaxSize() when the reading is
+	 *  contiguous, and it is reset to BufSize() on random access. The grown
+	 *  memory is kept until ShrinkBuffer() is called. A request not smaller
+	 *  than the buffer is read into the destination directly.
+	**/
 	class COREARRAY_DLL_DEFAULT CdBufStream: public CdRef
 	{
 	public:
@@ -660,6 +681,8 @@ namespace CoreArray
 
 		/// Read block of data, or throw an exception if fail
 		void ReadData(void *Buffer, ssize_t Count);
+		/// Read block of data, and return the number of bytes actually read
+		ssize_t Read(void *Buffer, ssize_t Count);
 		/// Read a 8-bit integer with native endianness
 		C_UInt8 R8b();
 		/// Read a 16-bit integer with native endianness
@@ -691,8 +714,17 @@ namespace CoreArray
 		void SetStream(CdStream *Value);
 		COREARRAY_INLINE CdStream *BaseStream() const { return _BaseStream; }
 
-		COREARRAY_INLINE ssize_t BufSize() const { return _BufSize; }
+		/// the buffer size for random access
+		COREARRAY_INLINE ssize_t BufSize() const { return _BufMinSize; }
 		void SetBufSize(const ssize_t NewBufSize);
+		/// the maximum buffer size for sequential reading
+		COREARRAY_INLINE ssize_t BufMaxSize() const { return _BufMaxSize; }
+		void SetBufMaxSize(const ssize_t NewMaxSize);
+		/// the allocated buffer size
+		COREARRAY_INLINE ssize_t BufCurSize() const { return _BufAllocSize; }
+		/// release the buffer grown for sequential reading
+		void ShrinkBuffer();
+
 		virtual SIZE64 GetSize();
 		virtual void SetSize(SIZE64 Value);
 
@@ -700,13 +732,19 @@ namespace CoreArray
 
 	protected:
 		CdStream *_Stream, *_BaseStream;
-		ssize_t _BufSize;
+		ssize_t _BufSize, _BufMinSize, _BufMaxSize;
+		ssize_t _BufAllocSize;
 		SIZE64 _Position;
 		SIZE64 _BufStart, _BufEnd;
 
 		C_UInt8 *_Buffer;
 		bool _BufWriteFlag;
 		std::vector<CdStreamPipe*> _PipeItems;
+
+		/// fill the buffer from the current position
+		void _FillBuffer();
+		/// set the buffer size, and reallocate it if needed or if Release
+		void _ResizeBuffer(ssize_t NewSize, bool Release=false);
 	};
 
 
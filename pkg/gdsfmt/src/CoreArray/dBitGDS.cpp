@@ -27,6 +27,13 @@
 
 #include "dBitGDS.h"
 
+#ifdef COREARRAY_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef COREARRAY_SIMD_AVX
+#include <immintrin.h>
+#endif
+
 
 namespace CoreArray
 {
@@ -309,3 +316,510 @@ COREARRAY_DLL_DEFAULT C_Int32 CoreArray::BitSet_IfSigned(C_Int32 val,
 
 	return val;
 }
+
+
+
+// =====================================================================
+// 2-bit packing and unpacking
+// =====================================================================
+
+/// the indices of selected elements for an 8-bit selection mask
+static struct TBit2SelIndex
+{
+	C_UInt8 Num[256];     ///< the number of selected elements
+	C_UInt8 Idx[256][8];  ///< the indices of selected elements
+
+	TBit2SelIndex()
+	{
+		for (int m=0; m < 256; m++)
+		{
+			int k = 0;
+			for (int i=0; i < 8; i++)
+				if (m & (1 << i)) Idx[m][k++] = i;
+			Num[m] = k;
+		}
+	}
+} Bit2SelIndex;
+
+/// copy the elements in 'val' selected by the 8-bit mask 'm' to 'p'
+template<typename TYPE> static COREARRAY_FORCEINLINE
+	TYPE *bit2_compress(TYPE *p, const C_UInt8 *val, int m)
+{
+	const C_UInt8 *idx = Bit2SelIndex.Idx[m];
+	for (int k = Bit2SelIndex.Num[m]; k > 0; k--)
+		*p++ = val[*idx++];
+	return p;
+}
+
+
+#ifdef COREARRAY_SIMD_SSE2
+
+/// expand 16 bytes of 2-bit integers in 'v' to 64 values in 'o0' .. 'o3'
+static COREARRAY_FORCEINLINE void bit2_expand(__m128i v, __m128i &o0,
+	__m128i &o1, __m128i &o2, __m128i &o3)
+{
+	const __m128i mask = _mm_set1_epi8(0x03);
+	__m128i a0 = _mm_and_si128(v, mask);
+	__m128i a1 = _mm_and_si128(_mm_srli_epi16(v, 2), mask);
+	__m128i a2 = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+	__m128i a3 = _mm_and_si128(_mm_srli_epi16(v, 6), mask);
+	__m128i b0 = _mm_unpacklo_epi8(a0, a1);
+	__m128i b1 = _mm_unpackhi_epi8(a0, a1);
+	__m128i b2 = _mm_unpacklo_epi8(a2, a3);
+	__m128i b3 = _mm_unpackhi_epi8(a2, a3);
+	o0 = _mm_unpacklo_epi16(b0, b2);
+	o1 = _mm_unpackhi_epi16(b0, b2);
+	o2 = _mm_unpacklo_epi16(b1, b3);
+	o3 = _mm_unpackhi_epi16(b1, b3);
+}
+
+/// store 16 unpacked values
+static COREARRAY_FORCEINLINE C_UInt8 *bit2_store(C_UInt8 *p, __m128i v)
+{
+	_mm_storeu_si128((__m128i*)p, v);
+	return p + 16;
+}
+
+/// store 16 unpacked values
+static COREARRAY_FORCEINLINE C_Int8 *bit2_store(C_Int8 *p, __m128i v)
+{
+	_mm_storeu_si128((__m128i*)p, v);
+	return p + 16;
+}
+
+/// store 16 unpacked values
+static COREARRAY_FORCEINLINE C_Int32 *bit2_store(C_Int32 *p, __m128i v)
+{
+#ifdef COREARRAY_SIMD_AVX2
+	_mm256_storeu_si256((__m256i*)p, _mm256_cvtepu8_epi32(v));
+	_mm256_storeu_si256((__m256i*)(p + 8),
+		_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+#else
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_unpacklo_epi8(v, zero);
+	__m128i hi = _mm_unpackhi_epi8(v, zero);
+	_mm_storeu_si128((__m128i*)p, _mm_unpacklo_epi16(lo, zero));
+	_mm_storeu_si128((__m128i*)(p + 4), _mm_unpackhi_epi16(lo, zero));
+	_mm_storeu_si128((__m128i*)(p + 8), _mm_unpacklo_epi16(hi, zero));
+	_mm_storeu_si128((__m128i*)(p + 12), _mm_unpackhi_epi16(hi, zero));
+#endif
+	return p + 16;
+}
+
+/// store 16 unpacked values
+static COREARRAY_FORCEINLINE C_Float64 *bit2_store(C_Float64 *p, __m128i v)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_unpacklo_epi8(v, zero);
+	__m128i hi = _mm_unpackhi_epi8(v, zero);
+	__m128i i[4] = {
+		_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+		_mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+	for (int k=0; k < 4; k++, p += 4)
+	{
+	#ifdef COREARRAY_SIMD_AVX
+		_mm256_storeu_pd(p, _mm256_cvtepi32_pd(i[k]));
+	#else
+		_mm_storeu_pd(p, _mm_cvtepi32_pd(i[k]));
+		_mm_storeu_pd(p + 2, _mm_cvtepi32_pd(_mm_srli_si128(i[k], 8)));
+	#endif
+	}
+	return p;
+}
+
+/// load 16 values and keep the lowest 2 bits
+static COREARRAY_FORCEINLINE __m128i bit2_load(const C_UInt8 *p)
+{
+	return _mm_and_si128(_mm_loadu_si128((__m128i const*)p),
+		_mm_set1_epi8(0x03));
+}
+
+/// load 16 values and keep the lowest 2 bits
+static COREARRAY_FORCEINLINE __m128i bit2_load(const C_Int8 *p)
+{
+	return bit2_load((const C_UInt8*)p);
+}
+
+/// load 16 values and keep the lowest 2 bits
+static COREARRAY_FORCEINLINE __m128i bit2_load(const C_Int32 *p)
+{
+	const __m128i mask = _mm_set1_epi32(0x03);
+	__m128i v0 = _mm_and_si128(_mm_loadu_si128((__m128i const*)p), mask);
+	__m128i v1 = _mm_and_si128(_mm_loadu_si128((__m128i const*)(p+4)), mask);
+	__m128i v2 = _mm_and_si128(_mm_loadu_si128((__m128i const*)(p+8)), mask);
+	__m128i v3 = _mm_and_si128(_mm_loadu_si128((__m128i const*)(p+12)), mask);
+	return _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3));
+}
+
+/// pack 16 values (0 .. 3) in 'v' to the lowest byte of each 32-bit lane
+static COREARRAY_FORCEINLINE __m128i bit2_shrink(__m128i v)
+{
+	v = _mm_or_si128(v, _mm_srli_epi32(v, 6));
+	v = _mm_or_si128(v, _mm_srli_epi32(v, 12));
+	return _mm_and_si128(v, _mm_set1_epi32(0xFF));
+}
+
+#endif
+
+
+/// unpack 2-bit integers
+template<typename TYPE> static COREARRAY_FORCEINLINE
+	TYPE *bit2_unpack(TYPE *p, const C_UInt8 *s, size_t n)
+{
+#ifdef COREARRAY_SIMD_SSE2
+	for (; n >= 16; n -= 16, s += 16)
+	{
+		__m128i o0, o1, o2, o3;
+		bit2_expand(_mm_loadu_si128((__m128i const*)s), o0, o1, o2, o3);
+		p = bit2_store(p, o0); p = bit2_store(p, o1);
+		p = bit2_store(p, o2); p = bit2_store(p, o3);
+	}
+#endif
+	return Bit2Unpack<TYPE>(p, s, n);
+}
+
+/// unpack 2-bit integers with a selection
+template<typename TYPE> static COREARRAY_FORCEINLINE
+	TYPE *bit2_unpack_ex(TYPE *p, const C_UInt8 *s, size_t n,
+	const C_BOOL sel[])
+{
+#ifdef COREARRAY_SIMD_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; n >= 16; n -= 16, s += 16, sel += 64)
+	{
+		// bit masks of selection, a bit is set if not selected
+		int m[4];
+		for (int k=0; k < 4; k++)
+		{
+			m[k] = _mm_movemask_epi8(_mm_cmpeq_epi8(
+				_mm_loadu_si128((__m128i const*)(sel + 16*k)), zero));
+		}
+		if ((m[0] & m[1] & m[2] & m[3]) == 0xFFFF)
+			continue;
+
+		__m128i o[4];
+		bit2_expand(_mm_loadu_si128((__m128i const*)s), o[0], o[1], o[2], o[3]);
+		for (int k=0; k < 4; k++)
+		{
+			if (m[k] == 0)
+			{
+				p = bit2_store(p, o[k]);
+			} else if (m[k] != 0xFFFF)
+			{
+				// branch-free compression
+				C_UInt8 val[16];
+				TYPE tmp[16];
+				_mm_storeu_si128((__m128i*)val, o[k]);
+				int msk = ~m[k], j = 0;
+				for (int i=0; i < 16; i++)
+				{
+					tmp[j] = val[i];
+					j += (msk >> i) & 0x01;
+				}
+				memcpy(p, tmp, sizeof(TYPE)*j);
+				p += j;
+			}
+		}
+	}
+#endif
+	for (; n >= 2; n -= 2, s += 2, sel += 8)
+	{
+		// 8 values in a time using the selection index
+		int m = 0;
+		for (int k=0; k < 8; k++)
+			if (sel[k]) m |= (1 << k);
+		if (m == 0) continue;
+		C_UInt8 val[8];
+		Bit2Unpack<C_UInt8>(val, s, 2);
+		p = bit2_compress(p, val, m);
+	}
+	return Bit2UnpackEx<TYPE>(p, s, n, sel);
+}
+
+/// pack 2-bit integers
+template<typename TYPE> static COREARRAY_FORCEINLINE
+	void bit2_pack(C_UInt8 *s, const TYPE *p, size_t n)
+{
+#ifdef COREARRAY_SIMD_SSE2
+	for (; n >= 16; n -= 16, s += 16, p += 64)
+	{
+		__m128i v0 = bit2_shrink(bit2_load(p));
+		__m128i v1 = bit2_shrink(bit2_load(p + 16));
+		__m128i v2 = bit2_shrink(bit2_load(p + 32));
+		__m128i v3 = bit2_shrink(bit2_load(p + 48));
+		_mm_storeu_si128((__m128i*)s, _mm_packus_epi16(
+			_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3)));
+	}
+#endif
+	Bit2Pack<TYPE>(s, p, n);
+}
+
+
+COREARRAY_DLL_DEFAULT C_UInt8 *CoreArray::Bit2Unpack(C_UInt8 *p,
+	const C_UInt8 *s, size_t n)
+{
+#ifdef COREARRAY_SIMD_AVX2
+	const __m256i mask = _mm256_set1_epi8(0x03);
+	for (; n >= 32; n -= 32, s += 32, p += 128)
+	{
+		__m256i v = _mm256_loadu_si256((__m256i const*)s);
+		__m256i a0 = _mm256_and_si256(v, mask);
+		__m256i a1 = _mm256_and_si256(_mm256_srli_epi16(v, 2), mask);
+		__m256i a2 = _mm256_and_si256(_mm256_srli_epi16(v, 4), mask);
+		__m256i a3 = _mm256_and_si256(_mm256_srli_epi16(v, 6), mask);
+		__m256i b0 = _mm256_unpacklo_epi8(a0, a1);
+		__m256i b1 = _mm256_unpackhi_epi8(a0, a1);
+		__m256i b2 = _mm256_unpacklo_epi8(a2, a3);
+		__m256i b3 = _mm256_unpackhi_epi8(a2, a3);
+		// the unpacking works within 128-bit lanes
+		__m256i o0 = _mm256_unpacklo_epi16(b0, b2);
+		__m256i o1 = _mm256_unpackhi_epi16(b0, b2);
+		__m256i o2 = _mm256_unpacklo_epi16(b1, b3);
+		__m256i o3 = _mm256_unpackhi_epi16(b1, b3);
+		_mm256_storeu_si256((__m256i*)p, _mm256_permute2x128_si256(o0, o1, 0x20));
+		_mm256_storeu_si256((__m256i*)(p+32), _mm256_permute2x128_si256(o2, o3, 0x20));
+		_mm256_storeu_si256((__m256i*)(p+64), _mm256_permute2x128_si256(o0, o1, 0x31));
+		_mm256_storeu_si256((__m256i*)(p+96), _mm256_permute2x128_si256(o2, o3, 0x31));
+	}
+#endif
+	return bit2_unpack(p, s, n);
+}
+
+COREARRAY_DLL_DEFAULT C_Int8 *CoreArray::Bit2Unpack(C_Int8 *p,
+	const C_UInt8 *s, size_t n)
+{
+	return (C_Int8*)Bit2Unpack((C_UInt8*)p, s, n);
+}
+
+COREARRAY_DLL_DEFAULT C_Int32 *CoreArray::Bit2Unpack(C_Int32 *p,
+	const C_UInt8 *s, size_t n)
+{
+	return bit2_unpack(p, s, n);
+}
+
+COREARRAY_DLL_DEFAULT C_Float64 *CoreArray::Bit2Unpack(C_Float64 *p,
+	const C_UInt8 *s, size_t n)
+{
+	return bit2_unpack(p, s, n);
+}
+
+COREARRAY_DLL_DEFAULT C_UInt8 *CoreArray::Bit2UnpackEx(C_UInt8 *p,
+	const C_UInt8 *s, size_t n, const C_BOOL sel[])
+{
+	return bit2_unpack_ex(p, s, n, sel);
+}
+
+COREARRAY_DLL_DEFAULT C_Int8 *CoreArray::Bit2UnpackEx(C_Int8 *p,
+	const C_UInt8 *s, size_t n, const C_BOOL sel[])
+{
+	return bit2_unpack_ex(p, s, n, sel);
+}
+
+COREARRAY_DLL_DEFAULT C_Int32 *CoreArray::Bit2UnpackEx(C_Int32 *p,
+	const C_UInt8 *s, size_t n, const C_BOOL sel[])
+{
+	return bit2_unpack_ex(p, s, n, sel);
+}
+
+COREARRAY_DLL_DEFAULT C_Float64 *CoreArray::Bit2UnpackEx(C_Float64 *p,
+	const C_UInt8 *s, size_t n, const C_BOOL sel[])
+{
+	return bit2_unpack_ex(p, s, n, sel);
+}
+
+COREARRAY_DLL_DEFAULT void CoreArray::Bit2Pack(C_UInt8 *s,
+	const C_UInt8 *p, size_t n)
+{
+	bit2_pack(s, p, n);
+}
+
+COREARRAY_DLL_DEFAULT void CoreArray::Bit2Pack(C_UInt8 *s,
+	const C_Int8 *p, size_t n)
+{
+	bit2_pack(s, p, n);
+}
+
+COREARRAY_DLL_DEFAULT void CoreArray::Bit2Pack(C_UInt8 *s,
+	const C_Int32 *p, size_t n)
+{
+	bit2_pack(s, p, n);
+}
+
+
+
+// =====================================================================
+// n-bit packing and unpacking
+// =====================================================================
+
+/// load a 64-bit little-endian integer from an unaligned address
+static COREARRAY_FORCEINLINE C_UInt64 bitn_load64(const C_UInt8 *s)
+{
+#ifdef COREARRAY_ENDIAN_LITTLE
+	C_UInt64 v;
+	memcpy(&v, s, sizeof(v));
+	return v;
+#else
+	return C_UInt64(s[0]) | (C_UInt64(s[1]) << 8) |
+		(C_UInt64(s[2]) << 16) | (C_UInt64(s[3]) << 24) |
+		(C_UInt64(s[4]) << 32) | (C_UInt64(s[5]) << 40) |
+		(C_UInt64(s[6]) << 48) | (C_UInt64(s[7]) << 56);
+#endif
+}
+
+/// store a 32-bit little-endian integer to an unaligned address
+static COREARRAY_FORCEINLINE void bitn_store32(C_UInt8 *s, C_UInt32 v)
+{
+#ifdef COREARRAY_ENDIAN_LITTLE
+	memcpy(s, &v, sizeof(v));
+#else
+	s[0] = C_UInt8(v); s[1] = C_UInt8(v >> 8);
+	s[2] = C_UInt8(v >> 16); s[3] = C_UInt8(v >> 24);
+#endif
+}
+
+/// get the integer of 'nbit' bits at the bit position 'pos' of 's',
+/// without reading any byte after it
+static COREARRAY_FORCEINLINE C_UInt64 bitn_get(const C_UInt8 *s,
+	size_t pos, unsigned nbit)
+{
+	s += pos >> 3;
+	const unsigned shr = pos & 0x07;
+	C_UInt64 v = 0;
+	for (unsigned i=0; (i << 3) < shr + nbit; i++)
+		v |= C_UInt64(s[i]) << (i << 3);
+	return v >> shr;
+}
+
+/// convert the lowest 'nbit' bits to an unsigned integer
+template<unsigned nbit, typename TYPE> struct BITN_CVT
+{
+	static COREARRAY_FORCEINLINE TYPE Cvt(C_UInt64 v)
+	{
+		return TYPE(v & ((C_UInt64(1) << nbit) - 1));
+	}
+};
+
+/// convert the lowest 'nbit' bits to a signed integer
+template<unsigned nbit> struct BITN_CVT<nbit, C_Int32>
+{
+	static COREARRAY_FORCEINLINE C_Int32 Cvt(C_UInt64 v)
+	{
+		return C_Int32(C_UInt32(v) << (32 - nbit)) >> (32 - nbit);
+	}
+};
+
+/// unpack integers of 'nbit' bits
+template<unsigned nbit, typename TYPE> static
+	TYPE *bitn_unpack(TYPE *p, const C_UInt8 *s, size_t n, unsigned offset)
+{
+	// header, until the bit position is aligned to a byte
+	size_t pos = offset;
+	for (; (n > 0) && (pos & 0x07); n--, pos += nbit)
+		*p++ = BITN_CVT<nbit, TYPE>::Cvt(bitn_get(s, pos, nbit));
+	s += pos >> 3;
+
+	// body, 8 integers in 'nbit' bytes a time, each from a 64-bit word
+	size_t nbyte = (n * nbit + 7) >> 3;
+	for (; (n >= 8) && (nbyte >= nbit + 8); n -= 8, nbyte -= nbit, s += nbit)
+	{
+		for (unsigned k=0; k < 8; k++)
+		{
+			*p++ = BITN_CVT<nbit, TYPE>::Cvt(
+				bitn_load64(s + ((k*nbit) >> 3)) >> ((k*nbit) & 0x07));
+		}
+	}
+
+	// tail
+	for (pos = 0; n > 0; n--, pos += nbit)
+		*p++ = BITN_CVT<nbit, TYPE>::Cvt(bitn_get(s, pos, nbit));
+	return p;
+}
+
+/// pack integers of 'nbit' bits
+template<unsigned nbit, typename TYPE> static
+	void bitn_pack(C_UInt8 *s, const TYPE *p, size_t n, unsigned offset)
+{
+	const C_UInt64 mask = (C_UInt64(1) << nbit) - 1;
+	C_UInt64 w = s[0] & ((1u << offset) - 1);
+	unsigned nw = offset;
+
+	// fill a 64-bit word, and write its lower 32 bits once they are full
+	for (; n > 0; n--)
+	{
+		w |= (C_UInt64(C_UInt32(*p++)) & mask) << nw;
+		nw += nbit;
+		if (nw >= 32)
+		{
+			bitn_store32(s, C_UInt32(w));
+			s += 4; w >>= 32; nw -= 32;
+		}
+	}
+	for (; nw > 0; nw = (nw > 8) ? (nw - 8) : 0, w >>= 8)
+		*s++ = C_UInt8(w);
+}
+
+
+/// the table of n-bit kernels specialized on the number of bits
+template<typename TYPE> struct TBitNFunc
+{
+	typedef TYPE *(*TUnpack)(TYPE*, const C_UInt8*, size_t, unsigned);
+	typedef void (*TPack)(C_UInt8*, const TYPE*, size_t, unsigned);
+
+	TUnpack Unpack[32];  ///< the unpacking functions, indexed by nbit
+	TPack Pack[32];      ///< the packing functions, indexed by nbit
+
+	template<unsigned nbit, int dummy=0> struct SET
+	{
+		static void Set(TBitNFunc<TYPE> &f)
+		{
+			f.Unpack[nbit] = &bitn_unpack<nbit, TYPE>;
+			f.Pack[nbit] = &bitn_pack<nbit, TYPE>;
+			SET<nbit-1>::Set(f);
+		}
+	};
+	template<int dummy> struct SET<0, dummy>
+	{
+		static void Set(TBitNFunc<TYPE> &f)
+			{ f.Unpack[0] = NULL; f.Pack[0] = NULL; }
+	};
+
+	TBitNFunc() { SET<31>::Set(*this); }
+
+	COREARRAY_INLINE static void Check(unsigned nbit)
+	{
+		if ((nbit < 1) || (nbit > 31))
+			throw ErrArray("Invalid number of bits: %d.", nbit);
+	}
+};
+
+static TBitNFunc<C_UInt32> BitNFunc_UInt32;
+static TBitNFunc<C_Int32> BitNFunc_Int32;
+
+
+COREARRAY_DLL_DEFAULT C_UInt32 *CoreArray::BitNUnpack(C_UInt32 *p,
+	const C_UInt8 *s, size_t n, unsigned offset, unsigned nbit)
+{
+	TBitNFunc<C_UInt32>::Check(nbit);
+	return (*BitNFunc_UInt32.Unpack[nbit])(p, s, n, offset);
+}
+
+COREARRAY_DLL_DEFAULT C_Int32 *CoreArray::BitNUnpack(C_Int32 *p,
+	const C_UInt8 *s, size_t n, unsigned offset, unsigned nbit)
+{
+	TBitNFunc<C_Int32>::Check(nbit);
+	return (*BitNFunc_Int32.Unpack[nbit])(p, s, n, offset);
+}
+
+COREARRAY_DLL_DEFAULT void CoreArray::BitNPack(C_UInt8 *s,
+	const C_UInt32 *p, size_t n, unsigned offset, unsigned nbit)
+{
+	TBitNFunc<C_UInt32>::Check(nbit);
+	(*BitNFunc_UInt32.Pack[nbit])(s, p, n, offset);
+}
+
+COREARRAY_DLL_DEFAULT void CoreArray::BitNPack(C_UInt8 *s,
+	const C_Int32 *p, size_t n, unsigned offset, unsigned nbit)
+{
+	TBitNFunc<C_Int32>::Check(nbit);
+	(*BitNFunc_Int32.Pack[nbit])(s, p, n, offset);
+}
@@ -68,6 +68,114 @@ namespace CoreArray
 		SIZE64 pS, SIZE64 pD, SIZE64 Len);
 
 
+	// =====================================================================
+	// 2-bit packing and unpacking (SSE2/AVX2 if available)
+	// =====================================================================
+
+	/// unpack 'n' bytes of 2-bit integers in 's' to 'p', return 'p + 4*n'
+	COREARRAY_DLL_DEFAULT C_UInt8 *Bit2Unpack(C_UInt8 *p,
+		const C_UInt8 *s, size_t n);
+	/// unpack 'n' bytes of 2-bit integers in 's' to 'p', return 'p + 4*n'
+	COREARRAY_DLL_DEFAULT C_Int8 *Bit2Unpack(C_Int8 *p,
+		const C_UInt8 *s, size_t n);
+	/// unpack 'n' bytes of 2-bit integers in 's' to 'p', return 'p + 4*n'
+	COREARRAY_DLL_DEFAULT C_Int32 *Bit2Unpack(C_Int32 *p,
+		const C_UInt8 *s, size_t n);
+	/// unpack 'n' bytes of 2-bit integers in 's' to 'p', return 'p + 4*n'
+	COREARRAY_DLL_DEFAULT C_Float64 *Bit2Unpack(C_Float64 *p,
+		const C_UInt8 *s, size_t n);
+
+	/// unpack 'n' bytes of 2-bit integers in 's' to 'p', generic version
+	template<typename TYPE> COREARRAY_INLINE
+		TYPE *Bit2Unpack(TYPE *p, const C_UInt8 *s, size_t n)
+	{
+		for (; n > 0; n--)
+		{
+			C_UInt8 Ch = *s++;
+			p[0] = Ch & 0x03; p[1] = (Ch >> 2) & 0x03;
+			p[2] = (Ch >> 4) & 0x03; p[3] = (Ch >> 6);
+			p += 4;
+		}
+		return p;
+	}
+
+	/// unpack 'n' bytes of 2-bit integers in 's' to 'p' according to the
+	/// selection 'sel' of length '4*n', return the end of output
+	COREARRAY_DLL_DEFAULT C_UInt8 *Bit2UnpackEx(C_UInt8 *p,
+		const C_UInt8 *s, size_t n, const C_BOOL sel[]);
+	/// unpack 'n' bytes of 2-bit integers with the selection 'sel'
+	COREARRAY_DLL_DEFAULT C_Int8 *Bit2UnpackEx(C_Int8 *p,
+		const C_UInt8 *s, size_t n, const C_BOOL sel[]);
+	/// unpack 'n' bytes of 2-bit integers with the selection 'sel'
+	COREARRAY_DLL_DEFAULT C_Int32 *Bit2UnpackEx(C_Int32 *p,
+		const C_UInt8 *s, size_t n, const C_BOOL sel[]);
+	/// unpack 'n' bytes of 2-bit integers with the selection 'sel'
+	COREARRAY_DLL_DEFAULT C_Float64 *Bit2UnpackEx(C_Float64 *p,
+		const C_UInt8 *s, size_t n, const C_BOOL sel[]);
+
+	/// unpack 'n' bytes of 2-bit integers with the selection 'sel',
+	/// generic version
+	template<typename TYPE> COREARRAY_INLINE
+		TYPE *Bit2UnpackEx(TYPE *p, const C_UInt8 *s, size_t n,
+		const C_BOOL sel[])
+	{
+		for (; n > 0; n--, sel += 4)
+		{
+			C_UInt8 Ch = *s++;
+			if (sel[0]) *p++ = Ch & 0x03;
+			if (sel[1]) *p++ = (Ch >> 2) & 0x03;
+			if (sel[2]) *p++ = (Ch >> 4) & 0x03;
+			if (sel[3]) *p++ = (Ch >> 6);
+		}
+		return p;
+	}
+
+	/// pack '4*n' integers in 'p' to 'n' bytes of 2-bit integers in 's'
+	COREARRAY_DLL_DEFAULT void Bit2Pack(C_UInt8 *s, const C_UInt8 *p,
+		size_t n);
+	/// pack '4*n' integers in 'p' to 'n' bytes of 2-bit integers in 's'
+	COREARRAY_DLL_DEFAULT void Bit2Pack(C_UInt8 *s, const C_Int8 *p,
+		size_t n);
+	/// pack '4*n' integers in 'p' to 'n' bytes of 2-bit integers in 's'
+	COREARRAY_DLL_DEFAULT void Bit2Pack(C_UInt8 *s, const C_Int32 *p,
+		size_t n);
+
+	/// pack '4*n' integers in 'p' to 'n' bytes of 2-bit integers in 's',
+	/// generic version
+	template<typename TYPE> COREARRAY_INLINE
+		void Bit2Pack(C_UInt8 *s, const TYPE *p, size_t n)
+	{
+		for (; n > 0; n--, p += 4)
+		{
+			*s++ = (C_UInt8(p[0]) & 0x03) | ((C_UInt8(p[1]) & 0x03) << 2) |
+				((C_UInt8(p[2]) & 0x03) << 4) | (C_UInt8(p[3]) << 6);
+		}
+	}
+
+
+	// =====================================================================
+	// n-bit packing and unpacking (1 <= nbit <= 31)
+	// =====================================================================
+
+	/// unpack 'n' integers of 'nbit' bits in 's' starting at the bit
+	/// 'offset' (0 .. 7) to 'p', return 'p + n'
+	COREARRAY_DLL_DEFAULT C_UInt32 *BitNUnpack(C_UInt32 *p, const C_UInt8 *s,
+		size_t n, unsigned offset, unsigned nbit);
+	/// unpack 'n' signed integers of 'nbit' bits in 's' starting at the bit
+	/// 'offset' (0 .. 7) to 'p', return 'p + n'
+	COREARRAY_DLL_DEFAULT C_Int32 *BitNUnpack(C_Int32 *p, const C_UInt8 *s,
+		size_t n, unsigned offset, unsigned nbit);
+
+	/// pack 'n' integers in 'p' to 's' starting at the bit 'offset' (0 .. 7)
+	/** the lowest 'offset' bits of s[0] are kept, and the unused high bits
+	 *  of the last byte are set to zero **/
+	COREARRAY_DLL_DEFAULT void BitNPack(C_UInt8 *s, const C_UInt32 *p,
+		size_t n, unsigned offset, unsigned nbit);
+	/// pack 'n' signed integers in 'p' to 's' starting at the bit 'offset'
+	COREARRAY_DLL_DEFAULT void BitNPack(C_UInt8 *s, const C_Int32 *p,
+		size_t n, unsigned offset, unsigned nbit);
+
+
 	/// bit array { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 }
 	extern const C_UInt8 CoreArray_MaskBit1Array[];
 	/// bit array { 0xFE, 0xFD, 0xFB, 0xF7, 0xEF, 0xDF, 0xBF, 0x7F }
@@ -327,13 +435,17 @@ namespace CoreArray
 	// =====================================================================
 
 	/// the number of integer for buffering
+	/** it should be a multiple of 8, so a block of integers ends at the same
+	 *  bit offset within a byte as it starts **/
 	static const ssize_t NUM_BUF_BIT_INT = 1024;
 
 	/// Template for allocate function, such like SBIT0, BIT0
-	/** in the case that MEM_TYPE is numeric **/
-	template<bool is_signed, typename int_type, C_Int64 mask, typename MEM_TYPE>
+	/** integers are unpacked and packed by BitNUnpack and BitNPack in
+	 *  blocks of NUM_BUF_BIT_INT, and then converted to MEM_TYPE **/
+	template<bool is_signed, typename int_type, C_Int64 mask,
+		typename MEM_TYPE, bool is_numeric>
 		struct COREARRAY_DLL_DEFAULT ALLOC_FUNC<
-			BIT_INTEGER<0u, is_signed, int_type, mask>, MEM_TYPE, true >
+			BIT_INTEGER<0u, is_signed, int_type, mask>, MEM_TYPE, is_numeric >
 	{
 		/// integer type
 		typedef typename
@@ -344,21 +456,24 @@ namespace CoreArray
 		{
 			// initialize
 			const unsigned N_BIT = (I.Handler->BitOf());
+			IntType IntBit[NUM_BUF_BIT_INT];
+			C_UInt8 Stack[NUM_BUF_BIT_INT*4 + 1];
 			SIZE64 pI = I.Ptr * N_BIT;
 			I.Ptr += n;
-			BIT_LE_R<CdAllocator> ss(I.Allocator);
 
 			I.Allocator->SetPosition(pI >> 3);
-			C_UInt8 offset = pI & 0x07;
-			if (offset)
-				ss.SkipBit(offset);
-
-			for (; n > 0; n--)
+			const unsigned offset = pI & 0x07;
+			ssize_t L0 = 0;
+			while (n > 0)
 			{
-				IntType v = ss.ReadBit(N_BIT);
-				if (is_signed)
-					v = BitSet_IfSigned(v, N_BIT);
-				*Buffer ++ = v;
+				ssize_t m = (n <= NUM_BUF_BIT_INT) ? n : NUM_BUF_BIT_INT;
+				ssize_t L = (offset + m*N_BIT + 7) >> 3;
+				I.Allocator->ReadData(Stack + L0, L - L0);
+				BitNUnpack(IntBit, Stack, m, offset, N_BIT);
+				Buffer = VAL_CONV<MEM_TYPE, IntType>::Cvt(Buffer, IntBit, m);
+				n -= m;
+				// the last byte is shared with the next block
+				if (offset) { Stack[0] = Stack[L-1]; L0 = 1; }
 			}
 
 			return Buffer;
@@ -368,202 +483,45 @@ namespace CoreArray
 		static MEM_TYPE *ReadEx(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
 			const C_BOOL sel[])
 		{
-			// initialize
-			const unsigned N_BIT = (I.Handler->BitOf());
-			SIZE64 pI = I.Ptr * N_BIT;
-			I.Ptr += n;
-			BIT_LE_R<CdAllocator> ss(I.Allocator);
-
-			I.Allocator->SetPosition(pI >> 3);
-			C_UInt8 offset = pI & 0x07;
-			if (offset)
-				ss.SkipBit(offset);
-
-			for (; n > 0; n--)
-			{
-				if (*sel++)
-				{
-					IntType v = ss.ReadBit(N_BIT);
-					if (is_signed)
-						v = BitSet_IfSigned(v, N_BIT);
-					*Buffer ++ = v;
-				} else
-					ss.SkipBit(N_BIT);
-			}
-
-			return Buffer;
-		}
-
-		/// write an array to CdAllocator
-		static const MEM_TYPE *Write(CdIterator &I, const MEM_TYPE *Buffer,
-			ssize_t n)
-		{
-			// initialize
-			const unsigned N_BIT = (I.Handler->BitOf());
-			SIZE64 pI = I.Ptr * N_BIT;
-			I.Ptr += n;
-			BIT_LE_W<CdAllocator> ss(I.Allocator);
-
-			I.Allocator->SetPosition(pI >> 3);
-			C_UInt8 offset = pI & 0x07;
-			if (offset)
-			{
-				C_UInt8 Ch = I.Allocator->R8b();
-				I.Allocator->SetPosition(I.Allocator->Position() - 1);
-				ss.WriteBit(Ch, offset);
-			}
-
-			pI += n * N_BIT;
-			for (; n > 0; n--)
-				ss.WriteBit((IntType)(*Buffer ++), N_BIT);
-			if (ss.Offset > 0)
-			{
-				I.Allocator->SetPosition(pI >> 3);
-				C_UInt8 Ch = I.Allocator->R8b();
-				I.Allocator->SetPosition(I.Allocator->Position() - 1);
-				ss.WriteBit(Ch >> ss.Offset, 8 - ss.Offset);
-			}
-
-			return Buffer;
-		}
-
-		/// append an array to CdAllocator
-		static const MEM_TYPE *Append(CdIterator &I, const MEM_TYPE *Buffer,
-			ssize_t n)
-		{
-			// compression extended info
-			const unsigned N_BIT = (I.Handler->BitOf());
-			TdCompressRemainder *ar = (I.Handler->PipeInfo() != NULL) ?
-				&(I.Handler->PipeInfo()->Remainder()) : NULL;
-
-			// initialize
-			SIZE64 pI = I.Ptr * N_BIT;
-			I.Ptr += n;
-			BIT_LE_W<CdAllocator> ss(I.Allocator);
-
-			// extract bits
-			C_UInt8 offset = pI & 0x07;
-			if (offset)
-			{
-				C_UInt8 Ch;
-				if (!ar)
-				{
-					I.Allocator->SetPosition(pI >> 3);
-					Ch = I.Allocator->R8b();
-					I.Allocator->SetPosition(I.Allocator->Position() - 1);
-				} else
-					Ch = I.Handler->PipeInfo()->Remainder().Buf[0];
-				ss.WriteBit(Ch, offset);
-			} else {
-				if (!ar)
-					I.Allocator->SetPosition(pI >> 3);
-			}
-
-			for (; n > 0; n--)
-				ss.WriteBit((IntType)(*Buffer ++), N_BIT);
-			if (ss.Offset > 0)
-			{
-				if (ar)
-				{
-					I.Handler->PipeInfo()->Remainder().Size = 1u;
-					I.Handler->PipeInfo()->Remainder().Buf[0] = ss.Reminder;
-					ss.Offset = 0;
-				}
-			} else {
-				if (ar)
-					I.Handler->PipeInfo()->Remainder().Size = 0;
-			}
-
-			return Buffer;
-		}
-	};
-
-	/// template for allocate function, such like SBIT0, BIT0
-	/** in the case that MEM_TYPE is not numeric **/
-	template<bool is_signed, typename int_type, C_Int64 mask, typename MEM_TYPE>
-		struct COREARRAY_DLL_DEFAULT ALLOC_FUNC<
-			BIT_INTEGER<0u, is_signed, int_type, mask>, MEM_TYPE, false >
-	{
-		/// integer type
-		typedef typename
-			BIT_INTEGER<0u, is_signed, int_type, mask>::IntType IntType;
-
-		/// read an array from CdAllocator
-		static MEM_TYPE *Read(CdIterator &I, MEM_TYPE *Buffer, ssize_t n)
-		{
-			// initialize
-			const unsigned N_BIT = (I.Handler->BitOf());
-			IntType IntBit[NUM_BUF_BIT_INT];
-			SIZE64 pI = I.Ptr * N_BIT;
-			I.Ptr += n;
-			BIT_LE_R<CdAllocator> ss(I.Allocator);
-
-			I.Allocator->SetPosition(pI >> 3);
-			C_UInt8 offset = pI & 0x07;
-			if (offset)
-				ss.SkipBit(offset);
-
-			IntType *pN = IntBit;
-			for (; n > 0; n--)
-			{
-				*pN = ss.ReadBit(N_BIT);
-				if (is_signed)
-					*pN = BitSet_IfSigned(*pN, N_BIT);
-				pN ++;
-				if (pN >= (IntBit+NUM_BUF_BIT_INT))
-				{
-					Buffer = VAL_CONV<MEM_TYPE, IntType>::Cvt(
-						Buffer, IntBit, NUM_BUF_BIT_INT);
-					pN = IntBit;
-				}
-			}
-			if (pN > IntBit)
-			{
-				Buffer = VAL_CONV<MEM_TYPE, IntType>::Cvt(Buffer, IntBit,
-					pN - IntBit);
-			}
-
-			return Buffer;
+			const ssize_t gap = COREARRAY_ALLOC_SKIP_SIZE * 8 /
+				I.Handler->BitOf();
+			return ALLOC_READ_SEL< ALLOC_FUNC<BIT_INTEGER<0u, is_signed,
+				int_type, mask>, MEM_TYPE, is_numeric> >(I, Buffer, n, sel,
+				1, gap);
 		}
 
-		/// read an array from CdAllocator
-		static MEM_TYPE *ReadEx(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
+		/// read an array from CdAllocator, without skipping unselected runs
+		static MEM_TYPE *ReadExDense(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
 			const C_BOOL sel[])
 		{
 			// initialize
 			const unsigned N_BIT = (I.Handler->BitOf());
 			IntType IntBit[NUM_BUF_BIT_INT];
+			C_UInt8 Stack[NUM_BUF_BIT_INT*4 + 1];
 			SIZE64 pI = I.Ptr * N_BIT;
 			I.Ptr += n;
-			BIT_LE_R<CdAllocator> ss(I.Allocator);
 
 			I.Allocator->SetPosition(pI >> 3);
-			C_UInt8 offset = pI & 0x07;
-			if (offset)
-				ss.SkipBit(offset);
-
-			IntType *pN = IntBit;
-			for (; n > 0; n--)
+			const unsigned offset = pI & 0x07;
+			ssize_t L0 = 0;
+			while (n > 0)
 			{
-				if (*sel++)
-				{
-					*pN = ss.ReadBit(N_BIT);
-					if (is_signed)
-						*pN = BitSet_IfSigned(*pN, N_BIT);
-					pN ++;
-				} else
-					ss.SkipBit(N_BIT);
-				if (pN >= (IntBit+NUM_BUF_BIT_INT))
+				ssize_t m = (n <= NUM_BUF_BIT_INT) ? n : NUM_BUF_BIT_INT;
+				ssize_t L = (offset + m*N_BIT + 7) >> 3;
+				I.Allocator->ReadData(Stack + L0, L - L0);
+				BitNUnpack(IntBit, Stack, m, offset, N_BIT);
+				// branch-free compression
+				IntType *p = IntBit;
+				for (ssize_t i=0; i < m; i++)
 				{
-					Buffer = VAL_CONV<MEM_TYPE, IntType>::Cvt(
-						Buffer, IntBit, NUM_BUF_BIT_INT);
-					pN = IntBit;
+					*p = IntBit[i];
+					p += (sel[i] != 0);
 				}
-			}
-			if (pN > IntBit)
-			{
 				Buffer = VAL_CONV<MEM_TYPE, IntType>::Cvt(Buffer, IntBit,
-					pN - IntBit);
+					p - IntBit);
+				sel += m; n -= m;
+				// the last byte is shared with the next block
+				if (offset) { Stack[0] = Stack[L-1]; L0 = 1; }
 			}
 
 			return Buffer;
@@ -576,35 +534,37 @@ namespace CoreArray
 			// initialize
 			const unsigned N_BIT = (I.Handler->BitOf());
 			IntType IntBit[NUM_BUF_BIT_INT];
+			C_UInt8 Stack[NUM_BUF_BIT_INT*4 + 1];
 			SIZE64 pI = I.Ptr * N_BIT;
 			I.Ptr += n;
-			BIT_LE_W<CdAllocator> ss(I.Allocator);
 
 			I.Allocator->SetPosition(pI >> 3);
-			C_UInt8 offset = pI & 0x07;
+			unsigned offset = pI & 0x07;
 			if (offset)
 			{
-				C_UInt8 Ch = I.Allocator->R8b();
+				Stack[0] = I.Allocator->R8b();
 				I.Allocator->SetPosition(I.Allocator->Position() - 1);
-				ss.WriteBit(Ch, offset);
 			}
 
-			pI += n * N_BIT;
 			while (n > 0)
 			{
 				ssize_t m = (n <= NUM_BUF_BIT_INT) ? n : NUM_BUF_BIT_INT;
 				VAL_CONV<IntType, MEM_TYPE>::Cvt(IntBit, Buffer, m);
 				Buffer += m;
 				n -= m;
-				for (IntType *p = IntBit; m > 0; m--)
-					ss.WriteBit(*p++, N_BIT);
+				BitNPack(Stack, IntBit, m, offset, N_BIT);
+				ssize_t L = (offset + m*N_BIT) >> 3;
+				I.Allocator->WriteData(Stack, L);
+				offset = (offset + m*N_BIT) & 0x07;
+				if (offset) Stack[0] = Stack[L];
 			}
-			if (ss.Offset > 0)
+			if (offset)
 			{
-				I.Allocator->SetPosition(pI >> 3);
+				// keep the following bits in the last byte
+				const C_UInt8 msk = 0xFF << offset;
 				C_UInt8 Ch = I.Allocator->R8b();
 				I.Allocator->SetPosition(I.Allocator->Position() - 1);
-				ss.WriteBit(Ch >> ss.Offset, 8 - ss.Offset);
+				I.Allocator->W8b((Stack[0] & ~msk) | (Ch & msk));
 			}
 
 			return Buffer;
@@ -621,23 +581,21 @@ namespace CoreArray
 
 			// initialize
 			IntType IntBit[NUM_BUF_BIT_INT];
+			C_UInt8 Stack[NUM_BUF_BIT_INT*4 + 1];
 			SIZE64 pI = I.Ptr * N_BIT;
 			I.Ptr += n;
-			BIT_LE_W<CdAllocator> ss(I.Allocator);
 
 			// extract bits
-			C_UInt8 offset = pI & 0x07;
+			unsigned offset = pI & 0x07;
 			if (offset)
 			{
-				C_UInt8 Ch;
 				if (!ar)
 				{
 					I.Allocator->SetPosition(pI >> 3);
-					Ch = I.Allocator->R8b();
+					Stack[0] = I.Allocator->R8b();
 					I.Allocator->SetPosition(I.Allocator->Position() - 1);
 				} else
-					Ch = I.Handler->PipeInfo()->Remainder().Buf[0];
-				ss.WriteBit(Ch, offset);
+					Stack[0] = ar->Buf[0];
 			} else {
 				if (!ar)
 					I.Allocator->SetPosition(pI >> 3);
@@ -649,20 +607,23 @@ namespace CoreArray
 				VAL_CONV<IntType, MEM_TYPE>::Cvt(IntBit, Buffer, m);
 				Buffer += m;
 				n -= m;
-				for (IntType *p = IntBit; m > 0; m--)
-					ss.WriteBit(*p++, N_BIT);
+				BitNPack(Stack, IntBit, m, offset, N_BIT);
+				ssize_t L = (offset + m*N_BIT) >> 3;
+				I.Allocator->WriteData(Stack, L);
+				offset = (offset + m*N_BIT) & 0x07;
+				if (offset) Stack[0] = Stack[L];
 			}
-			if (ss.Offset > 0)
+			if (offset)
 			{
 				if (ar)
 				{
-					I.Handler->PipeInfo()->Remainder().Size = 1u;
-					I.Handler->PipeInfo()->Remainder().Buf[0] = ss.Reminder;
-					ss.Offset = 0;
-				}
+					ar->Size = 1u;
+					ar->Buf[0] = Stack[0];
+				} else
+					I.Allocator->W8b(Stack[0]);
 			} else {
 				if (ar)
-					I.Handler->PipeInfo()->Remainder().Size = 0;
+					ar->Size = 0;
 			}
 
 			return Buffer;
@@ -670,7 +631,6 @@ namespace CoreArray
 	};
 }
 
-
 #include "dBitGDS_Bit1.h"
 #include "dBitGDS_Bit2.h"
 #include "dBitGDS_Bit4.h"
@@ -82,16 +82,7 @@ namespace CoreArray
 				I.Allocator->ReadData(Stack, L);
 				n -= (L << 2);
 				// extract bits
-				C_UInt8 *s = Stack;
-				for (; L > 0; L--)
-				{
-					C_UInt8 Ch = *s++;
-					Buffer[0] = Ch & 0x03;
-					Buffer[1] = (Ch >> 2) & 0x03;
-					Buffer[2] = (Ch >> 4) & 0x03;
-					Buffer[3] = (Ch >> 6);
-					Buffer += 4;
-				}
+				Buffer = Bit2Unpack(Buffer, Stack, L);
 			}
 
 			// tail
@@ -108,6 +99,14 @@ namespace CoreArray
 		/// read an array from CdAllocator
 		static MEM_TYPE *ReadEx(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
 			const C_BOOL sel[])
+		{
+			return ALLOC_READ_SEL< ALLOC_FUNC<BIT2, MEM_TYPE, true> >(I,
+				Buffer, n, sel, 1, COREARRAY_ALLOC_SKIP_SIZE * 4);
+		}
+
+		/// read an array from CdAllocator, without skipping unselected runs
+		static MEM_TYPE *ReadExDense(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
+			const C_BOOL sel[])
 		{
 			// buffer
 			C_UInt8 Stack[MEMORY_BUFFER_SIZE];
@@ -139,18 +138,8 @@ namespace CoreArray
 				I.Allocator->ReadData(Stack, L);
 				n -= (L << 2);
 				// extract bits
-				C_UInt8 *s = Stack;
-				for (; L > 0; L--)
-				{
-					C_UInt8 Ch = *s++;
-					if (*sel++) *Buffer++ = Ch & 0x03;
-					Ch >>= 2;
-					if (*sel++) *Buffer++ = Ch & 0x03;
-					Ch >>= 2;
-					if (*sel++) *Buffer++ = Ch & 0x03;
-					Ch >>= 2;
-					if (*sel++) *Buffer++ = Ch;
-				}
+				Buffer = Bit2UnpackEx(Buffer, Stack, L, sel);
+				sel += (L << 2);
 			}
 
 			// tail
@@ -186,8 +175,7 @@ namespace CoreArray
 			}
 
 			pI += n * N_BIT;
-			for (; n > 0; n--)
-				ss.WriteBit((IntType)(*Buffer ++), N_BIT);
+			Buffer = WriteBits(I, ss, Buffer, n);
 			if (ss.Offset > 0)
 			{
 				I.Allocator->SetPosition(pI >> 3);
@@ -230,8 +218,7 @@ namespace CoreArray
 					I.Allocator->SetPosition(pI >> 3);
 			}
 
-			for (; n > 0; n--)
-				ss.WriteBit((IntType)(*Buffer ++), N_BIT);
+			Buffer = WriteBits(I, ss, Buffer, n);
 			if (ss.Offset > 0)
 			{
 				if (ar)
@@ -247,6 +234,28 @@ namespace CoreArray
 
 			return Buffer;
 		}
+
+	private:
+		/// write 2-bit integers, packing whole bytes once aligned
+		static const MEM_TYPE *WriteBits(CdIterator &I,
+			BIT_LE_W<CdAllocator> &ss, const MEM_TYPE *Buffer, ssize_t n)
+		{
+			C_UInt8 Stack[MEMORY_BUFFER_SIZE];
+			for (; (n > 0) && (ss.Offset > 0); n--)
+				ss.WriteBit((IntType)(*Buffer ++), N_BIT);
+			while (n >= 4)
+			{
+				ssize_t L = (n >> 2);
+				if (L > MEMORY_BUFFER_SIZE) L = MEMORY_BUFFER_SIZE;
+				Bit2Pack(Stack, Buffer, L);
+				I.Allocator->WriteData(Stack, L);
+				Buffer += (L << 2);
+				n -= (L << 2);
+			}
+			for (; n > 0; n--)
+				ss.WriteBit((IntType)(*Buffer ++), N_BIT);
+			return Buffer;
+		}
 	};
 
 	/// template for allocate function for 2-bit integer
@@ -292,14 +301,13 @@ namespace CoreArray
 				n -= (L << 2);
 				// extract bits
 				C_UInt8 *s = Stack;
-				for (; L > 0; L--)
+				while (L > 0)
 				{
-					C_UInt8 Ch = *s++;
-					*pN++ = Ch & 0x03; Ch >>= 2;
-					*pN++ = Ch & 0x03; Ch >>= 2;
-					*pN++ = Ch & 0x03; Ch >>= 2;
-					*pN++ = Ch;
-					if (pN >= (IntBit+NUM_BUF_BIT_INT-4))
+					ssize_t m = (IntBit + NUM_BUF_BIT_INT - pN) >> 2;
+					if (m > L) m = L;
+					pN = Bit2Unpack(pN, s, m);
+					s += m; L -= m;
+					if (pN > (IntBit+NUM_BUF_BIT_INT-4))
 					{
 						Buffer = VAL_CONV<MEM_TYPE, IntType>::Cvt(
 							Buffer, IntBit, pN-IntBit);
@@ -328,6 +336,14 @@ namespace CoreArray
 		/// read an array from CdAllocator
 		static MEM_TYPE *ReadEx(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
 			const C_BOOL sel[])
+		{
+			return ALLOC_READ_SEL< ALLOC_FUNC<BIT2, MEM_TYPE, false> >(I,
+				Buffer, n, sel, 1, COREARRAY_ALLOC_SKIP_SIZE * 4);
+		}
+
+		/// read an array from CdAllocator, without skipping unselected runs
+		static MEM_TYPE *ReadExDense(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
+			const C_BOOL sel[])
 		{
 			// buffer
 			C_UInt8 Stack[MEMORY_BUFFER_SIZE];
@@ -362,17 +378,13 @@ namespace CoreArray
 				n -= (L << 2);
 				// extract bits
 				C_UInt8 *s = Stack;
-				for (; L > 0; L--)
+				while (L > 0)
 				{
-					C_UInt8 Ch = *s++;
-					if (*sel++) *pN++ = Ch & 0x03;
-					Ch >>= 2;
-					if (*sel++) *pN++ = Ch & 0x03;
-					Ch >>= 2;
-					if (*sel++) *pN++ = Ch & 0x03;
-					Ch >>= 2;
-					if (*sel++) *pN++ = Ch;
-					if (pN >= (IntBit+NUM_BUF_BIT_INT-4))
+					ssize_t m = (IntBit + NUM_BUF_BIT_INT - pN) >> 2;
+					if (m > L) m = L;
+					pN = Bit2UnpackEx(pN, s, m, sel);
+					s += m; sel += (m << 2); L -= m;
+					if (pN > (IntBit+NUM_BUF_BIT_INT-4))
 					{
 						Buffer = VAL_CONV<MEM_TYPE, IntType>::Cvt(
 							Buffer, IntBit, pN-IntBit);
@@ -427,8 +439,7 @@ namespace CoreArray
 				VAL_CONV<IntType, MEM_TYPE>::Cvt(IntBit, Buffer, m);
 				Buffer += m;
 				n -= m;
-				for (IntType *p = IntBit; m > 0; m--)
-					ss.WriteBit(*p++, N_BIT);
+				WriteBits(I, ss, IntBit, m);
 			}
 			if (ss.Offset > 0)
 			{
@@ -479,8 +490,7 @@ namespace CoreArray
 				VAL_CONV<IntType, MEM_TYPE>::Cvt(IntBit, Buffer, m);
 				Buffer += m;
 				n -= m;
-				for (IntType *p = IntBit; m > 0; m--)
-					ss.WriteBit(*p++, N_BIT);
+				WriteBits(I, ss, IntBit, m);
 			}
 			if (ss.Offset > 0)
 			{
@@ -497,6 +507,26 @@ namespace CoreArray
 
 			return Buffer;
 		}
+
+	private:
+		/// write 2-bit integers, packing whole bytes once aligned
+		static void WriteBits(CdIterator &I, BIT_LE_W<CdAllocator> &ss,
+			const IntType *p, ssize_t n)
+		{
+			C_UInt8 Stack[NUM_BUF_BIT_INT >> 2];
+			for (; (n > 0) && (ss.Offset > 0); n--)
+				ss.WriteBit(*p++, N_BIT);
+			if (n >= 4)
+			{
+				ssize_t L = (n >> 2);
+				Bit2Pack(Stack, p, L);
+				I.Allocator->WriteData(Stack, L);
+				p += (L << 2);
+				n -= (L << 2);
+			}
+			for (; n > 0; n--)
+				ss.WriteBit(*p++, N_BIT);
+		}
 	};
 }
 
@@ -97,6 +97,14 @@ namespace CoreArray
 		/// read an array from CdAllocator
 		static MEM_TYPE *ReadEx(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
 			const C_BOOL sel[])
+		{
+			return ALLOC_READ_SEL< ALLOC_FUNC<BIT4, MEM_TYPE, true> >(I,
+				Buffer, n, sel, 1, COREARRAY_ALLOC_SKIP_SIZE * 2);
+		}
+
+		/// read an array from CdAllocator, without skipping unselected runs
+		static MEM_TYPE *ReadExDense(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
+			const C_BOOL sel[])
 		{
 			// buffer
 			C_UInt8 Stack[MEMORY_BUFFER_SIZE];
@@ -293,6 +301,14 @@ namespace CoreArray
 		/// read an array from CdAllocator
 		static MEM_TYPE *ReadEx(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
 			const C_BOOL sel[])
+		{
+			return ALLOC_READ_SEL< ALLOC_FUNC<BIT4, MEM_TYPE, false> >(I,
+				Buffer, n, sel, 1, COREARRAY_ALLOC_SKIP_SIZE * 2);
+		}
+
+		/// read an array from CdAllocator, without skipping unselected runs
+		static MEM_TYPE *ReadExDense(CdIterator &I, MEM_TYPE *Buffer, ssize_t n,
+			const C_BOOL sel[])
 		{
 			// buffer
 			C_UInt8 Stack[MEMORY_BUFFER_SIZE];
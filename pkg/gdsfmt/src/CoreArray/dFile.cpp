@@ -51,6 +51,9 @@ static const char *VAR_ATTRLIST = "ATTRLIST";
 static const char *rsAttrName = "No Attribute Name ('%s').";
 static const char *rsAttrNameExist = "Attribute '%s' has existed.";
 
+/// the minimum number of names to build an index for name lookup
+static const size_t NAME_INDEX_MIN_COUNT = 16;
+
 CdObjAttr::CdObjAttr(CdGDSObj &vOwner): CdObject(), fOwner(vOwner)
 { }
 
@@ -83,6 +86,8 @@ CdAny &CdObjAttr::Add(const UTF16String &Name)
 		TdPair *I = new TdPair;
 		I->name = Name;
 		fList.push_back(I);
+		if (!fNameIndex.empty())
+			fNameIndex[Name] = fList.size() - 1;
 		Changed();
 		return I->val;
 	} else
@@ -106,6 +111,7 @@ void CdObjAttr::Delete(const UTF16String &Name)
 	TdPair *p = *it;
 	*it = NULL;
 	fList.erase(it);
+	xResetIndex();
 	delete p;
 	Changed();
 }
@@ -116,6 +122,7 @@ void CdObjAttr::Delete(int Index)
 	TdPair *p = fList[Index];
 	fList[Index] = NULL;
     fList.erase(fList.begin() + Index);
+	xResetIndex();
 	delete p;
 	Changed();
 }
@@ -132,6 +139,7 @@ void CdObjAttr::Clear()
 			delete p;
 		}
 		fList.clear();
+		xResetIndex();
 		Changed();
 	}
 }
@@ -169,6 +177,7 @@ void CdObjAttr::Loading(CdReader &Reader, TdVersion Version)
 		}
 		fList.clear();
 	}
+	xResetIndex();
 
 	if (Cnt > 0)
 	{
@@ -208,6 +217,18 @@ void CdObjAttr::Saving(CdWriter &Writer)
 
 vector<CdObjAttr::TdPair*>::iterator CdObjAttr::Find(const UTF16String &Name)
 {
+	if (fList.size() >= NAME_INDEX_MIN_COUNT)
+	{
+		if (fNameIndex.empty())
+		{
+			for (size_t i=0; i < fList.size(); i++)
+				fNameIndex.insert(make_pair(fList[i]->name, i));
+		}
+		map<UTF16String, size_t>::iterator p = fNameIndex.find(Name);
+		return (p != fNameIndex.end()) ? (fList.begin() + p->second) :
+			fList.end();
+	}
+
 	vector<TdPair*>::iterator it;
 	for (it = fList.begin(); it != fList.end(); it++)
 	{
@@ -225,9 +246,10 @@ void CdObjAttr::SetName(const UTF16String &OldName, const UTF16String &NewName)
 		throw ErrGDSObj(rsAttrName, UTF16ToUTF8(OldName).c_str());
 	if (OldName != NewName)
 	{
-		if (HasName(NewName) >= 0)
+		if (HasName(NewName))
 			throw ErrGDSObj(rsAttrNameExist, UTF16ToUTF8(NewName).c_str());
 		(*it)->name = NewName;
+		xResetIndex();
 		Changed();
 	}
 }
@@ -238,9 +260,10 @@ void CdObjAttr::SetName(int Index, const UTF16String &NewName)
 	xValidateName(NewName);
 	if (p.name != NewName)
 	{
-		if (HasName(NewName) >= 0)
+		if (HasName(NewName))
 			throw ErrGDSObj(rsAttrNameExist, UTF16ToUTF8(NewName).c_str());
 		p.name = NewName;
+		xResetIndex();
 		Changed();
 	}
 }
@@ -330,6 +353,7 @@ void CdGDSObj::SetName(const UTF16String &NewName)
 				{
 					if (fFolder->_HasName(NewName))
 						throw ErrGDSObj(ERR_DUP_NAME);
+					fFolder->_IndexRename(it->Name, NewName);
 					it->Name = NewName;
 					fFolder->fChanged = true;
 				}
@@ -360,7 +384,9 @@ void CdGDSObj::MoveTo(CdGDSFolder &folder)
 				if (folder._HasName(it->Name))
 					throw ErrGDSObj(ERR_DUP_NAME);
 				folder.fList.push_back(*it);
+				folder._IndexAppend();
 				fFolder->fList.erase(it);
+				fFolder->_IndexReset();
 				fFolder->fChanged = folder.fChanged = true;
 				fFolder = &folder;
 			}
@@ -381,6 +407,8 @@ void CdGDSObj::GetOwnBlockStream(vector<const CdBlockStream*> &Out)
 	Out.clear();
 }
 
+void CdGDSObj::UpdateBufSize() { }
+
 CdGDSFile *CdGDSObj::GDSFile()
 {
 	if (fGDSStream)
@@ -559,6 +587,34 @@ namespace CoreArray
 	};
 
 
+	/// The pipe for writing data to a compressed stream with random access
+	template<typename CLASS>
+		class COREARRAY_DLL_DEFAULT CdWritePipeRA:
+		public CdWritePipe2<CLASS, CdRAAlgorithm::TBlockSize>
+	{
+	public:
+		CdWritePipeRA(CdRecodeStream::TLevel vLevel,
+				CdRAAlgorithm::TBlockSize bs, int nThread,
+				TdCompressRemainder &vRemainder):
+			CdWritePipe2<CLASS, CdRAAlgorithm::TBlockSize>(vLevel, bs,
+				vRemainder)
+		{
+			fNumThread = nThread;
+		}
+
+	protected:
+		int fNumThread;
+
+		virtual CdStream *InitPipe(CdBufStream *BufStream)
+		{
+			CdStream *rv =
+				CdWritePipe2<CLASS, CdRAAlgorithm::TBlockSize>::InitPipe(BufStream);
+			this->fPStream->SetNumThread(fNumThread);
+			return rv;
+		}
+	};
+
+
 	/// The pipe system with a template
 	template<int MaxBVal, int DefBVal, typename BSIZE,
 		typename CLASS, typename TYPE>
@@ -582,6 +638,7 @@ namespace CoreArray
 			rv->fParamIndex = fParamIndex;
 			rv->fLevel = fLevel;
 			rv->fBlockSize = fBlockSize;
+			rv->fNumThread = fNumThread;
 			return rv;
 		}
 
@@ -630,8 +687,8 @@ namespace CoreArray
 
 		virtual CdPipeMgrItem *Match(const char *Mode) const
 		{
-			int ic, ip;
-			ParseMode(Mode, ic, ip);
+			int ic, ip, nt;
+			ParseMode(Mode, ic, ip, &nt);
 			if (ic >= 0)
 			{
 				CdPipe<MaxBVal, DefBVal, BSIZE, CLASS, TYPE> *rv = new TYPE();
@@ -640,6 +697,7 @@ namespace CoreArray
 				rv->fBlockSize = (BSIZE)ip;
 				rv->fCoderIndex = rv->fLevel;
 				rv->fParamIndex = ip;
+				rv->fNumThread = nt;
 				return rv;
 			} else
 				return NULL;
@@ -752,7 +810,7 @@ namespace CoreArray
 	// =====================================================================
 
 	typedef CdStreamPipe2<CdZRA_Inflate> CdZRAReadPipe;
-	typedef CdWritePipe2<CdZRA_Deflate, CdRAAlgorithm::TBlockSize> CdZRAWritePipe;
+	typedef CdWritePipeRA<CdZRA_Deflate> CdZRAWritePipe;
 
 	static const char *ZRA_Strings[] =
 	{
@@ -772,11 +830,13 @@ namespace CoreArray
 		virtual void PushReadPipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdZRAReadPipe); }
 		virtual void PushWritePipe(CdBufStream &buf)
-			{ buf.PushPipe(new CdZRAWritePipe(fLevel, fBlockSize, fRemainder)); }
+			{ buf.PushPipe(new CdZRAWritePipe(fLevel, fBlockSize, fNumThread,
+				fRemainder)); }
 
 	protected:
 		virtual const char **CoderList() const { return ZRA_Strings; }
 		virtual const char **ParamList() const { return RA_Str_BSize; }
+		virtual bool MultiThread() const { return true; }
 	};
 
 
@@ -817,7 +877,7 @@ namespace CoreArray
 	// =====================================================================
 
 	typedef CdStreamPipe2<CdLZ4RA_Inflate> CdLZ4RAReadPipe;
-	typedef CdWritePipe2<CdLZ4RA_Deflate, CdRAAlgorithm::TBlockSize> CdLZ4RAWritePipe;
+	typedef CdWritePipeRA<CdLZ4RA_Deflate> CdLZ4RAWritePipe;
 
 	static const char *LZ4RA_Strings[] =
 	{
@@ -837,11 +897,80 @@ namespace CoreArray
 		virtual void PushReadPipe(CdBufStream &buf)
 			{ buf.PushPipe(new CdLZ4RAReadPipe); }
 		virtual void PushWritePipe(CdBufStream &buf)
-			{ buf.PushPipe(new CdLZ4RAWritePipe(fLevel, fBlockSize, fRemainder)); }
+			{ buf.PushPipe(new CdLZ4RAWritePipe(fLevel, fBlockSize, fNumThread,
+				fRemainder)); }
 
 	protected:
 		virtual const char **CoderList() const { return LZ4RA_Strings; }
 		virtual const char **ParamList() const { return RA_Str_BSize; }
+		virtual bool MultiThread() const { return true; }
+	};
+
+
+	// =====================================================================
+	// ZSTD: Zstandard Pipe
+	// =====================================================================
+
+	typedef CdStreamPipe2<CdZstdInflate> CdZstdReadPipe;
+	typedef CdWritePipe<CdZstdDeflate> CdZstdWritePipe;
+
+	static const char *Zstd_Strings[] =
+	{
+		"ZSTD.none", "ZSTD.fast", "ZSTD.default",
+		"ZSTD.max", "ZSTD", NULL
+	};
+
+	class COREARRAY_DLL_DEFAULT CdPipeZstd:
+		public CdPipe<0, -1, int, CdZstdDeflate, CdPipeZstd>
+	{
+	public:
+		virtual const char *Coder() const
+			{ return "ZSTD"; }
+		virtual const char *Description() const
+			{ return "Zstandard_v" ZSTD_VERSION_STRING; }
+		virtual void PushReadPipe(CdBufStream &buf)
+			{ buf.PushPipe(new CdZstdReadPipe); }
+		virtual void PushWritePipe(CdBufStream &buf)
+			{ buf.PushPipe(new CdZstdWritePipe(fLevel, fRemainder)); }
+
+	protected:
+		virtual const char **CoderList() const { return Zstd_Strings; }
+		virtual const char **ParamList() const { return NULL; }
+	};
+
+
+	// =====================================================================
+	// ZSTD_RA: Zstandard Pipe with random access
+	// =====================================================================
+
+	typedef CdStreamPipe2<CdZstdRA_Inflate> CdZstdRAReadPipe;
+	typedef CdWritePipeRA<CdZstdRA_Deflate> CdZstdRAWritePipe;
+
+	static const char *ZstdRA_Strings[] =
+	{
+		"ZSTD_RA.none", "ZSTD_RA.fast", "ZSTD_RA.default",
+		"ZSTD_RA.max", "ZSTD_RA", NULL
+	};
+
+	class COREARRAY_DLL_DEFAULT CdPipeZstdRA:
+		public CdPipe<CdRAAlgorithm::raLast, CdRAAlgorithm::raDefault,
+		CdRAAlgorithm::TBlockSize, CdZstdRA_Deflate, CdPipeZstdRA>
+	{
+	public:
+		virtual const char *Coder() const
+			{ return "ZSTD_RA"; }
+		virtual const char *Description() const
+			{ return "Zstandard_v" ZSTD_VERSION_STRING " (chunk + random access)"; }
+		virtual void PushReadPipe(CdBufStream &buf)
+			{ buf.PushPipe(new CdZstdRAReadPipe); }
+		virtual void PushWritePipe(CdBufStream &buf)
+			{ buf.PushPipe(new CdZstdRAWritePipe(fLevel, fBlockSize, fNumThread,
+				fRemainder)); }
+
+	protected:
+		virtual const char **CoderList() const { return ZstdRA_Strings; }
+		virtual const char **ParamList() const { return RA_Str_BSize; }
+		virtual bool MultiThread() const { return true; }
 	};
 }
 
@@ -886,6 +1015,7 @@ bool CdPipeMgrItem::EqualText(const char *s1, const char *s2)
 CdPipeMgrItem2::CdPipeMgrItem2(): CdPipeMgrItem()
 {
 	fCoderIndex = fParamIndex = -1;
+	fNumThread = 1;
 }
 
 bool CdPipeMgrItem2::Equal(const char *Mode) const
@@ -912,9 +1042,28 @@ string CdPipeMgrItem2::CoderParam() const
 }
 
 void CdPipeMgrItem2::ParseMode(const char *Mode, int &IdxCoder,
-	int &IdxParam) const
+	int &IdxParam, int *NumThread) const
 {
 	IdxCoder = IdxParam = -1;
+	if (NumThread) *NumThread = 1;
+
+	// the optional suffix of thread number, e.g., "ZIP_RA:4T"
+	string ss_mode = Mode;
+	size_t pos_t = ss_mode.rfind(':');
+	if ((pos_t != string::npos) && (ss_mode.size() > pos_t + 2) &&
+		(toupper(ss_mode[ss_mode.size()-1]) == 'T'))
+	{
+		int nt = 0;
+		for (size_t i=pos_t+1; i < ss_mode.size()-1; i++)
+		{
+			if (!isdigit(ss_mode[i]) || (nt > 9999)) return;
+			nt = nt*10 + (ss_mode[i] - '0');
+		}
+		if ((nt < 1) || !MultiThread()) return;
+		if (NumThread) *NumThread = nt;
+		ss_mode.resize(pos_t);
+		Mode = ss_mode.c_str();
+	}
 
 	string s = Mode;
 	size_t pos = s.find(':');
@@ -963,6 +1112,8 @@ CdStreamPipeMgr::CdStreamPipeMgr(): CdAbstractManager()
 	Register(new CdPipeZRA);
 	Register(new CdPipeLZ4);
 	Register(new CdPipeLZ4RA);
+	Register(new CdPipeZstd);
+	Register(new CdPipeZstdRA);
 }
 
 CdStreamPipeMgr::~CdStreamPipeMgr()
@@ -1138,6 +1289,7 @@ CdGDSObj *CdGDSFolder::AddFolder(const UTF16String &Name)
 	I.StreamID = rv->fGDSStream->ID();
 	I.SetFlagType(CdGDSFolder::TNode::FLAG_TYPE_FOLDER);
 	fList.push_back(I);
+	_IndexAppend();
 	fChanged = true;
 
 	return rv;
@@ -1192,9 +1344,13 @@ CdGDSObj *CdGDSFolder::InsertObj(int index, const UTF16String &Name,
 
 	I.Name = Name; I.Obj = val;
 	if (index < 0)
+	{
 		fList.push_back(I);
-	else
+		_IndexAppend();
+	} else {
 		fList.insert(fList.begin()+index, I);
+		_IndexReset();
+	}
 	fChanged = true;
 
 	return val;
@@ -1218,6 +1374,7 @@ void CdGDSFolder::MoveTo(int Index, int NewPos)
 			fList.erase(fList.begin() + Index);
 			fList.insert(fList.begin() + NewPos, ND);
 		}
+		_IndexReset();
 
 		fChanged = true;
 	}
@@ -1271,6 +1428,7 @@ void CdGDSFolder::DeleteObj(int Index, bool force)
 		}
 	}
     fList.erase(it);
+	_IndexReset();
 
 	fChanged = true;
 }
@@ -1351,16 +1509,11 @@ CdGDSObj * CdGDSFolder::ObjItemEx(int Index)
 
 CdGDSObj * CdGDSFolder::ObjItemEx(const UTF16String &Name)
 {
-	vector<CdGDSFolder::TNode>::iterator it;
-	for (it = fList.begin(); it != fList.end(); it++)
-	{
-		if (it->Name == Name)
-		{
-			_LoadItem(*it);
-			return it->Obj;
-		}
-	}
-	return NULL;
+	int Index = _IndexName(Name);
+	if (Index < 0) return NULL;
+	CdGDSFolder::TNode &I = fList[Index];
+	_LoadItem(I);
+	return I.Obj;
 }
 
 CdGDSObj * CdGDSFolder::Path(const UTF16String &FullName)
@@ -1452,6 +1605,7 @@ void CdGDSFolder::Loading(CdReader &Reader, TdVersion Version)
 {
 	// Load directory inforamtion
 	fList.clear();
+	_IndexReset();
 	C_Int32 L = 0;
 	Reader[VAR_DIRCNT] >> L;
 
@@ -1521,24 +1675,62 @@ void CdGDSFolder::_ClearFolder()
 		}
 	}
 	fList.clear();
+	_IndexReset();
+}
+
+int CdGDSFolder::_IndexName(const UTF16String &Name)
+{
+	if (fList.size() < NAME_INDEX_MIN_COUNT)
+	{
+		for (size_t i=0; i < fList.size(); i++)
+			if (fList[i].Name == Name)
+				return i;
+		return -1;
+	}
+
+	// build the index on demand
+	if (fNameIndex.empty())
+	{
+		for (size_t i=0; i < fList.size(); i++)
+			fNameIndex.insert(make_pair(fList[i].Name, i));
+	}
+	map<UTF16String, size_t>::iterator it = fNameIndex.find(Name);
+	return (it != fNameIndex.end()) ? (int)it->second : -1;
+}
+
+void CdGDSFolder::_IndexAppend()
+{
+	if (!fNameIndex.empty())
+		fNameIndex.insert(make_pair(fList.back().Name, fList.size()-1));
+}
+
+void CdGDSFolder::_IndexRename(const UTF16String &OldName,
+	const UTF16String &NewName)
+{
+	if (!fNameIndex.empty())
+	{
+		map<UTF16String, size_t>::iterator it = fNameIndex.find(OldName);
+		if (it != fNameIndex.end())
+		{
+			size_t i = it->second;
+			fNameIndex.erase(it);
+			fNameIndex.insert(make_pair(NewName, i));
+		} else
+			_IndexReset();
+	}
 }
 
 bool CdGDSFolder::_HasName(const UTF16String &Name)
 {
-	vector<CdGDSFolder::TNode>::iterator it;
-	for (it = fList.begin(); it != fList.end(); it++)
-		if (it->Name == Name)
-			return true;
-	return false;
+	return _IndexName(Name) >= 0;
 }
 
 CdGDSFolder::TNode &CdGDSFolder::_NameItem(const UTF16String &Name)
 {
-	vector<CdGDSFolder::TNode>::iterator it;
-	for (it = fList.begin(); it != fList.end(); it++)
-		if (it->Name == Name)
-			return *it;
-	throw ErrGDSObj(erFolderName, UTF16ToUTF8(Name).c_str());
+	int Index = _IndexName(Name);
+	if (Index < 0)
+		throw ErrGDSObj(erFolderName, UTF16ToUTF8(Name).c_str());
+	return fList[Index];
 }
 
 void CdGDSFolder::_LoadItem(TNode &I)
@@ -2370,11 +2562,20 @@ void CdGDSFile::LoadFileFork(const char *fn, bool ReadOnly)
 	fFileName = UTF8Text(fn);
 }
 
+void CdGDSFile::LoadFileMMap(const char *fn)
+{
+	TdAutoRef<CdStream> F(new CdMMapStream(fn));
+	LoadStream(F.get(), true);
+	fFileName = UTF8Text(fn);
+}
+
 void CdGDSFile::SyncFile()
 {
 	if (fStream == NULL)
 		throw ErrGDSFile(erSaveStream);
 	fRoot._UpdateAll();
+	if (fBlockTable && !fReadOnly)
+		WriteBlockTable();
 }
 
 void CdGDSFile::SaveAsFile(const UTF8String &fn)
@@ -2449,6 +2650,8 @@ void CdGDSFile::CloseFile()
 			fRoot.fGDSStream->Release();
 			fRoot.fGDSStream = NULL;
 		}
+		if (fBlockTable && !fReadOnly)
+			WriteBlockTable();
 		CdBlockCollection::Clear();
     }
 }
@@ -2456,6 +2659,7 @@ void CdGDSFile::CloseFile()
 void CdGDSFile::TidyUp(bool deep)
 {
 	bool TempReadOnly = fReadOnly;
+	bool TempBlockTable = fBlockTable;
 	UTF8String fn, f;
 	fn = fFileName;
 	f = fn + ASC(".tmp");
@@ -2465,6 +2669,8 @@ void CdGDSFile::TidyUp(bool deep)
 	remove(RawText(fn).c_str());
 	rename(RawText(f).c_str(), RawText(fn).c_str());
 	LoadFile(fn, TempReadOnly);
+	if (TempBlockTable && !TempReadOnly)
+		SetBlockTable(true);
 }
 
 bool CdGDSFile::_HaveModify(CdGDSFolder *folder)
@@ -2487,6 +2693,28 @@ bool CdGDSFile::_HaveModify(CdGDSFolder *folder)
 	return false;
 }
 
+void CdGDSFile::SetBufSize(ssize_t Size, ssize_t MaxSize)
+{
+	fBufSize = (Size > 0) ? Size : 0;
+	fBufMaxSize = (MaxSize > 0) ? MaxSize : 0;
+	_UpdateBufSize(&fRoot);
+}
+
+void CdGDSFile::_UpdateBufSize(CdGDSFolder *folder)
+{
+	vector<CdGDSFolder::TNode>::iterator it;
+	for (it = folder->fList.begin(); it != folder->fList.end(); it++)
+	{
+		if (it->Obj)
+		{
+			if (dynamic_cast<CdGDSFolder*>(it->Obj))
+				_UpdateBufSize(static_cast<CdGDSFolder*>(it->Obj));
+			else
+				it->Obj->UpdateBufSize();
+		}
+	}
+}
+
 bool CdGDSFile::Modified()
 {
 	return _HaveModify(&fRoot);
@@ -2494,7 +2722,7 @@ bool CdGDSFile::Modified()
 
 SIZE64 CdGDSFile::GetFileSize()
 {
-    return fStreamSize;
+    return fStreamSize + fTableSize;
 }
 
 int CdGDSFile::GetNumOfFragment()
@@ -2504,7 +2732,8 @@ int CdGDSFile::GetNumOfFragment()
 
 bool CdGDSFile::IfSupportForking()
 {
-	return (dynamic_cast<CdForkFileStream*>(fStream) != NULL);
+	return (dynamic_cast<CdForkFileStream*>(fStream) != NULL) ||
+		(dynamic_cast<CdMMapStream*>(fStream) != NULL);
 }
 
 TProcessID CdGDSFile::GetProcessID()
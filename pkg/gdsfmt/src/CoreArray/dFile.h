@@ -41,6 +41,7 @@
 #include "dSerial.h"
 #include "dStream.h"
 #include "dAny.h"
+#include <map>
 
 
 namespace CoreArray
@@ -95,6 +96,8 @@ namespace CoreArray
 
 		CdGDSObj &fOwner;
 		std::vector<TdPair*> fList;
+		/// the index of names for a long list, empty if it is not built
+		std::map<UTF16String, size_t> fNameIndex;
 
 		virtual void Loading(CdReader &Reader, TdVersion Version);
 		virtual void Saving(CdWriter &Writer);
@@ -102,6 +105,7 @@ namespace CoreArray
 	private:
 		std::vector<TdPair*>::iterator Find(const UTF16String &Name);
         void xValidateName(const UTF16String &name);
+		COREARRAY_INLINE void xResetIndex() { fNameIndex.clear(); }
 	};
 
 	
@@ -134,6 +138,9 @@ namespace CoreArray
 		/// Get a list of CdBlockStream owned by this object, except fGDSStream
 		virtual void GetOwnBlockStream(vector<const CdBlockStream*> &Out);
 
+		/// Reapply the default buffer sizes after CdGDSFile::SetBufSize
+		virtual void UpdateBufSize();
+
 		/// Get the GDS file
 		CdGDSFile *GDSFile();
 		COREARRAY_INLINE CdObjAttr &Attribute() { return fAttr; }
@@ -237,10 +244,15 @@ namespace CoreArray
 	protected:
 		int fCoderIndex;
 		int fParamIndex;
+		/// the number of threads for compression, not saved in the file
+		int fNumThread;
 
-		void ParseMode(const char *Mode, int &IdxCoder, int &IdxParam) const;
+		void ParseMode(const char *Mode, int &IdxCoder, int &IdxParam,
+			int *NumThread=NULL) const;
 		virtual const char **CoderList() const = 0;
 		virtual const char **ParamList() const = 0;
+		/// whether the mode allows a suffix of thread number, e.g., ":4T"
+		virtual bool MultiThread() const { return false; }
 	};
 
 
@@ -430,6 +442,8 @@ namespace CoreArray
 			void SetFlagType(C_UInt32 val);
 		};
 		std::vector<TNode> fList;
+		/// the index of child names for a large folder, empty if not built
+		std::map<UTF16String, size_t> fNameIndex;
 
 		virtual void Loading(CdReader &Reader, TdVersion Version);
 		virtual void Saving(CdWriter &Writer);
@@ -438,6 +452,11 @@ namespace CoreArray
 		void _ClearFolder();
 
 	private:
+		int _IndexName(const UTF16String &Name);
+		void _IndexAppend();
+		COREARRAY_INLINE void _IndexReset() { fNameIndex.clear(); }
+		void _IndexRename(const UTF16String &OldName,
+			const UTF16String &NewName);
 		bool _HasName(const UTF16String &Name);
 		TNode &_NameItem(const UTF16String &Name);
 		void _LoadItem(TNode &I);
@@ -603,6 +622,8 @@ namespace CoreArray
 		void LoadFile(const UTF8String &fn, bool ReadOnly=true);
 		void LoadFile(const char *fn, bool ReadOnly=true);
 		void LoadFileFork(const char *fn, bool ReadOnly=true);
+		/// Open a file in read-only mode via memory mapping
+		void LoadFileMMap(const char *fn);
 
 		void SaveAsFile(const UTF8String &fn);
 		void SaveAsFile(const char *fn);
@@ -616,6 +637,17 @@ namespace CoreArray
 		/// Clean up all fragments
 		void TidyUp(bool deep);
 
+		/// Set the default buffer sizes of all array objects
+		/** \param Size     the buffer size for random access, 0 for the
+		 *                  library default (STREAM_BUFFER_SIZE)
+		 *  \param MaxSize  the maximum buffer size for sequential reading,
+		 *                  0 for the library default (STREAM_BUFFER_MAX_SIZE)
+		 *  Objects with their own buffer sizes are not affected.
+		**/
+		void SetBufSize(ssize_t Size, ssize_t MaxSize);
+		COREARRAY_INLINE ssize_t BufSize() const { return fBufSize; }
+		COREARRAY_INLINE ssize_t BufMaxSize() const { return fBufMaxSize; }
+
 		bool Modified();
 
 		/// Return file size of the CdGDSFile object
@@ -651,6 +683,7 @@ namespace CoreArray
 
 		void _Init();
 		bool _HaveModify(CdGDSFolder *folder);
+		void _UpdateBufSize(CdGDSFolder *folder);
 	};
 
 	/// The pointer to a CoreArray GDS File
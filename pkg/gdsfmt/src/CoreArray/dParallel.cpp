@@ -38,36 +38,6 @@ extern "C"
 }
 
 
-namespace CoreArray
-{
-	namespace Parallel
-	{
-		namespace _INTERNAL
-		{
-			struct COREARRAY_DLL_DEFAULT _pThreadStruct
-			{
-				void (*proc)(CoreArray::CdThread *, int, void*);
-				int ThreadIndex;
-				void *Param;
-				CoreArray::Parallel::CParallelBase *cpBase;
-			};
-
-			int _pDoThread(CoreArray::CdThread *Thread, _pThreadStruct Data)
-			{
-				Data.cpBase->InitThread();
-
-				COREARRAY_PARALLEL_TRY
-					COREARRAY_Parallel_Call((TCallProc)Data.proc,
-						Thread, Data.ThreadIndex, Data.Param);
-				COREARRAY_PARALLEL_CATCH
-
-				Data.cpBase->DoneThread();
-				return 0;
-			}
-		}
-	}
-}
-
 using namespace std;
 using namespace CoreArray;
 using namespace CoreArray::Parallel;
@@ -157,22 +127,303 @@ void CdConsoleProgress::ShowProgress()
 }
 
 
+// CdThreadPool
+
+/// the worker thread in the pool
+class CdThreadPool::CdWorker
+{
+public:
+	CdThreadPool *Pool;  //< the owner
+	CdThreadEvent Event; //< signaled when a job is assigned
+	bool Quit;           //< whether the thread should exit
+
+	// the current job
+	CdThreadPool::TProc Proc;
+	void *Param;
+	int Index;
+	CParallelBase *Base;
+	CdThreadPool::TJobGroup *Group;
+	CdThreadPool::TJob *Job;  //< an asynchronous job if not NULL
+
+	CdWorker(CdThreadPool *pool): Pool(pool), Quit(false), Proc(NULL),
+		Param(NULL), Index(0), Base(NULL), Group(NULL), Job(NULL)
+	{
+		Thread.BeginThread(CdThreadPool::_WorkerLoop, this);
+	}
+
+	/// stop and join the thread
+	void Stop()
+	{
+		Quit = true;
+		Event.Set();
+		Thread.EndThread();
+	}
+
+private:
+	CdThread Thread;
+};
+
+/// the workers assigned in a call of CdThreadPool::Run
+struct CdThreadPool::TJobGroup
+{
+	int Count;           //< the number of running workers
+	CdThreadEvent Done;  //< signaled when all workers finish
+	bool Failed;         //< whether a worker throws an exception
+	string ErrMsg;       //< the message of the first exception
+};
+
+/// call a job, and return the error message if an exception is thrown
+static bool _CallJob(CdThreadPool::TProc Proc, CdThread *Thread, int Index,
+	void *Param, CParallelBase *Base, string &ErrMsg)
+{
+	bool Failed = false;
+	try {
+		if (Base) Base->InitThread();
+		COREARRAY_Parallel_Call((TCallProc)Proc, Thread, Index, Param);
+	}
+	catch (std::exception &E) {
+		Failed = true; ErrMsg = E.what();
+	}
+	catch (const char *E) {
+		Failed = true; ErrMsg = E;
+	}
+	catch (...) {
+		Failed = true; ErrMsg = "Unknown error in a worker thread.";
+	}
+	if (Base) Base->DoneThread();
+	return Failed;
+}
+
+int CdThreadPool::_WorkerLoop(CdThread *Thread, CdWorker *Worker)
+{
+	CdThreadPool &Pool = *Worker->Pool;
+	Worker->Event.Wait();
+	while (!Worker->Quit)
+	{
+		string ErrMsg;
+		if (Worker->Job)
+		{
+			// an asynchronous job, and 'Job' is not used after Set()
+			TJob *Job = Worker->Job;
+			Job->Failed = _CallJob(Job->Proc, Thread, 0, Job->Param, NULL,
+				ErrMsg);
+			Job->Done.Set();
+
+			// take the next job in the queue, or back to the pool
+			TdAutoMutex AutoMutex(&Pool.fMutex);
+			if (!Pool.fQueue.empty())
+			{
+				Worker->Job = Pool.fQueue.front();
+				Pool.fQueue.pop_front();
+				continue;
+			}
+			Worker->Job = NULL;
+			Pool.fNumAsync --;
+			Pool.fIdle.push_back(Worker);
+		} else {
+			// the job might be reassigned once the worker is back to the pool,
+			// and the exception is passed to the calling thread in Run()
+			TJobGroup *Group = Worker->Group;
+			bool Failed = _CallJob(Worker->Proc, Thread, Worker->Index,
+				Worker->Param, Worker->Base, ErrMsg);
+
+			// back to the pool
+			TdAutoMutex AutoMutex(&Pool.fMutex);
+			Pool.fIdle.push_back(Worker);
+			if (Failed && !Group->Failed)
+			{
+				Group->Failed = true;
+				Group->ErrMsg = ErrMsg;
+			}
+			// 'Group' is on the stack of Run(), and it is not used after Set()
+			if ((--Group->Count) <= 0)
+				Group->Done.Set();
+		}
+		Worker->Event.Wait();
+	}
+	return 0;
+}
+
+CdThreadPool::CdThreadPool()
+{
+	fNumWorker = fNumAsync = 0;
+}
+
+CdThreadPool::~CdThreadPool()
+{
+	Clear();
+}
+
+void CdThreadPool::Run(int nThread, CParallelBase *Base, TProc Proc,
+	void *param)
+{
+	if (!Proc) return;
+
+	TJobGroup Group;
+	Group.Count = 0;
+	Group.Failed = false;
+	if (nThread > 1)
+	{
+		TdAutoMutex AutoMutex(&fMutex);
+		// create the workers before assigning any job
+		while ((int)fIdle.size() < nThread-1)
+		{
+			fIdle.push_back(new CdWorker(this));
+			fNumWorker ++;
+		}
+		// assign the jobs
+		Group.Count = nThread - 1;
+		for (int i=1; i < nThread; i++)
+		{
+			CdWorker *W = fIdle.back();
+			fIdle.pop_back();
+			W->Proc = Proc; W->Param = param;
+			W->Index = i; W->Base = Base;
+			W->Group = &Group;
+			W->Event.Set();
+		}
+	}
+
+	// the calling thread, and the workers should finish before 'Group' is
+	// out of scope even if an exception is thrown
+	try {
+		if (Base) Base->InitThread();
+		COREARRAY_Parallel_Call((TCallProc)Proc, NULL, 0, param);
+	}
+	catch (...) {
+		if (Base) Base->DoneThread();
+		if (nThread > 1) Group.Done.Wait();
+		throw;
+	}
+	if (Base) Base->DoneThread();
+
+	// wait for the workers
+	if (nThread > 1)
+	{
+		Group.Done.Wait();
+		if (Group.Failed)
+			throw ErrParallel(Group.ErrMsg);
+	}
+}
+
+void CdThreadPool::Submit(TJob *Job)
+{
+	Job->Failed = false;
+	Job->Pool = this;
+	TdAutoMutex AutoMutex(&fMutex);
+	if (fIdle.empty() && (fNumAsync < Mach::GetCPU_NumOfCores()))
+	{
+		fIdle.push_back(new CdWorker(this));
+		fNumWorker ++;
+	}
+	if (!fIdle.empty() && (fNumAsync < Mach::GetCPU_NumOfCores()))
+	{
+		CdWorker *W = fIdle.back();
+		fIdle.pop_back();
+		fNumAsync ++;
+		W->Job = Job;
+		W->Event.Set();
+	} else
+		fQueue.push_back(Job);
+}
+
+void CdThreadPool::Wait(TJob *Job)
+{
+	// the worker threads of another pool do not exist in a forked process
+	bool RunHere = (Job->Pool != this);
+	if (!RunHere)
+	{
+		TdAutoMutex AutoMutex(&fMutex);
+		deque<TJob*>::iterator it = find(fQueue.begin(), fQueue.end(), Job);
+		if (it != fQueue.end())
+		{
+			fQueue.erase(it);
+			RunHere = true;
+		}
+	}
+	if (RunHere)
+	{
+		// not taken by any worker, run it in the calling thread
+		string ErrMsg;
+		Job->Failed = _CallJob(Job->Proc, NULL, 0, Job->Param, NULL, ErrMsg);
+	} else
+		Job->Done.Wait();
+}
+
+int CdThreadPool::NumWorker()
+{
+	TdAutoMutex AutoMutex(&fMutex);
+	return fNumWorker;
+}
+
+void CdThreadPool::Clear()
+{
+	vector<CdWorker*> lst;
+	{
+		TdAutoMutex AutoMutex(&fMutex);
+		lst.swap(fIdle);
+		fNumWorker -= lst.size();
+	}
+	for (vector<CdWorker*>::iterator it=lst.begin(); it != lst.end(); it++)
+	{
+		(*it)->Stop();
+		delete *it;
+	}
+}
+
+/// the process-wide thread pool
+static CdThreadPool *GlobalThreadPool = NULL;
+/// the process which creates GlobalThreadPool
+static TProcessID GlobalThreadPoolPID = 0;
+/// the mutex object for GlobalThreadPool
+static CdThreadMutex GlobalThreadPoolMutex;
+
+/// stop the worker threads when the library is unloaded
+static struct TGlobalThreadPoolFree
+{
+	~TGlobalThreadPoolFree()
+	{
+		if (GlobalThreadPool && (GlobalThreadPoolPID == GetCurrentProcessID()))
+		{
+			try {
+				delete GlobalThreadPool;
+			} catch (...) { }
+		}
+		GlobalThreadPool = NULL;
+	}
+} GlobalThreadPoolFree;
+
+CdThreadPool &CdThreadPool::Global()
+{
+	TdAutoMutex AutoMutex(&GlobalThreadPoolMutex);
+	// the worker threads do not exist in a forked process
+	if (GlobalThreadPool && (GlobalThreadPoolPID != GetCurrentProcessID()))
+		GlobalThreadPool = NULL;
+	if (!GlobalThreadPool)
+	{
+		GlobalThreadPool = new CdThreadPool;
+		GlobalThreadPoolPID = GetCurrentProcessID();
+	}
+	return *GlobalThreadPool;
+}
+
+
 // CParallelBase
 
 static const char *errNThread = "Invalid # of threads (%d)";
+static const char *errGrain = "Invalid grain size (%lld)";
 
 CParallelBase::CParallelBase(int _nThread)
 {
 	if (_nThread < 1)
 		throw ErrParallel(errNThread, _nThread);
 	fnThread = _nThread;
+	fGrain = 1;
 	fProgress = NULL;
 }
 
 CParallelBase::~CParallelBase()
-{
-	CloseThreads();
-}
+{ }
 
 void CParallelBase::InitThread()
 {
@@ -185,25 +436,20 @@ void CParallelBase::DoneThread()
 	// do nothing ...
 }
 
-void CParallelBase::CloseThreads()
-{
-	vector<CdThread*>::iterator it;
-	for (it=fThreads.begin(); it!=fThreads.end(); it++)
-	{
-		delete *it;
-		*it = NULL;
-	}
-	fThreads.clear();
-}
-
 void CParallelBase::SetNumThread(int _nThread)
 {
-	CloseThreads();
 	if (_nThread < 1)
     	throw ErrParallel(errNThread, _nThread);
 	fnThread = _nThread;
 }
 
+void CParallelBase::SetGrain(C_Int64 _Grain)
+{
+	if (_Grain < 1)
+		throw ErrParallel(errGrain, (long long)_Grain);
+	fGrain = _Grain;
+}
+
 void CParallelBase::AutoSetnThread()
 {
 	fnThread = Mach::GetCPU_NumOfCores();
@@ -214,35 +460,77 @@ void CParallelBase::AutoSetnThread()
 void CParallelBase::RunThreads(CParallelBase::TProc Proc, void *param)
 {
 	if (!Proc) return;
-	CloseThreads();
 
 	if (fnThread > 1)
 	{
-		fThreads.resize(fnThread-1);
-		for (int i=0; i < fnThread-1; i++)
-		{
-			_INTERNAL::_pThreadStruct pd;
-			pd.proc = Proc;
-			pd.ThreadIndex = i+1;
-			pd.cpBase = this;
-			pd.Param = param;
-			fThreads[i] = new CdThread;
-			fThreads[i]->BeginThread(_INTERNAL::_pDoThread, pd);
+		CdThreadPool::Global().Run(fnThread, this, Proc, param);
+	} else {
+		InitThread();
+		try {
+			COREARRAY_Parallel_Call((TCallProc)Proc, NULL, 0, param);
 		}
+		catch (...) {
+			DoneThread();
+			throw;
+		}
+		DoneThread();
 	}
+}
 
-	InitThread();
+/// the parameters of CParallelBase::RunRange
+struct TRangeParam
+{
+	CParallelBase::TRangeProc Proc;  //< the user-defined function
+	void *Param;                     //< the user-defined parameter
+	C_Int64 Total, Grain, Next;      //< the range, block size and next task
+	CdThreadMutex Mutex;             //< the mutex object for Next
+};
 
-	COREARRAY_PARALLEL_TRY
-		COREARRAY_Parallel_Call((TCallProc)Proc, NULL, 0, param);
-	COREARRAY_PARALLEL_CATCH
+static void _pRangeThread(CdThread *Thread, int Index, void *Param)
+{
+	TRangeParam &P = *((TRangeParam*)Param);
+	for (;;)
+	{
+		C_Int64 Start;
+		{
+			TdAutoMutex AutoMutex(&P.Mutex);
+			if (P.Next >= P.Total) break;
+			Start = P.Next;
+			P.Next += P.Grain;
+		}
+		C_Int64 Cnt = P.Total - Start;
+		if (Cnt > P.Grain) Cnt = P.Grain;
+		(*P.Proc)(Start, Cnt, Index, P.Param);
+	}
+}
 
-	DoneThread();
+void CParallelBase::RunRange(CParallelBase::TRangeProc Proc, C_Int64 Total,
+	C_Int64 Grain, void *param)
+{
+	if (!Proc || (Total <= 0)) return;
+	if (Grain <= 0) Grain = fGrain;
 
-	for (int i=0; i < fnThread-1; i++)
-		fThreads[i]->EndThread();
+	// the number of threads, not more than the number of blocks
+	C_Int64 nBlock = (Total + Grain - 1) / Grain;
+	int nThread = (nBlock < fnThread) ? (int)nBlock : fnThread;
 
-	CloseThreads();
+	if (nThread > 1)
+	{
+		TRangeParam P;
+		P.Proc = Proc; P.Param = param;
+		P.Total = Total; P.Grain = Grain; P.Next = 0;
+		CdThreadPool::Global().Run(nThread, this, _pRangeThread, &P);
+	} else {
+		InitThread();
+		try {
+			(*Proc)(0, Total, 0, param);
+		}
+		catch (...) {
+			DoneThread();
+			throw;
+		}
+		DoneThread();
+	}
 }
 
 void CParallelBase::SetProgress(CdBaseProgression *Val)
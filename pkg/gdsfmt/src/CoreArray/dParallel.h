@@ -43,6 +43,7 @@
 #include "dTrait.h"
 
 #include <vector>
+#include <deque>
 #include <memory>
 #include <algorithm>
 #ifndef COREARRAY_NO_STD_IN_OUT
@@ -142,25 +143,94 @@ namespace CoreArray
 			{
 				TCLASS * obj;
 				void (TCLASS::*proc)(CdThread *, int);
-				int ThreadIndex;
-				CParallelBase *cpBase;
 			};
 
 			template<class TCLASS> COREARRAY_DLL_DEFAULT
-				int _pDoThreadEx(CdThread *Thread, _pThreadStructEx<TCLASS> Data)
+				void _pDoThreadEx(CdThread *Thread, int Index, void *Param)
 			{
-				Data.cpBase->InitThread();
-
-				COREARRAY_PARALLEL_TRY
-                	(Data.obj->*Data.proc)(Thread, Data.ThreadIndex);
-				COREARRAY_PARALLEL_CATCH
-
-				Data.cpBase->DoneThread();
-				return 0;
+				_pThreadStructEx<TCLASS> &Data = *((_pThreadStructEx<TCLASS>*)Param);
+				(Data.obj->*Data.proc)(Thread, Index);
 			}
 		}
 
 
+		/// A process-wide pool of worker threads
+		/** The worker threads are created on demand, and they wait for the
+		 *  next job after finishing the current one instead of exiting, so
+		 *  that a parallel call does not pay for creating and joining threads.
+		 *  A job with n threads always gets n-1 workers running concurrently,
+		 *  and a nested parallel call gets additional workers. Asynchronous
+		 *  jobs (Submit) share at most as many workers as CPU cores, and wait
+		 *  in a queue if all of them are busy.
+		**/
+		class COREARRAY_DLL_DEFAULT CdThreadPool
+		{
+		public:
+			/// The function called by each thread
+			typedef void (*TProc)(CdThread *Thread, int, void *);
+
+			CdThreadPool();
+			~CdThreadPool();
+
+			/// Call Proc on nThread threads (including the calling thread)
+			/** Proc(NULL, 0, param) is called by the calling thread, and
+			 *  Proc(Thread, i, param) with i = 1, ..., nThread-1 by the workers.
+			 *  Return after all calls finish. If any call throws an exception,
+			 *  the exception is raised in the calling thread after all calls
+			 *  finish.
+			**/
+			void Run(int nThread, CParallelBase *Base, TProc Proc, void *param);
+
+			/// An asynchronous job
+			struct TJob
+			{
+				TProc Proc;          //< the function called by a worker
+				void *Param;         //< the parameter passed to Proc
+				bool Failed;         //< whether Proc throws an exception
+				CdThreadEvent Done;  //< signaled when Proc returns
+				CdThreadPool *Pool;  //< the pool which Job is submitted to
+			};
+
+			/// Call Job->Proc(Thread, 0, Job->Param) on a worker, without waiting
+			/** The caller should call Wait(Job) before freeing or resubmitting
+			 *  Job. An exception thrown by Proc is not passed to the caller,
+			 *  but Job->Failed is set.
+			**/
+			void Submit(TJob *Job);
+			/// Wait until the submitted job finishes
+			/** The calling thread runs the job itself if no worker has taken it
+			 *  yet, so that waiting in a worker never blocks the queue.
+			**/
+			void Wait(TJob *Job);
+
+			/// Return the number of worker threads
+			int NumWorker();
+			/// Stop and free all idle worker threads
+			void Clear();
+
+			/// The process-wide thread pool
+			static CdThreadPool &Global();
+
+		protected:
+			class CdWorker;
+			struct TJobGroup;
+			friend class CdWorker;
+
+			/// the mutex object for fIdle and job groups
+			CdThreadMutex fMutex;
+			/// the idle workers
+			std::vector<CdWorker*> fIdle;
+			/// the number of workers
+			int fNumWorker;
+			/// the number of workers running asynchronous jobs
+			int fNumAsync;
+			/// the asynchronous jobs waiting for a worker
+			std::deque<TJob*> fQueue;
+
+			static int _WorkerLoop(CdThread *Thread, CdWorker *Worker);
+		};
+
+
         /// The base class of parallel computing library, multi-thread
 		class COREARRAY_DLL_DEFAULT CParallelBase
 		{
@@ -172,56 +242,50 @@ namespace CoreArray
 			void InitThread();
 			/// Free resource when a thread finishes
 			void DoneThread();
-			/// Close all threads
-			void CloseThreads();
 			/// Return the total number of thread used
 			COREARRAY_INLINE int nThread() const { return fnThread; }
 			/// Reset the number of thread used
 			void SetNumThread(int _nThread);
+			/// Return the number of tasks taken by a thread at a time
+			COREARRAY_INLINE C_Int64 Grain() const { return fGrain; }
+			/// Set the number of tasks taken by a thread at a time (1 by default)
+			/** A larger grain reduces the cost of locking for small tasks, and
+			 *  is used by CParallelSection and CParallelQueue.
+			**/
+			void SetGrain(C_Int64 _Grain);
 			/// Automatically determine the number of threads used
 			void AutoSetnThread();
 
 			COREARRAY_INLINE CdThreadMutex &Mutex() { return fMutex; }
 
-			/// Create nThread threads (including the main thread), and Proc is called by each thread
+			/// Run nThread threads (including the main thread), and Proc is called by each thread
 			typedef void (*TProc)(CdThread *Thread, int, void *);
 
 			void RunThreads(TProc Proc, void *param);
 
-			/// Create nThread threads (including the main thread), and Proc is called by each
+			/// Run nThread threads (including the main thread), and Proc is called by each
 			//  thread closure or delegate for C++
 			template<class TCLASS>
 				void RunThreads(void (TCLASS::*Proc)(CdThread *, int), TCLASS *obj)
 			{
 				if (!Proc || !obj) return;
-				CloseThreads();
-
-				if (fnThread > 1)
-				{
-					fThreads.resize(fnThread-1);
-					for (int i=0; i < fnThread-1; i++)
-					{
-						_INTERNAL::_pThreadStructEx<TCLASS> pd;
-						pd.obj = obj; pd.proc = Proc;
-						pd.ThreadIndex = i+1; pd.cpBase = this;
-						fThreads[i] = new CdThread;
-						fThreads[i]->BeginThread(_INTERNAL::_pDoThreadEx<TCLASS>, pd);
-					}
-				}
-
-				InitThread();
-
-				COREARRAY_PARALLEL_TRY
-					(obj->*Proc)(NULL, 0);
-				COREARRAY_PARALLEL_CATCH
-
-				DoneThread();
+				_INTERNAL::_pThreadStructEx<TCLASS> pd;
+				pd.obj = obj; pd.proc = Proc;
+				RunThreads(_INTERNAL::_pDoThreadEx<TCLASS>, &pd);
+			}
 
-				for (int i=0; i < fnThread-1; i++)
-					fThreads[i]->EndThread();
+			/// Proc is called on a range [Start, Start+Count) of tasks
+			typedef void (*TRangeProc)(C_Int64 Start, C_Int64 Count, int Index,
+				void *param);
 
-				CloseThreads();
-			}
+			/// Split [0, Total) into blocks of Grain tasks and call Proc on each block
+			/** The blocks are assigned to at most nThread threads dynamically,
+			 *  and only the calling thread is used if Total <= Grain, which
+			 *  avoids the dispatching cost for small problems. If Grain <= 0,
+			 *  Grain() is used.
+			**/
+			void RunRange(TRangeProc Proc, C_Int64 Total, C_Int64 Grain,
+				void *param);
 
 			COREARRAY_INLINE CdBaseProgression *Progress() const { return fProgress; }
 			void SetProgress(CdBaseProgression *Val);
@@ -229,7 +293,7 @@ namespace CoreArray
 
 		protected:
 			int fnThread;
-			std::vector<CdThread*> fThreads;
+			C_Int64 fGrain;
 			CdThreadMutex fMutex;
 			CdBaseProgression *fProgress;
 
@@ -324,13 +388,24 @@ namespace CoreArray
                 TINDEX Idx;
 				do {
 					fMutex.Lock();
-					if (Rec.TotalSize > 0)
+					size_t S = min((size_t)fGrain, Rec.TotalSize);
+					if (S > 0)
 					{
-						OUTTYPE *pBuf = Rec.InBuf++;
-						Idx = Rec.Index; ++Rec.Index; --Rec.TotalSize;
+						OUTTYPE *pBuf = Rec.InBuf;
+						Rec.InBuf += S;
+						Idx = Rec.Index; Rec.Index += S;
+						Rec.TotalSize -= S;
 						fMutex.Unlock();
-						(Rec.Obj->*Rec.Proc)(Idx, *pBuf);
-						ForwardProgress();
+						for (size_t i=S; i > 0; i--)
+						{
+							(Rec.Obj->*Rec.Proc)(Idx, *pBuf);
+							++Idx; ++pBuf;
+						}
+						if (fProgress)
+						{
+							TdAutoMutex AutoMutex(&fMutex);
+							fProgress->Forward(S);
+						}
 					} else {
 						fMutex.Unlock();
 						break;
@@ -360,13 +435,24 @@ namespace CoreArray
                 TINDEX Idx;
 				do {
 					fMutex.Lock();
-					if (Rec.TotalSize > 0)
+					size_t S = min((size_t)fGrain, Rec.TotalSize);
+					if (S > 0)
 					{
-						OUTTYPE *pBuf = Rec.InBuf++;
-						Idx = Rec.Index; ++Rec.Index; --Rec.TotalSize;
+						OUTTYPE *pBuf = Rec.InBuf;
+						Rec.InBuf += S;
+						Idx = Rec.Index; Rec.Index += S;
+						Rec.TotalSize -= S;
 						fMutex.Unlock();
-						(Rec.Obj->*Rec.Proc)(Idx, *pBuf, ThreadData);
-						ForwardProgress();
+						for (size_t i=S; i > 0; i--)
+						{
+							(Rec.Obj->*Rec.Proc)(Idx, *pBuf, ThreadData);
+							++Idx; ++pBuf;
+						}
+						if (fProgress)
+						{
+							TdAutoMutex AutoMutex(&fMutex);
+							fProgress->Forward(S);
+						}
 					} else {
 						fMutex.Unlock();
 						break;
@@ -665,24 +751,30 @@ namespace CoreArray
 							fMutex.Unlock(); Suspend();
                         }
 					} else {
+						// the tasks are taken within the current buffer
+						C_Int64 S = std::min(fGrain, Rec.IndexEnd-Rec.WorkingIndex);
 						OUTTYPE *pBuf = Rec.Buffer + (Rec.WorkingIndex-Rec.IndexBase);
-						Rec.WorkingIndex++;
-						Idx = Rec.Idx; ++Rec.Idx;
+						Rec.WorkingIndex += S;
+						Idx = Rec.Idx; Rec.Idx += S;
 						fMutex.Unlock();
 						// call ...
-						(Rec.Obj->*Rec.Proc)(Idx, *pBuf);
+						for (C_Int64 i=S; i > 0; i--)
+						{
+							(Rec.Obj->*Rec.Proc)(Idx, *pBuf);
+							++Idx; ++pBuf;
+						}
 						// update FinishIndex
 						{
 							TdAutoMutex Auto(&fMutex);
 							if (fProgress)
-								fProgress->Forward();
-							if ((++Rec.FinishIndex) >= Rec.IndexEnd)
+								fProgress->Forward(S);
+							if ((Rec.FinishIndex += S) >= Rec.IndexEnd)
 							{
 								size_t OldSize = Rec.IndexEnd - Rec.IndexBase;
 								C_Int64 L = std::min(Rec.TotalSize-Rec.IndexEnd, (C_Int64)Rec.BufSize);
 								Rec.IndexBase = Rec.IndexEnd;
 								Rec.IndexEnd += L;
-								Idx = Rec.IdxBase; Rec.IdxBase += L;
+								Idx = Rec.IdxBase; Rec.IdxBase += OldSize;
 								(Rec.Obj->*Rec.QueueFunc)(Idx, Rec.Buffer, OldSize);
 								WakeUp();
 							}
@@ -725,24 +817,30 @@ namespace CoreArray
 							fMutex.Unlock(); Suspend();
                         }
 					} else {
+						// the tasks are taken within the current buffer
+						C_Int64 S = std::min(fGrain, Rec.IndexEnd-Rec.WorkingIndex);
 						OUTTYPE *pBuf = Rec.Buffer + (Rec.WorkingIndex-Rec.IndexBase);
-						Rec.WorkingIndex++;
-						Idx = Rec.Idx; ++Rec.Idx;
+						Rec.WorkingIndex += S;
+						Idx = Rec.Idx; Rec.Idx += S;
 						fMutex.Unlock();
 						// call ...
-						(Rec.Obj->*Rec.Proc)(Idx, *pBuf, ThreadData);
+						for (C_Int64 i=S; i > 0; i--)
+						{
+							(Rec.Obj->*Rec.Proc)(Idx, *pBuf, ThreadData);
+							++Idx; ++pBuf;
+						}
 						// update FinishIndex
 						{
 							TdAutoMutex Auto(&fMutex);
 							if (fProgress)
-								fProgress->Forward();
-							if ((++Rec.FinishIndex) >= Rec.IndexEnd)
+								fProgress->Forward(S);
+							if ((Rec.FinishIndex += S) >= Rec.IndexEnd)
 							{
 								size_t OldSize = Rec.IndexEnd - Rec.IndexBase;
 								C_Int64 L = std::min(Rec.TotalSize-Rec.IndexEnd, (C_Int64)Rec.BufSize);
 								Rec.IndexBase = Rec.IndexEnd;
 								Rec.IndexEnd += L;
-								Idx = Rec.IdxBase; Rec.IdxBase += L;
+								Idx = Rec.IdxBase; Rec.IdxBase += OldSize;
 								(Rec.Obj->*Rec.QueueFunc)(Idx, Rec.Buffer, OldSize);
 								WakeUp();
 							}
@@ -780,24 +878,30 @@ namespace CoreArray
 							fMutex.Unlock(); Suspend();
                         }
 					} else {
+						// the tasks are taken within the current buffer
+						C_Int64 S = std::min(fGrain, Rec.IndexEnd-Rec.WorkingIndex);
 						OUTTYPE *pBuf = Rec.Buffer + (Rec.WorkingIndex-Rec.IndexBase);
-						Rec.WorkingIndex++;
-						Idx = Rec.Idx; ++Rec.Idx;
+						Rec.WorkingIndex += S;
+						Idx = Rec.Idx; Rec.Idx += S;
 						fMutex.Unlock();
 						// call ...
-						(Rec.Obj->*Rec.Proc)(Thread, Index, Idx, *pBuf);
+						for (C_Int64 i=S; i > 0; i--)
+						{
+							(Rec.Obj->*Rec.Proc)(Thread, Index, Idx, *pBuf);
+							++Idx; ++pBuf;
+						}
 						// update FinishIndex
 						{
 							TdAutoMutex Auto(&fMutex);
 							if (fProgress)
-								fProgress->Forward();
-							if ((++Rec.FinishIndex) >= Rec.IndexEnd)
+								fProgress->Forward(S);
+							if ((Rec.FinishIndex += S) >= Rec.IndexEnd)
 							{
 								size_t OldSize = Rec.IndexEnd - Rec.IndexBase;
 								C_Int64 L = std::min(Rec.TotalSize-Rec.IndexEnd, (C_Int64)Rec.BufSize);
 								Rec.IndexBase = Rec.IndexEnd;
 								Rec.IndexEnd += L;
-								Idx = Rec.IdxBase; Rec.IdxBase += L;
+								Idx = Rec.IdxBase; Rec.IdxBase += OldSize;
 								(Rec.Obj->*Rec.QueueFunc)(Thread, Index, Idx, Rec.Buffer, OldSize);
 								WakeUp();
 							}
@@ -935,7 +1039,7 @@ namespace CoreArray
 								C_Int64 L = std::min(Rec.TotalSize-Rec.IndexEnd, (C_Int64)Rec.BufSize);
 								Rec.IndexBase = Rec.IndexEnd;
 								Rec.IndexEnd += L;
-								Idx = Rec.IdxBase; Rec.IdxBase += L;
+								Idx = Rec.IdxBase; Rec.IdxBase += OldSize;
 								(Rec.Obj->*Rec.QueueFunc)(Idx, Rec.Buffer, OldSize);
 								WakeUp();
 							}
@@ -1003,7 +1107,7 @@ namespace CoreArray
 								C_Int64 L = std::min(Rec.TotalSize-Rec.IndexEnd, (C_Int64)Rec.BufSize);
 								Rec.IndexBase = Rec.IndexEnd;
 								Rec.IndexEnd += L;
-								Idx = Rec.IdxBase; Rec.IdxBase += L;
+								Idx = Rec.IdxBase; Rec.IdxBase += OldSize;
 								(Rec.Obj->*Rec.QueueFunc)(Idx, Rec.Buffer, OldSize);
 								WakeUp();
 							}
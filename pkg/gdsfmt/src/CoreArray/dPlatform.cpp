@@ -1120,6 +1120,51 @@ size_t CoreArray::SysHandleRead(TSysHandle Handle, void *Buffer, size_t Count)
 	#endif
 }
 
+#if defined(COREARRAY_PLATFORM_WINDOWS)
+/// the mutex object for restoring the file pointer in SysHandleReadAt
+static CdThreadMutex SysHandleReadAtMutex;
+#endif
+
+size_t CoreArray::SysHandleReadAt(TSysHandle Handle, C_Int64 Offset,
+	void *Buffer, size_t Count)
+{
+	#if defined(COREARRAY_PLATFORM_WINDOWS)
+		// ReadFile with an offset moves the file pointer of a synchronous
+		// handle, which is restored for the sequential I/O of the owner
+		TdAutoMutex AutoMutex(&SysHandleReadAtMutex);
+		C_Int64 Pos = SysHandleSeek(Handle, 0, soCurrent);
+		if (Pos < 0) return 0;
+		OVERLAPPED ov;
+		memset(&ov, 0, sizeof(ov));
+		ov.Offset = (DWORD)Offset;
+		ov.OffsetHigh = (DWORD)(Offset >> 32);
+		unsigned long rv;
+		if (!ReadFile(Handle, Buffer, Count, &rv, &ov))
+			rv = 0;
+		SysHandleSeek(Handle, Pos, soBeginning);
+		return rv;
+	#else
+		size_t n = 0;
+		while (Count > 0)
+		{
+		#if defined(COREARRAY_CYGWIN) || defined(COREARRAY_PLATFORM_MACOS)
+			ssize_t rv = pread(Handle, Buffer, Count, Offset);
+		#else
+			ssize_t rv = pread64(Handle, Buffer, Count, Offset);
+		#endif
+			if (rv < 0)
+			{
+				if (errno == EINTR) continue;
+				break;
+			} else if (rv == 0)
+				break;
+			Buffer = (char*)Buffer + rv;
+			Count -= rv; Offset += rv; n += rv;
+		}
+		return n;
+	#endif
+}
+
 size_t CoreArray::SysHandleWrite(TSysHandle Handle, const void* Buffer,
 	size_t Count)
 {
@@ -1900,6 +1945,69 @@ void CdThreadsSuspending::WakeUp()
 }
 
 
+// CdThreadEvent
+
+CdThreadEvent::CdThreadEvent()
+{
+#if defined(COREARRAY_POSIX_THREAD)
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
+	signaled = false;
+#elif defined(COREARRAY_PLATFORM_WINDOWS)
+	// Create an auto-reset event.
+	event_ = CreateEvent(NULL,  // no security
+						FALSE, // auto-reset
+						FALSE, // non-signaled initially
+						NULL); // unnamed
+	if (event_ == NULL)
+		RaiseLastOSError<ErrThread>();
+#else
+	XXXX: need portable pthread_mutex_init and pthread_cond_init
+#endif
+}
+
+CdThreadEvent::~CdThreadEvent()
+{
+#if defined(COREARRAY_POSIX_THREAD)
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&cond);
+#elif defined(COREARRAY_PLATFORM_WINDOWS)
+	CloseHandle(event_);
+#else
+	XXXX: need portable pthread_mutex_destroy and pthread_cond_destroy
+#endif
+}
+
+void CdThreadEvent::Set()
+{
+#if defined(COREARRAY_POSIX_THREAD)
+	pthread_mutex_lock(&mutex);
+	signaled = true;
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&mutex);
+#elif defined(COREARRAY_PLATFORM_WINDOWS)
+	SetEvent(event_);
+#else
+	XXXX: need portable pthread_cond_signal
+#endif
+}
+
+void CdThreadEvent::Wait()
+{
+#if defined(COREARRAY_POSIX_THREAD)
+	pthread_mutex_lock(&mutex);
+	while (!signaled)
+		pthread_cond_wait(&cond, &mutex);
+	signaled = false;
+	pthread_mutex_unlock(&mutex);
+#elif defined(COREARRAY_PLATFORM_WINDOWS)
+	WaitForSingleObject(event_, INFINITE);
+#else
+	XXXX: need portable pthread_cond_wait
+#endif
+}
+
+
 // ErrCoreArray
 
 void ErrCoreArray::Init(const char *fmt, va_list arglist)
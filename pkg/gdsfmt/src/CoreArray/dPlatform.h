@@ -298,6 +298,9 @@ namespace CoreArray
 	COREARRAY_DLL_DEFAULT bool SysCloseHandle(TSysHandle Handle);
 	COREARRAY_DLL_DEFAULT size_t SysHandleRead(TSysHandle Handle, void *Buffer,
 		size_t Count);
+	/// read at the given offset without changing the file offset (thread-safe)
+	COREARRAY_DLL_DEFAULT size_t SysHandleReadAt(TSysHandle Handle,
+		C_Int64 Offset, void *Buffer, size_t Count);
 	COREARRAY_DLL_DEFAULT size_t SysHandleWrite(TSysHandle Handle,
 		const void* Buffer, size_t Count);
 	COREARRAY_DLL_DEFAULT C_Int64 SysHandleSeek(TSysHandle Handle,
@@ -570,6 +573,41 @@ namespace CoreArray
 	typedef CdThreadsSuspending* PdThreadsSuspending;
 
 
+	/// Auto-reset event for waking up a thread
+	/** A call of Set() is not lost if no thread is waiting, and the next
+	 *  Wait() returns immediately.
+	**/
+	class COREARRAY_DLL_DEFAULT CdThreadEvent
+	{
+	public:
+		CdThreadEvent();
+		~CdThreadEvent();
+
+		/// Signal the event, and wake up one waiting thread
+		void Set();
+		/// Wait until the event is signaled, then reset it
+		void Wait();
+
+	protected:
+
+	#if defined(COREARRAY_POSIX_THREAD)
+
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		bool signaled;
+
+	#elif defined(COREARRAY_PLATFORM_WINDOWS)
+
+		HANDLE event_;
+
+	#else
+		#error "The system should support posix thread."
+	#endif
+	};
+
+	typedef CdThreadEvent* PdThreadEvent;
+
+
 
 	// =====================================================================
 	// Exception
@@ -123,7 +123,7 @@ namespace CoreArray
 			this->_AssignToDim(*rv);
 			if (this->fPipeInfo)
 				rv->fPipeInfo = this->fPipeInfo->NewOne();
-			return NULL;
+			return rv;
 		}
 
 		COREARRAY_INLINE ssize_t MaxLength() const
@@ -357,6 +357,22 @@ namespace CoreArray
 	};
 
 
+	/// find the first zero character in [p, e), or return e if not found
+	template<typename TYPE> COREARRAY_INLINE
+		TYPE *VarStrFindZero(TYPE *p, TYPE *e)
+	{
+		while ((p < e) && (*p != 0)) p++;
+		return p;
+	}
+
+	/// find the first zero character in [p, e), or return e if not found
+	COREARRAY_INLINE C_UTF8 *VarStrFindZero(C_UTF8 *p, C_UTF8 *e)
+	{
+		void *r = memchr(p, 0, e - p);
+		return r ? (C_UTF8*)r : e;
+	}
+
+
 	/// Variable-length string container
 	/** \tparam T  should be VARIABLE_LENGTH<C_UTF8>,
 	 *             VARIABLE_LENGTH<C_UTF16> or VARIABLE_LENGTH<C_UTF32>
@@ -374,6 +390,7 @@ namespace CoreArray
 			this->_ActualPosition = 0;
 			this->_CurrentIndex = 0;
 			this->_TotalSize = 0;
+			this->_Index.push_back(0);
 		}
 
         virtual CdGDSObj *NewOne(void *Param = NULL)
@@ -398,9 +415,19 @@ namespace CoreArray
 */
 
 
+		/// the number of strings between two entries of the offset index (2^10)
+		static const int INDEX_SHIFT = 10;
+		/// the number of characters in a chunk for bulk reading
+		static const ssize_t STRING_CHUNK_SIZE = 4096;
+
 		SIZE64 _ActualPosition;
 		C_Int64 _CurrentIndex;
 		SIZE64 _TotalSize;
+		/// sparse offset index, the byte position of string (i << INDEX_SHIFT)
+		/** built lazily while strings are visited, it covers the positions of
+		 *  the first (_Index.size() << INDEX_SHIFT) strings
+		**/
+		vector<SIZE64> _Index;
 
 		void _RewindIndex()
 		{
@@ -408,32 +435,23 @@ namespace CoreArray
 			this->_CurrentIndex = 0;
 		}
 
-		COREARRAY_INLINE TType _ReadString()
+		/// add the current position to the offset index if needed
+		COREARRAY_INLINE void _AddIndex()
 		{
-			TYPE Ch;
-			TType Val;
-			BYTE_LE<CdAllocator> ss(this->fAllocator);
-			ss.SetPosition(this->_ActualPosition);
-			do {
-				ss >> Ch;
-				this->_ActualPosition += sizeof(Ch);
-				if (Ch != 0) Val.push_back(Ch);
-			} while (Ch != 0);
-			this->_CurrentIndex ++;
-			COREARRAY_ENDIAN_LE_TO_NT_ARRAY((TYPE*)Val.c_str(), Val.size());
-			return Val;
+			if ((this->_CurrentIndex & ((1 << INDEX_SHIFT) - 1)) == 0)
+			{
+				if ((this->_CurrentIndex >> INDEX_SHIFT) ==
+						(C_Int64)this->_Index.size())
+					this->_Index.push_back(this->_ActualPosition);
+			}
 		}
 
-		COREARRAY_INLINE void _SkipString()
+		/// shift the indexed positions after the current string by 'Delta'
+		COREARRAY_INLINE void _ShiftIndex(SIZE64 Delta)
 		{
-			TYPE Ch;
-			BYTE_LE<CdAllocator> ss(this->fAllocator);
-			ss.SetPosition(this->_ActualPosition);
-			do {
-				ss >> Ch;
-				this->_ActualPosition += sizeof(Ch);
-			} while (Ch != 0);
-			this->_CurrentIndex ++;
+			size_t i = (this->_CurrentIndex >> INDEX_SHIFT) + 1;
+			for (; i < this->_Index.size(); i++)
+				this->_Index[i] += Delta;
 		}
 
 		COREARRAY_INLINE void _WriteString(const TType val)
@@ -456,12 +474,14 @@ namespace CoreArray
 					this->_ActualPosition + str_size,
 					this->_TotalSize - this->_ActualPosition - old_len);
 				this->_TotalSize -= (old_len - str_size);
+				this->_ShiftIndex(str_size - old_len);
 			} else if (old_len < str_size)
 			{
 				this->fAllocator.Move(this->_ActualPosition + old_len,
 					this->_ActualPosition + str_size,
 					this->_TotalSize - this->_ActualPosition - old_len);
 				this->_TotalSize += (str_size - old_len);
+				this->_ShiftIndex(str_size - old_len);
 			}
 
 			BYTE_LE<CdAllocator> ss(this->fAllocator);
@@ -470,43 +490,110 @@ namespace CoreArray
 
 			this->_ActualPosition += str_size + sizeof(Ch);
 			this->_CurrentIndex ++;
+			this->_AddIndex();
 		}
 
-		COREARRAY_INLINE void _AppendString(const TType val)
+		COREARRAY_INLINE void _AppendString(const TType val, C_Int64 Idx)
 		{
 			const typename TdTraits< FIXED_LENGTH<TYPE> >::RawType Ch = 0;
 			size_t pos = val.find(Ch);
 			if (pos == string::npos) pos = val.length();
 
+			// remove the index entries from the appended string
+			size_t k = (Idx + (1 << INDEX_SHIFT) - 1) >> INDEX_SHIFT;
+			if (k < 1) k = 1;
+			if (this->_Index.size() > k) this->_Index.resize(k);
+			this->_CurrentIndex = Idx;
+			this->_ActualPosition = this->_TotalSize;
+			this->_AddIndex();
+
 			BYTE_LE<CdAllocator> ss(this->fAllocator);
 			ss.SetPosition(this->_TotalSize);
 			ss.W((TYPE*)val.c_str(), pos+1);
 
 			this->_ActualPosition = this->_TotalSize = ss.Position();
-			this->_CurrentIndex = this->fTotalCount + 1;
+			this->_CurrentIndex = Idx + 1;
+			this->_AddIndex();
 		}
 
 		COREARRAY_INLINE void _Find_Position(SIZE64 Index)
 		{
 			if (Index != this->_CurrentIndex)
 			{
-				if (Index < this->_CurrentIndex)
-					this->_RewindIndex();
+				// jump to the nearest indexed string before 'Index'
+				size_t k = Index >> INDEX_SHIFT;
+				if (k >= this->_Index.size())
+					k = this->_Index.size() - 1;
+				C_Int64 I = (C_Int64)k << INDEX_SHIFT;
+				if ((Index < this->_CurrentIndex) || (I > this->_CurrentIndex))
+				{
+					this->_CurrentIndex = I;
+					this->_ActualPosition = this->_Index[k];
+				}
 
-				BYTE_LE<CdAllocator> ss(this->fAllocator);
-				ss.SetPosition(this->_ActualPosition);
-				while (this->_CurrentIndex < Index)
+				if (this->_CurrentIndex < Index)
 				{
-					TYPE Ch;
-					do {
-						ss >> Ch;
-						this->_ActualPosition += sizeof(Ch);
-					} while (Ch != 0);
-					this->_CurrentIndex ++;
+					this->_ReadStrings((TType*)NULL,
+						Index - this->_CurrentIndex, NULL);
 				}
 			}
 		}
 
+		/// read or skip 'n' strings from the current position
+		/** strings are scanned in chunks, 'Buffer = NULL' to skip all,
+		 *  'sel = NULL' to read all
+		**/
+		template<typename MEM_TYPE>
+			MEM_TYPE *_ReadStrings(MEM_TYPE *Buffer, C_Int64 n,
+			const C_BOOL sel[])
+		{
+			if (!this->fAllocator.BufStream())
+				throw ErrArray("CdVarStr: the allocator is not initialized.");
+			this->fAllocator.SetPosition(this->_ActualPosition);
+
+			vector<TYPE> Chunk(STRING_CHUNK_SIZE);
+			TYPE *p = &Chunk[0], *e = p;
+			TType s;
+
+			for (; n > 0; n--)
+			{
+				TYPE *z = VarStrFindZero(p, e);
+				while (z >= e)
+				{
+					// load more characters
+					ssize_t L = e - p;
+					if (L > 0)
+						memmove(&Chunk[0], p, L * sizeof(TYPE));
+					if (L >= (ssize_t)Chunk.size() / 2)
+						Chunk.resize(Chunk.size() * 2);
+					p = &Chunk[0]; e = p + L;
+					ssize_t m = this->fAllocator.Read(e, (Chunk.size() - L) *
+						sizeof(TYPE)) / sizeof(TYPE);
+					if (m <= 0)
+						throw ErrStream("CdVarStr: no string terminator.");
+					COREARRAY_ENDIAN_LE_TO_NT_ARRAY(e, m);
+					z = VarStrFindZero(e, e + m);
+					e += m;
+				}
+
+				bool Flag = (Buffer != NULL);
+				if (sel) Flag = Flag && (*sel++);
+				if (Flag)
+				{
+					s.assign(p, z);
+					ValCvtArray(Buffer, &s, 1);
+					Buffer ++;
+				}
+
+				this->_ActualPosition += (z - p + 1) * sizeof(TYPE);
+				p = z + 1;
+				this->_CurrentIndex ++;
+				this->_AddIndex();
+			}
+
+			return Buffer;
+		}
+
 		COREARRAY_INLINE C_Int64 _TotalCount() const
 		{
 			return this->fTotalCount;
@@ -540,14 +627,7 @@ namespace CoreArray
 			CdVarStr<TYPE> *IT = static_cast< CdVarStr<TYPE>* >(I.Handler);
 			IT->_Find_Position(I.Ptr / sizeof(TYPE));
 			I.Ptr += n * sizeof(TYPE);
-			for (; n > 0; n--)
-			{
-				typename TdTraits< VARIABLE_LENGTH<TYPE> >::TType s =
-					IT->_ReadString();
-				ValCvtArray(Buffer, &s, 1);
-				Buffer ++;
-			}
-			return Buffer;
+			return IT->_ReadStrings(Buffer, n, NULL);
 		}
 
 		/// read an array from CdAllocator
@@ -557,19 +637,7 @@ namespace CoreArray
 			CdVarStr<TYPE> *IT = static_cast< CdVarStr<TYPE>* >(I.Handler);
 			IT->_Find_Position(I.Ptr / sizeof(TYPE));
 			I.Ptr += n * sizeof(TYPE);
-			for (; n > 0; n--)
-			{
-				if (*sel++)
-				{
-					typename TdTraits< VARIABLE_LENGTH<TYPE> >::TType s =
-						IT->_ReadString();
-					ValCvtArray(Buffer, &s, 1);
-					Buffer ++;
-				} else {
-					IT->_SkipString();
-				}
-			}
-			return Buffer;
+			return IT->_ReadStrings(Buffer, n, sel);
 		}
 
 		/// write an array to CdAllocator
@@ -591,7 +659,8 @@ namespace CoreArray
 				if (Idx < IT->_TotalCount())
 					IT->_WriteString(s);
 				else
-					IT->_AppendString(s);
+					IT->_AppendString(s, Idx);
+				Idx ++;
 			}
 
 			return Buffer;
@@ -26,8 +26,14 @@
 // If not, see <http://www.gnu.org/licenses/>.
 
 #include "dStream.h"
+#include "dParallel.h"
 #include <cctype>
 #include <limits>
+#include <algorithm>
+
+#ifdef COREARRAY_PLATFORM_UNIX
+#   include <sys/mman.h>
+#endif
 
 #ifndef COREARRAY_NO_STD_IN_OUT
 #   include <iostream>
@@ -39,9 +45,11 @@ using namespace CoreArray;
 
 static const char *SFCreateErrorEx = "Can not create file '%s'. %s";
 static const char *SFOpenErrorEx = "Can not open file '%s'. %s";
+static const char *SFMMapErrorEx = "Can not map file '%s' into memory. %s";
 
 static const char *rsBlockInvalidPos = "Invalid Position: %lld in CdBlockStream.";
 static const char *rsInvalidBlockLen = "Invalid length of Block!";
+static const char *rsBlockReadOnly = "CdBlockReadStream is read-only.";
 
 
 // CoreArray GDS Stream position mask
@@ -71,6 +79,14 @@ ssize_t CdHandleStream::Read(void *Buffer, ssize_t Count)
 		return 0;
 }
 
+ssize_t CdHandleStream::ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count)
+{
+	if (Count > 0)
+		return SysHandleReadAt(fHandle, Pos, Buffer, Count);
+	else
+		return 0;
+}
+
 ssize_t CdHandleStream::Write(const void *Buffer, ssize_t Count)
 {
 	if (Count > 0)
@@ -198,6 +214,125 @@ COREARRAY_INLINE void CdForkFileStream::RedirectFile()
 }
 
 
+// Read-only file stream with memory mapping
+
+CdMMapStream::CdMMapStream(const char * const AFileName): CdFileStream()
+{
+	fMemory = NULL;
+	fSize = fPosition = 0;
+#ifdef COREARRAY_PLATFORM_WINDOWS
+	fMapping = NULL;
+#endif
+
+	Init(AFileName, fmOpenRead);
+	fSize = CdHandleStream::Seek(0, soEnd);
+	if (fSize <= 0) return;
+	if (fSize != (SIZE64)(size_t)fSize)
+		throw ErrStream(SFMMapErrorEx, AFileName, "The file is too large.");
+
+#if defined(COREARRAY_PLATFORM_UNIX)
+	void *p = mmap(NULL, fSize, PROT_READ, MAP_SHARED, fHandle, 0);
+	if (p == MAP_FAILED)
+		throw ErrStream(SFMMapErrorEx, AFileName, LastSysErrMsg().c_str());
+	fMemory = (C_UInt8*)p;
+#elif defined(COREARRAY_PLATFORM_WINDOWS)
+	fMapping = CreateFileMapping(fHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (fMapping == NULL)
+		throw ErrStream(SFMMapErrorEx, AFileName, LastSysErrMsg().c_str());
+	fMemory = (C_UInt8*)MapViewOfFile(fMapping, FILE_MAP_READ, 0, 0, 0);
+	if (fMemory == NULL)
+	{
+		string msg = LastSysErrMsg();
+		CloseHandle(fMapping);
+		fMapping = NULL;
+		throw ErrStream(SFMMapErrorEx, AFileName, msg.c_str());
+	}
+#else
+	throw ErrStream(SFMMapErrorEx, AFileName, "Not supported.");
+#endif
+}
+
+CdMMapStream::~CdMMapStream()
+{
+#if defined(COREARRAY_PLATFORM_UNIX)
+	if (fMemory) munmap(fMemory, fSize);
+#elif defined(COREARRAY_PLATFORM_WINDOWS)
+	if (fMemory) UnmapViewOfFile(fMemory);
+	if (fMapping) CloseHandle(fMapping);
+#endif
+	fMemory = NULL;
+}
+
+ssize_t CdMMapStream::Read(void *Buffer, ssize_t Count)
+{
+	if (Count > fSize - fPosition)
+		Count = fSize - fPosition;
+	if (Count > 0)
+	{
+		memcpy(Buffer, fMemory + fPosition, Count);
+		fPosition += Count;
+		return Count;
+	} else
+		return 0;
+}
+
+ssize_t CdMMapStream::ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count)
+{
+	if ((Pos < 0) || (Pos >= fSize)) return 0;
+	if (Count > fSize - Pos)
+		Count = fSize - Pos;
+	if (Count > 0)
+	{
+		memcpy(Buffer, fMemory + Pos, Count);
+		return Count;
+	} else
+		return 0;
+}
+
+ssize_t CdMMapStream::Write(const void *Buffer, ssize_t Count)
+{
+	throw ErrStream("The memory-mapped file is read-only.");
+}
+
+SIZE64 CdMMapStream::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	switch (Origin)
+	{
+		case soBeginning:
+			fPosition = Offset; break;
+		case soCurrent:
+			fPosition += Offset; break;
+		case soEnd:
+			fPosition = fSize + Offset; break;
+		default:
+			return -1;
+	}
+	return fPosition;
+}
+
+SIZE64 CdMMapStream::GetSize()
+{
+	return fSize;
+}
+
+void CdMMapStream::SetSize(SIZE64 NewSize)
+{
+	throw ErrStream("The memory-mapped file is read-only.");
+}
+
+const void *CdMMapStream::MemPtr(SIZE64 Pos, SIZE64 &Count)
+{
+	if ((Pos >= 0) && (Pos < fSize))
+	{
+		Count = fSize - Pos;
+		return fMemory + Pos;
+	} else {
+		Count = 0;
+		return NULL;
+	}
+}
+
+
 // CdTempStream
 
 CdTempStream::CdTempStream(): CdFileStream(
@@ -380,6 +515,113 @@ CdRecodeStream::~CdRecodeStream()
 
 
 
+// =====================================================================
+// Cache of decompressed blocks
+// =====================================================================
+
+const C_Int64 CdRABlockCache::DEFAULT_MAX_SIZE;
+
+CdRABlockCache::CdRABlockCache()
+{
+	fMaxSize = DEFAULT_MAX_SIZE;
+	fSize = 0;
+	fHitCount = fMissCount = 0;
+	fReadAhead = 0;
+}
+
+const C_UInt8 *CdRABlockCache::Find(C_UInt32 StreamID, C_Int32 BlockIdx)
+{
+	map<TKey, TList::iterator>::iterator it =
+		fMap.find(TKey(StreamID, BlockIdx));
+	if (it != fMap.end())
+	{
+		// move to the front
+		fList.splice(fList.begin(), fList, it->second);
+		fHitCount ++;
+		return &(it->second->Data[0]);
+	} else {
+		fMissCount ++;
+		return NULL;
+	}
+}
+
+C_UInt8 *CdRABlockCache::Add(C_UInt32 StreamID, C_Int32 BlockIdx,
+	ssize_t Size)
+{
+	Remove(StreamID, BlockIdx);
+	Shrink(fMaxSize - Size);
+
+	fList.push_front(TItem());
+	TItem &I = fList.front();
+	I.Key = TKey(StreamID, BlockIdx);
+	I.Data.resize((Size > 0) ? Size : 1);
+	fMap[I.Key] = fList.begin();
+	fSize += Size;
+	return &I.Data[0];
+}
+
+void CdRABlockCache::Remove(C_UInt32 StreamID, C_Int32 BlockIdx)
+{
+	map<TKey, TList::iterator>::iterator it =
+		fMap.find(TKey(StreamID, BlockIdx));
+	if (it != fMap.end())
+	{
+		fSize -= it->second->Data.size();
+		fList.erase(it->second);
+		fMap.erase(it);
+	}
+}
+
+void CdRABlockCache::Remove(C_UInt32 StreamID)
+{
+	if (fMap.empty()) return;
+	map<TKey, TList::iterator>::iterator it =
+		fMap.lower_bound(TKey(StreamID, numeric_limits<C_Int32>::min()));
+	while ((it != fMap.end()) && (it->first.first == StreamID))
+	{
+		fSize -= it->second->Data.size();
+		fList.erase(it->second);
+		fMap.erase(it++);
+	}
+}
+
+void CdRABlockCache::Clear()
+{
+	fList.clear();
+	fMap.clear();
+	fSize = 0;
+}
+
+void CdRABlockCache::ResetCounter()
+{
+	fHitCount = fMissCount = 0;
+}
+
+void CdRABlockCache::SetMaxSize(C_Int64 NewSize)
+{
+	if (NewSize < 0) NewSize = 0;
+	fMaxSize = NewSize;
+	Shrink(NewSize);
+}
+
+void CdRABlockCache::SetReadAhead(int NumBlock)
+{
+	fReadAhead = (NumBlock > 1) ? NumBlock : 0;
+}
+
+void CdRABlockCache::Shrink(C_Int64 MaxSize)
+{
+	while ((fSize > MaxSize) && !fList.empty())
+	{
+		TItem &I = fList.back();
+		fSize -= I.Data.size();
+		fMap.erase(I.Key);
+		fList.pop_back();
+	}
+}
+
+
+
 // =====================================================================
 // Algorithm of random access
 // =====================================================================
@@ -410,6 +652,15 @@ CdRA_Read::CdRA_Read(CdRecodeStream *owner):
 	fCB_ZStart = fCB_ZSize = 0;
 	fCB_UZStart = fCB_UZSize = 0;
 	fBlockListStart = 0;
+	fCache = NULL;
+	fCacheID = 0;
+	fNeedReset = false;
+	fLastBlockIdx = -1;
+}
+
+CdRA_Read::~CdRA_Read()
+{
+	DoneReadAhead();
 }
 
 void CdRA_Read::InitReadStream()
@@ -417,6 +668,21 @@ void CdRA_Read::InitReadStream()
 	// get the base position
 	fOwner.fStreamBase = fOwner.fStream->Position();
 
+	// the cache of decompressed blocks in the GDS file
+	CdBlockStream *bs = dynamic_cast<CdBlockStream*>(fOwner.fStream);
+	if (bs)
+	{
+		fCache = &bs->Collection().RACache();
+		fCacheID = bs->ID().Get();
+	} else {
+		CdBlockReadStream *rs = dynamic_cast<CdBlockReadStream*>(fOwner.fStream);
+		if (rs)
+		{
+			fCache = &rs->RACache();
+			fCacheID = rs->Stream().ID().Get();
+		}
+	}
+
 	// read and check the magic number
 	ReadMagicNumber(*fOwner.fStream);
 	// get the algorithm version, but unused here
@@ -443,6 +709,11 @@ void CdRA_Read::InitReadStream()
 	fBlockIdx = 0;
 	fCB_ZStart = fBlockListStart;
 	fCB_UZStart = 0;
+	fIndexing.clear();
+	TBlockIndex I;
+	I.ZStart = fCB_ZStart;
+	I.UZStart = fCB_UZStart;
+	fIndexing.push_back(I);
 	GetBlockHeader();
 }
 
@@ -455,58 +726,56 @@ bool CdRA_Read::SeekStream(SIZE64 Position)
 			Position);
 	}
 
-	if (Position < fCB_UZStart)
+	// within the current block
+	if ((fCB_UZStart <= Position) && (Position < (fCB_UZStart + fCB_UZSize)))
+		return false;
+
+	// binary search on the blocks which have been visited
+	const size_t n = fIndexing.size();
+	if (Position < fIndexing[n-1].UZStart)
 	{
-		// the first compressed block
-		fBlockIdx = 0;
-		fCB_ZStart = fBlockListStart;
-		fCB_UZStart = 0;
-		// find the block
-		for (;;)
+		// fIndexing[lo].UZStart <= Position < fIndexing[hi].UZStart
+		size_t lo = 0, hi = n - 1;
+		while ((hi - lo) > 1)
 		{
-			GetBlockHeader();
-			if ((fCB_UZStart + fCB_UZSize) <= Position)
-			{
-				// go to the next block
-				fCB_ZStart += fCB_ZSize;
-				fCB_UZStart += fCB_UZSize;
-				if ((++fBlockIdx) >= fBlockNum)
-				{
-					if (Position > fCB_UZStart)
-					{
-						throw ErrStream(
-							"'Seek' out of the range with position (%lld).",
-							Position);
-					}
-				}
-			} else
-				break;
+			size_t mid = (lo + hi) >> 1;
+			if (fIndexing[mid].UZStart <= Position)
+				lo = mid;
+			else
+				hi = mid;
 		}
-		// output
+		SetBlockByIndex(lo);
 		return true;
+	}
 
-	} else if (Position >= (fCB_UZStart + fCB_UZSize))
+	// start from the last visited block, and walk through the block headers
+	fBlockIdx = n - 1;
+	fCB_ZStart = fIndexing[n-1].ZStart;
+	fCB_UZStart = fIndexing[n-1].UZStart;
+	for (;;)
 	{
-		do {
-			// go to the next block
-			fCB_ZStart += fCB_ZSize;
-			fCB_UZStart += fCB_UZSize;
-			if ((++fBlockIdx) >= fBlockNum)
+		if (fBlockIdx >= fBlockNum)
+		{
+			if (Position > fCB_UZStart)
 			{
-				if (Position > fCB_UZStart)
-				{
-					throw ErrStream(
-						"'Seek' out of the range with position (%lld).",
-						Position);
-				}
+				throw ErrStream(
+					"'Seek' out of the range with position (%lld).",
+					Position);
 			}
-			GetBlockHeader();
-		} while ((fCB_UZStart + fCB_UZSize) <= Position);
-		// output
-		return true;
+			fCB_ZSize = fCB_UZSize = 1; // avoid ZERO
+			break;
+		}
+		GetBlockHeader();
+		if (Position < (fCB_UZStart + fCB_UZSize))
+			break;
+		// go to the next block
+		fCB_ZStart += fCB_ZSize;
+		fCB_UZStart += fCB_UZSize;
+		fBlockIdx ++;
 	}
 
-	return false;
+	// output
+	return true;
 }
 
 bool CdRA_Read::NextBlock()
@@ -516,7 +785,10 @@ bool CdRA_Read::NextBlock()
 	fBlockIdx ++;
 	if (fBlockIdx < fBlockNum)
 	{
-		GetBlockHeader();
+		if ((size_t)fBlockIdx < (fIndexing.size() - 1))
+			SetBlockByIndex(fBlockIdx);
+		else
+			GetBlockHeader();
 		return true;
 	} else {
 		fCB_ZSize = fCB_UZSize = 1; // avoid ZERO
@@ -524,6 +796,233 @@ bool CdRA_Read::NextBlock()
 	}
 }
 
+void CdRA_Read::LoadBlock(C_UInt8 *Buffer)
+{
+	vector<C_UInt8> ZData;
+	ReadBlockZData(ZData);
+	DecodeBlock(ZData.empty() ? NULL : &ZData[0], ZData.size(),
+		Buffer, fCB_UZSize);
+}
+
+ssize_t CdRA_Read::CacheRead(void *Buffer, ssize_t Count, SIZE64 &CurPos)
+{
+	C_UInt8 *pBuf = (C_UInt8*)Buffer;
+	ssize_t OldCount = Count;
+
+	while (Count > 0)
+	{
+		if (CurPos >= (fCB_UZStart + fCB_UZSize))
+		{
+			if (!NextBlock()) break;
+		}
+		if (fBlockIdx >= fBlockNum) break;
+
+		const C_UInt8 *p = BlockData();
+		ssize_t I = CurPos - fCB_UZStart;
+		ssize_t L = fCB_UZSize - I;
+		if (L > Count) L = Count;
+		memcpy(pBuf, p + I, L);
+		pBuf += L; CurPos += L;
+		Count -= L;
+	}
+
+	// the decompression state is not in accordance with the position
+	fNeedReset = true;
+	return OldCount - Count;
+}
+
+void CdRA_Read::ReadBlockZData(vector<C_UInt8> &ZData)
+{
+	ssize_t n = fCB_ZSize - SIZE_RA_BLOCK_HEADER;
+	if (n < 0) n = 0;
+	ZData.resize(n);
+	fOwner.fStreamPos = fCB_ZStart + SIZE_RA_BLOCK_HEADER;
+	fOwner.fStream->SetPosition(fOwner.fStreamPos);
+	if (n > 0)
+		fOwner.fStream->ReadData(&ZData[0], n);
+	fOwner.fStreamPos += n;
+
+	SIZE64 tmp = fOwner.fStreamPos - fOwner.fStreamBase;
+	if (tmp > fOwner.fTotalIn) fOwner.fTotalIn = tmp;
+}
+
+/// a decompressed block out of the cache
+struct CdRA_Read::TBlockBuffer
+{
+	const CdRA_Read *Owner;  //< the reading object
+	C_Int32 Index;           //< the block index, -1 for unused
+	SIZE64 UZSize;           //< the size of uncompressed block
+	vector<C_UInt8> ZData;   //< the compressed data without header
+	vector<C_UInt8> Data;    //< the decompressed data
+	bool Pending;            //< whether Job has not been waited for
+	Parallel::CdThreadPool::TJob Job;  //< the decompression in the pool
+
+	TBlockBuffer(const CdRA_Read *owner)
+	{
+		Owner = owner; Index = -1; UZSize = 0; Pending = false;
+		Job.Proc = CdRA_Read::AheadDecode;
+		Job.Param = this;
+		Job.Failed = false;
+		Job.Pool = NULL;
+	}
+
+	void Decode()
+	{
+		Owner->DecodeBlock(ZData.empty() ? NULL : &ZData[0], ZData.size(),
+			&Data[0], UZSize);
+	}
+};
+
+const C_UInt8 *CdRA_Read::BlockData()
+{
+	const int NumAhead = fCache ? fCache->ReadAhead() : 0;
+	const bool Sequential = (fBlockIdx == fLastBlockIdx + 1);
+
+	// decompressed ahead, or the current block
+	TBlockBuffer *B = FindAhead(fBlockIdx);
+	if (B)
+	{
+		WaitAhead(B);
+	} else {
+		// in the cache
+		if (fCache && fCache->Enabled())
+		{
+			const C_UInt8 *p = fCache->Find(fCacheID, fBlockIdx);
+			if (p)
+			{
+				fLastBlockIdx = fBlockIdx;
+				return p;
+			}
+		}
+
+		// random access
+		if (fCache && fCache->Enabled() && !(Sequential && (NumAhead > 1)))
+		{
+			C_UInt8 *buf = fCache->Add(fCacheID, fBlockIdx, fCB_UZSize);
+			try {
+				LoadBlock(buf);
+			} catch (...) {
+				fCache->Remove(fCacheID, fBlockIdx);
+				throw;
+			}
+			fLastBlockIdx = fBlockIdx;
+			return buf;
+		}
+
+		// decompress the current block in the calling thread
+		B = FreeAhead(fBlockIdx, fBlockIdx + (NumAhead > 1 ? NumAhead : 1), 0);
+		B->Index = -1;
+		B->UZSize = fCB_UZSize;
+		ReadBlockZData(B->ZData);
+		B->Data.resize(fCB_UZSize > 0 ? fCB_UZSize : 1);
+		B->Decode();
+		B->Index = fBlockIdx;
+	}
+
+	// sequential reading, keep the following blocks being decompressed
+	if (Sequential && (NumAhead > 1))
+		SubmitAhead(NumAhead);
+
+	fLastBlockIdx = fBlockIdx;
+	return &B->Data[0];
+}
+
+void CdRA_Read::AheadDecode(CdThread *Thread, int Index, void *Param)
+{
+	((TBlockBuffer*)Param)->Decode();
+}
+
+CdRA_Read::TBlockBuffer *CdRA_Read::FindAhead(C_Int32 Index)
+{
+	vector<TBlockBuffer*>::iterator it;
+	for (it=fAheadBuf.begin(); it != fAheadBuf.end(); it++)
+	{
+		if ((*it)->Index == Index) return *it;
+	}
+	return NULL;
+}
+
+CdRA_Read::TBlockBuffer *CdRA_Read::FreeAhead(C_Int32 Lo, C_Int32 Hi,
+	size_t MaxCount)
+{
+	// prefer a buffer which is not being decompressed
+	TBlockBuffer *rv = NULL;
+	vector<TBlockBuffer*>::iterator it;
+	for (it=fAheadBuf.begin(); it != fAheadBuf.end(); it++)
+	{
+		TBlockBuffer *B = *it;
+		if ((B->Index < Lo) || (B->Index >= Hi))
+		{
+			if (!B->Pending) return B;
+			if (!rv) rv = B;
+		}
+	}
+	if (!rv && ((MaxCount <= 0) || (fAheadBuf.size() < MaxCount)))
+	{
+		rv = new TBlockBuffer(this);
+		fAheadBuf.push_back(rv);
+	}
+	if (rv && rv->Pending)
+	{
+		Parallel::CdThreadPool::Global().Wait(&rv->Job);
+		rv->Pending = false;
+	}
+	return rv;
+}
+
+void CdRA_Read::WaitAhead(TBlockBuffer *B)
+{
+	if (B->Pending)
+	{
+		Parallel::CdThreadPool::Global().Wait(&B->Job);
+		B->Pending = false;
+		// decompress it again in the calling thread to raise the error
+		if (B->Job.Failed)
+		{
+			B->Index = -1;
+			B->Decode();
+			B->Index = fBlockIdx;
+		}
+	}
+}
+
+void CdRA_Read::SubmitAhead(int NumBlock)
+{
+	// read the compressed data, the stream is accessed by the calling thread
+	// only, and the decompression is done by the thread pool
+	const C_Int32 Start = fBlockIdx;
+	for (int i=1; i < NumBlock; i++)
+	{
+		if (!NextBlock()) break;
+		if (FindAhead(fBlockIdx)) continue;
+
+		TBlockBuffer *B = FreeAhead(Start, Start + NumBlock, NumBlock);
+		if (!B) break;
+		B->Index = -1;
+		B->UZSize = fCB_UZSize;
+		ReadBlockZData(B->ZData);
+		B->Data.resize(fCB_UZSize > 0 ? fCB_UZSize : 1);
+		B->Index = fBlockIdx;
+		Parallel::CdThreadPool::Global().Submit(&B->Job);
+		B->Pending = true;
+	}
+	// go back to the current block
+	if (fBlockIdx != Start)
+		SetBlockByIndex(Start);
+}
+
+void CdRA_Read::DoneReadAhead()
+{
+	vector<TBlockBuffer*>::iterator it;
+	for (it=fAheadBuf.begin(); it != fAheadBuf.end(); it++)
+	{
+		if ((*it)->Pending)
+			Parallel::CdThreadPool::Global().Wait(&(*it)->Job);
+		delete *it;
+	}
+	fAheadBuf.clear();
+}
+
 void CdRA_Read::GetBlockHeader()
 {
 	C_UInt8 BSZ[SIZE_RA_BLOCK_HEADER];
@@ -535,6 +1034,30 @@ void CdRA_Read::GetBlockHeader()
 		(C_UInt32(BSZ[2]) << 16);
 	fCB_UZSize = BSZ[3] | (C_UInt32(BSZ[4]) << 8) |
 		(C_UInt32(BSZ[5]) << 16) | (C_UInt32(BSZ[6]) << 24);
+
+	// append the starting position of next block to the indexing
+	if ((fBlockIdx < fBlockNum) &&
+		((size_t)fBlockIdx == (fIndexing.size() - 1)))
+	{
+		if (fCB_ZSize < SIZE_RA_BLOCK_HEADER)
+			throw ErrStream("Invalid block header for random access.");
+		TBlockIndex I;
+		I.ZStart = fCB_ZStart + fCB_ZSize;
+		I.UZStart = fCB_UZStart + fCB_UZSize;
+		fIndexing.push_back(I);
+	}
+}
+
+void CdRA_Read::SetBlockByIndex(size_t Index)
+{
+	const TBlockIndex &I = fIndexing[Index];
+	const TBlockIndex &J = fIndexing[Index + 1];
+	fBlockIdx = Index;
+	fCB_ZStart = I.ZStart;
+	fCB_ZSize = J.ZStart - I.ZStart;
+	fCB_UZStart = I.UZStart;
+	fCB_UZSize = J.UZStart - I.UZStart;
+	fOwner.fStreamPos = fCB_ZStart + SIZE_RA_BLOCK_HEADER;
 }
 
 
@@ -549,6 +1072,10 @@ CdRA_Write::CdRA_Write(CdRecodeStream *owner, TBlockSize bs):
 	fCB_ZStart = fCB_UZStart = 0;
 	fBlockListStart = 0;
 	fHasInitWriteBlock = false;
+	fRABlockSize = RA_BLOCK_SIZE_LIST[bs];
+	fNumThread = 1;
+	fParBlockCnt = 0;
+	fParTotalIn = fParTotalOut = 0;
 }
 
 void CdRA_Write::InitWriteStream()
@@ -627,21 +1154,164 @@ void CdRA_Write::DoneWriteBlock()
 }
 
 
+void CdRA_Write::SetNumThread(int NumThread)
+{
+	if (NumThread < 1) NumThread = 1;
+	if ((NumThread <= 1) && (fNumThread > 1))
+		ParallelFlush();
+	fNumThread = NumThread;
+}
 
-// =====================================================================
-// The classes of ZLIB stream
-// =====================================================================
+ssize_t CdRA_Write::ParallelRawSize() const
+{
+	// the maximum size of uncompressed block, keeping the size of
+	//   compressed block (including incompressible data) < 2^24
+	static const ssize_t MAX_RAW_SIZE = 8*1024*1024;
 
-static const char *ErrZInvalidLevel =
-	"Invalid compression level in '%s'!";
-static const char *ErrZDeflateInvalid =
-	"Invalid Zip Deflate Stream operation '%s'!";
-static const char *ErrZInflateInvalid =
-	"Invalid Zip Inflate Stream operation '%s'!";
-static const char *ErrZDeflateClosed =
-	"ZIP deflate stream has been closed.";
+	// estimate the compression ratio from the blocks written
+	double sz = fRABlockSize;
+	if ((fParTotalIn > 0) && (fParTotalOut > 0))
+		sz *= (double)fParTotalIn / fParTotalOut;
+	if (sz > 16.0*fRABlockSize) sz = 16.0*fRABlockSize;
+	if (sz > MAX_RAW_SIZE) sz = MAX_RAW_SIZE;
 
-static short ZLevels[4] =
+	const ssize_t align = RawBlockAlign();
+	ssize_t rv = ((ssize_t)sz / align) * align;
+	if (rv < align) rv = align;
+	return rv;
+}
+
+ssize_t CdRA_Write::ParallelWrite(const void *Buffer, ssize_t Count)
+{
+	const C_UInt8 *p = (const C_UInt8*)Buffer;
+	ssize_t OldCount = Count;
+
+	while (Count > 0)
+	{
+		if ((fParBlockCnt <= 0) ||
+			(fParBlock[fParBlockCnt-1].RawSize >=
+			(ssize_t)fParBlock[fParBlockCnt-1].Raw.size()))
+		{
+			// need a new block
+			if (fParBlockCnt >= (size_t)fNumThread)
+				ParallelFlush();
+			if (fParBlock.size() <= fParBlockCnt)
+				fParBlock.resize(fParBlockCnt + 1);
+			TParallelBlock &B = fParBlock[fParBlockCnt++];
+			B.Raw.resize(ParallelRawSize());
+			B.RawSize = 0;
+		}
+
+		TParallelBlock &B = fParBlock[fParBlockCnt-1];
+		ssize_t L = (ssize_t)B.Raw.size() - B.RawSize;
+		if (L > Count) L = Count;
+		memcpy(&B.Raw[B.RawSize], p, L);
+		B.RawSize += L;
+		p += L; Count -= L;
+		// the position of uncompressed data includes the pending blocks
+		fOwner.fTotalIn += L;
+	}
+
+	return OldCount;
+}
+
+/// the parameters of CdRA_Write::ParallelCompress
+struct CdRA_Write::TParallelCompress
+{
+	CdRA_Write *Obj;      //< the writing object
+	size_t Index, Count;  //< the next block, and the total number of blocks
+	CdThreadMutex *Mutex; //< the mutex object for Index and ErrMsg
+	string ErrMsg;        //< the error message from worker threads
+};
+
+void CdRA_Write::ParallelCompress(CdThread *Thread, int Index, void *Param)
+{
+	TParallelCompress &P = *((TParallelCompress*)Param);
+	for (;;)
+	{
+		size_t i;
+		{
+			TdAutoMutex AutoMutex(P.Mutex);
+			if ((P.Index >= P.Count) || !P.ErrMsg.empty()) break;
+			i = P.Index ++;
+		}
+		TParallelBlock &B = P.Obj->fParBlock[i];
+		try {
+			P.Obj->CompressBlock(&B.Raw[0], B.RawSize, B.Out);
+		} catch (std::exception &E) {
+			TdAutoMutex AutoMutex(P.Mutex);
+			P.ErrMsg = E.what();
+		} catch (...) {
+			TdAutoMutex AutoMutex(P.Mutex);
+			P.ErrMsg = "Unknown error in compressing blocks in parallel.";
+		}
+	}
+}
+
+void CdRA_Write::ParallelFlush()
+{
+	if (fParBlockCnt <= 0) return;
+	if (fParBlock[fParBlockCnt-1].RawSize <= 0)
+		fParBlockCnt --;
+
+	// compress the blocks
+	if (fParBlockCnt > 1)
+	{
+		int nThread = fNumThread;
+		if (nThread > (int)fParBlockCnt) nThread = fParBlockCnt;
+		Parallel::CParallelBase Par(nThread);
+		TParallelCompress P;
+		P.Obj = this;
+		P.Index = 0; P.Count = fParBlockCnt;
+		P.Mutex = &Par.Mutex();
+		Par.RunThreads(ParallelCompress, &P);
+		if (!P.ErrMsg.empty())
+		{
+			fParBlockCnt = 0;
+			throw ErrStream(P.ErrMsg);
+		}
+	} else if (fParBlockCnt > 0)
+	{
+		TParallelBlock &B = fParBlock[0];
+		CompressBlock(&B.Raw[0], B.RawSize, B.Out);
+	}
+
+	// write the compressed blocks in order
+	for (size_t i=0; i < fParBlockCnt; i++)
+		fOwner.fTotalIn -= fParBlock[i].RawSize;
+	fOwner.fStream->SetPosition(fOwner.fStreamPos);
+	for (size_t i=0; i < fParBlockCnt; i++)
+	{
+		TParallelBlock &B = fParBlock[i];
+		InitWriteBlock();
+		fOwner.fStream->WriteData(&B.Out[0], B.Out.size());
+		fOwner.fStreamPos += B.Out.size();
+		fOwner.fTotalIn += B.RawSize;
+		DoneWriteBlock();
+		fParTotalIn += B.RawSize;
+		fParTotalOut += B.Out.size();
+		B.Out.clear();
+	}
+	fOwner.fTotalOut = fOwner.fStreamPos - fOwner.fStreamBase;
+	fParBlockCnt = 0;
+}
+
+
+
+// =====================================================================
+// The classes of ZLIB stream
+// =====================================================================
+
+static const char *ErrZInvalidLevel =
+	"Invalid compression level in '%s'!";
+static const char *ErrZDeflateInvalid =
+	"Invalid Zip Deflate Stream operation '%s'!";
+static const char *ErrZInflateInvalid =
+	"Invalid Zip Inflate Stream operation '%s'!";
+static const char *ErrZDeflateClosed =
+	"ZIP deflate stream has been closed.";
+
+static short ZLevels[4] =
 {
 	Z_NO_COMPRESSION,       // zcNone
 	Z_BEST_SPEED,           // zcFastest
@@ -947,15 +1617,21 @@ static const C_UInt8 ZRA_MAGIC_HEADER[ZRA_MAGIC_HEADER_SIZE] =
 #endif
 
 
+static int ZRA_WindowBits(CdRAAlgorithm::TBlockSize BK)
+{
+	return BK==CdRAAlgorithm::ra16KB  ? ZRA_WINDOW_BITS_16K :
+		(BK==CdRAAlgorithm::ra32KB  ? ZRA_WINDOW_BITS_32K :
+		(BK==CdRAAlgorithm::ra64KB  ? ZRA_WINDOW_BITS_64K :
+		(BK==CdRAAlgorithm::ra128KB ? ZRA_WINDOW_BITS_128K : ZRA_WINDOW_BITS)));
+}
+
 CdZRA_Deflate::CdZRA_Deflate(CdStream &Dest, TLevel Level,
 	TBlockSize BK): CdRA_Write(this, BK),
-	CdZDeflate( Dest, Level,
-		 BK==ra16KB  ? ZRA_WINDOW_BITS_16K :
-		(BK==ra32KB  ? ZRA_WINDOW_BITS_32K :
-		(BK==ra64KB  ? ZRA_WINDOW_BITS_64K :
-		(BK==ra128KB ? ZRA_WINDOW_BITS_128K : ZRA_WINDOW_BITS))) )
+	CdZDeflate(Dest, Level, ZRA_WindowBits(BK))
 {
 	fBlockZIPSize = fCurBlockZIPSize = RA_BLOCK_SIZE_LIST[BK];
+	fLevel = Level;
+	fWindowBits = ZRA_WindowBits(BK);
 	InitWriteStream();
 }
 
@@ -965,6 +1641,8 @@ ssize_t CdZRA_Deflate::Write(const void *Buffer, ssize_t Count)
 		throw EZLibError(ErrZDeflateClosed);
 
 	if (Count <= 0) return 0;
+	if (fNumThread > 1)
+		return ParallelWrite(Buffer, Count);
 	if (fStream->Position() != fStreamPos)
 		fStream->SetPosition(fStreamPos);
 
@@ -1022,6 +1700,7 @@ void CdZRA_Deflate::Close()
 			WriteData((void*)PtrExtRec->Buf, PtrExtRec->Size);
 			PtrExtRec = NULL;
 		}
+		ParallelFlush();
 		SyncFinishBlock();
 		DoneWriteStream();
 		fHaveClosed = true;
@@ -1033,6 +1712,28 @@ void CdZRA_Deflate::WriteMagicNumber(CdStream &Stream)
 	Stream.WriteData(ZRA_MAGIC_HEADER, ZRA_MAGIC_HEADER_SIZE);
 }
 
+void CdZRA_Deflate::CompressBlock(const C_UInt8 *Raw, ssize_t Size,
+	vector<C_UInt8> &Out)
+{
+	z_stream z;
+	memset((void*)&z, 0, sizeof(z));
+	ZCheck( deflateInit2_(&z, ZLevels[fLevel], 8 /* Z_DEFLATED */,
+		fWindowBits, Z_DEFAULT_MEMORY, Z_DEFAULT_STRATEGY, ZLIB_VERSION,
+		sizeof(z)) );
+
+	Out.resize(deflateBound(&z, Size));
+	z.next_in = (Bytef*)Raw;
+	z.avail_in = Size;
+	z.next_out = &Out[0];
+	z.avail_out = Out.size();
+	int rv = deflate(&z, Z_FINISH);
+	Out.resize(z.total_out);
+	deflateEnd(&z);
+
+	if (rv != Z_STREAM_END)
+		throw EZLibError((rv < 0) ? rv : Z_BUF_ERROR);
+}
+
 void CdZRA_Deflate::SyncFinishBlock()
 {
 	if (fHasInitWriteBlock)
@@ -1060,9 +1761,21 @@ CdZRA_Inflate::CdZRA_Inflate(CdStream &Source):
 	InitReadStream();
 }
 
+CdZRA_Inflate::~CdZRA_Inflate()
+{
+	DoneReadAhead();
+}
+
 ssize_t CdZRA_Inflate::Read(void *Buffer, ssize_t Count)
 {
 	if (Count <= 0) return 0;
+	if (UseCache())
+	{
+		ssize_t rv = CacheRead(Buffer, Count, fCurPosition);
+		if (fCurPosition > fTotalOut) fTotalOut = fCurPosition;
+		return rv;
+	}
+	if (fNeedReset) Seek(fCurPosition, soBeginning);
 	if (fBlockIdx >= fBlockNum) return 0;
 
 	C_UInt8 *pBuf = (C_UInt8*)Buffer;
@@ -1135,13 +1848,19 @@ SIZE64 CdZRA_Inflate::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
 		throw EZLibError(ErrZInflateInvalid, "Seek");
 
 	bool flag = SeekStream(Offset);
-	if (flag || (Offset < fCurPosition))
+	if (UseCache())
+	{
+		fNeedReset = true;
+		return (fCurPosition = Offset);
+	}
+	if (flag || fNeedReset || (Offset < fCurPosition))
 	{
 		fZStream.next_in = fBuffer;
 		fZStream.avail_in = 0;
 		ZCheck(inflateReset(&fZStream));
 		fStreamPos = fCB_ZStart + SIZE_RA_BLOCK_HEADER;
 		fCurPosition = fCB_UZStart;
+		fNeedReset = false;
 	}
 
 	Offset -= fCurPosition;
@@ -1167,6 +1886,24 @@ void CdZRA_Inflate::ReadMagicNumber(CdStream &Stream)
 		throw EZLibError(ErrZInflateHeader);
 }
 
+void CdZRA_Inflate::DecodeBlock(const C_UInt8 *ZBuf, ssize_t ZSize,
+	C_UInt8 *Buffer, ssize_t UZSize) const
+{
+	z_stream z;
+	memset((void*)&z, 0, sizeof(z));
+	ZCheck(inflateInit2_(&z, ZRA_WINDOW_BITS, ZLIB_VERSION, sizeof(z)));
+	z.next_in = (Bytef*)ZBuf;
+	z.avail_in = ZSize;
+	z.next_out = Buffer;
+	z.avail_out = UZSize;
+	int ZResult = inflate(&z, Z_FINISH);
+	ssize_t n = z.total_out;
+	inflateEnd(&z);
+
+	if ((ZResult != Z_STREAM_END) || (n != UZSize))
+		throw EZLibError("Invalid ZIP block for random access");
+}
+
 
 // EZLibError
 
@@ -1512,6 +2249,8 @@ ssize_t CdLZ4RA_Deflate::Write(const void *Buffer, ssize_t Count)
 	if (fHaveClosed)
 		throw ELZ4Error(ErrLZ4DeflateClosed);
 	if (Count <= 0) return 0;
+	if (fNumThread > 1)
+		return ParallelWrite(Buffer, Count);
 
 	ssize_t OldCount = Count;
 	C_UInt8 *pBuf = (C_UInt8*)Buffer;
@@ -1586,6 +2325,7 @@ void CdLZ4RA_Deflate::Close()
 			WriteData((void*)PtrExtRec->Buf, PtrExtRec->Size);
 			PtrExtRec = NULL;
 		}
+		ParallelFlush();
 		fCurBlockLZ4Size = 0;
 		Compressing(LZ4RA_RAW_BUFFER_SIZE - fUnusedRawSize);
 		DoneWriteStream();
@@ -1599,6 +2339,74 @@ void CdLZ4RA_Deflate::WriteMagicNumber(CdStream &Stream)
 	Stream.W8b(fLevel);
 }
 
+void CdLZ4RA_Deflate::CompressBlock(const C_UInt8 *Raw, ssize_t Size,
+	vector<C_UInt8> &Out)
+{
+	// the same chunks and double buffer as 'Compressing'
+	vector<char> Buffer(2*LZ4RA_RAW_BUFFER_SIZE + LZ4RA_LZ4_BUFFER_SIZE);
+	char *RawBuf[2] = { &Buffer[0], &Buffer[LZ4RA_RAW_BUFFER_SIZE] };
+	char *LZ4Buffer = &Buffer[2*LZ4RA_RAW_BUFFER_SIZE];
+	int IdxRaw = 0;
+
+	LZ4_stream_t *lz4 = NULL;
+	LZ4_streamHC_t *lz4hc = NULL;
+	switch (fLevel)
+	{
+	case clFast:
+		lz4 = (LZ4_stream_t*)calloc(1, sizeof(LZ4_stream_t));
+		if (!lz4) throw bad_alloc();
+		break;
+	case clDefault: case clMax:
+		lz4hc = LZ4_createStreamHC();
+		if (!lz4hc) throw bad_alloc();
+		LZ4_resetStreamHC(lz4hc, LZ4DeflateLevel[fLevel]);
+		break;
+	default:
+		break;
+	}
+
+	Out.clear();
+	Out.reserve(Size + Size/128 + 64);
+	try {
+		while (Size > 0)
+		{
+			int n = (Size > LZ4RA_RAW_BUFFER_SIZE) ? LZ4RA_RAW_BUFFER_SIZE : Size;
+			const char *p;
+			int cmpBytes;
+			if (fLevel != clNone)
+			{
+				memcpy(RawBuf[IdxRaw], Raw, n);
+				if (lz4)
+				{
+					cmpBytes = LZ4_compress_continue(lz4, RawBuf[IdxRaw],
+						LZ4Buffer, n);
+				} else {
+					cmpBytes = LZ4_compressHC_continue(lz4hc, RawBuf[IdxRaw],
+						LZ4Buffer, n);
+				}
+				if (cmpBytes <= 0)
+					throw ELZ4Error(ErrLZ4Compressing);
+				p = LZ4Buffer;
+				IdxRaw = 1 - IdxRaw;
+			} else {
+				cmpBytes = n;
+				p = (const char*)Raw;
+			}
+			Out.push_back(cmpBytes & 0xFF);
+			Out.push_back((cmpBytes >> 8) & 0xFF);
+			Out.insert(Out.end(), p, p + cmpBytes);
+			Raw += n; Size -= n;
+		}
+	} catch (...) {
+		if (lz4) free(lz4);
+		if (lz4hc) LZ4_freeStreamHC(lz4hc);
+		throw;
+	}
+
+	if (lz4) free(lz4);
+	if (lz4hc) LZ4_freeStreamHC(lz4hc);
+}
+
 void CdLZ4RA_Deflate::Compressing(int bufsize)
 {
 	if (bufsize <= 0) return;
@@ -1672,9 +2480,21 @@ CdLZ4RA_Inflate::CdLZ4RA_Inflate(CdStream &Source):
 	iRaw = CntRaw = 0;
 }
 
+CdLZ4RA_Inflate::~CdLZ4RA_Inflate()
+{
+	DoneReadAhead();
+}
+
 ssize_t CdLZ4RA_Inflate::Read(void *Buffer, ssize_t Count)
 {
 	if (Count <= 0) return 0;
+	if (UseCache())
+	{
+		ssize_t rv = CacheRead(Buffer, Count, fCurPosition);
+		if (fCurPosition > fTotalOut) fTotalOut = fCurPosition;
+		return rv;
+	}
+	if (fNeedReset) Seek(fCurPosition, soBeginning);
 	if (fBlockIdx >= fBlockNum) return 0;
 
 	C_UInt8 *pBuf = (C_UInt8*)Buffer;
@@ -1711,95 +2531,541 @@ ssize_t CdLZ4RA_Inflate::Read(void *Buffer, ssize_t Count)
             iRaw = 0;
 		}
 
-		ssize_t L = Count;
-		if (L > (CntRaw - iRaw)) L = CntRaw - iRaw;
-		memcpy(pBuf, &pRaw[iRaw], L);
-		fCurPosition += L;
-		Count -= L;
-		pBuf += L;
+		ssize_t L = Count;
+		if (L > (CntRaw - iRaw)) L = CntRaw - iRaw;
+		memcpy(pBuf, &pRaw[iRaw], L);
+		fCurPosition += L;
+		Count -= L;
+		pBuf += L;
+
+		iRaw += L;
+		if (iRaw >= CntRaw)
+		{
+			CntRaw = 0;
+			SIZE64 b = fCurPosition - fCB_UZStart;
+			if (b == fCB_UZSize)
+			{
+				// go to the next block
+				if (NextBlock())
+					lz4_body.table[0] = 0;
+				else
+					break;
+			} else if (b > fCB_UZSize)
+				throw ELZ4Error("Invalid LZ4 block for random access");
+		}
+	}
+
+	SIZE64 tmp = fStreamPos - fStreamBase;
+	if (tmp > fTotalIn) fTotalIn = tmp;
+	if (fCurPosition > fTotalOut) fTotalOut = fCurPosition;
+
+	return OldCount - Count;
+}
+
+ssize_t CdLZ4RA_Inflate::Write(const void *Buffer, ssize_t Count)
+{
+	throw ELZ4Error(ErrLZ4InflateInvalid, "Write");
+}
+
+SIZE64 CdLZ4RA_Inflate::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	if (Origin == soCurrent)
+	{
+		Offset += fCurPosition;
+		if (Offset < 0)
+			throw ELZ4Error(ErrLZ4InflateInvalid, "Seek");
+	} else if (Origin == soEnd)
+		throw ELZ4Error(ErrLZ4InflateInvalid, "Seek");
+
+	bool flag = SeekStream(Offset);
+	if (UseCache())
+	{
+		fNeedReset = true;
+		return (fCurPosition = Offset);
+	}
+	if (flag || fNeedReset || (Offset < fCurPosition))
+	{
+		lz4_body.table[0] = 0;
+		iRaw = CntRaw = 0;
+		fStreamPos = fCB_ZStart + SIZE_RA_BLOCK_HEADER;
+		fCurPosition = fCB_UZStart;
+		fNeedReset = false;
+	}
+
+	Offset -= fCurPosition;
+	if (Offset > 0)
+	{
+		C_UInt8 buffer[4096];
+		SIZE64 DivI = Offset / sizeof(buffer);
+		for (; DivI > 0; DivI--)
+			ReadData(buffer, sizeof(buffer));
+		ReadData(buffer, Offset % sizeof(buffer));
+	} else if (Offset < 0)
+		throw ELZ4Error(ErrLZ4InflateInvalid, "Seek");
+
+	return fCurPosition;
+}
+
+SIZE64 CdLZ4RA_Inflate::GetSize()
+{
+	return -1;
+}
+
+void CdLZ4RA_Inflate::SetSize(SIZE64 NewSize)
+{
+	throw ELZ4Error(ErrLZ4InflateInvalid, "SetSize");
+}
+
+void CdLZ4RA_Inflate::ReadMagicNumber(CdStream &Stream)
+{
+	C_UInt8 Header[LZ4_MAGIC_HEADER_SIZE];
+	Stream.SetPosition(fStreamBase);
+	Stream.ReadData(Header, sizeof(Header));
+	if (memcmp(Header, LZ4_MAGIC_HEADER, LZ4_MAGIC_HEADER_SIZE) != 0)
+		throw ELZ4Error(ErrLZ4InflateHeader);
+	fLevel = (CdRecodeStream::TLevel)((C_Int8)Stream.R8b());
+}
+
+void CdLZ4RA_Inflate::DecodeBlock(const C_UInt8 *ZBuf, ssize_t ZSize,
+	C_UInt8 *Buffer, ssize_t UZSize) const
+{
+	// the decompressed data are contiguous, and used as the dictionary
+	LZ4_streamDecode_t body;
+	memset((void*)&body, 0, sizeof(body));
+	const C_UInt8 *ZEnd = ZBuf + ZSize;
+	ssize_t Size = 0;
+
+	while ((Size < UZSize) && (ZBuf + sizeof(C_UInt16) <= ZEnd))
+	{
+		ssize_t Len = ZBuf[0] | (ssize_t(ZBuf[1]) << 8);
+		ZBuf += sizeof(C_UInt16);
+		if (ZBuf + Len > ZEnd) break;
+		ssize_t n = UZSize - Size;
+		if (n > LZ4RA_RAW_BUFFER_SIZE) n = LZ4RA_RAW_BUFFER_SIZE;
+
+		if (fLevel != clNone)
+		{
+			int decBytes = LZ4_decompress_safe_continue(&body,
+				(const char*)ZBuf, (char*)Buffer + Size, Len, n);
+			if (decBytes <= 0) break;
+			Size += decBytes;
+		} else {
+			if (Len > n) break;
+			memcpy(Buffer + Size, ZBuf, Len);
+			Size += Len;
+		}
+		ZBuf += Len;
+	}
+
+	if (Size != UZSize)
+		throw ELZ4Error("Invalid LZ4 block for random access");
+}
+
+
+
+// =====================================================================
+// The classes of Zstandard stream
+// =====================================================================
+
+//   none, fast, default, max
+//   Zstandard has no level without compression, so 'none' is the fastest
+//   negative level which still compresses the data (lightly)
+static const int ZstdLevels[4] = { -5, 1, 3, 19 };
+
+static const char *ErrZstdDeflateInvalid =
+	"Invalid Zstandard Deflate Stream operation '%s'!";
+static const char *ErrZstdInflateInvalid =
+	"Invalid Zstandard Inflate Stream operation '%s'!";
+static const char *ErrZstdDeflateClosed =
+	"Zstandard deflate stream has been closed.";
+
+COREARRAY_INLINE static size_t ZstdCheck(size_t Code)
+{
+	if (ZSTD_isError(Code)) throw EZstdError(Code);
+	return Code;
+}
+
+CdBaseZstdStream::CdBaseZstdStream(CdStream &vStream):
+	CdRecodeStream(vStream)
+{ }
+
+
+// Compression of Zstandard algorithm
+
+CdZstdDeflate::CdZstdDeflate(CdStream &Dest, CdRecodeStream::TLevel level):
+	CdBaseZstdStream(Dest)
+{
+	if ((level < clFirst) || (level > clLast))
+		throw EZstdError("CdZstdDeflate::CdZstdDeflate, invalid level.");
+	fLevel = level;
+
+	fZStream = ZSTD_createCStream();
+	if (!fZStream)
+		throw EZstdError("No memory to create Zstandard stream.");
+	size_t rv = ZSTD_initCStream(fZStream, ZstdLevels[level]);
+	if (ZSTD_isError(rv))
+	{
+		ZSTD_freeCStream(fZStream);
+		fZStream = NULL;
+		throw EZstdError(rv);
+	}
+
+	fCompressSize = ZSTD_CStreamOutSize();
+	fCompress = new C_UInt8[fCompressSize];
+	fHaveClosed = false;
+	PtrExtRec = NULL;
+}
+
+CdZstdDeflate::~CdZstdDeflate()
+{
+	Close();
+	if (fCompress)
+	{
+		delete[] fCompress;
+		fCompress = NULL;
+	}
+	if (fZStream)
+	{
+		ZSTD_freeCStream(fZStream);
+		fZStream = NULL;
+	}
+}
+
+ssize_t CdZstdDeflate::Read(void *Buffer, ssize_t Count)
+{
+	throw EZstdError(ErrZstdDeflateInvalid, "Read");
+}
+
+void CdZstdDeflate::WriteOutput(ZSTD_EndDirective Mode, ZSTD_inBuffer &In)
+{
+	size_t remaining;
+	do {
+		ZSTD_outBuffer Out = { fCompress, (size_t)fCompressSize, 0 };
+		remaining = ZstdCheck(ZSTD_compressStream2(fZStream, &Out, &In, Mode));
+		if (Out.pos > 0)
+		{
+			fStream->WriteData(fCompress, Out.pos);
+			fStreamPos += Out.pos;
+		}
+	} while ((In.pos < In.size) || ((Mode != ZSTD_e_continue) && (remaining > 0)));
+}
+
+ssize_t CdZstdDeflate::Write(const void *Buffer, ssize_t Count)
+{
+	if (fHaveClosed)
+		throw EZstdError(ErrZstdDeflateClosed);
+	if (Count <= 0) return 0;
+
+	ZSTD_inBuffer In = { Buffer, (size_t)Count, 0 };
+	WriteOutput(ZSTD_e_continue, In);
+	fTotalIn += Count;
+	fTotalOut = (fStreamPos - fStreamBase);
+	return Count;
+}
+
+SIZE64 CdZstdDeflate::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	switch (Origin)
+	{
+		case soBeginning:
+			if (Offset == fTotalIn) return fTotalIn;
+			break;
+		case soCurrent:
+			if (Offset == 0) return fTotalIn;
+			break;
+		case soEnd:
+			if (Offset == 0) return fTotalIn;
+			break;
+	}
+	throw EZstdError(ErrZstdDeflateInvalid, "Seek");
+}
+
+void CdZstdDeflate::SetSize(SIZE64 NewSize)
+{
+	if (NewSize != fTotalIn)
+		throw EZstdError(ErrZstdDeflateInvalid, "SetSize");
+}
+
+void CdZstdDeflate::Close()
+{
+	if (!fHaveClosed)
+	{
+		if (PtrExtRec)
+		{
+			WriteData((void*)PtrExtRec->Buf, PtrExtRec->Size);
+			PtrExtRec = NULL;
+		}
+
+		ZSTD_inBuffer In = { NULL, 0, 0 };
+		WriteOutput(ZSTD_e_end, In);
+		fTotalOut = (fStreamPos - fStreamBase);
+		fHaveClosed = true;
+	}
+}
+
+
+// Decompression of Zstandard algorithm
+
+CdZstdInflate::CdZstdInflate(CdStream &Source): CdBaseZstdStream(Source)
+{
+	fZStream = ZSTD_createDStream();
+	if (!fZStream)
+		throw EZstdError("No memory to create Zstandard stream.");
+	ZstdCheck(ZSTD_initDStream(fZStream));
+	fCurPosition = 0;
+	fBufPtr = fBufEnd = fBuffer;
+}
+
+CdZstdInflate::~CdZstdInflate()
+{
+	if (fZStream)
+	{
+		ZSTD_freeDStream(fZStream);
+		fZStream = NULL;
+	}
+}
+
+ssize_t CdZstdInflate::Read(void *Buffer, ssize_t Count)
+{
+	ssize_t OldCount = Count;
+	C_UInt8 *p = (C_UInt8*)Buffer;
+	while (Count > 0)
+	{
+		if (fBufPtr >= fBufEnd)
+		{
+			ssize_t Cnt = fStream->Read(fBuffer, sizeof(fBuffer));
+			fStreamPos += Cnt;
+			fBufPtr = fBuffer;
+			fBufEnd = fBufPtr + Cnt;
+			if (Cnt <= 0) break;
+		}
+
+		ZSTD_inBuffer In = { fBufPtr, (size_t)(fBufEnd - fBufPtr), 0 };
+		ZSTD_outBuffer Out = { p, (size_t)Count, 0 };
+		ZstdCheck(ZSTD_decompressStream(fZStream, &Out, &In));
+
+		fBufPtr += In.pos;
+		fCurPosition += Out.pos;
+		p += Out.pos;
+		Count -= Out.pos;
+		// no progress at the end of a frame without more input
+		if ((In.pos == 0) && (Out.pos == 0))
+			break;
+	}
+
+	SIZE64 tmp = fStreamPos - fStreamBase;
+	if (tmp > fTotalIn) fTotalIn = tmp;
+	if (fCurPosition > fTotalOut) fTotalOut = fCurPosition;
+
+	return (OldCount - Count);
+}
+
+ssize_t CdZstdInflate::Write(const void *Buffer, ssize_t Count)
+{
+	throw EZstdError(ErrZstdInflateInvalid, "Write");
+}
+
+SIZE64 CdZstdInflate::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	if ((Offset==0) && (Origin==soBeginning))
+	{
+		if (fCurPosition == 0) return 0;
+		ZstdCheck(ZSTD_DCtx_reset(fZStream, ZSTD_reset_session_only));
+		fBufPtr = fBufEnd = fBuffer;
+		fStream->SetPosition(fStreamPos = fStreamBase);
+		return (fCurPosition = 0);
+	} else if (Origin != soEnd)
+	{
+		if ((Offset==0) && (Origin==soCurrent))
+			return fCurPosition;
+
+		if (Origin == soCurrent) Offset += fCurPosition;
+		if (Offset < fCurPosition)
+			Seek(0, soBeginning);
+		else
+			Offset -= fCurPosition;
+
+		C_UInt8 buffer[4096];
+		SIZE64 DivI = Offset / sizeof(buffer);
+		for (; DivI > 0; DivI--)
+			ReadData(buffer, sizeof(buffer));
+		ReadData(buffer, Offset % sizeof(buffer));
+	} else
+		throw EZstdError(ErrZstdInflateInvalid, "Seek");
+
+	return fCurPosition;
+}
+
+SIZE64 CdZstdInflate::GetSize()
+{
+	return -1;
+}
+
+void CdZstdInflate::SetSize(SIZE64 NewSize)
+{
+	throw EZstdError(ErrZstdInflateInvalid, "SetSize");
+}
+
+
+// CdZstdRA_Deflate
+
+#define ZSTD_MAGIC_HEADER_SIZE     8
+static const C_UInt8 ZSTD_MAGIC_HEADER[ZSTD_MAGIC_HEADER_SIZE] =
+	{ 'Z', 'S', 'T', 'D', '_', 'R', 'A', 0x10 };
+
+CdZstdRA_Deflate::CdZstdRA_Deflate(CdStream &Dest, TLevel Level,
+	TBlockSize BK): CdRA_Write(this, BK), CdBaseZstdStream(Dest)
+{
+	if ((Level < clFirst) || (Level > clLast))
+		throw EZstdError("CdZstdRA_Deflate::CdZstdRA_Deflate, invalid level.");
+	fLevel = Level;
+	PtrExtRec = NULL;
+	fHaveClosed = false;
+	InitWriteStream();
+}
+
+ssize_t CdZstdRA_Deflate::Read(void *Buffer, ssize_t Count)
+{
+	throw EZstdError(ErrZstdDeflateInvalid, "Read");
+}
+
+ssize_t CdZstdRA_Deflate::Write(const void *Buffer, ssize_t Count)
+{
+	if (fHaveClosed)
+		throw EZstdError(ErrZstdDeflateClosed);
+	if (Count <= 0) return 0;
+	// a whole block is compressed at once, even with one thread
+	return ParallelWrite(Buffer, Count);
+}
+
+SIZE64 CdZstdRA_Deflate::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	switch (Origin)
+	{
+		case soBeginning:
+			if (Offset == fTotalIn) return fTotalIn;
+			break;
+		case soCurrent:
+			if (Offset == 0) return fTotalIn;
+			break;
+		case soEnd:
+			if (Offset == 0) return fTotalIn;
+			break;
+	}
+	throw EZstdError(ErrZstdDeflateInvalid, "Seek");
+}
+
+void CdZstdRA_Deflate::SetSize(SIZE64 NewSize)
+{
+	if (NewSize != fTotalIn)
+		throw EZstdError(ErrZstdDeflateInvalid, "SetSize");
+}
 
-		iRaw += L;
-		if (iRaw >= CntRaw)
+void CdZstdRA_Deflate::Close()
+{
+	if (!fHaveClosed)
+	{
+		if (PtrExtRec)
 		{
-			CntRaw = 0;
-			SIZE64 b = fCurPosition - fCB_UZStart;
-			if (b == fCB_UZSize)
-			{
-				// go to the next block
-				if (NextBlock())
-					lz4_body.table[0] = 0;
-				else
-					break;
-			} else if (b > fCB_UZSize)
-				throw ELZ4Error("Invalid LZ4 block for random access");
+			WriteData((void*)PtrExtRec->Buf, PtrExtRec->Size);
+			PtrExtRec = NULL;
 		}
+		ParallelFlush();
+		DoneWriteStream();
+		fHaveClosed = true;
 	}
+}
 
-	SIZE64 tmp = fStreamPos - fStreamBase;
-	if (tmp > fTotalIn) fTotalIn = tmp;
-	if (fCurPosition > fTotalOut) fTotalOut = fCurPosition;
+void CdZstdRA_Deflate::WriteMagicNumber(CdStream &Stream)
+{
+	Stream.WriteData(ZSTD_MAGIC_HEADER, ZSTD_MAGIC_HEADER_SIZE);
+	Stream.W8b(fLevel);
+}
 
-	return OldCount - Count;
+void CdZstdRA_Deflate::CompressBlock(const C_UInt8 *Raw, ssize_t Size,
+	vector<C_UInt8> &Out)
+{
+	Out.resize(ZSTD_compressBound(Size));
+	size_t rv = ZstdCheck(ZSTD_compress(&Out[0], Out.size(), Raw, Size,
+		ZstdLevels[fLevel]));
+	Out.resize(rv);
 }
 
-ssize_t CdLZ4RA_Inflate::Write(const void *Buffer, ssize_t Count)
+
+// CdZstdRA_Inflate
+
+static const char *ErrZstdInflateHeader =
+	"Invalid header for Zstandard stream with random access.";
+
+CdZstdRA_Inflate::CdZstdRA_Inflate(CdStream &Source):
+	CdRA_Read(this), CdBaseZstdStream(Source)
 {
-	throw ELZ4Error(ErrLZ4InflateInvalid, "Write");
+	fLevel = clUnknown;
+	InitReadStream();
+	fCurPosition = 0;
 }
 
-SIZE64 CdLZ4RA_Inflate::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+CdZstdRA_Inflate::~CdZstdRA_Inflate()
+{
+	DoneReadAhead();
+}
+
+ssize_t CdZstdRA_Inflate::Read(void *Buffer, ssize_t Count)
+{
+	// always decompress a whole block, since a block is a Zstandard frame
+	if (Count <= 0) return 0;
+	ssize_t rv = CacheRead(Buffer, Count, fCurPosition);
+	if (fCurPosition > fTotalOut) fTotalOut = fCurPosition;
+	return rv;
+}
+
+ssize_t CdZstdRA_Inflate::Write(const void *Buffer, ssize_t Count)
+{
+	throw EZstdError(ErrZstdInflateInvalid, "Write");
+}
+
+SIZE64 CdZstdRA_Inflate::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
 {
 	if (Origin == soCurrent)
 	{
 		Offset += fCurPosition;
 		if (Offset < 0)
-			throw ELZ4Error(ErrLZ4InflateInvalid, "Seek");
+			throw EZstdError(ErrZstdInflateInvalid, "Seek");
 	} else if (Origin == soEnd)
-		throw ELZ4Error(ErrLZ4InflateInvalid, "Seek");
-
-	bool flag = SeekStream(Offset);
-	if (flag || (Offset < fCurPosition))
-	{
-		lz4_body.table[0] = 0;
-		iRaw = CntRaw = 0;
-		fStreamPos = fCB_ZStart + SIZE_RA_BLOCK_HEADER;
-		fCurPosition = fCB_UZStart;
-	}
-
-	Offset -= fCurPosition;
-	if (Offset > 0)
-	{
-		C_UInt8 buffer[4096];
-		SIZE64 DivI = Offset / sizeof(buffer);
-		for (; DivI > 0; DivI--)
-			ReadData(buffer, sizeof(buffer));
-		ReadData(buffer, Offset % sizeof(buffer));
-	} else if (Offset < 0)
-		throw ELZ4Error(ErrLZ4InflateInvalid, "Seek");
+		throw EZstdError(ErrZstdInflateInvalid, "Seek");
 
-	return fCurPosition;
+	SeekStream(Offset);
+	return (fCurPosition = Offset);
 }
 
-SIZE64 CdLZ4RA_Inflate::GetSize()
+SIZE64 CdZstdRA_Inflate::GetSize()
 {
 	return -1;
 }
 
-void CdLZ4RA_Inflate::SetSize(SIZE64 NewSize)
+void CdZstdRA_Inflate::SetSize(SIZE64 NewSize)
 {
-	throw ELZ4Error(ErrLZ4InflateInvalid, "SetSize");
+	throw EZstdError(ErrZstdInflateInvalid, "SetSize");
 }
 
-void CdLZ4RA_Inflate::ReadMagicNumber(CdStream &Stream)
+void CdZstdRA_Inflate::ReadMagicNumber(CdStream &Stream)
 {
-	C_UInt8 Header[LZ4_MAGIC_HEADER_SIZE];
+	C_UInt8 Header[ZSTD_MAGIC_HEADER_SIZE];
 	Stream.SetPosition(fStreamBase);
 	Stream.ReadData(Header, sizeof(Header));
-	if (memcmp(Header, LZ4_MAGIC_HEADER, LZ4_MAGIC_HEADER_SIZE) != 0)
-		throw ELZ4Error(ErrLZ4InflateHeader);
+	if (memcmp(Header, ZSTD_MAGIC_HEADER, ZSTD_MAGIC_HEADER_SIZE) != 0)
+		throw EZstdError(ErrZstdInflateHeader);
 	fLevel = (CdRecodeStream::TLevel)((C_Int8)Stream.R8b());
 }
 
+void CdZstdRA_Inflate::DecodeBlock(const C_UInt8 *ZBuf, ssize_t ZSize,
+	C_UInt8 *Buffer, ssize_t UZSize) const
+{
+	size_t rv = ZSTD_decompress(Buffer, UZSize, ZBuf, ZSize);
+	if (ZSTD_isError(rv) || ((ssize_t)rv != UZSize))
+		throw EZstdError("Invalid Zstandard block for random access");
+}
+
 
 
 // =====================================================================
@@ -1926,12 +3192,86 @@ ssize_t CdBlockStream::Read(void *Buffer, ssize_t Count)
 	return fPosition - LastPos;
 }
 
+const void *CdBlockStream::MemPtr(SIZE64 Pos, SIZE64 &Count)
+{
+	const TBlockInfo *Hint = fCurrent;
+	return MemPtr(Pos, Count, Hint);
+}
+
+const void *CdBlockStream::MemPtr(SIZE64 Pos, SIZE64 &Count,
+	const TBlockInfo *&Hint)
+{
+	Count = 0;
+	CdStream *vStream = fCollection.Stream();
+	if (!vStream || (Pos < 0) || (Pos >= fBlockSize))
+		return NULL;
+	const TBlockInfo *p = FindBlock(Pos, Hint);
+	if (!p) return NULL;
+	Hint = p;
+
+	SIZE64 I = Pos - p->BlockStart;
+	SIZE64 L = p->BlockSize - I;
+	if (L > fBlockSize - Pos) L = fBlockSize - Pos;
+	if (L <= 0) return NULL;
+	const void *rv = vStream->MemPtr(p->StreamStart + I, Count);
+	if (rv && (Count > L)) Count = L;
+	return rv;
+}
+
+ssize_t CdBlockStream::ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count)
+{
+	const TBlockInfo *Hint = NULL;
+	return ReadAt(Pos, Buffer, Count, Hint);
+}
+
+ssize_t CdBlockStream::ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count,
+	const TBlockInfo *&Hint)
+{
+	if ((Pos < 0) || (Pos >= fBlockSize)) return 0;
+	if ((Pos+Count) > fBlockSize)
+		Count = fBlockSize - Pos;
+	CdStream *vStream = fCollection.Stream();
+	if (!vStream || (Count <= 0)) return 0;
+
+	const TBlockInfo *p = FindBlock(Pos, Hint);
+	char *s = (char*)Buffer;
+	ssize_t rv = 0;
+	while (p && (Count > 0))
+	{
+		SIZE64 I = Pos - p->BlockStart;
+		SIZE64 L = p->BlockSize - I;
+		if (L > 0)
+		{
+			if (L > Count) L = Count;
+			ssize_t RL = vStream->ReadAt(p->StreamStart + I, s, L);
+			rv += RL;
+			if (RL != L) break;
+			s += L; Pos += L; Count -= L;
+		}
+		if (Count > 0) p = p->Next;
+	}
+	if (p) Hint = p;
+	return rv;
+}
+
+const CdBlockStream::TBlockInfo *CdBlockStream::FindBlock(SIZE64 Pos,
+	const TBlockInfo *Hint) const
+{
+	const TBlockInfo *p = Hint;
+	if (!p || (Pos < p->BlockStart)) p = fList;
+	if (!p) return NULL;
+	while (p->Next && (Pos >= p->Next->BlockStart))
+		p = p->Next;
+	return p;
+}
+
 ssize_t CdBlockStream::Write(const void *Buffer, ssize_t Count)
 {
 	SIZE64 LastPos = fPosition;
 
 	if (Count > 0)
 	{
+		fCollection.fRACache.Remove(fID.Get());
 		SIZE64 L = fPosition + Count;
 		if (L > fBlockCapacity)
 			fCollection._IncStreamSize(*this, L);
@@ -2014,6 +3354,7 @@ void CdBlockStream::SetSize(SIZE64 NewSize)
 {
 	if ((0<=NewSize) && (NewSize!=fBlockSize))
 	{
+		fCollection.fRACache.Remove(fID.Get());
 		if (NewSize > fBlockCapacity)
 			fCollection._IncStreamSize(*this, NewSize);
 		else if (NewSize < fBlockCapacity)
@@ -2033,6 +3374,7 @@ void CdBlockStream::SetSizeOnly(SIZE64 NewSize)
 {
 	if ((0<=NewSize) && (NewSize!=fBlockSize))
 	{
+		fCollection.fRACache.Remove(fID.Get());
 		if (NewSize > fBlockCapacity)
 		{
 			SetSize(NewSize);
@@ -2068,6 +3410,7 @@ void CdBlockStream::SyncSizeInfo()
 	{
 		if (fList)
 		{
+			fCollection._DropBlockTable();
 			CdStream *s = fCollection.Stream();
 			s->SetPosition(fList->StreamStart - GDS_POS_SIZE);
 			BYTE_LE<CdStream>(*s) << TdGDSPos(fBlockSize);
@@ -2095,6 +3438,83 @@ CdBlockStream::TBlockInfo *CdBlockStream::_FindCur(const SIZE64 Pos)
 		return NULL;
 }
 
+// CdBlockReadStream
+
+/// the mutex object for the reference count of a block stream shared by
+///   the readers in different threads, since CdRef is not thread-safe
+static CdThreadMutex BlockReadStreamMutex;
+
+CdBlockReadStream::CdBlockReadStream(CdBlockStream &Stream): CdStream()
+{
+	fStream = &Stream;
+	{
+		TdAutoMutex AutoMutex(&BlockReadStreamMutex);
+		fStream->AddRef();
+	}
+	fHint = NULL;
+	fPosition = 0;
+	// no read-ahead, since the view is used in a thread
+	fRACache.SetMaxSize(Stream.Collection().RACache().MaxSize());
+}
+
+CdBlockReadStream::~CdBlockReadStream()
+{
+	{
+		TdAutoMutex AutoMutex(&BlockReadStreamMutex);
+		fStream->Release();
+	}
+	fStream = NULL;
+}
+
+ssize_t CdBlockReadStream::Read(void *Buffer, ssize_t Count)
+{
+	ssize_t rv = fStream->ReadAt(fPosition, Buffer, Count, fHint);
+	fPosition += rv;
+	return rv;
+}
+
+ssize_t CdBlockReadStream::Write(const void *Buffer, ssize_t Count)
+{
+	throw ErrStream(rsBlockReadOnly);
+}
+
+SIZE64 CdBlockReadStream::Seek(SIZE64 Offset, TdSysSeekOrg Origin)
+{
+	switch (Origin)
+	{
+		case soBeginning:
+			fPosition = Offset; break;
+		case soCurrent:
+			fPosition += Offset; break;
+		case soEnd:
+			fPosition = fStream->Size() + Offset; break;
+		default:
+			return -1;
+	}
+	return fPosition;
+}
+
+SIZE64 CdBlockReadStream::GetSize()
+{
+	return fStream->Size();
+}
+
+void CdBlockReadStream::SetSize(SIZE64 NewSize)
+{
+	throw ErrStream(rsBlockReadOnly);
+}
+
+const void *CdBlockReadStream::MemPtr(SIZE64 Pos, SIZE64 &Count)
+{
+	return fStream->MemPtr(Pos, Count, fHint);
+}
+
+ssize_t CdBlockReadStream::ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count)
+{
+	return fStream->ReadAt(Pos, Buffer, Count, fHint);
+}
+
+
 // CdBlockCollection
 
 CdBlockCollection::CdBlockCollection(const SIZE64 vCodeStart)
@@ -2106,6 +3526,9 @@ CdBlockCollection::CdBlockCollection(const SIZE64 vCodeStart)
 	fCodeStart = vCodeStart;
 	fClassMgr = &dObjManager();
 	fReadOnly = false;
+	fBufSize = fBufMaxSize = 0;
+	fBlockTable = fBlockTableLoaded = false;
+	fTableSize = 0;
 }
 
 CdBlockCollection::~CdBlockCollection()
@@ -2117,6 +3540,7 @@ void CdBlockCollection::_IncStreamSize(CdBlockStream &Block,
 	const SIZE64 NewCapacity)
 {
 	// NewCapacity > fBlockCapacity
+	_DropBlockTable();
 	if (Block.fList != NULL)
 	{
 		CdBlockStream::TBlockInfo *p = Block.fList;
@@ -2175,6 +3599,7 @@ void CdBlockCollection::_DecStreamSize(CdBlockStream &Block,
 	const SIZE64 NewSize)
 {
 	// NewSize < fBlockCapacity
+	_DropBlockTable();
 	CdBlockStream::TBlockInfo *p, *q;
 
 	p = Block.fList; q = NULL;
@@ -2290,17 +3715,14 @@ CdBlockStream *CdBlockCollection::NewBlockStream()
 	rv->AddRef();
 	rv->fID = vNextID; ++vNextID;
 	fBlockList.push_back(rv);
+	fBlockIndex[rv->fID.Get()] = rv;
 
 	return rv;
 }
 
 bool CdBlockCollection::HaveID(TdGDSBlockID id)
 {
-	vector<CdBlockStream*>::const_iterator it;
-	for (it=fBlockList.begin(); it != fBlockList.end(); it++)
-		if ((*it)->fID == id)
-			return true;
-	return false;
+	return fBlockIndex.find(id.Get()) != fBlockIndex.end();
 }
 
 int CdBlockCollection::NumOfFragment()
@@ -2329,14 +3751,72 @@ void CdBlockCollection::LoadStream(CdStream *vStream, bool vReadOnly)
 	// Assign
 	(fStream=vStream)->AddRef();
     fReadOnly = vReadOnly;
+	fStreamSize = fStream->GetSize();
 
-	// Start to screen
-	CdBlockStream::TBlockInfo *p, *q, *n;
+	// All blocks in the order of position, with the IDs and sizes of heads
+	vector<CdBlockStream::TBlockInfo*> List;
+	vector<TdGDSBlockID> IDs;
+	vector<TdGDSPos> Sizes;
+	if (!_LoadBlockTable(List, IDs, Sizes))
+		_ScanBlocks(List, IDs, Sizes);
+
+	// Reorganize Block, the positions of blocks are in ascending order
+	const size_t n = List.size();
+	vector<SIZE64> Start(n);
+	vector<bool> Used(n, false);
+	for (size_t i=0; i < n; i++)
+		Start[i] = List[i]->AbsStart();
+
+	for (size_t i=0; i < n; i++)
+	{
+		CdBlockStream::TBlockInfo *p = List[i];
+		if (!p->Head) continue;
+
+		CdBlockStream *bs = new CdBlockStream(*this);
+		bs->AddRef();
+		fBlockList.push_back(bs);
+
+		bs->fID = IDs[i];
+		fBlockIndex.insert(make_pair(bs->fID.Get(), bs));
+		bs->fBlockSize = Sizes[i];
+		bs->fBlockCapacity = p->BlockSize;
+		bs->fList = bs->fCurrent = p;
+		p->Next = NULL;
+		Used[i] = true;
+
+		// Find a list
+		while (p->StreamNext != 0)
+		{
+			vector<SIZE64>::iterator it =
+				lower_bound(Start.begin(), Start.end(), p->StreamNext);
+			size_t k = it - Start.begin();
+			if ((k >= n) || (*it != p->StreamNext) || Used[k] || List[k]->Head)
+				break;
+			Used[k] = true;
+			CdBlockStream::TBlockInfo *q = List[k];
+			p->Next = q;
+			q->BlockStart = p->BlockStart + p->BlockSize;
+			bs->fBlockCapacity += q->BlockSize;
+			p = q;
+			p->Next = NULL;
+		}
+	}
 
-	fStream->SetPosition(fCodeStart);
-	fStreamSize = fStream->GetSize();
+	// The remaining blocks are unused
+	CdBlockStream::TBlockInfo *p = NULL;
+	for (size_t i=0; i < n; i++)
+	{
+		if (Used[i]) continue;
+		if (p) p->Next = List[i]; else fUnuse = List[i];
+		p = List[i];
+		p->Next = NULL;
+	}
+}
 
-	p = fUnuse;
+void CdBlockCollection::_ScanBlocks(vector<CdBlockStream::TBlockInfo*> &List,
+	vector<TdGDSBlockID> &IDs, vector<TdGDSPos> &Sizes)
+{
+	fStream->SetPosition(fCodeStart);
 	while (fStream->Position() < fStreamSize)
 	{
 		TdGDSPos sSize, sNext;
@@ -2350,59 +3830,253 @@ void CdBlockCollection::LoadStream(CdStream *vStream, bool vReadOnly)
 		n->BlockSize = (sSize & GDS_STREAM_POS_MASK) - L - 2*GDS_POS_SIZE;
 		n->StreamStart = fStream->Position() + L;
 		n->StreamNext = sNext;
+		List.push_back(n);
 
-		if (p) p->Next = n; else fUnuse = n;
-		p = n;
+		TdGDSBlockID ID(0);
+		TdGDSPos Size(0);
+		if (n->Head)
+			BYTE_LE<CdStream>(fStream) >> ID >> Size;
+		IDs.push_back(ID);
+		Sizes.push_back(Size);
 
 		fStream->SetPosition(sPos);
 	}
+}
+
 
-	// Reorganize Block
-	while (fUnuse != NULL)
+// the table of blocks at the end of a GDS file:
+//   an unused block { TdGDSPos size, TdGDSPos 0 } followed by
+//   { TdGDSPos size, TdGDSPos next [, TdGDSBlockID id, TdGDSPos stream size
+//     if it is a head] } of each block in the order of position,
+//   TdGDSPos the number of blocks, TdGDSPos the position of the table,
+//   C_UInt32 the CRC-32 of the above, and BLOCK_TABLE_MAGIC
+
+static const char BLOCK_TABLE_MAGIC[] = "GDSBTBL1";
+static const ssize_t BLOCK_TABLE_MAGIC_SIZE = 8;
+static const ssize_t BLOCK_TABLE_FOOTER_SIZE =
+	2*GDS_POS_SIZE + sizeof(C_UInt32) + BLOCK_TABLE_MAGIC_SIZE;
+
+namespace CoreArray
+{
+	/// the memory buffer of a block table, used with BYTE_LE
+	struct CdBlockTableBuf
 	{
-		// Find the Head
-		p = fUnuse; q = NULL;
-		while (p != NULL) {
-			if (p->Head) break;
-			q = p; p = p->Next;
-        }
+		vector<C_UInt8> Buffer;
+		size_t Pos;
 
-		if (p != NULL)
+		CdBlockTableBuf() { Pos = 0; }
+
+		void ReadData(void *Buf, ssize_t Count)
 		{
-        	// Delete p
-			if (q) q->Next = p->Next; else fUnuse = p->Next;
-			//
-			CdBlockStream *bs = new CdBlockStream(*this);
-			bs->AddRef();
-			fBlockList.push_back(bs);
-			//
-			fStream->SetPosition(p->StreamStart -
-				CdBlockStream::TBlockInfo::HeadSize);
-			BYTE_LE<CdStream>(fStream) >> bs->fID >> bs->fBlockSize;
-			bs->fBlockCapacity = p->BlockSize;
-			bs->fList = bs->fCurrent = p;
-			p->Next = NULL;
+			if (Pos + Count > Buffer.size())
+				throw ErrStream(rsInvalidBlockLen);
+			memcpy(Buf, &Buffer[Pos], Count);
+			Pos += Count;
+		}
+		C_UInt8 R8b()
+		{
+			C_UInt8 v;
+			ReadData(&v, 1);
+			return v;
+		}
+		C_UInt32 R32b()
+		{
+			C_UInt32 v;
+			ReadData(&v, 4);
+			return v;
+		}
+		void WriteData(const void *Buf, ssize_t Count)
+		{
+			Buffer.insert(Buffer.end(), (const C_UInt8*)Buf,
+				(const C_UInt8*)Buf + Count);
+		}
+		void W8b(C_UInt8 val) { Buffer.push_back(val); }
+		void W32b(C_UInt32 val) { WriteData(&val, 4); }
+	};
 
-			// Find a list
-			n = fUnuse; q = NULL;
-			while ((n != NULL) && (p->StreamNext != 0))
+	struct CdBlockTableItem
+	{
+		CdBlockStream::TBlockInfo *Info;
+		CdBlockStream *Owner;
+		SIZE64 Start;
+		bool operator< (const CdBlockTableItem &v) const
+			{ return Start < v.Start; }
+	};
+}
+
+bool CdBlockCollection::_LoadBlockTable(
+	vector<CdBlockStream::TBlockInfo*> &List, vector<TdGDSBlockID> &IDs,
+	vector<TdGDSPos> &Sizes)
+{
+	const SIZE64 MinSize = fCodeStart + 2*GDS_POS_SIZE + BLOCK_TABLE_FOOTER_SIZE;
+	if (fStreamSize < MinSize) return false;
+
+	try {
+		// the footer
+		CdBlockTableBuf Foot;
+		Foot.Buffer.resize(BLOCK_TABLE_FOOTER_SIZE);
+		fStream->SetPosition(fStreamSize - BLOCK_TABLE_FOOTER_SIZE);
+		fStream->ReadData(&Foot.Buffer[0], BLOCK_TABLE_FOOTER_SIZE);
+		if (memcmp(&Foot.Buffer[BLOCK_TABLE_FOOTER_SIZE-BLOCK_TABLE_MAGIC_SIZE],
+				BLOCK_TABLE_MAGIC, BLOCK_TABLE_MAGIC_SIZE) != 0)
+			return false;
+		TdGDSPos Cnt, TabPos;
+		C_UInt32 CRC;
+		BYTE_LE<CdBlockTableBuf>(Foot) >> Cnt >> TabPos >> CRC;
+		if ((TabPos < fCodeStart) || (TabPos > fStreamSize - (MinSize - fCodeStart)))
+			return false;
+
+		// the unused block storing the table
+		TdGDSPos sSize, sNext;
+		fStream->SetPosition(TabPos);
+		BYTE_LE<CdStream>(fStream) >> sSize >> sNext;
+		if ((SIZE64(sSize) != fStreamSize - TabPos) || (SIZE64(sNext) != 0))
+			return false;
+
+		// the table
+		CdBlockTableBuf Tab;
+		const ssize_t Len = fStreamSize - TabPos - 2*GDS_POS_SIZE;
+		Tab.Buffer.resize(Len);
+		fStream->ReadData(&Tab.Buffer[0], Len);
+		const ssize_t LenCRC = Len - sizeof(C_UInt32) - BLOCK_TABLE_MAGIC_SIZE;
+		if (crc32(0, &Tab.Buffer[0], LenCRC) != CRC)
+			return false;
+
+		BYTE_LE<CdBlockTableBuf> R(Tab);
+		SIZE64 Pos = fCodeStart;
+		for (C_Int64 i=0; i < Cnt; i++)
+		{
+			R >> sSize >> sNext;
+			bool Head = (sSize & GDS_STREAM_POS_MASK_HEAD_BIT) != 0;
+			SIZE64 L = (Head ? CdBlockStream::TBlockInfo::HeadSize : 0) +
+				2*GDS_POS_SIZE;
+			SIZE64 Total = sSize & GDS_STREAM_POS_MASK;
+			if ((Total < L) || (Pos + Total > TabPos))
+				throw ErrStream(rsInvalidBlockLen);
+
+			CdBlockStream::TBlockInfo *n = new CdBlockStream::TBlockInfo;
+			List.push_back(n);
+			n->Head = Head;
+			n->BlockSize = Total - L;
+			n->StreamStart = Pos + L;
+			n->StreamNext = sNext;
+
+			TdGDSBlockID ID(0);
+			TdGDSPos Size(0);
+			if (Head) R >> ID >> Size;
+
+			// the file might be modified in place by a version without the
+			// table, which reuses unused blocks and relinks the used ones,
+			// so every block should agree with its header on disk
+			CdBlockTableBuf H;
+			H.Buffer.resize(L);
+			fStream->SetPosition(Pos);
+			fStream->ReadData(&H.Buffer[0], L);
+			BYTE_LE<CdBlockTableBuf> HR(H);
+			TdGDSPos hSize, hNext;
+			HR >> hSize >> hNext;
+			if ((hSize != sSize) || (hNext != sNext))
+				throw ErrStream(rsInvalidBlockLen);
+			if (Head)
 			{
-				if ((p->StreamNext == n->AbsStart()) && (!n->Head))
-				{
-					if (q) q->Next = n->Next; else fUnuse = n->Next;
-					p->Next = n;
-					n->BlockStart = p->BlockStart + p->BlockSize;
-					bs->fBlockCapacity += n->BlockSize;
-					p = n; n = n->Next;
-					p->Next = NULL;
-				} else {
-					q = n; n = n->Next;
-                }
+				TdGDSBlockID hID;
+				TdGDSPos hStreamSize;
+				HR >> hID >> hStreamSize;
+				if ((hID != ID) || (hStreamSize != Size))
+					throw ErrStream(rsInvalidBlockLen);
 			}
 
-			// need checking codes
-		} else
-        	break;
+			IDs.push_back(ID);
+			Sizes.push_back(Size);
+			Pos += Total;
+		}
+		if ((Pos != TabPos) ||
+				(Tab.Pos != (size_t)(LenCRC - 2*GDS_POS_SIZE)))
+			throw ErrStream(rsInvalidBlockLen);
+
+		fTableSize = fStreamSize - TabPos;
+		fStreamSize = TabPos;
+		fBlockTable = fBlockTableLoaded = true;
+		return true;
+	}
+	catch (exception &) {
+		for (size_t i=0; i < List.size(); i++)
+			delete List[i];
+		List.clear(); IDs.clear(); Sizes.clear();
+		return false;
+	}
+}
+
+void CdBlockCollection::WriteBlockTable()
+{
+	if (!fStream || fReadOnly || (fTableSize > 0))
+		return;
+
+	// all blocks in the order of position
+	vector<CdBlockTableItem> List;
+	vector<CdBlockStream*>::iterator it;
+	for (it=fBlockList.begin(); it != fBlockList.end(); it++)
+	{
+		(*it)->SyncSizeInfo();
+		for (CdBlockStream::TBlockInfo *p=(*it)->fList; p; p=p->Next)
+		{
+			CdBlockTableItem I = { p, *it, p->AbsStart() };
+			List.push_back(I);
+		}
+	}
+	for (CdBlockStream::TBlockInfo *p=fUnuse; p; p=p->Next)
+	{
+		CdBlockTableItem I = { p, NULL, p->AbsStart() };
+		List.push_back(I);
+	}
+	sort(List.begin(), List.end());
+
+	// the table, the blocks should be contiguous
+	CdBlockTableBuf Tab;
+	BYTE_LE<CdBlockTableBuf> W(Tab);
+	SIZE64 Pos = fCodeStart;
+	vector<CdBlockTableItem>::iterator p;
+	for (p=List.begin(); p != List.end(); p++)
+	{
+		CdBlockStream::TBlockInfo *I = p->Info;
+		bool Head = I->Head && p->Owner && (p->Owner->fList == I);
+		if ((p->Start != Pos) || (I->Head != Head))
+			return;
+		SIZE64 Total = I->BlockSize + 2*GDS_POS_SIZE +
+			(Head ? CdBlockStream::TBlockInfo::HeadSize : 0);
+		W << TdGDSPos(Total | (Head ? GDS_STREAM_POS_MASK_HEAD_BIT : 0))
+			<< TdGDSPos(I->StreamNext);
+		if (Head)
+			W << p->Owner->fID << p->Owner->fBlockSize;
+		Pos += Total;
+	}
+	if (Pos != fStreamSize) return;
+
+	W << TdGDSPos(List.size()) << TdGDSPos(fStreamSize);
+	W << C_UInt32(crc32(0, &Tab.Buffer[0], Tab.Buffer.size()));
+	W.WriteData(BLOCK_TABLE_MAGIC, BLOCK_TABLE_MAGIC_SIZE);
+
+	// saved in an unused block
+	SIZE64 Total = 2*GDS_POS_SIZE + Tab.Buffer.size();
+	fStream->SetPosition(fStreamSize);
+	BYTE_LE<CdStream>(fStream) << TdGDSPos(Total) << TdGDSPos(0);
+	fStream->WriteData(&Tab.Buffer[0], Tab.Buffer.size());
+	fStream->SetSize(fStreamSize + Total);
+	fTableSize = Total;
+}
+
+void CdBlockCollection::SetBlockTable(bool Enable)
+{
+	fBlockTable = Enable;
+	if (!Enable) _DropBlockTable();
+}
+
+void CdBlockCollection::_DropBlockTable()
+{
+	if ((fTableSize > 0) && !fReadOnly)
+	{
+		fTableSize = 0;
+		fStream->SetSize(fStreamSize);
 	}
 }
 
@@ -2434,6 +4108,7 @@ void CdBlockCollection::Clear()
 		}
 	}
 	fBlockList.clear();
+	fBlockIndex.clear();
 
 	if (fStream)
 	{
@@ -2448,55 +4123,57 @@ void CdBlockCollection::Clear()
 
 	xClearList(fUnuse);
 	fUnuse = NULL;
+	fRACache.Clear();
+	fBlockTable = fBlockTableLoaded = false;
+	fTableSize = 0;
 }
 
 void CdBlockCollection::DeleteBlockStream(TdGDSBlockID id)
 {
-	vector<CdBlockStream*>::iterator it;
-	for (it=fBlockList.begin(); it != fBlockList.end(); it++)
+	map<C_UInt32, CdBlockStream*>::iterator m = fBlockIndex.find(id.Get());
+	if (m == fBlockIndex.end())
+		throw ErrStream("Invalid block with id: %x", id.Get());
+
+	vector<CdBlockStream*>::iterator it =
+		find(fBlockList.begin(), fBlockList.end(), m->second);
+	fBlockIndex.erase(m);
+
+	_DropBlockTable();
+	fRACache.Remove(id.Get());
+	CdBlockStream::TBlockInfo *p, *q;
+	p = (*it)->fList; q = NULL;
+	while (p != NULL)
 	{
-		if ((*it)->fID == id)
+		if (p->Head)
 		{
-			CdBlockStream::TBlockInfo *p, *q;
-			p = (*it)->fList; q = NULL;
-			while (p != NULL)
-			{
-				if (p->Head)
-				{
-					p->BlockSize += CdBlockStream::TBlockInfo::HeadSize;
-					p->StreamStart -= CdBlockStream::TBlockInfo::HeadSize;
-					p->Head = false;
-				}
-				p->SetSize2(*fStream, p->BlockSize, 0);
-            	q = p; p = p->Next;
-            }
-			if (q) {
-				q->Next = fUnuse;
-				fUnuse = (*it)->fList;
-				(*it)->fList = NULL;
-            }
-
-			(*it)->Release();
-			fBlockList.erase(it);
-			return;
+			p->BlockSize += CdBlockStream::TBlockInfo::HeadSize;
+			p->StreamStart -= CdBlockStream::TBlockInfo::HeadSize;
+			p->Head = false;
 		}
+		p->SetSize2(*fStream, p->BlockSize, 0);
+		q = p; p = p->Next;
 	}
-	throw ErrStream("Invalid block with id: %x", id.Get());
+	if (q) {
+		q->Next = fUnuse;
+		fUnuse = (*it)->fList;
+		(*it)->fList = NULL;
+	}
+
+	(*it)->Release();
+	fBlockList.erase(it);
 }
 
 CdBlockStream *CdBlockCollection::operator[] (const TdGDSBlockID &id)
 {
-	vector<CdBlockStream*>::iterator it;
-	for (it=fBlockList.begin(); it != fBlockList.end(); it++)
-	{
-		if ((*it)->fID == id)
-			return *it;
-	}
+	map<C_UInt32, CdBlockStream*>::iterator it = fBlockIndex.find(id.Get());
+	if (it != fBlockIndex.end())
+		return it->second;
 
 	CdBlockStream *rv = new CdBlockStream(*this);
 	rv->AddRef();
 	rv->fID = id;
 	fBlockList.push_back(rv);
+	fBlockIndex[id.Get()] = rv;
 	if (vNextID.Get() < id.Get())
 		vNextID = id.Get() + 1;
 
@@ -48,8 +48,12 @@
 #include "../LZ4/lz4hc.h"
 #include "../LZ4/lz4frame.h"
 
+#include "../ZSTD/zstd.h"
+
 #include <cstring>
 #include <vector>
+#include <list>
+#include <map>
 
 #ifdef COREARRAY_PLATFORM_UNIX
 #  include <sys/types.h>
@@ -73,6 +77,7 @@ namespace CoreArray
 		virtual ssize_t Write(const void *Buffer, ssize_t Count);
 		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
 		virtual void SetSize(SIZE64 NewSize);
+		virtual ssize_t ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count);
 
 		COREARRAY_INLINE TSysHandle Handle() const { return fHandle; }
 
@@ -132,6 +137,37 @@ namespace CoreArray
 	};
 
 
+	/// Read-only file stream with memory mapping
+	/** The whole file is mapped into memory, and reading is copying from the
+	 *  mapped pages, which are shared with other processes via the page
+	 *  cache. It is safe in forked processes without reopening the file.
+	**/
+	class COREARRAY_DLL_DEFAULT CdMMapStream: public CdFileStream
+	{
+	public:
+		CdMMapStream(const char * const AFileName);
+		virtual ~CdMMapStream();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual SIZE64 GetSize();
+		virtual void SetSize(SIZE64 NewSize);
+		virtual const void *MemPtr(SIZE64 Pos, SIZE64 &Count);
+		virtual ssize_t ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count);
+
+		COREARRAY_INLINE const C_UInt8 *Memory() const { return fMemory; }
+
+	protected:
+		C_UInt8 *fMemory;   //< the mapped memory
+		SIZE64 fSize;       //< the size of file
+		SIZE64 fPosition;   //< the current position
+	#ifdef COREARRAY_PLATFORM_WINDOWS
+		HANDLE fMapping;    //< the file-mapping object
+	#endif
+	};
+
+
 	/// Temporary stream, in which a temporary file is created
 	class COREARRAY_DLL_DEFAULT CdTempStream: public CdFileStream
 	{
@@ -253,6 +289,78 @@ namespace CoreArray
 
 
 
+	// =====================================================================
+	// Cache of decompressed blocks
+	// =====================================================================
+
+	/// The LRU cache of decompressed blocks for random access
+	/** The blocks are identified by (stream ID, block index), and the least
+	 *  recently used blocks are discarded if the total size exceeds the
+	 *  memory budget. A block larger than the budget is kept alone. The
+	 *  cache is disabled by default. It has no lock, and it is only used by
+	 *  the thread reading the block streams of a collection, since a reader
+	 *  of CdBlockReadStream has its own cache. **/
+	class COREARRAY_DLL_DEFAULT CdRABlockCache
+	{
+	public:
+		/// the default memory budget in bytes (disabled)
+		static const C_Int64 DEFAULT_MAX_SIZE = 0;
+
+		CdRABlockCache();
+
+		/// return the decompressed block, or NULL if it is not cached
+		const C_UInt8 *Find(C_UInt32 StreamID, C_Int32 BlockIdx);
+		/// add a block, and return the buffer (Size bytes) to be filled
+		C_UInt8 *Add(C_UInt32 StreamID, C_Int32 BlockIdx, ssize_t Size);
+		/// remove a block
+		void Remove(C_UInt32 StreamID, C_Int32 BlockIdx);
+		/// remove all blocks of a stream
+		void Remove(C_UInt32 StreamID);
+		/// remove all blocks
+		void Clear();
+		/// reset the counters of hits and misses
+		void ResetCounter();
+
+		/// set the memory budget, 0 to disable the cache
+		void SetMaxSize(C_Int64 NewSize);
+		/// set the number of blocks decompressed in parallel ahead of
+		///   sequential reading, 0 or 1 to disable read-ahead
+		void SetReadAhead(int NumBlock);
+
+		COREARRAY_INLINE bool Enabled() const { return fMaxSize > 0; }
+		COREARRAY_INLINE int ReadAhead() const { return fReadAhead; }
+		COREARRAY_INLINE C_Int64 MaxSize() const { return fMaxSize; }
+		COREARRAY_INLINE C_Int64 Size() const { return fSize; }
+		COREARRAY_INLINE size_t Count() const { return fMap.size(); }
+		COREARRAY_INLINE C_Int64 HitCount() const { return fHitCount; }
+		COREARRAY_INLINE C_Int64 MissCount() const { return fMissCount; }
+
+	protected:
+		typedef pair<C_UInt32, C_Int32> TKey;
+		struct TItem
+		{
+			TKey Key;
+			vector<C_UInt8> Data;
+		};
+		typedef list<TItem> TList;
+
+		/// the blocks, the most recently used first
+		TList fList;
+		/// the map from a key to an item in fList
+		map<TKey, TList::iterator> fMap;
+		/// the memory budget, the current size in total
+		C_Int64 fMaxSize, fSize;
+		/// the numbers of hits and misses
+		C_Int64 fHitCount, fMissCount;
+		/// the number of blocks decompressed ahead
+		int fReadAhead;
+
+		/// discard the least recently used blocks until fSize <= MaxSize
+		void Shrink(C_Int64 MaxSize);
+	};
+
+
+
 	// =====================================================================
 	// Algorithm of random access
 	// =====================================================================
@@ -295,12 +403,17 @@ namespace CoreArray
 	{
 	public:
 		CdRA_Read(CdRecodeStream *owner);
+		~CdRA_Read();
 
 		/// initialize the stream with magic number and others
 		void InitReadStream();
 		/// seek in the stream, if return true indicates reset deflate algorithm
 		bool SeekStream(SIZE64 Position);
 
+		/// whether the cache or read-ahead of decompressed blocks is used
+		COREARRAY_INLINE bool UseCache() const
+			{ return fCache && (fCache->Enabled() || (fCache->ReadAhead() > 1)); }
+
 	protected:
 		/// the total number of independent compressed block
 		C_Int32 fBlockNum;
@@ -317,14 +430,68 @@ namespace CoreArray
 		/// the start position of block list
 		SIZE64 fBlockListStart;
 
+		/// the starting positions of a compressed block
+		struct TBlockIndex
+		{
+			SIZE64 ZStart;   //< the starting position of compressed block
+			SIZE64 UZStart;  //< the starting position of uncompressed block
+		};
+		/// the positions of blocks which have been visited, built lazily
+		/** fIndexing[i] is the starting position of the i-th block, and
+		 *  fIndexing.back() is the first block whose header is unknown **/
+		vector<TBlockIndex> fIndexing;
+
+		/// the cache of decompressed blocks, NULL if no cache
+		CdRABlockCache *fCache;
+		/// the stream ID used in the cache
+		C_UInt32 fCacheID;
+		/// true, if the decompression state does not match the position
+		bool fNeedReset;
+
+		/// a decompressed block out of the cache
+		struct TBlockBuffer;
+		/// the buffers of the current block and the blocks decompressed
+		///   ahead by the thread pool
+		vector<TBlockBuffer*> fAheadBuf;
+		/// the block index lastly returned by BlockData()
+		C_Int32 fLastBlockIdx;
+
 		/// read the magic number on Stream
 		virtual void ReadMagicNumber(CdStream &Stream) = 0;
+		/// decompress a whole block without changing the stream state,
+		///   it could be called by multiple threads simultaneously
+		virtual void DecodeBlock(const C_UInt8 *ZBuf, ssize_t ZSize,
+			C_UInt8 *Buffer, ssize_t UZSize) const = 0;
 		/// go to the next block
 		bool NextBlock();
+		/// decompress the whole current block to Buffer (fCB_UZSize bytes)
+		void LoadBlock(C_UInt8 *Buffer);
+		/// read data from the position CurPos via the cache or read-ahead
+		ssize_t CacheRead(void *Buffer, ssize_t Count, SIZE64 &CurPos);
+		/// wait for the blocks being decompressed ahead, and free the buffers
+		/** It should be called in the destructor of a derived class, since
+		 *  the worker threads call DecodeBlock() **/
+		void DoneReadAhead();
 
 	private:
 		/// get the header of block
 		void GetBlockHeader();
+		/// go to the block with the index in fIndexing
+		void SetBlockByIndex(size_t Index);
+		/// read the compressed data of current block
+		void ReadBlockZData(vector<C_UInt8> &ZData);
+		/// return the decompressed data of current block
+		const C_UInt8 *BlockData();
+		/// return the buffer of a block in fAheadBuf, or NULL
+		TBlockBuffer *FindAhead(C_Int32 Index);
+		/// return a buffer in fAheadBuf not holding the blocks in [Lo, Hi)
+		TBlockBuffer *FreeAhead(C_Int32 Lo, C_Int32 Hi, size_t MaxCount);
+		/// wait for the decompression of a block in fAheadBuf
+		void WaitAhead(TBlockBuffer *B);
+		/// submit the decompression of the following blocks to the thread
+		///   pool, without waiting
+		void SubmitAhead(int NumBlock);
+		static void AheadDecode(CdThread *Thread, int Index, void *Param);
 	};
 
 	/// The writing algorithm with random access on data stream
@@ -343,6 +510,11 @@ namespace CoreArray
 		/// finalize a compressed block
 		void DoneWriteBlock();
 
+		/// set the number of threads for compressing blocks in parallel
+		void SetNumThread(int NumThread);
+		/// the number of threads for compressing blocks in parallel
+		COREARRAY_INLINE int NumThread() const { return fNumThread; }
+
 	protected:
 		/// the total number of independent compressed block
 		C_Int32 fBlockNum;
@@ -355,8 +527,43 @@ namespace CoreArray
 		/// whether a block is initialized
 		bool fHasInitWriteBlock;
 
+		/// the expected size of compressed block
+		ssize_t fRABlockSize;
+		/// the number of threads, > 1 for compressing blocks in parallel
+		int fNumThread;
+
+		/// an uncompressed block and its compressed data in parallel mode
+		struct TParallelBlock
+		{
+			vector<C_UInt8> Raw;  //< the buffer of uncompressed data
+			ssize_t RawSize;      //< the size of uncompressed data
+			vector<C_UInt8> Out;  //< the compressed data
+		};
+		/// the blocks waiting for compression in parallel mode
+		vector<TParallelBlock> fParBlock;
+		/// the number of blocks in use in fParBlock
+		size_t fParBlockCnt;
+		/// the total sizes of uncompressed and compressed data in parallel mode
+		SIZE64 fParTotalIn, fParTotalOut;
+
 		/// write the magic number on Stream
 		virtual void WriteMagicNumber(CdStream &Stream) = 0;
+		/// compress a whole block independently, called by worker threads
+		virtual void CompressBlock(const C_UInt8 *Raw, ssize_t Size,
+			vector<C_UInt8> &Out) = 0;
+		/// the size of uncompressed block should be a multiple of this value
+		virtual ssize_t RawBlockAlign() const { return 1; }
+
+		/// append data in parallel mode
+		ssize_t ParallelWrite(const void *Buffer, ssize_t Count);
+		/// compress the blocks in parallel, and write them in order
+		void ParallelFlush();
+
+	private:
+		struct TParallelCompress;
+		/// the size of a new uncompressed block in parallel mode
+		ssize_t ParallelRawSize() const;
+		static void ParallelCompress(CdThread *Thread, int Index, void *Param);
 	};
 
 
@@ -440,12 +647,22 @@ namespace CoreArray
 		virtual ssize_t Write(const void *Buffer, ssize_t Count);
 		virtual void Close();
 
+		using CdRA_Write::SetNumThread;
+		using CdRA_Write::NumThread;
+
 	protected:
 		ssize_t fBufferSize;
 		ssize_t fBlockZIPSize, fCurBlockZIPSize;
+		/// the compression level
+		CdRecodeStream::TLevel fLevel;
+		/// the parameter of window size
+		int fWindowBits;
 
 		/// write the magic number
 		virtual void WriteMagicNumber(CdStream &Stream);
+		/// compress a whole block independently
+		virtual void CompressBlock(const C_UInt8 *Raw, ssize_t Size,
+			vector<C_UInt8> &Out);
 		/// finish and close a ZIP compressed block
 		void SyncFinishBlock();
 	};
@@ -457,6 +674,7 @@ namespace CoreArray
 	{
 	public:
 		CdZRA_Inflate(CdStream &Source);
+		virtual ~CdZRA_Inflate();
 
 		virtual ssize_t Read(void *Buffer, ssize_t Count);
 		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
@@ -464,6 +682,9 @@ namespace CoreArray
 	protected:
 		/// read the magic number on Stream
 		virtual void ReadMagicNumber(CdStream &Stream);
+		/// decompress a whole block
+		virtual void DecodeBlock(const C_UInt8 *ZBuf, ssize_t ZSize,
+			C_UInt8 *Buffer, ssize_t UZSize) const;
 	};
 
 
@@ -585,6 +806,9 @@ namespace CoreArray
 		COREARRAY_INLINE bool HaveClosed() const { return fHaveClosed; }
 		COREARRAY_INLINE CdRecodeStream::TLevel Level() const { return fLevel; }
 
+		using CdRA_Write::SetNumThread;
+		using CdRA_Write::NumThread;
+
 		TdCompressRemainder *PtrExtRec;
 
 	protected:
@@ -604,6 +828,11 @@ namespace CoreArray
 
 		/// write the magic number
 		virtual void WriteMagicNumber(CdStream &Stream);
+		/// compress a whole block independently
+		virtual void CompressBlock(const C_UInt8 *Raw, ssize_t Size,
+			vector<C_UInt8> &Out);
+		/// an uncompressed block consists of the chunks of raw buffer
+		virtual ssize_t RawBlockAlign() const { return LZ4RA_RAW_BUFFER_SIZE; }
 		/// compressing
 		void Compressing(int bufsize);
 	};
@@ -614,6 +843,7 @@ namespace CoreArray
 	{
 	public:
 		CdLZ4RA_Inflate(CdStream &Source);
+		virtual ~CdLZ4RA_Inflate();
 
 		virtual ssize_t Read(void *Buffer, ssize_t Count);
 		virtual ssize_t Write(const void *Buffer, ssize_t Count);
@@ -639,6 +869,9 @@ namespace CoreArray
 
 		/// read the magic number on Stream
 		virtual void ReadMagicNumber(CdStream &Stream);
+		/// decompress a whole block
+		virtual void DecodeBlock(const C_UInt8 *ZBuf, ssize_t ZSize,
+			C_UInt8 *Buffer, ssize_t UZSize) const;
 	};
 
 
@@ -658,6 +891,146 @@ namespace CoreArray
 
 
 
+	// =====================================================================
+	// The classes of Zstandard stream
+	// =====================================================================
+
+	/// The wrapper of Zstandard algorithm (http://facebook.github.io/zstd)
+	class COREARRAY_DLL_DEFAULT CdBaseZstdStream: public CdRecodeStream
+	{
+	public:
+		CdBaseZstdStream(CdStream &vStream);
+	};
+
+	/// Compression of Zstandard algorithm
+	class COREARRAY_DLL_DEFAULT CdZstdDeflate: public CdBaseZstdStream
+	{
+	public:
+		CdZstdDeflate(CdStream &Dest, CdRecodeStream::TLevel level);
+		virtual ~CdZstdDeflate();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual void SetSize(SIZE64 NewSize);
+		void Close();
+		int Pending() { return 0; }
+
+		COREARRAY_INLINE CdRecodeStream::TLevel Level() const { return fLevel; }
+		COREARRAY_INLINE bool HaveClosed() const { return fHaveClosed; }
+		TdCompressRemainder *PtrExtRec;
+
+	protected:
+		CdRecodeStream::TLevel fLevel;
+		ZSTD_CStream *fZStream;
+		C_UInt8 *fCompress;
+		ssize_t fCompressSize;
+		bool fHaveClosed;
+
+		void WriteOutput(ZSTD_EndDirective Mode, ZSTD_inBuffer &In);
+	};
+
+	/// Decompression of Zstandard algorithm
+	class COREARRAY_DLL_DEFAULT CdZstdInflate: public CdBaseZstdStream
+	{
+	public:
+		CdZstdInflate(CdStream &Source);
+		virtual ~CdZstdInflate();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual SIZE64 GetSize();
+		virtual void SetSize(SIZE64 NewSize);
+
+	protected:
+		ZSTD_DStream *fZStream;
+		SIZE64 fCurPosition;
+		C_UInt8 fBuffer[16384];  // 2^14, 16K
+		C_UInt8 *fBufPtr, *fBufEnd;
+	};
+
+
+	/// Input stream for Zstandard with the support of random access
+	class COREARRAY_DLL_DEFAULT CdZstdRA_Deflate:
+		protected CdRA_Write, public CdBaseZstdStream
+	{
+	public:
+		CdZstdRA_Deflate(CdStream &Dest, TLevel Level, TBlockSize BlockSize);
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual void SetSize(SIZE64 NewSize);
+		virtual void Close();
+
+		ssize_t Pending() { return 0; }
+		COREARRAY_INLINE bool HaveClosed() const { return fHaveClosed; }
+		COREARRAY_INLINE CdRecodeStream::TLevel Level() const { return fLevel; }
+
+		using CdRA_Write::SetNumThread;
+		using CdRA_Write::NumThread;
+
+		TdCompressRemainder *PtrExtRec;
+
+	protected:
+		/// the compression level
+		CdRecodeStream::TLevel fLevel;
+		bool fHaveClosed;
+
+		/// write the magic number
+		virtual void WriteMagicNumber(CdStream &Stream);
+		/// compress a whole block independently
+		virtual void CompressBlock(const C_UInt8 *Raw, ssize_t Size,
+			vector<C_UInt8> &Out);
+	};
+
+	/// Output stream for Zstandard with the support of random access
+	class COREARRAY_DLL_DEFAULT CdZstdRA_Inflate:
+		protected CdRA_Read, public CdBaseZstdStream
+	{
+	public:
+		CdZstdRA_Inflate(CdStream &Source);
+		virtual ~CdZstdRA_Inflate();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual SIZE64 GetSize();
+		virtual void SetSize(SIZE64 NewSize);
+
+		COREARRAY_INLINE CdRecodeStream::TLevel Level() const { return fLevel; }
+
+	protected:
+		/// the compression level
+		CdRecodeStream::TLevel fLevel;
+		/// the current position
+		SIZE64 fCurPosition;
+
+		/// read the magic number on Stream
+		virtual void ReadMagicNumber(CdStream &Stream);
+		/// decompress a whole block
+		virtual void DecodeBlock(const C_UInt8 *ZBuf, ssize_t ZSize,
+			C_UInt8 *Buffer, ssize_t UZSize) const;
+	};
+
+
+	/// Exception for Zstandard stream
+	class COREARRAY_DLL_EXPORT EZstdError: public ErrStream
+	{
+	public:
+		EZstdError(): ErrStream()
+			{ }
+		EZstdError(const char *fmt, ...): ErrStream()
+			{ _COREARRAY_ERRMACRO_(fmt); }
+		EZstdError(const std::string &msg): ErrStream()
+			{ fMessage = msg; }
+		EZstdError(size_t code)
+			{ fMessage = ZSTD_getErrorName(code); }
+	};
+
+
+
 	// =====================================================================
 	// GDS block stream
 	// =====================================================================
@@ -699,8 +1072,19 @@ namespace CoreArray
 		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
 		virtual SIZE64 GetSize();
 		virtual void SetSize(SIZE64 NewSize);
+		virtual const void *MemPtr(SIZE64 Pos, SIZE64 &Count);
+		virtual ssize_t ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count);
         void SetSizeOnly(SIZE64 NewSize);
 
+		/// Return the block containing Pos, starting from Hint if possible
+		const TBlockInfo *FindBlock(SIZE64 Pos, const TBlockInfo *Hint) const;
+		/// Read at Pos without using the position, thread-safe if read-only
+		/** \param Hint  the block of the last access, updated on return **/
+		ssize_t ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count,
+			const TBlockInfo *&Hint);
+		/// Return a pointer at Pos without using the position
+		const void *MemPtr(SIZE64 Pos, SIZE64 &Count, const TBlockInfo *&Hint);
+
 		void SyncSizeInfo();
 
 		bool ReadOnly() const;
@@ -730,6 +1114,38 @@ namespace CoreArray
 	typedef CdBlockStream::TBlockInfo* PdBlockStream_BlockInfo;
 
 
+	/// Read-only view of a chunk stream with its own position
+	/** Reading is done by positional I/O on the underlying file, and the
+	 *  state of CdBlockStream is not changed. Several views of the same or
+	 *  different chunk streams can be read concurrently in threads, if the
+	 *  GDS file is opened read-only. Each view has a private cache of
+	 *  decompressed blocks, since the cache of CdBlockCollection is shared.
+	**/
+	class COREARRAY_DLL_DEFAULT CdBlockReadStream: public CdStream
+	{
+	public:
+		CdBlockReadStream(CdBlockStream &Stream);
+		virtual ~CdBlockReadStream();
+
+		virtual ssize_t Read(void *Buffer, ssize_t Count);
+		virtual ssize_t Write(const void *Buffer, ssize_t Count);
+		virtual SIZE64 Seek(SIZE64 Offset, TdSysSeekOrg Origin);
+		virtual SIZE64 GetSize();
+		virtual void SetSize(SIZE64 NewSize);
+		virtual const void *MemPtr(SIZE64 Pos, SIZE64 &Count);
+		virtual ssize_t ReadAt(SIZE64 Pos, void *Buffer, ssize_t Count);
+
+		COREARRAY_INLINE CdBlockStream &Stream() const { return *fStream; }
+		COREARRAY_INLINE CdRABlockCache &RACache() { return fRACache; }
+
+	protected:
+		CdBlockStream *fStream;
+		const CdBlockStream::TBlockInfo *fHint;
+		SIZE64 fPosition;
+		CdRABlockCache fRACache;
+	};
+
+
 	/// a collection of stream block
 	class COREARRAY_DLL_DEFAULT CdBlockCollection: public CdAbstract
 	{
@@ -758,24 +1174,61 @@ namespace CoreArray
 			{ return fReadOnly; }
 		COREARRAY_INLINE const vector<CdBlockStream*> &BlockList() const
 			{ return fBlockList; }
+		COREARRAY_INLINE CdRABlockCache &RACache()
+			{ return fRACache; }
 		COREARRAY_INLINE PdBlockStream_BlockInfo const UnusedBlock() const
         	{ return fUnuse; }
 
+		/// the default buffer sizes of objects, 0 for the library defaults
+		COREARRAY_INLINE ssize_t BufSize() const { return fBufSize; }
+		COREARRAY_INLINE ssize_t BufMaxSize() const { return fBufMaxSize; }
+
+		/// Write the table of blocks to the end of stream
+		/** The table is stored in an unused block, and it allows LoadStream
+		 *  to skip the scanning of all block headers. It is removed once the
+		 *  blocks are modified, and it will be ignored if it is not valid.
+		**/
+		void WriteBlockTable();
+		/// Enable or disable writing the table of blocks on synchronization
+		void SetBlockTable(bool Enable);
+		/// whether the table of blocks is written on synchronization
+		COREARRAY_INLINE bool BlockTable() const { return fBlockTable; }
+		/// whether the blocks are loaded from the table of blocks
+		COREARRAY_INLINE bool BlockTableLoaded() const
+			{ return fBlockTableLoaded; }
+
 	protected:
 		CdStream *fStream;
 		SIZE64 fStreamSize;
 		PdBlockStream_BlockInfo fUnuse;
 		vector<CdBlockStream*> fBlockList;
+		/// the index of fBlockList by stream ID
+		map<C_UInt32, CdBlockStream*> fBlockIndex;
 		SIZE64 fCodeStart;
 		CdObjClassMgr *fClassMgr;
 		bool fReadOnly;
+		/// the cache of decompressed blocks shared by the block streams
+		CdRABlockCache fRACache;
+		/// the default buffer sizes for random and sequential reading
+		ssize_t fBufSize, fBufMaxSize;
+		/// whether to write the table of blocks, and whether it was loaded
+		bool fBlockTable, fBlockTableLoaded;
+		/// the size of the table of blocks after fStreamSize, 0 for none
+		SIZE64 fTableSize;
 
 		void _IncStreamSize(CdBlockStream &Block, const SIZE64 NewSize);
 		void _DecStreamSize(CdBlockStream &Block, const SIZE64 NewSize);
 		PdBlockStream_BlockInfo _NeedBlock(SIZE64 Size, bool Head);
+		/// remove the table of blocks from the end of stream
+		void _DropBlockTable();
 
 	private:
 		TdGDSBlockID vNextID;
+
+		bool _LoadBlockTable(vector<PdBlockStream_BlockInfo> &List,
+			vector<TdGDSBlockID> &IDs, vector<TdGDSPos> &Sizes);
+		void _ScanBlocks(vector<PdBlockStream_BlockInfo> &List,
+			vector<TdGDSBlockID> &IDs, vector<TdGDSPos> &Sizes);
 	};
 }
 
@@ -123,6 +123,11 @@ void CdContainer::Caching()
     // do nothing ...
 }
 
+bool CdContainer::PinCache()
+{
+	return false;
+}
+
 SIZE64 CdContainer::GDSStreamSize()
 {
 	return -1;
@@ -694,6 +699,7 @@ static const char *ERR_INV_DIMLEN = "%s: Invalid length of the %d dimension (%d)
 static const char *ERR_INV_DIM_INDEX = "%s: Invalid index of dimentions (%d).";
 static const char *ERR_DIM_INDEX = "Invalid dimension index.";
 static const char *ERR_APPEND_SV = "Invalid 'InSV' in 'CdAllocArray::Append'.";
+static const char *ERR_NEW_READER = "NewReader: the GDS file should be read-only.";
 static const char *ERR_PACKED_MODE = "Invalid packed/compression method '%s'.";
 static const char *ERR_READONLY = "The GDS file is read-only!";
 static const char *ERR_SETELMSIZE = "CdAllocArray::SetElmSize, Invalid parameter.";
@@ -714,6 +720,7 @@ CdAllocArray::CdAllocArray(ssize_t vElmSize): CdAbstractArray()
 	vAllocStream = NULL;
 	vAlloc_Ptr = vCnt_Ptr = 0;
 	fNeedUpdate = false;
+	fBufSize = fBufMaxSize = 0;
 	_OnFlushEvent = NULL;
 }
 
@@ -971,6 +978,7 @@ void CdAllocArray::CloseWriter()
 				fAllocator.Free();
 				vAllocStream->SetPosition(0);
 				fAllocator.Initialize(*vAllocStream, true, false);
+				_InitBuffer();
 
 				if (fPipeInfo)
 					fPipeInfo->PushReadPipe(*fAllocator.BufStream());
@@ -1022,6 +1030,7 @@ void CdAllocArray::SetPackedMode(const char *Mode)
 
 			vAllocStream->SetPosition(0);
 			fAllocator.Initialize(*vAllocStream, true, false);
+			_InitBuffer();
 			if (fPipeInfo)
 				fPipeInfo->PushReadPipe(*fAllocator.BufStream());
 
@@ -1038,6 +1047,7 @@ void CdAllocArray::SetPackedMode(const char *Mode)
 			{
 				vAllocStream->SetPosition(0);
 				fAllocator.Initialize(*vAllocStream, false, true);
+				_InitBuffer();
 				fPipeInfo->PushWritePipe(*fAllocator.BufStream());
 			}
 		}
@@ -1088,6 +1098,23 @@ void CdAllocArray::Caching()
 	}
 }
 
+bool CdAllocArray::PinCache()
+{
+	if (!vAllocStream) return false;
+
+	// the size of data might be not tracked after loading, e.g., strings
+	SIZE64 Size = AllocSize(fTotalCount);
+	if (fPipeInfo)
+	{
+		if (fPipeInfo->StreamTotalIn() > Size)
+			Size = fPipeInfo->StreamTotalIn();
+	} else {
+		if (vAllocStream->GetSize() > Size)
+			Size = vAllocStream->GetSize();
+	}
+	return fAllocator.Pin(Size);
+}
+
 SIZE64 CdAllocArray::GDSStreamSize()
 {
 	if (vAllocStream)
@@ -1097,6 +1124,34 @@ SIZE64 CdAllocArray::GDSStreamSize()
 		return -1;
 }
 
+CdAllocArray *CdAllocArray::NewReader()
+{
+	if (!fGDSStream || !fGDSStream->ReadOnly() || !vAllocStream)
+		throw ErrArray(ERR_NEW_READER);
+
+	CdAllocArray *rv = static_cast<CdAllocArray*>(NewOne());
+	try {
+		TArrayDim DimBuf;
+		GetDim(DimBuf);
+		rv->fElmSize = fElmSize;
+		rv->_ResetDim(DimBuf, DimCnt());
+
+		TdAutoRef<CdBlockReadStream> S(new CdBlockReadStream(*vAllocStream));
+		rv->fAllocator.Initialize(*S, true, false);
+		rv->fBufSize = fBufSize;
+		rv->fBufMaxSize = fBufMaxSize;
+		rv->_InitBuffer();
+		if (rv->fPipeInfo)
+			rv->fPipeInfo->PushReadPipe(*rv->fAllocator.BufStream());
+	}
+	catch (...) {
+		delete rv;
+		throw;
+	}
+	rv->fChanged = rv->fNeedUpdate = false;
+	return rv;
+}
+
 void CdAllocArray::GetOwnBlockStream(vector<const CdBlockStream*> &Out)
 {
 	Out.clear();
@@ -1176,6 +1231,7 @@ void CdAllocArray::Loading(CdReader &Reader, TdVersion Version)
 		vAlloc_Ptr = Reader.PropPosition(VAR_DATA);
 		vAllocStream = fGDSStream->Collection()[vAllocID];
 		fAllocator.Initialize(*vAllocStream, true, !fGDSStream->ReadOnly());
+		_InitBuffer();
 		if (fPipeInfo)
 			fPipeInfo->PushReadPipe(*fAllocator.BufStream());
 	}
@@ -1206,6 +1262,7 @@ void CdAllocArray::Saving(CdWriter &Writer)
 		{
 			vAllocStream = fGDSStream->Collection().NewBlockStream();
 			fAllocator.Initialize(*vAllocStream, true, true);
+			_InitBuffer();
 			if (fPipeInfo)
 				fPipeInfo->PushWritePipe(*fAllocator.BufStream());
 		}
@@ -1353,6 +1410,39 @@ void CdAllocArray::_SetLargeBuffer()
 	}
 }
 
+void CdAllocArray::SetBufSize(ssize_t Size, ssize_t MaxSize)
+{
+	fBufSize = (Size > 0) ? Size : 0;
+	fBufMaxSize = (MaxSize > 0) ? MaxSize : 0;
+	_InitBuffer();
+}
+
+void CdAllocArray::ShrinkBuffer()
+{
+	CdBufStream *Buf = fAllocator.BufStream();
+	if (Buf) Buf->ShrinkBuffer();
+}
+
+void CdAllocArray::UpdateBufSize()
+{
+	_InitBuffer();
+}
+
+void CdAllocArray::_InitBuffer()
+{
+	CdBufStream *Buf = fAllocator.BufStream();
+	if (!Buf) return;
+	ssize_t sz=fBufSize, mx=fBufMaxSize;
+	if (fGDSStream)
+	{
+		CdBlockCollection &C = fGDSStream->Collection();
+		if (sz <= 0) sz = C.BufSize();
+		if (mx <= 0) mx = C.BufMaxSize();
+	}
+	Buf->SetBufSize((sz > 0) ? sz : STREAM_BUFFER_SIZE);
+	Buf->SetBufMaxSize((mx > 0) ? mx : STREAM_BUFFER_MAX_SIZE);
+}
+
 void CdAllocArray::_SetFlushEvent()
 {
 	fAllocator.BufStream()->OnFlush.Set(this, &CdAllocArray::UpdateInfo);
@@ -1388,6 +1478,14 @@ CdArrayRead::CdArrayRead()
 
 CdArrayRead::~CdArrayRead()
 {
+	// the scan is finished
+	CdAllocArray *Obj = dynamic_cast<CdAllocArray*>(fObject);
+	if (Obj)
+	{
+		try {
+			Obj->ShrinkBuffer();
+		} catch (...) { }
+	}
 }
 		
 void CdArrayRead::Init(CdAbstractArray &vObj, int vMargin, C_SVType vSVType,
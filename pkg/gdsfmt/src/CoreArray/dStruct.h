@@ -132,6 +132,8 @@ namespace CoreArray
 
 		/// Cache the data in memory depending on the operating system
 		virtual void Caching();
+		/// Pin the (decompressed) data in the process-wide memory cache
+		virtual bool PinCache();
 
 		/// Get the size of data in the GDS file/stream
 		virtual SIZE64 GDSStreamSize();
@@ -453,6 +455,8 @@ namespace CoreArray
 
 		/// Cache the data in memory depending on the operating system
 		virtual void Caching();
+		/// Pin the (decompressed) data in the process-wide memory cache
+		virtual bool PinCache();
 
 		/// Get the size of data in the GDS file/stream
 		virtual SIZE64 GDSStreamSize();
@@ -460,6 +464,28 @@ namespace CoreArray
 		/// Get a list of CdBlockStream owned by this object, except fGDSStream
 		virtual void GetOwnBlockStream(vector<const CdBlockStream*> &Out);
 
+		/// Create an independent reader of this object for concurrent reading
+		/** The returned object shares the data in the read-only GDS file via
+		 *  positional I/O, with its own buffer and decompression state, so
+		 *  that readers can be used in different threads at the same time.
+		 *  It is not a member of any folder, and should be deleted by the
+		 *  caller.
+		**/
+		CdAllocArray *NewReader();
+
+		/// Set the buffer sizes for random and sequential reading
+		/** \param Size     the buffer size for random access, 0 for the default
+		 *  \param MaxSize  the maximum buffer size grown for sequential
+		 *                  reading, 0 for the default
+		 *  The defaults are given by the GDS file (CdGDSFile::SetBufSize).
+		**/
+		void SetBufSize(ssize_t Size, ssize_t MaxSize);
+		virtual void UpdateBufSize();
+		COREARRAY_INLINE ssize_t BufSize() const { return fBufSize; }
+		COREARRAY_INLINE ssize_t BufMaxSize() const { return fBufMaxSize; }
+		/// Release the buffer grown for sequential reading, after a scan
+		void ShrinkBuffer();
+
 		/// the size of element
 		COREARRAY_FORCEINLINE ssize_t ElmSize() const { return fElmSize; }
 		/// the allocator
@@ -488,6 +514,9 @@ namespace CoreArray
 		/// update a part of data, not all; fChanged -- update all
 		bool fNeedUpdate;
 
+		/// the buffer sizes for random and sequential reading, 0 for default
+		ssize_t fBufSize, fBufMaxSize;
+
 		/// get the size in byte corresponding to the count 'Num'
 		virtual SIZE64 AllocSize(C_Int64 Num);
 
@@ -525,6 +554,8 @@ namespace CoreArray
 		void xDimAuto(int DimIndex);
 		void _SetSmallBuffer();
 		void _SetLargeBuffer();
+		/// apply the buffer sizes to the allocator
+		void _InitBuffer();
 
 		void (*_OnFlushEvent)(CdAllocArray *This, CdBufStream *Sender);
 		void _SetFlushEvent();
@@ -1126,6 +1126,40 @@ COREARRAY_DLL_EXPORT bool plc_WakeUp(PdThreadsSuspending obj)
 	CORECATCH(false);
 }
 
+// thread event object
+
+/// initialize an auto-reset event object
+COREARRAY_DLL_EXPORT PdThreadEvent plc_InitEvent()
+{
+	CORETRY
+		return new CdThreadEvent;
+	CORECATCH(NULL);
+}
+/// destroy the event object
+COREARRAY_DLL_EXPORT bool plc_DoneEvent(PdThreadEvent obj)
+{
+	CORETRY
+		if (obj) delete obj;
+		return true;
+	CORECATCH(false);
+}
+/// signal the event object, and wake up one waiting thread
+COREARRAY_DLL_EXPORT bool plc_SetEvent(PdThreadEvent obj)
+{
+	CORETRY
+		if (obj) obj->Set();
+		return true;
+	CORECATCH(false);
+}
+/// wait until the event object is signaled, then reset it
+COREARRAY_DLL_EXPORT bool plc_WaitEvent(PdThreadEvent obj)
+{
+	CORETRY
+		if (obj) obj->Wait();
+		return true;
+	CORECATCH(false);
+}
+
 
 static CParallelBase _ParallelBase;
 
@@ -255,6 +255,17 @@ extern "C"
 	/// wakeup the thread suspending object
 	extern bool plc_WakeUp(PdThreadsSuspending obj);
 
+	// thread event object
+
+	/// initialize an auto-reset event object
+	extern PdThreadEvent plc_InitEvent();
+	/// destroy the event object
+	extern bool plc_DoneEvent(PdThreadEvent obj);
+	/// signal the event object, and wake up one waiting thread
+	extern bool plc_SetEvent(PdThreadEvent obj);
+	/// wait until the event object is signaled, then reset it
+	extern bool plc_WaitEvent(PdThreadEvent obj);
+
 	/// parallel computing
 	extern bool plc_DoBaseThread(void (*Proc)(PdThread, int, void*),
 		void *param, int nThread);
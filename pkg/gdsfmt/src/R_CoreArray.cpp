@@ -782,6 +782,15 @@ COREARRAY_DLL_EXPORT PdGDSFile GDS_File_Create(const char *FileName)
 COREARRAY_DLL_EXPORT PdGDSFile GDS_File_Open(const char *FileName,
 	C_BOOL ReadOnly, C_BOOL ForkSupport)
 {
+	return GDS_File_OpenEx(FileName, ReadOnly, ForkSupport, false);
+}
+
+COREARRAY_DLL_EXPORT PdGDSFile GDS_File_OpenEx(const char *FileName,
+	C_BOOL ReadOnly, C_BOOL ForkSupport, C_BOOL UseMMap)
+{
+	if (UseMMap && !ReadOnly)
+		throw ErrGDSFmt("Memory mapping requires read-only mode.");
+
 	// to register CoreArray classes and objects
 	RegisterClass();
 
@@ -790,7 +799,9 @@ COREARRAY_DLL_EXPORT PdGDSFile GDS_File_Open(const char *FileName,
 
 	try {
 		file = new CdGDSFile;
-		if (!ForkSupport)
+		if (UseMMap)
+			file->LoadFileMMap(FileName);
+		else if (!ForkSupport)
 			file->LoadFile(FileName, ReadOnly);
 		else
 			file->LoadFileFork(FileName, ReadOnly);
@@ -847,6 +858,12 @@ COREARRAY_DLL_EXPORT void GDS_File_Sync(PdGDSFile File)
 	File->SyncFile();
 }
 
+COREARRAY_DLL_EXPORT void GDS_File_SetBufSize(PdGDSFile File, C_Int64 Size,
+	C_Int64 MaxSize)
+{
+	File->SetBufSize(Size, MaxSize);
+}
+
 COREARRAY_DLL_EXPORT PdGDSFolder GDS_File_Root(PdGDSFile File)
 {
 	return &File->Root();
@@ -959,6 +976,28 @@ COREARRAY_DLL_EXPORT void GDS_Array_AppendString(PdAbstractArray Obj,
 	Obj->Append(&val, 1, svStrUTF8);
 }
 
+COREARRAY_DLL_EXPORT void GDS_Array_SetBufSize(PdAbstractArray Obj,
+	C_Int64 Size, C_Int64 MaxSize)
+{
+	CdAllocArray *Ar = dynamic_cast<CdAllocArray*>(Obj);
+	if (!Ar)
+		throw ErrGDSFmt("The GDS node does not support stream buffers.");
+	Ar->SetBufSize(Size, MaxSize);
+}
+
+COREARRAY_DLL_EXPORT PdAbstractArray GDS_Array_NewReader(PdAbstractArray Obj)
+{
+	CdAllocArray *Ar = dynamic_cast<CdAllocArray*>(Obj);
+	if (!Ar)
+		throw ErrGDSFmt("The GDS node does not support independent readers.");
+	return Ar->NewReader();
+}
+
+COREARRAY_DLL_EXPORT void GDS_Array_FreeReader(PdAbstractArray Reader)
+{
+	delete Reader;
+}
+
 
 // ===========================================================================
 // Functions for CdContainer - CdIterator
@@ -1117,6 +1156,14 @@ COREARRAY_DLL_EXPORT void GDS_Parallel_RunThreads(
 	R_CoreArray_ParallelBase.RunThreads((CParallelBase::TProc)Proc, Param);
 }
 
+COREARRAY_DLL_EXPORT void GDS_Parallel_RunRange(
+	void (*Proc)(C_Int64, C_Int64, int, void*), void *Param,
+	C_Int64 Total, C_Int64 Grain, int nThread)
+{
+	R_CoreArray_ParallelBase.SetNumThread(nThread);
+	R_CoreArray_ParallelBase.RunRange(Proc, Total, Grain, Param);
+}
+
 
 // ===========================================================================
 /// functions for machine
@@ -1200,8 +1247,10 @@ void R_init_gdsfmt(DllInfo *info)
 	// functions for file structure
 	REG(GDS_File_Create);
 	REG(GDS_File_Open);
+	REG(GDS_File_OpenEx);
 	REG(GDS_File_Close);
 	REG(GDS_File_Sync);
+	REG(GDS_File_SetBufSize);
 	REG(GDS_File_Root);
 
 	REG(GDS_Node_File);
@@ -1224,6 +1273,9 @@ void R_init_gdsfmt(DllInfo *info)
 	REG(GDS_Array_WriteData);
 	REG(GDS_Array_AppendData);
 	REG(GDS_Array_AppendString);
+	REG(GDS_Array_SetBufSize);
+	REG(GDS_Array_NewReader);
+	REG(GDS_Array_FreeReader);
 
 	// functions for CdIterator
 	REG(GDS_Iter_GetStart);
@@ -1253,6 +1305,7 @@ void R_init_gdsfmt(DllInfo *info)
 	REG(GDS_Parallel_Suspend);
 	REG(GDS_Parallel_WakeUp);
 	REG(GDS_Parallel_RunThreads);
+	REG(GDS_Parallel_RunRange);
 
 	// functions for machine
 	REG(GDS_Mach_GetNumOfCores);
@@ -294,6 +294,7 @@ COREARRAY_DLL_EXPORT SEXP gdsCreateGDS(SEXP FileName, SEXP AllowDup)
  *  \param ReadOnly    [in] if TRUE, read-only
  *  \param AllowDup    [in] allow duplicate file
  *  \param AllowFork   [in] allow opening in a forked process
+ *  \param UseMMap     [in] map the file into memory (read-only)
  *  \return
  *    $filename    the file name to be created
  *    $id          ID of GDS file, internal use
@@ -301,7 +302,7 @@ COREARRAY_DLL_EXPORT SEXP gdsCreateGDS(SEXP FileName, SEXP AllowDup)
  *    $readonly	   whether it is read-only or not
 **/
 COREARRAY_DLL_EXPORT SEXP gdsOpenGDS(SEXP FileName, SEXP ReadOnly,
-	SEXP AllowDup, SEXP AllowFork)
+	SEXP AllowDup, SEXP AllowFork, SEXP UseMMap)
 {
 	const char *fn = CHAR(STRING_ELT(FileName, 0));
 
@@ -317,6 +318,12 @@ COREARRAY_DLL_EXPORT SEXP gdsOpenGDS(SEXP FileName, SEXP ReadOnly,
 	if (allow_fork == NA_LOGICAL)
 		error("'allow.fork' must be TRUE or FALSE.");
 
+	int use_mmap = asLogical(UseMMap);
+	if (use_mmap == NA_LOGICAL)
+		error("'use.mmap' must be TRUE or FALSE.");
+	if (use_mmap && !readonly)
+		error("'use.mmap=TRUE' requires 'readonly=TRUE'.");
+
 	COREARRAY_TRY
 
 		if (!allow_dup)
@@ -335,7 +342,8 @@ COREARRAY_DLL_EXPORT SEXP gdsOpenGDS(SEXP FileName, SEXP ReadOnly,
 			}
 		}
 
-		CdGDSFile *file = GDS_File_Open(fn, readonly, allow_fork);
+		CdGDSFile *file = GDS_File_OpenEx(fn, readonly, allow_fork,
+			use_mmap);
 		PROTECT(rv_ans = NEW_LIST(4));
 			SET_ELEMENT(rv_ans, 0, FileName);
 			SET_ELEMENT(rv_ans, 1, ScalarInteger(GetFileIndex(file)));
@@ -532,6 +540,145 @@ COREARRAY_DLL_EXPORT SEXP gdsDiagInfo(SEXP gds_id)
 }
 
 
+/// get or set the cache of decompressed blocks
+/** \param gds_id      [in] the internal file id
+ *  \param MaxSize     [in] the memory budget in bytes, or NULL (unchanged)
+ *  \param Reset       [in] if TRUE, reset the counters of hits and misses
+ *  \param ReadAhead   [in] the number of blocks decompressed in parallel
+ *                          ahead of sequential reading, or NULL (unchanged)
+**/
+COREARRAY_DLL_EXPORT SEXP gdsBlockCache(SEXP gds_id, SEXP MaxSize,
+	SEXP Reset, SEXP ReadAhead)
+{
+	int reset_flag = asLogical(Reset);
+	if (reset_flag == NA_LOGICAL)
+		error("'reset' must be TRUE or FALSE.");
+
+	COREARRAY_TRY
+
+		CdGDSFile *tmp = GDS_ID_2_GDS_File(gds_id);
+		CdRABlockCache &Cache = ((CdBlockCollection*)tmp)->RACache();
+
+		if (!Rf_isNull(MaxSize))
+		{
+			double sz = Rf_asReal(MaxSize);
+			if (!R_FINITE(sz) || (sz < 0))
+				throw ErrGDSFmt("'max.size' should be a non-negative number.");
+			Cache.SetMaxSize((C_Int64)sz);
+		}
+		if (!Rf_isNull(ReadAhead))
+		{
+			int n = Rf_asInteger(ReadAhead);
+			if ((n == NA_INTEGER) || (n < 0))
+				throw ErrGDSFmt("'readahead' should be a non-negative integer.");
+			Cache.SetReadAhead(n);
+		}
+		if (reset_flag == TRUE)
+			Cache.ResetCounter();
+
+		PROTECT(rv_ans = NEW_LIST(6));
+		SEXP nm = PROTECT(NEW_CHARACTER(6));
+		SET_NAMES(rv_ans, nm);
+
+		SET_ELEMENT(rv_ans, 0, ScalarReal(Cache.MaxSize()));
+		SET_STRING_ELT(nm, 0, mkChar("max.size"));
+		SET_ELEMENT(rv_ans, 1, ScalarReal(Cache.Size()));
+		SET_STRING_ELT(nm, 1, mkChar("size"));
+		SET_ELEMENT(rv_ans, 2, ScalarInteger(Cache.Count()));
+		SET_STRING_ELT(nm, 2, mkChar("num.block"));
+		SET_ELEMENT(rv_ans, 3, ScalarReal(Cache.HitCount()));
+		SET_STRING_ELT(nm, 3, mkChar("hit"));
+		SET_ELEMENT(rv_ans, 4, ScalarReal(Cache.MissCount()));
+		SET_STRING_ELT(nm, 4, mkChar("miss"));
+		SET_ELEMENT(rv_ans, 5, ScalarInteger(Cache.ReadAhead()));
+		SET_STRING_ELT(nm, 5, mkChar("readahead"));
+
+		UNPROTECT(2);
+
+	COREARRAY_CATCH
+}
+
+
+/// get or set the default stream buffer sizes of a GDS file
+/** \param gds_id      [in] the internal file id
+ *  \param Size        [in] the buffer size for random access, or NULL
+ *  \param MaxSize     [in] the maximum buffer size grown for sequential
+ *                          reading, or NULL
+**/
+COREARRAY_DLL_EXPORT SEXP gdsBufSizeGDS(SEXP gds_id, SEXP Size, SEXP MaxSize)
+{
+	COREARRAY_TRY
+
+		CdGDSFile *tmp = GDS_ID_2_GDS_File(gds_id);
+		ssize_t sz = tmp->BufSize(), mx = tmp->BufMaxSize();
+		if (!Rf_isNull(Size) || !Rf_isNull(MaxSize))
+		{
+			if (!Rf_isNull(Size))
+			{
+				double v = Rf_asReal(Size);
+				if (!R_FINITE(v) || (v < 0))
+					throw ErrGDSFmt("'size' should be a non-negative number.");
+				sz = (ssize_t)v;
+			}
+			if (!Rf_isNull(MaxSize))
+			{
+				double v = Rf_asReal(MaxSize);
+				if (!R_FINITE(v) || (v < 0))
+					throw ErrGDSFmt("'max.size' should be a non-negative number.");
+				mx = (ssize_t)v;
+			}
+			tmp->SetBufSize(sz, mx);
+		}
+
+		PROTECT(rv_ans = NEW_LIST(2));
+		SEXP nm = PROTECT(NEW_CHARACTER(2));
+		SET_NAMES(rv_ans, nm);
+		SET_ELEMENT(rv_ans, 0, ScalarReal((sz > 0) ? sz : STREAM_BUFFER_SIZE));
+		SET_STRING_ELT(nm, 0, mkChar("size"));
+		SET_ELEMENT(rv_ans, 1,
+			ScalarReal((mx > 0) ? mx : STREAM_BUFFER_MAX_SIZE));
+		SET_STRING_ELT(nm, 1, mkChar("max.size"));
+		UNPROTECT(2);
+
+	COREARRAY_CATCH
+}
+
+
+
+/// get or set whether a table of blocks is written to a GDS file
+/** \param gds_id      [in] the internal file id
+ *  \param Enable      [in] TRUE or FALSE, or NULL (unchanged)
+**/
+COREARRAY_DLL_EXPORT SEXP gdsBlockTable(SEXP gds_id, SEXP Enable)
+{
+	COREARRAY_TRY
+
+		CdGDSFile *tmp = GDS_ID_2_GDS_File(gds_id);
+		CdBlockCollection *Collection = (CdBlockCollection*)tmp;
+
+		if (!Rf_isNull(Enable))
+		{
+			int flag = Rf_asLogical(Enable);
+			if (flag == NA_LOGICAL)
+				throw ErrGDSFmt("'enable' must be TRUE or FALSE.");
+			if (tmp->ReadOnly())
+				throw ErrGDSFmt("The GDS file is read-only.");
+			Collection->SetBlockTable(flag == TRUE);
+		}
+
+		PROTECT(rv_ans = NEW_LIST(2));
+		SEXP nm = PROTECT(NEW_CHARACTER(2));
+		SET_NAMES(rv_ans, nm);
+		SET_ELEMENT(rv_ans, 0, ScalarLogical(Collection->BlockTable()));
+		SET_STRING_ELT(nm, 0, mkChar("enable"));
+		SET_ELEMENT(rv_ans, 1, ScalarLogical(Collection->BlockTableLoaded()));
+		SET_STRING_ELT(nm, 1, mkChar("loaded"));
+		UNPROTECT(2);
+
+	COREARRAY_CATCH
+}
+
+
 
 // ----------------------------------------------------------------------------
 // File Structure Operations
@@ -1465,6 +1612,13 @@ COREARRAY_DLL_EXPORT SEXP gdsDeleteAttr(SEXP Node, SEXP Name)
 // Data Operations
 // ----------------------------------------------------------------------------
 
+/// release the stream buffer grown when reading the node
+static void _ShrinkBuffer(PdAbstractArray Obj)
+{
+	CdAllocArray *Ar = dynamic_cast<CdAllocArray*>(Obj);
+	if (Ar) Ar->ShrinkBuffer();
+}
+
 /// read data from a node
 /** \param Node        [in] a GDS node
  *  \param Start       [in] the starting position
@@ -1539,6 +1693,7 @@ COREARRAY_DLL_EXPORT SEXP gdsObjReadData(SEXP Node, SEXP Start, SEXP Count,
 	COREARRAY_TRY
 		rv_ans = GDS_R_Array_Read(Obj, pDS, pDL, NULL,
 			(use_raw_flag ? GDS_R_READ_ALLOW_RAW_TYPE : 0));
+		_ShrinkBuffer(Obj);
 	CORE_CATCH(has_error = true);
 	if (has_error) error(GDS_GetError());
 
@@ -1636,6 +1791,7 @@ COREARRAY_DLL_EXPORT SEXP gdsObjReadExData(SEXP Node, SEXP Selection,
 		// read data
 		rv_ans = GDS_R_Array_Read(_Obj, NULL, NULL, &(SelList[0]),
 			(use_raw_flag ? GDS_R_READ_ALLOW_RAW_TYPE : 0));
+		_ShrinkBuffer(_Obj);
 
 		// to simplify
 		if (strcmp(simplify_text, "auto") == 0)
@@ -2122,9 +2278,14 @@ COREARRAY_DLL_EXPORT SEXP gdsObjCompressClose(SEXP Node)
 
 /// Caching the data associated with a GDS variable
 /** \param node        [in] a GDS node
+ *  \param Pin         [in] if TRUE, pin the data in memory
 **/
-COREARRAY_DLL_EXPORT SEXP gdsCache(SEXP Node)
+COREARRAY_DLL_EXPORT SEXP gdsCache(SEXP Node, SEXP Pin)
 {
+	int pin_flag = asLogical(Pin);
+	if (pin_flag == NA_LOGICAL)
+		error("'pin' must be TRUE or FALSE.");
+
 	COREARRAY_TRY
 
 		PdGDSObj Obj = GDS_R_SEXP2Obj(Node);
@@ -2132,7 +2293,18 @@ COREARRAY_DLL_EXPORT SEXP gdsCache(SEXP Node)
 
 		if (dynamic_cast<CdContainer*>(Obj))
 		{
-			static_cast<CdContainer*>(Obj)->Caching();
+			CdContainer *Ct = static_cast<CdContainer*>(Obj);
+			if (pin_flag == TRUE)
+			{
+				if (!Ct->PinCache())
+				{
+					warning("The data of the GDS node are not pinned in memory "
+						"(not readable, or exceeding the memory budget, "
+						"see 'pincache.gds').");
+					Ct->Caching();
+				}
+			} else
+				Ct->Caching();
 		} else
 			warning("The GDS node does not support caching.");
 
@@ -2140,6 +2312,98 @@ COREARRAY_DLL_EXPORT SEXP gdsCache(SEXP Node)
 }
 
 
+/// get or set the memory budget of pinned data
+/** \param MaxSize     [in] the memory budget in bytes, or NULL (unchanged)
+ *  \param Clear       [in] if TRUE, release all pinned data
+**/
+COREARRAY_DLL_EXPORT SEXP gdsPinCache(SEXP MaxSize, SEXP Clear)
+{
+	int clear_flag = asLogical(Clear);
+	if (clear_flag == NA_LOGICAL)
+		error("'clear' must be TRUE or FALSE.");
+
+	COREARRAY_TRY
+
+		if (!Rf_isNull(MaxSize))
+		{
+			double sz = Rf_asReal(MaxSize);
+			if (!R_FINITE(sz) || (sz < 0))
+				throw ErrGDSFmt("'max.size' should be a non-negative number.");
+			dAllocPinCache.SetMaxSize((C_Int64)sz);
+		}
+		if (clear_flag == TRUE)
+			dAllocPinCache.Clear();
+
+		PROTECT(rv_ans = NEW_LIST(3));
+		SEXP nm = PROTECT(NEW_CHARACTER(3));
+		SET_NAMES(rv_ans, nm);
+
+		SET_ELEMENT(rv_ans, 0, ScalarReal(dAllocPinCache.MaxSize()));
+		SET_STRING_ELT(nm, 0, mkChar("max.size"));
+		SET_ELEMENT(rv_ans, 1, ScalarReal(dAllocPinCache.Size()));
+		SET_STRING_ELT(nm, 1, mkChar("size"));
+		SET_ELEMENT(rv_ans, 2, ScalarInteger(dAllocPinCache.Count()));
+		SET_STRING_ELT(nm, 2, mkChar("num.node"));
+
+		UNPROTECT(2);
+
+	COREARRAY_CATCH
+}
+
+
+/// get or set the stream buffer sizes of a GDS variable
+/** \param Node        [in] a GDS node
+ *  \param Size        [in] the buffer size for random access, or NULL
+ *  \param MaxSize     [in] the maximum buffer size grown for sequential
+ *                          reading, or NULL
+**/
+COREARRAY_DLL_EXPORT SEXP gdsBufSizeNode(SEXP Node, SEXP Size, SEXP MaxSize)
+{
+	COREARRAY_TRY
+
+		PdGDSObj Obj = GDS_R_SEXP2Obj(Node);
+		GDS_R_NodeValid(Obj, TRUE);
+
+		CdAllocArray *Ar = dynamic_cast<CdAllocArray*>(Obj);
+		if (!Ar)
+			throw ErrGDSFmt("The GDS node does not support stream buffers.");
+
+		if (!Rf_isNull(Size) || !Rf_isNull(MaxSize))
+		{
+			ssize_t sz = Ar->BufSize(), mx = Ar->BufMaxSize();
+			if (!Rf_isNull(Size))
+			{
+				double v = Rf_asReal(Size);
+				if (!R_FINITE(v) || (v < 0))
+					throw ErrGDSFmt("'size' should be a non-negative number.");
+				sz = (ssize_t)v;
+			}
+			if (!Rf_isNull(MaxSize))
+			{
+				double v = Rf_asReal(MaxSize);
+				if (!R_FINITE(v) || (v < 0))
+					throw ErrGDSFmt("'max.size' should be a non-negative number.");
+				mx = (ssize_t)v;
+			}
+			Ar->SetBufSize(sz, mx);
+		}
+
+		CdBufStream *Buf = Ar->Allocator().BufStream();
+		PROTECT(rv_ans = NEW_LIST(3));
+		SEXP nm = PROTECT(NEW_CHARACTER(3));
+		SET_NAMES(rv_ans, nm);
+		SET_ELEMENT(rv_ans, 0, ScalarReal(Buf ? Buf->BufSize() : 0));
+		SET_STRING_ELT(nm, 0, mkChar("size"));
+		SET_ELEMENT(rv_ans, 1, ScalarReal(Buf ? Buf->BufMaxSize() : 0));
+		SET_STRING_ELT(nm, 1, mkChar("max.size"));
+		SET_ELEMENT(rv_ans, 2, ScalarReal(Buf ? Buf->BufCurSize() : 0));
+		SET_STRING_ELT(nm, 2, mkChar("current"));
+		UNPROTECT(2);
+
+	COREARRAY_CATCH
+}
+
+
 /// Caching the data associated with a GDS variable
 /** \param Node        [in] a GDS node
  *  \param NewNode     [in] the node of a new location
@@ -3113,4 +3377,308 @@ COREARRAY_DLL_EXPORT SEXP gds_test_Class(SEXP ClassName)
 	COREARRAY_CATCH
 }
 
+
+/// the parameters of gds_test_ThreadPool
+struct COREARRAY_DLL_LOCAL TTestThreadPool
+{
+	int ThrowIndex;      ///< the thread throwing an exception
+	vector<int> Count;   ///< the number of calls for each thread
+};
+
+static void _test_ThreadPool(CdThread *Thread, int Index, void *Param)
+{
+	TTestThreadPool *P = (TTestThreadPool*)Param;
+	// keep the workers busy, so they are still running when the calling
+	// thread throws
+	volatile double s = 0;
+	for (int i=0; i < 2000000*Index; i++) s += i;
+	P->Count[Index] ++;
+	if (Index == P->ThrowIndex)
+		throw ErrGDSFmt("Thread %d fails.", Index);
+}
+
+/// run the thread pool with a job throwing an exception
+/** \param NumThread   [in] the number of threads
+ *  \param ThrowIndex  [in] the thread throwing an exception, or -1 for none
+**/
+COREARRAY_DLL_EXPORT SEXP gds_test_ThreadPool(SEXP NumThread, SEXP ThrowIndex)
+{
+	int nThread = Rf_asInteger(NumThread);
+	int ThrowIdx = Rf_asInteger(ThrowIndex);
+
+	COREARRAY_TRY
+
+		CoreArray::Parallel::CParallelBase Base(nThread);
+		TTestThreadPool P;
+		P.ThrowIndex = ThrowIdx;
+		P.Count.resize(nThread, 0);
+		Base.RunThreads(_test_ThreadPool, &P);
+
+		PROTECT(rv_ans = NEW_INTEGER(nThread));
+		for (int i=0; i < nThread; i++)
+			INTEGER(rv_ans)[i] = P.Count[i];
+		UNPROTECT(1);
+
+	COREARRAY_CATCH
+}
+
+
+/// the tasks of gds_test_Grain
+class COREARRAY_DLL_LOCAL CTestGrain
+{
+public:
+	vector<int> Range;  ///< the number of calls for each task by RunRange
+	vector<int> Sect;   ///< the output of CParallelSection
+	vector<int> Queue;  ///< the number of correct outputs of CParallelQueue
+	C_Int64 Grain;      ///< the grain size
+	int nOverGrain;     ///< the number of blocks larger than Grain
+
+	void SectProc(const C_Int64 &i, int &out) { out = i + 1; }
+	void QueueProc(const C_Int64 &i, int &out) { out = i + 1; }
+	void QueueFunc(const C_Int64 &i, int *buf, size_t n)
+	{
+		for (size_t k=0; k < n; k++)
+			Queue[i + k] += (buf[k] == i + (C_Int64)k + 1) ? 1 : 0;
+	}
+};
+
+static void _test_Grain(C_Int64 Start, C_Int64 Count, int Index, void *Param)
+{
+	CTestGrain *P = (CTestGrain*)Param;
+	if (Count > P->Grain) P->nOverGrain ++;
+	for (C_Int64 i=Start; i < Start+Count; i++)
+		P->Range[i] ++;
+}
+
+/// run the tasks with a grain size
+/** \param Total       [in] the number of tasks
+ *  \param Grain       [in] the grain size
+ *  \param NumThread   [in] the number of threads
+ *  \return a Total-by-3 matrix: the number of calls for each task by
+ *          RunRange, the output of CParallelSection, and the number of
+ *          correct outputs of CParallelQueue
+**/
+COREARRAY_DLL_EXPORT SEXP gds_test_Grain(SEXP Total, SEXP Grain, SEXP NumThread)
+{
+	int nTotal = Rf_asInteger(Total);
+	int nGrain = Rf_asInteger(Grain);
+	int nThread = Rf_asInteger(NumThread);
+
+	COREARRAY_TRY
+
+		CTestGrain P;
+		P.Range.resize(nTotal, 0);
+		P.Sect.resize(nTotal, 0);
+		P.Queue.resize(nTotal, 0);
+		P.Grain = nGrain;
+		P.nOverGrain = 0;
+
+		CoreArray::Parallel::CParallelBase Base(nThread);
+		Base.RunRange(_test_Grain, nTotal, nGrain, &P);
+		if ((nThread > 1) && (P.nOverGrain > 0))
+			throw ErrGDSFmt("A block is larger than the grain size.");
+
+		CoreArray::Parallel::CParallelSection Sect(nThread);
+		Sect.SetGrain(nGrain);
+		Sect.RunThreads(nTotal, &CTestGrain::SectProc, &P, &P.Sect[0],
+			(C_Int64)0);
+
+		CoreArray::Parallel::CParallelQueue Queue(nThread);
+		Queue.SetGrain(nGrain);
+		Queue.RunThreads(nTotal, 7, &CTestGrain::QueueProc,
+			&CTestGrain::QueueFunc, &P, (C_Int64)0);
+
+		PROTECT(rv_ans = Rf_allocMatrix(INTSXP, nTotal, 3));
+		int *p = INTEGER(rv_ans);
+		for (int i=0; i < nTotal; i++)
+		{
+			p[i] = P.Range[i];
+			p[i + nTotal] = P.Sect[i];
+			p[i + 2*nTotal] = P.Queue[i];
+		}
+		UNPROTECT(1);
+
+	COREARRAY_CATCH
+}
+
+
+/// the parameters of gds_test_Reader
+struct COREARRAY_DLL_LOCAL TTestReader
+{
+	PdAbstractArray Obj;       ///< the array
+	vector<C_Int32> Dim;       ///< the dimension
+	C_Int64 SliceSize;         ///< the number of elements in a slice
+	int NumThread;             ///< the number of threads
+	double *Out;               ///< the output
+};
+
+static void _test_Reader(CdThread *Thread, int Index, void *Param)
+{
+	TTestReader *P = (TTestReader*)Param;
+	PdAbstractArray Reader = GDS_Array_NewReader(P->Obj);
+	try {
+		// the slices of the first dimension are interleaved among threads
+		vector<C_Int32> Start(P->Dim.size(), 0), Len(P->Dim);
+		Len[0] = 1;
+		for (C_Int32 i=Index; i < P->Dim[0]; i += P->NumThread)
+		{
+			Start[0] = i;
+			GDS_Array_ReadData(Reader, &Start[0], &Len[0],
+				P->Out + i*P->SliceSize, svFloat64);
+		}
+	}
+	catch (...) {
+		GDS_Array_FreeReader(Reader);
+		throw;
+	}
+	GDS_Array_FreeReader(Reader);
+}
+
+/// read a numeric array with independent readers in multiple threads
+/** \param Node        [in] the GDS node in a read-only GDS file
+ *  \param NumThread   [in] the number of threads
+**/
+COREARRAY_DLL_EXPORT SEXP gds_test_Reader(SEXP Node, SEXP NumThread)
+{
+	int nThread = Rf_asInteger(NumThread);
+
+	COREARRAY_TRY
+
+		GDS_R_NodeValid_SEXP(Node, TRUE);
+		PdAbstractArray Obj =
+			dynamic_cast<CdAbstractArray*>(GDS_R_SEXP2Obj(Node));
+		if (Obj == NULL)
+			throw ErrGDSFmt("There is no data field.");
+		if (!COREARRAY_SV_NUMERIC(GDS_Array_GetSVType(Obj)))
+			throw ErrGDSFmt("Only numeric data are supported.");
+
+		TTestReader P;
+		P.Obj = Obj;
+		P.Dim.resize(GDS_Array_DimCnt(Obj));
+		GDS_Array_GetDim(Obj, &P.Dim[0], P.Dim.size());
+		P.SliceSize = 1;
+		for (size_t i=1; i < P.Dim.size(); i++)
+			P.SliceSize *= P.Dim[i];
+		P.NumThread = nThread;
+
+		PROTECT(rv_ans = NEW_NUMERIC(GDS_Array_GetTotalCount(Obj)));
+		P.Out = REAL(rv_ans);
+		CoreArray::Parallel::CParallelBase Base(nThread);
+		Base.RunThreads(_test_Reader, &P);
+		UNPROTECT(1);
+
+	COREARRAY_CATCH
+}
+
+
+/// read a vector through the given memory type
+/** \param Node        [in] a one-dimensional GDS node
+ *  \param Start       [in] the starting position (from one)
+ *  \param Count       [in] the number of elements
+ *  \param Sel         [in] NULL, or a logical vector of length `Count'
+ *  \param Type        [in] "uint8", "int32" or "float64"
+**/
+COREARRAY_DLL_EXPORT SEXP gds_test_ReadAs(SEXP Node, SEXP Start, SEXP Count,
+	SEXP Sel, SEXP Type)
+{
+	C_Int32 st = Rf_asInteger(Start) - 1;
+	C_Int32 cnt = Rf_asInteger(Count);
+	const char *tn = CHAR(STRING_ELT(Type, 0));
+
+	COREARRAY_TRY
+
+		GDS_R_NodeValid_SEXP(Node, TRUE);
+		CdAbstractArray *Obj =
+			dynamic_cast<CdAbstractArray*>(GDS_R_SEXP2Obj(Node));
+		if ((Obj == NULL) || (Obj->DimCnt() != 1))
+			throw ErrGDSFmt("There is no one-dimensional data field.");
+		if ((st < 0) || (cnt < 0) || (st+cnt > Obj->GetDLen(0)))
+			throw ErrGDSFmt("Invalid `start' or `count'.");
+
+		const C_BOOL *sel = NULL;
+		vector<C_BOOL> sel_buf;
+		size_t n = cnt;
+		if (!Rf_isNull(Sel))
+		{
+			if (XLENGTH(Sel) != cnt)
+				throw ErrGDSFmt("Invalid length of `sel'.");
+			sel_buf.resize(cnt);
+			n = 0;
+			for (C_Int32 i=0; i < cnt; i++)
+				if ((sel_buf[i] = (LOGICAL(Sel)[i] == TRUE))) n ++;
+			sel = cnt ? &sel_buf[0] : NULL;
+		}
+
+		C_SVType sv;
+		size_t sz;
+		if (strcmp(tn, "uint8") == 0)
+			{ sv = svUInt8; sz = sizeof(C_UInt8); }
+		else if (strcmp(tn, "int32") == 0)
+			{ sv = svInt32; sz = sizeof(C_Int32); }
+		else if (strcmp(tn, "float64") == 0)
+			{ sv = svFloat64; sz = sizeof(C_Float64); }
+		else
+			throw ErrGDSFmt("Invalid `type'.");
+
+		// one guard element after the output to catch overruns
+		vector<C_UInt8> buf((n + 1) * sz, 0xA5);
+		if (sel)
+			Obj->ReadDataEx(&st, &cnt, &sel, &buf[0], sv);
+		else
+			Obj->ReadData(&st, &cnt, &buf[0], sv);
+		for (size_t i=n*sz; i < buf.size(); i++)
+		{
+			if (buf[i] != 0xA5)
+				throw ErrGDSFmt("The output buffer is overrun.");
+		}
+
+		PROTECT(rv_ans = NEW_NUMERIC(n));
+		double *p = REAL(rv_ans);
+		for (size_t i=0; i < n; i++)
+		{
+			switch (sv)
+			{
+				case svUInt8:
+					p[i] = ((C_UInt8*)&buf[0])[i]; break;
+				case svInt32:
+					p[i] = ((C_Int32*)&buf[0])[i]; break;
+				default:
+					p[i] = ((C_Float64*)&buf[0])[i];
+			}
+		}
+		UNPROTECT(1);
+
+	COREARRAY_CATCH
+}
+
+
+/// rename an attribute of a GDS node
+/** \param Node        [in] a GDS node
+ *  \param Name        [in] the old name, or the index (from one)
+ *  \param NewName     [in] the new name
+**/
+COREARRAY_DLL_EXPORT SEXP gds_test_RenameAttr(SEXP Node, SEXP Name,
+	SEXP NewName)
+{
+	const char *nm = translateCharUTF8(STRING_ELT(NewName, 0));
+
+	COREARRAY_TRY
+
+		PdGDSObj Obj = GDS_R_SEXP2Obj(Node);
+		GDS_R_NodeValid(Obj, FALSE);
+		if (Rf_isString(Name))
+		{
+			Obj->Attribute().SetName(
+				UTF16Text(translateCharUTF8(STRING_ELT(Name, 0))),
+				UTF16Text(nm));
+		} else {
+			int idx = Rf_asInteger(Name);
+			if ((idx < 1) || (idx > (int)Obj->Attribute().Count()))
+				throw ErrGDSFmt("Invalid index of attribute (%d).", idx);
+			Obj->Attribute().SetName(idx - 1, UTF16Text(nm));
+		}
+
+	COREARRAY_CATCH
+}
+
 } // extern "C"